@@ -0,0 +1,49 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree. An additional grant
+ * of patent rights can be found in the PATENTS file in the same directory.
+ */
+
+#include "Analyses.h"
+
+#include "DexUtil.h"
+
+ClassScopeAnalysis::ClassScopeAnalysis(AnalysisManager&,
+                                       DexStoresVector& stores)
+    : scope(build_class_scope(stores)) {}
+
+TypeHierarchyAnalysis::TypeHierarchyAnalysis(AnalysisManager& am,
+                                             DexStoresVector& stores)
+    : hierarchy(
+          build_type_hierarchy(am.get<ClassScopeAnalysis>(stores).scope)) {}
+
+SignatureMapAnalysis::SignatureMapAnalysis(AnalysisManager& am,
+                                           DexStoresVector& stores)
+    : sig_map(build_signature_map(
+          am.get<TypeHierarchyAnalysis>(stores).hierarchy)) {}
+
+TypeSystemAnalysis::TypeSystemAnalysis(AnalysisManager& am,
+                                       DexStoresVector& stores)
+    : type_system(am.get<ClassScopeAnalysis>(stores).scope) {}
+
+VinfoAnalysis::VinfoAnalysis(AnalysisManager& am, DexStoresVector& stores)
+    : vinfo(am.get<ClassScopeAnalysis>(stores).scope) {}
+
+CallGraphAnalysis::CallGraphAnalysis(AnalysisManager& am,
+                                     DexStoresVector& stores)
+    : graph(am.get<ClassScopeAnalysis>(stores).scope) {}
+
+CodeSummaryAnalysis::CodeSummaryAnalysis(AnalysisManager& am,
+                                         DexStoresVector& stores)
+    : summaries(am.get<ClassScopeAnalysis>(stores).scope) {}
+
+MethodSummariesAnalysis::MethodSummariesAnalysis(AnalysisManager& am,
+                                                 DexStoresVector& stores)
+    : summaries(am.get<ClassScopeAnalysis>(stores).scope,
+                am.get<CallGraphAnalysis>(stores).graph) {}
+
+PurityAnalysis::PurityAnalysis(AnalysisManager& am, DexStoresVector& stores)
+    : pure_methods(am.get<ClassScopeAnalysis>(stores).scope) {}
@@ -0,0 +1,133 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree. An additional grant
+ * of patent rights can be found in the PATENTS file in the same directory.
+ */
+
+#pragma once
+
+#include "AnalysisManager.h"
+#include "CallGraph.h"
+#include "CodeSummary.h"
+#include "DexClass.h"
+#include "MethodSummaries.h"
+#include "Purity.h"
+#include "TypeSystem.h"
+#include "Vinfo.h"
+#include "VirtualScope.h"
+
+/**
+ * Whole-program analyses shared between passes through the AnalysisManager.
+ * They depend on the set of classes, their members and the hierarchy, but
+ * not on method bodies.
+ */
+
+/**
+ * All the classes in all the stores, as returned by build_class_scope().
+ */
+struct ClassScopeAnalysis : public Analysis {
+  static const char* name() { return "ClassScope"; }
+  ClassScopeAnalysis(AnalysisManager&, DexStoresVector& stores);
+
+  Scope scope;
+};
+
+/**
+ * The class hierarchy of the class scope, see build_type_hierarchy().
+ */
+struct TypeHierarchyAnalysis : public Analysis {
+  static const char* name() { return "TypeHierarchy"; }
+  TypeHierarchyAnalysis(AnalysisManager& am, DexStoresVector& stores);
+
+  ClassHierarchy hierarchy;
+};
+
+/**
+ * The virtual scopes of the class scope, see build_signature_map().
+ */
+struct SignatureMapAnalysis : public Analysis {
+  static const char* name() { return "SignatureMap"; }
+  SignatureMapAnalysis(AnalysisManager& am, DexStoresVector& stores);
+
+  SignatureMap sig_map;
+};
+
+/**
+ * Subtype queries over the class scope, see TypeSystem.
+ */
+struct TypeSystemAnalysis : public Analysis {
+  static const char* name() { return "TypeSystem"; }
+  TypeSystemAnalysis(AnalysisManager& am, DexStoresVector& stores);
+
+  TypeSystem type_system;
+};
+
+struct VinfoAnalysis : public Analysis {
+  static const char* name() { return "Vinfo"; }
+  VinfoAnalysis(AnalysisManager& am, DexStoresVector& stores);
+
+  Vinfo vinfo;
+};
+
+/**
+ * The call graph of the class scope, see CallGraph. Unlike the analyses above
+ * it depends on method bodies, so preserve_structural_analyses() leaves it
+ * out: only passes that keep it up to date as they edit code may preserve it.
+ */
+struct CallGraphAnalysis : public Analysis {
+  static const char* name() { return "CallGraph"; }
+  CallGraphAnalysis(AnalysisManager& am, DexStoresVector& stores);
+
+  CallGraph graph;
+};
+
+/**
+ * The CodeSummary of every method of the class scope. Like the call graph it
+ * depends on method bodies and is only preserved by passes that keep it up to
+ * date.
+ */
+struct CodeSummaryAnalysis : public Analysis {
+  static const char* name() { return "CodeSummary"; }
+  CodeSummaryAnalysis(AnalysisManager& am, DexStoresVector& stores);
+
+  CodeSummaries summaries;
+};
+
+/**
+ * Interprocedural constant and nullness summaries of the methods of the class
+ * scope, see MethodSummaries. Built from the call graph and the method bodies,
+ * so only preserved by passes that keep them up to date.
+ */
+struct MethodSummariesAnalysis : public Analysis {
+  static const char* name() { return "MethodSummaries"; }
+  MethodSummariesAnalysis(AnalysisManager& am, DexStoresVector& stores);
+
+  MethodSummaries summaries;
+};
+
+/**
+ * The methods proven free of side effects from their code, see PureMethods.
+ * Like the call graph it depends on method bodies.
+ */
+struct PurityAnalysis : public Analysis {
+  static const char* name() { return "Purity"; }
+  PurityAnalysis(AnalysisManager& am, DexStoresVector& stores);
+
+  PureMethods pure_methods;
+};
+
+/**
+ * Mark all the structural analyses above as preserved. Passes that only
+ * rewrite method bodies (no class, member or hierarchy changes) should call
+ * this from Pass::get_preserved_analyses().
+ */
+inline void preserve_structural_analyses(PreservedAnalyses& pa) {
+  pa.preserve<ClassScopeAnalysis>();
+  pa.preserve<TypeHierarchyAnalysis>();
+  pa.preserve<SignatureMapAnalysis>();
+  pa.preserve<TypeSystemAnalysis>();
+  pa.preserve<VinfoAnalysis>();
+}
@@ -0,0 +1,54 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree. An additional grant
+ * of patent rights can be found in the PATENTS file in the same directory.
+ */
+
+#include "AnalysisManager.h"
+
+#include "Trace.h"
+
+void AnalysisManager::invalidate(const std::type_index& id) {
+  auto it = m_cache.find(id);
+  if (it != m_cache.end()) {
+    TRACE(PM, 2, "Invalidating analysis %s\n", it->second.name.c_str());
+    ++m_stats[it->second.name].invalidations;
+    m_cache.erase(it);
+  }
+  auto deps = m_dependents.find(id);
+  if (deps == m_dependents.end()) {
+    return;
+  }
+  auto dependents = std::move(deps->second);
+  m_dependents.erase(deps);
+  for (const auto& dependent : dependents) {
+    invalidate(dependent);
+  }
+}
+
+void AnalysisManager::invalidate(const PreservedAnalyses& preserved) {
+  std::vector<std::type_index> stale;
+  for (const auto& it : m_cache) {
+    if (!preserved.is_preserved(it.first)) {
+      stale.push_back(it.first);
+    }
+  }
+  for (const auto& id : stale) {
+    invalidate(id);
+  }
+}
+
+void AnalysisManager::invalidate_all() {
+  invalidate(PreservedAnalyses());
+}
+
+AnalysisManager::Stats AnalysisManager::get_total_stats() const {
+  Stats total;
+  for (const auto& it : m_stats) {
+    total += it.second;
+  }
+  return total;
+}
@@ -0,0 +1,192 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree. An additional grant
+ * of patent rights can be found in the PATENTS file in the same directory.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <map>
+#include <memory>
+#include <string>
+#include <typeindex>
+#include <typeinfo>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "Timer.h"
+
+class DexStore;
+using DexStoresVector = std::vector<DexStore>;
+class AnalysisManager;
+
+/**
+ * Base class of all the results memoized by the AnalysisManager.
+ *
+ * A concrete analysis T derives from Analysis and provides
+ *
+ *   static const char* name();
+ *   T(AnalysisManager& am, DexStoresVector& stores);
+ *
+ * The constructor computes the result. It may request other analyses from
+ * `am`; those are recorded as dependencies so that invalidating one of them
+ * also drops T.
+ */
+class Analysis {
+ public:
+  virtual ~Analysis() {}
+};
+
+/**
+ * The set of analyses a pass leaves valid once it has run. Every cached
+ * analysis that is not preserved is invalidated by the PassManager right
+ * after the pass' run_pass returns.
+ *
+ * Preservation does not protect an analysis from the invalidation of one of
+ * its dependencies: if a pass preserves the SignatureMapAnalysis but not the
+ * TypeHierarchyAnalysis it is built from, both are dropped.
+ */
+class PreservedAnalyses {
+ public:
+  template <class T>
+  void preserve() {
+    m_preserved.emplace(typeid(T));
+  }
+
+  void preserve_all() { m_all = true; }
+
+  bool is_preserved(const std::type_index& id) const {
+    return m_all || m_preserved.count(id) > 0;
+  }
+
+  template <class T>
+  bool is_preserved() const {
+    return is_preserved(std::type_index(typeid(T)));
+  }
+
+ private:
+  bool m_all{false};
+  std::unordered_set<std::type_index> m_preserved;
+};
+
+/**
+ * Memoizes analyses by type across passes.
+ *
+ * Passes don't normally talk to the AnalysisManager directly but go through
+ * PassManager::get_analysis<T>(), which forwards here.
+ */
+class AnalysisManager {
+ public:
+  struct Stats {
+    // number of times the analysis was computed
+    size_t builds{0};
+    // number of requests served from the cache
+    size_t hits{0};
+    // number of times a computed result was thrown away
+    size_t invalidations{0};
+    // total time spent computing the analysis
+    double build_secs{0};
+
+    Stats& operator+=(const Stats& that) {
+      builds += that.builds;
+      hits += that.hits;
+      invalidations += that.invalidations;
+      build_secs += that.build_secs;
+      return *this;
+    }
+  };
+
+  /**
+   * Return the result of analysis T, computing it if there is no valid
+   * cached result.
+   */
+  template <class T>
+  T& get(DexStoresVector& stores);
+
+  template <class T>
+  bool is_cached() const {
+    return m_cache.count(std::type_index(typeid(T))) > 0;
+  }
+
+  /**
+   * Drop analysis T and everything that was built on top of it.
+   */
+  template <class T>
+  void invalidate() {
+    invalidate(std::type_index(typeid(T)));
+  }
+
+  /**
+   * Drop every cached analysis that is not in `preserved`.
+   */
+  void invalidate(const PreservedAnalyses& preserved);
+
+  void invalidate_all();
+
+  /**
+   * Per analysis statistics, keyed by analysis name.
+   */
+  const std::map<std::string, Stats>& get_stats() const { return m_stats; }
+
+  Stats get_total_stats() const;
+
+ private:
+  void invalidate(const std::type_index& id);
+
+  struct Entry {
+    std::unique_ptr<Analysis> result;
+    std::string name;
+  };
+
+  std::unordered_map<std::type_index, Entry> m_cache;
+  // analysis -> analyses that requested it while being computed
+  std::unordered_map<std::type_index, std::unordered_set<std::type_index>>
+      m_dependents;
+  // analyses currently being computed, innermost last
+  std::vector<std::type_index> m_building;
+  std::map<std::string, Stats> m_stats;
+};
+
+template <class T>
+T& AnalysisManager::get(DexStoresVector& stores) {
+  std::type_index id(typeid(T));
+  if (!m_building.empty()) {
+    m_dependents[id].insert(m_building.back());
+  }
+  auto& stats = m_stats[T::name()];
+  auto it = m_cache.find(id);
+  if (it != m_cache.end()) {
+    ++stats.hits;
+    return static_cast<T&>(*it->second.result);
+  }
+
+  struct BuildingScope {
+    std::vector<std::type_index>& building;
+    BuildingScope(std::vector<std::type_index>& b, const std::type_index& id)
+        : building(b) {
+      building.push_back(id);
+    }
+    ~BuildingScope() { building.pop_back(); }
+  };
+
+  std::unique_ptr<Analysis> result;
+  auto start = std::chrono::high_resolution_clock::now();
+  {
+    BuildingScope scope(m_building, id);
+    Timer t(std::string("Building analysis ") + T::name());
+    result.reset(new T(*this, stores));
+  }
+  auto end = std::chrono::high_resolution_clock::now();
+  ++stats.builds;
+  stats.build_secs += std::chrono::duration<double>(end - start).count();
+
+  auto& entry = m_cache[id];
+  entry.result = std::move(result);
+  entry.name = T::name();
+  return static_cast<T&>(*entry.result);
+}
@@ -0,0 +1,251 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree. An additional grant
+ * of patent rights can be found in the PATENTS file in the same directory.
+ */
+
+#include "CallGraph.h"
+
+#include <algorithm>
+#include <unordered_set>
+
+#include "DexUtil.h"
+#include "MethodCosts.h"
+#include "Resolver.h"
+#include "Transform.h"
+#include "Walkers.h"
+#include "WorkQueue.h"
+
+namespace {
+
+using ResolvedInvokes =
+    std::vector<std::pair<IRMethodInstruction*, DexMethod*>>;
+
+ResolvedInvokes resolve_invokes(DexMethod* method) {
+  ResolvedInvokes invokes;
+  for (auto& mie : InstructionIterable(method->get_code())) {
+    auto insn = mie.insn;
+    if (!is_invoke(insn->opcode())) {
+      continue;
+    }
+    auto mop = static_cast<IRMethodInstruction*>(insn);
+    auto callee = resolve_method_cached(mop->get_method(),
+                                        opcode_to_search(insn));
+    if (callee != nullptr) {
+      invokes.emplace_back(mop, callee);
+    }
+  }
+  return invokes;
+}
+
+struct ResolveWork {
+  DexMethod* method;
+  ResolvedInvokes invokes;
+};
+
+void resolve_work(void* arg) {
+  auto work = static_cast<ResolveWork*>(arg);
+  MethodCostScope cost(work->method);
+  work->invokes = resolve_invokes(work->method);
+}
+
+}
+
+CallGraph::CallGraph(const Scope& scope) {
+  // Number the methods of the scope first so that node ids, and thus the
+  // order of the call sites, don't depend on thread scheduling.
+  std::vector<ResolveWork> work;
+  walk_methods(scope, [&](DexMethod* method) {
+    get_or_add_node(method);
+    if (method->get_code() != nullptr) {
+      work.push_back(ResolveWork{method, {}});
+    }
+  });
+  std::vector<work_item> work_items;
+  work_items.reserve(work.size());
+  for (auto& w : work) {
+    work_items.push_back(work_item{resolve_work, &w});
+  }
+  WorkQueue wq;
+  wq.run_work_items(work_items.data(), (int)work_items.size());
+
+  for (auto& w : work) {
+    auto caller_id = m_node_ids.at(w.method);
+    m_nodes[caller_id].out_begin = m_callsites.size();
+    for (const auto& invoke : w.invokes) {
+      get_or_add_node(invoke.second).num_callers++;
+      m_callsites.push_back(
+          CallSite{w.method, invoke.second, invoke.first, false});
+    }
+    m_nodes[caller_id].out_end = m_callsites.size();
+    ResolvedInvokes().swap(w.invokes);
+  }
+  m_num_live = m_callsites.size();
+
+  // Group the call sites by callee.
+  uint32_t offset = 0;
+  for (auto& node : m_nodes) {
+    node.in_begin = node.in_end = offset;
+    offset += node.num_callers;
+  }
+  m_in_edges.resize(m_callsites.size());
+  for (CallSiteId id = 0; id < m_callsites.size(); ++id) {
+    auto& callee = m_nodes[m_node_ids.at(m_callsites[id].callee)];
+    m_in_edges[callee.in_end++] = id;
+  }
+}
+
+const CallGraph::Node* CallGraph::find_node(const DexMethod* method) const {
+  auto it = m_node_ids.find(method);
+  return it == m_node_ids.end() ? nullptr : &m_nodes[it->second];
+}
+
+CallGraph::Node& CallGraph::get_or_add_node(const DexMethod* method) {
+  auto it = m_node_ids.emplace(method, m_nodes.size());
+  if (it.second) {
+    m_nodes.emplace_back();
+  }
+  return m_nodes[it.first->second];
+}
+
+size_t CallGraph::num_callsites_of(const DexMethod* callee) const {
+  auto node = find_node(callee);
+  return node == nullptr ? 0 : node->num_callers;
+}
+
+void CallGraph::remove_callsite(CallSiteId id) {
+  auto& site = m_callsites[id];
+  always_assert(!site.removed);
+  site.removed = true;
+  m_nodes[m_node_ids.at(site.callee)].num_callers--;
+  m_num_live--;
+}
+
+void CallGraph::add_callsite(DexMethod* caller,
+                             DexMethod* callee,
+                             IRMethodInstruction* insn) {
+  CallSiteId id = m_callsites.size();
+  m_callsites.push_back(CallSite{caller, callee, insn, false});
+  m_num_live++;
+  // Look the caller up after adding the callee, which may grow m_nodes.
+  auto& callee_node = get_or_add_node(callee);
+  callee_node.num_callers++;
+  callee_node.extra_in.push_back(id);
+  get_or_add_node(caller).extra_out.push_back(id);
+}
+
+void CallGraph::update_callsites(DexMethod* caller) {
+  auto& node = get_or_add_node(caller);
+  for (auto id = node.out_begin; id < node.out_end; ++id) {
+    if (!m_callsites[id].removed) {
+      remove_callsite(id);
+    }
+  }
+  for (auto id : node.extra_out) {
+    if (!m_callsites[id].removed) {
+      remove_callsite(id);
+    }
+  }
+  node.out_begin = node.out_end = 0;
+  node.extra_out.clear();
+  if (caller->get_code() == nullptr) {
+    return;
+  }
+  for (const auto& invoke : resolve_invokes(caller)) {
+    add_callsite(caller, invoke.second, invoke.first);
+  }
+}
+
+CallLevels call_levels(
+    const std::vector<DexMethod*>& methods,
+    const std::function<const std::vector<DexMethod*>&(DexMethod*)>&
+        callees_of) {
+  // Tarjan's algorithm, without recursion as call chains can be deep. It
+  // finds the strongly connected components callees first, so the level of
+  // all the callees outside of a component is known once it is complete.
+  struct Frame {
+    DexMethod* method;
+    const std::vector<DexMethod*>* callees;
+    size_t next_callee;
+  };
+  CallLevels result;
+  auto& component = result.component;
+  size_t next_index = 0;
+  std::unordered_map<DexMethod*, size_t> index;
+  std::unordered_map<DexMethod*, size_t> lowlink;
+  std::unordered_map<DexMethod*, size_t> level;
+  std::vector<DexMethod*> stack;
+  std::unordered_set<DexMethod*> on_stack;
+  std::vector<Frame> frames;
+  size_t num_components = 0;
+
+  auto push = [&](DexMethod* method) {
+    index[method] = lowlink[method] = next_index++;
+    stack.push_back(method);
+    on_stack.insert(method);
+    frames.push_back(Frame{method, &callees_of(method), 0});
+  };
+  auto pop_component = [&](DexMethod* root) {
+    std::vector<DexMethod*> members;
+    DexMethod* member;
+    do {
+      member = stack.back();
+      stack.pop_back();
+      on_stack.erase(member);
+      component[member] = num_components;
+      members.push_back(member);
+    } while (member != root);
+    size_t component_level = 0;
+    for (auto caller : members) {
+      for (auto callee : callees_of(caller)) {
+        if (component.at(callee) != num_components) {
+          component_level = std::max(component_level, level.at(callee) + 1);
+        }
+      }
+    }
+    for (auto m : members) {
+      level[m] = component_level;
+    }
+    num_components++;
+  };
+
+  for (auto root : methods) {
+    if (index.count(root)) continue;
+    push(root);
+    while (!frames.empty()) {
+      auto& frame = frames.back();
+      if (frame.next_callee < frame.callees->size()) {
+        auto callee = (*frame.callees)[frame.next_callee++];
+        if (!index.count(callee)) {
+          push(callee);
+        } else if (on_stack.count(callee)) {
+          lowlink[frame.method] =
+              std::min(lowlink[frame.method], index[callee]);
+        }
+        continue;
+      }
+      auto method = frame.method;
+      frames.pop_back();
+      if (!frames.empty()) {
+        auto caller = frames.back().method;
+        lowlink[caller] = std::min(lowlink[caller], lowlink[method]);
+      }
+      if (lowlink[method] == index[method]) {
+        pop_component(method);
+      }
+    }
+  }
+
+  auto& levels = result.levels;
+  for (auto method : methods) {
+    auto method_level = level.at(method);
+    if (levels.size() <= method_level) {
+      levels.resize(method_level + 1);
+    }
+    levels[method_level].push_back(method);
+  }
+  return result;
+}
@@ -0,0 +1,182 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree. An additional grant
+ * of patent rights can be found in the PATENTS file in the same directory.
+ */
+
+#pragma once
+
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+#include "DexClass.h"
+#include "IRInstruction.h"
+
+/**
+ * The invokes of a scope, resolved to method definitions.
+ *
+ * Every invoke whose target resolves (through the shared method ref cache) is
+ * a call site. Invokes that do not resolve are left out, and resolved targets
+ * may be abstract, native or external: clients that need code check
+ * is_concrete() themselves.
+ *
+ * The graph is built in parallel, one work item per method, and stored in
+ * compressed sparse row form: the call sites of a caller are contiguous and in
+ * code order, and the call sites of each callee are a contiguous range of an
+ * index. Call sites are identified by a CallSiteId that stays valid for the
+ * lifetime of the graph, so that they can be removed in constant time.
+ *
+ * Passes that edit code keep the graph consistent by removing the call sites
+ * they get rid of and by calling update_callsites() on the methods whose
+ * invokes they changed; the call sites added that way go to per-method
+ * overflow lists rather than to the compressed rows.
+ */
+class CallGraph {
+ public:
+  using CallSiteId = uint32_t;
+
+  struct CallSite {
+    DexMethod* caller;
+    DexMethod* callee;
+    IRMethodInstruction* insn;
+    bool removed;
+  };
+
+  explicit CallGraph(const Scope& scope);
+
+  CallGraph(const CallGraph&) = delete;
+  CallGraph& operator=(const CallGraph&) = delete;
+
+  const CallSite& callsite(CallSiteId id) const { return m_callsites[id]; }
+
+  /**
+   * Call fn(CallSiteId, const CallSite&) for each call site, in the order
+   * they were added: callers in scope order and the call sites of each caller
+   * in code order, followed by those added by update_callsites().
+   */
+  template <class Fn>
+  void for_each_callsite(Fn fn) const;
+
+  /**
+   * Call fn(CallSiteId, const CallSite&) for each call site in caller, in code
+   * order.
+   */
+  template <class Fn>
+  void for_each_callsite_in(const DexMethod* caller, Fn fn) const;
+
+  /**
+   * Call fn(CallSiteId, const CallSite&) for each call site invoking callee.
+   */
+  template <class Fn>
+  void for_each_callsite_of(const DexMethod* callee, Fn fn) const;
+
+  /**
+   * Number of call sites invoking callee.
+   */
+  size_t num_callsites_of(const DexMethod* callee) const;
+
+  size_t num_callsites() const { return m_num_live; }
+
+  void remove_callsite(CallSiteId id);
+
+  /**
+   * Replace the call sites of caller with the invokes currently in its code.
+   */
+  void update_callsites(DexMethod* caller);
+
+ private:
+  struct Node {
+    // call sites built with the graph, [out_begin, out_end) of m_callsites
+    // and [in_begin, in_end) of m_in_edges
+    CallSiteId out_begin{0};
+    CallSiteId out_end{0};
+    uint32_t in_begin{0};
+    uint32_t in_end{0};
+    // call sites invoking this method that are not removed
+    uint32_t num_callers{0};
+    // call sites added by update_callsites()
+    std::vector<CallSiteId> extra_out;
+    std::vector<CallSiteId> extra_in;
+  };
+
+  const Node* find_node(const DexMethod* method) const;
+  Node& get_or_add_node(const DexMethod* method);
+  void add_callsite(DexMethod* caller,
+                    DexMethod* callee,
+                    IRMethodInstruction* insn);
+
+  std::vector<Node> m_nodes;
+  std::unordered_map<const DexMethod*, uint32_t> m_node_ids;
+  std::vector<CallSite> m_callsites;
+  std::vector<CallSiteId> m_in_edges;
+  size_t m_num_live{0};
+};
+
+/**
+ * The strongly connected components of the calls from methods, and from
+ * everything they reach through callees_of, grouped into levels: a component
+ * is one level above the highest level it calls. Bottom up passes process a
+ * level once the levels below it are done.
+ */
+struct CallLevels {
+  // the component of every method reached
+  std::unordered_map<const DexMethod*, size_t> component;
+  // the given methods by level, in the order they were given
+  std::vector<std::vector<DexMethod*>> levels;
+};
+
+CallLevels call_levels(
+    const std::vector<DexMethod*>& methods,
+    const std::function<const std::vector<DexMethod*>&(DexMethod*)>&
+        callees_of);
+
+template <class Fn>
+void CallGraph::for_each_callsite(Fn fn) const {
+  for (CallSiteId id = 0; id < m_callsites.size(); ++id) {
+    const auto& site = m_callsites[id];
+    if (!site.removed) {
+      fn(id, site);
+    }
+  }
+}
+
+template <class Fn>
+void CallGraph::for_each_callsite_in(const DexMethod* caller, Fn fn) const {
+  auto node = find_node(caller);
+  if (node == nullptr) {
+    return;
+  }
+  for (auto id = node->out_begin; id < node->out_end; ++id) {
+    if (!m_callsites[id].removed) {
+      fn(id, m_callsites[id]);
+    }
+  }
+  for (auto id : node->extra_out) {
+    if (!m_callsites[id].removed) {
+      fn(id, m_callsites[id]);
+    }
+  }
+}
+
+template <class Fn>
+void CallGraph::for_each_callsite_of(const DexMethod* callee, Fn fn) const {
+  auto node = find_node(callee);
+  if (node == nullptr) {
+    return;
+  }
+  for (auto i = node->in_begin; i < node->in_end; ++i) {
+    auto id = m_in_edges[i];
+    if (!m_callsites[id].removed) {
+      fn(id, m_callsites[id]);
+    }
+  }
+  for (auto id : node->extra_in) {
+    if (!m_callsites[id].removed) {
+      fn(id, m_callsites[id]);
+    }
+  }
+}
@@ -0,0 +1,216 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree. An additional grant
+ * of patent rights can be found in the PATENTS file in the same directory.
+ */
+
+#include "ClassHierarchyIndex.h"
+
+#include <utility>
+
+constexpr ClassHierarchyIndex::type_id ClassHierarchyIndex::NO_TYPE;
+
+namespace {
+
+pthread_rwlock_t* read_lock(pthread_rwlock_t* lock) {
+  pthread_rwlock_rdlock(lock);
+  return lock;
+}
+
+pthread_rwlock_t* write_lock(pthread_rwlock_t* lock) {
+  pthread_rwlock_wrlock(lock);
+  return lock;
+}
+
+// Releases the lock, taken either way, at the end of the scope.
+class Unlock {
+ public:
+  explicit Unlock(pthread_rwlock_t* lock) : m_lock(lock) {}
+  ~Unlock() { pthread_rwlock_unlock(m_lock); }
+
+ private:
+  pthread_rwlock_t* m_lock;
+};
+
+}
+
+ClassHierarchyIndex::type_id ClassHierarchyIndex::intern(
+    const DexType* type) {
+  auto id = find_id(type);
+  if (id != NO_TYPE) {
+    return id;
+  }
+  id = m_types.size();
+  m_ids.emplace(type, id);
+  m_types.push_back(type);
+  m_super.push_back(NO_TYPE);
+  m_added_at.push_back(NO_TYPE);
+  m_dirty = true;
+  return id;
+}
+
+void ClassHierarchyIndex::add_class(const DexType* type,
+                                    const DexType* super) {
+  Unlock unlock(write_lock(&m_lock));
+  auto id = intern(type);
+  if (m_added_at[id] != NO_TYPE) {
+    return;
+  }
+  m_super[id] = super != nullptr ? intern(super) : NO_TYPE;
+  m_added_at[id] = m_added.size();
+  m_added.push_back(id);
+  m_dirty = true;
+}
+
+void ClassHierarchyIndex::remove_class(const DexType* type) {
+  Unlock unlock(write_lock(&m_lock));
+  auto id = find_id(type);
+  if (id == NO_TYPE || m_added_at[id] == NO_TYPE) {
+    return;
+  }
+  m_super[id] = NO_TYPE;
+  m_added_at[id] = NO_TYPE;
+  m_dirty = true;
+}
+
+ClassHierarchyIndex::type_id ClassHierarchyIndex::get_id(
+    const DexType* type) const {
+  Unlock unlock(read_lock(&m_lock));
+  return find_id(type);
+}
+
+const DexType* ClassHierarchyIndex::get_type(type_id id) const {
+  Unlock unlock(read_lock(&m_lock));
+  return m_types[id];
+}
+
+size_t ClassHierarchyIndex::size() const {
+  Unlock unlock(read_lock(&m_lock));
+  return m_types.size();
+}
+
+const DexType* ClassHierarchyIndex::get_super(const DexType* type) const {
+  Unlock unlock(read_lock(&m_lock));
+  auto id = find_id(type);
+  if (id == NO_TYPE || m_super[id] == NO_TYPE) {
+    return nullptr;
+  }
+  return m_types[m_super[id]];
+}
+
+ClassHierarchyIndex::TypeRange ClassHierarchyIndex::get_children(
+    const DexType* type) {
+  Unlock unlock(read_lock_built());
+  auto id = find_id(type);
+  if (id == NO_TYPE) {
+    return TypeRange(nullptr, nullptr);
+  }
+  auto data = m_children.data();
+  return TypeRange(data + m_child_offsets[id], data + m_child_offsets[id + 1]);
+}
+
+bool ClassHierarchyIndex::is_subclass(const DexType* parent,
+                                      const DexType* child) {
+  if (parent == child) {
+    return true;
+  }
+  Unlock unlock(read_lock_built());
+  auto pid = find_id(parent);
+  auto cid = find_id(child);
+  if (pid == NO_TYPE || cid == NO_TYPE) {
+    return false;
+  }
+  return m_pre[pid] <= m_pre[cid] && m_post[cid] <= m_post[pid];
+}
+
+void ClassHierarchyIndex::get_intervals(std::vector<uint32_t>& pre,
+                                        std::vector<uint32_t>& post) {
+  Unlock unlock(read_lock_built());
+  pre = m_pre;
+  post = m_post;
+}
+
+pthread_rwlock_t* ClassHierarchyIndex::read_lock_built() {
+  read_lock(&m_lock);
+  while (m_dirty) {
+    // Another thread may get the exclusive lock first and either rebuild or
+    // mutate the index again, hence the loop.
+    pthread_rwlock_unlock(&m_lock);
+    {
+      Unlock unlock(write_lock(&m_lock));
+      if (m_dirty) {
+        build();
+      }
+    }
+    read_lock(&m_lock);
+  }
+  return &m_lock;
+}
+
+void ClassHierarchyIndex::build() {
+  size_t n = m_types.size();
+
+  // Drop the entries of classes that were removed (or removed and added
+  // again) since the last build.
+  std::vector<type_id> added;
+  added.reserve(m_added.size());
+  for (size_t i = 0; i < m_added.size(); ++i) {
+    auto id = m_added[i];
+    if (m_added_at[id] == i) {
+      m_added_at[id] = added.size();
+      added.push_back(id);
+    }
+  }
+  m_added.swap(added);
+
+  // Children in CSR form, each list in the order classes were added.
+  m_child_offsets.assign(n + 1, 0);
+  for (auto id : m_added) {
+    if (m_super[id] != NO_TYPE) {
+      ++m_child_offsets[m_super[id] + 1];
+    }
+  }
+  for (size_t i = 0; i < n; ++i) {
+    m_child_offsets[i + 1] += m_child_offsets[i];
+  }
+  m_child_ids.resize(m_child_offsets[n]);
+  m_children.resize(m_child_offsets[n]);
+  std::vector<uint32_t> fill(m_child_offsets.begin(), m_child_offsets.end() - 1);
+  for (auto id : m_added) {
+    auto super = m_super[id];
+    if (super != NO_TYPE) {
+      auto pos = fill[super]++;
+      m_child_ids[pos] = id;
+      m_children[pos] = m_types[id];
+    }
+  }
+
+  // DFS numbering of the forest. A type is a subclass of another iff its
+  // [pre, post] interval is nested in the other's.
+  m_pre.assign(n, 0);
+  m_post.assign(n, 0);
+  uint32_t clock = 0;
+  std::vector<std::pair<type_id, uint32_t>> stack;
+  for (type_id root = 0; root < n; ++root) {
+    if (m_super[root] != NO_TYPE) {
+      continue;
+    }
+    m_pre[root] = clock++;
+    stack.emplace_back(root, m_child_offsets[root]);
+    while (!stack.empty()) {
+      auto& top = stack.back();
+      if (top.second < m_child_offsets[top.first + 1]) {
+        auto child = m_child_ids[top.second++];
+        m_pre[child] = clock++;
+        stack.emplace_back(child, m_child_offsets[child]);
+      } else {
+        m_post[top.first] = clock++;
+        stack.pop_back();
+      }
+    }
+  }
+  m_dirty = false;
+}
@@ -0,0 +1,142 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree. An additional grant
+ * of patent rights can be found in the PATENTS file in the same directory.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <pthread.h>
+#include <unordered_map>
+#include <vector>
+
+class DexType;
+
+/**
+ * Compact, read-mostly representation of the class (superclass) hierarchy
+ * known to redex. RedexContext owns the single instance and keeps it up to
+ * date as classes enter and leave the type system.
+ *
+ * Every type seen, either as a class or as the superclass of one, gets a
+ * dense id in the order it is first seen. The superclass edges live in a flat
+ * array indexed by id and are updated in O(1) when a class is added or
+ * removed. The derived data, i.e. the children of every type in CSR form and
+ * the DFS pre/post numbering of the forest, is recomputed in linear time on
+ * the first query following a change. With the numbering in place
+ * is_subclass() is two integer compares.
+ *
+ * All the methods are thread safe: mutations take the lock of the index
+ * exclusively, and queries take it shared. The first query after a mutation
+ * upgrades to the exclusive lock for the rebuild, so concurrent queries never
+ * see the derived data being reassigned. A TypeRange outlives the lock
+ * though, so it must not be held across a mutation made by another thread.
+ */
+class ClassHierarchyIndex {
+ public:
+  using type_id = uint32_t;
+  static constexpr type_id NO_TYPE = std::numeric_limits<type_id>::max();
+
+  /**
+   * A view over a contiguous run of types, only valid until the next
+   * mutation of the index.
+   */
+  class TypeRange {
+   public:
+    TypeRange(const DexType* const* begin, const DexType* const* end)
+        : m_begin(begin), m_end(end) {}
+    const DexType* const* begin() const { return m_begin; }
+    const DexType* const* end() const { return m_end; }
+    size_t size() const { return m_end - m_begin; }
+    bool empty() const { return m_begin == m_end; }
+
+   private:
+    const DexType* const* m_begin;
+    const DexType* const* m_end;
+  };
+
+  /**
+   * Record `type` as a class extending `super` (which may be null for
+   * java.lang.Object). Adding a type that is already a class is a no-op.
+   */
+  void add_class(const DexType* type, const DexType* super);
+
+  /**
+   * Detach `type` from its superclass. The id of the type stays valid.
+   */
+  void remove_class(const DexType* type);
+
+  /**
+   * Direct subclasses of `type`, in the order they were added.
+   */
+  TypeRange get_children(const DexType* type);
+
+  /**
+   * True if `child` is `parent` or a (transitive) subclass of it.
+   */
+  bool is_subclass(const DexType* parent, const DexType* child);
+
+  /**
+   * The superclass of `type` as recorded in the index, or nullptr.
+   */
+  const DexType* get_super(const DexType* type) const;
+
+  /**
+   * Copy out the DFS [pre, post] interval of every type, indexed by id: a
+   * type is a subclass of another iff its interval is nested in the other's.
+   * For callers that snapshot a hierarchy they no longer mutate and want to
+   * query it without the lock.
+   */
+  void get_intervals(std::vector<uint32_t>& pre, std::vector<uint32_t>& post);
+
+  type_id get_id(const DexType* type) const;
+
+  const DexType* get_type(type_id id) const;
+
+  size_t size() const;
+
+  ClassHierarchyIndex() { pthread_rwlock_init(&m_lock, nullptr); }
+  ~ClassHierarchyIndex() { pthread_rwlock_destroy(&m_lock); }
+
+  ClassHierarchyIndex(const ClassHierarchyIndex&) = delete;
+  ClassHierarchyIndex& operator=(const ClassHierarchyIndex&) = delete;
+
+ private:
+  // callers hold m_lock exclusively
+  type_id intern(const DexType* type);
+  void build();
+
+  // callers hold m_lock
+  type_id find_id(const DexType* type) const {
+    auto it = m_ids.find(type);
+    return it == m_ids.end() ? NO_TYPE : it->second;
+  }
+
+  /*
+   * Take m_lock shared, with the derived data up to date.
+   */
+  pthread_rwlock_t* read_lock_built();
+
+  std::unordered_map<const DexType*, type_id> m_ids;
+  std::vector<const DexType*> m_types;
+  // id -> id of the superclass, NO_TYPE for roots and removed classes
+  std::vector<type_id> m_super;
+  // id -> position in m_added when the type was last added as a class,
+  // NO_TYPE if the type is not (or no longer) a class
+  std::vector<type_id> m_added_at;
+  // ids in the order they were added as classes, may hold stale entries
+  std::vector<type_id> m_added;
+
+  // derived data, rebuilt by build()
+  std::vector<uint32_t> m_child_offsets;
+  std::vector<type_id> m_child_ids;
+  std::vector<const DexType*> m_children;
+  std::vector<uint32_t> m_pre;
+  std::vector<uint32_t> m_post;
+  bool m_dirty{false};
+  mutable pthread_rwlock_t m_lock;
+};
@@ -0,0 +1,115 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree. An additional grant
+ * of patent rights can be found in the PATENTS file in the same directory.
+ */
+
+#include "CodeSummary.h"
+
+#include "DexUtil.h"
+#include "MethodCosts.h"
+#include "Resolver.h"
+#include "Transform.h"
+#include "Walkers.h"
+#include "WorkQueue.h"
+
+namespace {
+
+bool is_public_ref(IRInstruction* insn) {
+  if (insn->has_fields()) {
+    auto field = static_cast<IRFieldInstruction*>(insn)->field();
+    field = resolve_field_cached(field, is_sfield_op(insn->opcode())
+        ? FieldSearch::Static : FieldSearch::Instance);
+    return field != nullptr && is_public(field);
+  }
+  auto method = static_cast<IRMethodInstruction*>(insn)->get_method();
+  auto op = insn->opcode();
+  if ((op == OPCODE_INVOKE_DIRECT || op == OPCODE_INVOKE_DIRECT_RANGE) &&
+      !is_init(method)) {
+    return false;
+  }
+  method = resolve_method_cached(method, opcode_to_search(insn));
+  return method != nullptr && is_public(method);
+}
+
+struct SummaryWork {
+  const DexMethod* method;
+  CodeSummary* summary;
+};
+
+void summary_work(void* arg) {
+  auto work = static_cast<SummaryWork*>(arg);
+  MethodCostScope cost(work->method);
+  *work->summary = summarize(*work->method->get_code());
+}
+
+}
+
+CodeSummary summarize(const IRCode& code) {
+  CodeSummary summary;
+  summary.registers = code.get_registers_size();
+  summary.ins = code.get_ins_size();
+  size_t returns = 0;
+  for (const auto& mie : code) {
+    if (mie.type == MFLOW_CATCH) {
+      auto type = mie.centry->catch_type;
+      auto cls = type == nullptr ? nullptr : type_class(type);
+      if (cls != nullptr && cls->is_external() && !is_public(cls)) {
+        summary.nonpublic_external_catch = true;
+      }
+      continue;
+    }
+    if (mie.type != MFLOW_OPCODE) {
+      continue;
+    }
+    auto insn = mie.insn;
+    auto op = insn->opcode();
+    summary.insn_count++;
+    summary.insn_size += insn->size();
+    if (op == OPCODE_THROW) {
+      summary.throws = true;
+    } else if (is_return(op)) {
+      returns++;
+    } else if (op == OPCODE_INVOKE_SUPER || op == OPCODE_INVOKE_SUPER_RANGE) {
+      summary.invokes_super = true;
+    }
+    if ((insn->has_fields() || insn->has_methods()) && !is_public_ref(insn)) {
+      summary.nonpublic_refs++;
+    }
+  }
+  summary.multiple_returns = returns > 1;
+  return summary;
+}
+
+CodeSummaries::CodeSummaries(const Scope& scope) {
+  // Insert every method up front: the work items only write to their own
+  // summary, and update() never rehashes the table.
+  std::vector<SummaryWork> work;
+  walk_methods(scope, [&](DexMethod* method) {
+    if (method->get_code() != nullptr) {
+      work.push_back(SummaryWork{method, &m_summaries[method]});
+    }
+  });
+  std::vector<work_item> work_items;
+  work_items.reserve(work.size());
+  for (auto& w : work) {
+    work_items.push_back(work_item{summary_work, &w});
+  }
+  WorkQueue wq;
+  wq.run_work_items(work_items.data(), (int)work_items.size());
+}
+
+const CodeSummary& CodeSummaries::get(const DexMethod* method) const {
+  auto it = m_summaries.find(method);
+  always_assert_log(it != m_summaries.end(), "no summary for %s", SHOW(method));
+  return it->second;
+}
+
+void CodeSummaries::update(DexMethod* method) {
+  auto it = m_summaries.find(method);
+  always_assert_log(it != m_summaries.end(), "no summary for %s", SHOW(method));
+  it->second = summarize(*method->get_code());
+}
@@ -0,0 +1,72 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree. An additional grant
+ * of patent rights can be found in the PATENTS file in the same directory.
+ */
+
+#pragma once
+
+#include <unordered_map>
+
+#include "DexClass.h"
+
+class IRCode;
+
+/**
+ * Facts about the code of a method that the inliner asks for over and over,
+ * gathered in a single walk of the instructions.
+ */
+struct CodeSummary {
+  // IRCode::count_opcodes()
+  uint32_t insn_count{0};
+  // IRCode::sum_opcode_sizes()
+  uint32_t insn_size{0};
+  uint16_t registers{0};
+  uint16_t ins{0};
+  bool throws{false};
+  bool multiple_returns{false};
+  bool invokes_super{false};
+  // catches an external type that is not public
+  bool nonpublic_external_catch{false};
+  // Field and method references that do not resolve to a public definition,
+  // including the ones that do not resolve at all. invoke-direct of anything
+  // but a constructor counts too, whatever the visibility of the target, as
+  // the inliner may have to make it static.
+  //
+  // Visibility is only ever relaxed, so a count that is out of date because
+  // members were made public since is too large, never too small.
+  uint32_t nonpublic_refs{0};
+};
+
+CodeSummary summarize(const IRCode& code);
+
+/**
+ * The CodeSummary of every method with code in a scope, computed in parallel.
+ *
+ * Passes that edit code call update() on the methods they changed. update()
+ * of distinct methods that were in the scope may run concurrently, and
+ * concurrently with get() of other methods.
+ */
+class CodeSummaries {
+ public:
+  explicit CodeSummaries(const Scope& scope);
+
+  CodeSummaries(const CodeSummaries&) = delete;
+  CodeSummaries& operator=(const CodeSummaries&) = delete;
+
+  /**
+   * The summary of a method with code.
+   */
+  const CodeSummary& get(const DexMethod* method) const;
+
+  /**
+   * Summarize the code of the method again.
+   */
+  void update(DexMethod* method);
+
+ private:
+  std::unordered_map<const DexMethod*, CodeSummary> m_summaries;
+};
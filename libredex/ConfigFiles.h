@@ -18,6 +18,7 @@
 
 #include "DexClass.h"
 #include "ProguardMap.h"
+#include "RedexResources.h"
 
 class DexType;
 using MethodTuple = std::tuple<DexString*, DexString*, DexString*>;
@@ -70,6 +71,21 @@ struct ConfigFiles {
     return m_printseeds;
   }
 
+  /**
+   * Class names referenced from the manifest, layouts and native libraries
+   * of the apk in "apk_dir". Scanned on first use and shared by all passes.
+   * Empty if no apk_dir was given.
+   */
+  const ResourceClasses& get_resource_classes() {
+    if (!m_resource_classes_loaded) {
+      if (!m_apk_dir.empty()) {
+        m_resource_classes = ::get_resource_classes(m_apk_dir);
+      }
+      m_resource_classes_loaded = true;
+    }
+    return m_resource_classes;
+  }
+
  public:
   bool using_seeds{false};
   std::string outdir;
@@ -87,6 +103,9 @@ struct ConfigFiles {
   std::vector<std::string> m_coldstart_classes;
   std::vector<std::string> m_coldstart_methods;
   std::string m_printseeds; // Filename to dump computed seeds.
+  std::string m_apk_dir;
+  bool m_resource_classes_loaded{false};
+  ResourceClasses m_resource_classes;
 
   // global no optimizations annotations
   std::unordered_set<DexType*> m_no_optimizations_annos;
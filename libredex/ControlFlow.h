@@ -21,7 +21,7 @@ enum EdgeType {
   EDGE_TYPE_SIZE
 };
 
-struct Block {
+struct Block : public memory_accounting::Accounted<memory_accounting::CFG> {
   explicit Block(size_t id) : m_id(id) {}
 
   size_t id() const { return m_id; }
@@ -60,7 +60,7 @@ bool ends_with_may_throw(Block* b, bool end_block_before_throw = true);
 std::vector<Block*> postorder_sort(const std::vector<Block*>& cfg);
 
 
-class ControlFlowGraph {
+class ControlFlowGraph : public memory_accounting::Accounted<memory_accounting::CFG> {
   using IdPair = std::pair<size_t, size_t>;
 
  public:
@@ -170,7 +170,7 @@ void MethodBlock::ifield_op(DexOpcode opcode,
   if (is_iget(opcode)) {
     auto iget = new IRFieldInstruction(opcode, field);
     iget->set_dest(reg_num(src_or_dst));
-    src_or_dst.type = field->get_class();
+    src_or_dst.type = field->get_type();
     iget->set_src(0, reg_num(obj));
     push_instruction(iget);
   } else {
@@ -260,7 +260,7 @@ void MethodBlock::sfield_op(DexOpcode opcode,
   if (is_sget(opcode)) {
     auto sget = new IRFieldInstruction(opcode, field);
     sget->set_dest(reg_num(src_or_dst));
-    src_or_dst.type = field->get_class();
+    src_or_dst.type = field->get_type();
     push_instruction(sget);
   } else {
     auto sput = new IRFieldInstruction(opcode, field);
@@ -8,6 +8,7 @@
  */
 
 #include "ControlFlow.h"
+#include "FlatCode.h"
 #include "IRInstruction.h"
 
 template <typename T>
@@ -77,11 +78,18 @@ std::unique_ptr<std::unordered_map<IRInstruction*, T>> forwards_dataflow(
   return forwards_dataflow(blocks, bottom, trans, bottom);
 }
 
-template <typename T>
-std::unique_ptr<std::unordered_map<IRInstruction*, T>> backwards_dataflow(
-    const std::vector<Block*>& blocks,
-    const T& bottom,
-    const std::function<void(const IRInstruction*, T*)>& trans) {
+/*
+ * The fixpoint of the backwards_dataflow overloads below, which only differ
+ * in how they go over the instructions of a block. block_trans(block, out,
+ * insn_outs) runs the instructions of the block backwards over *out, and when
+ * insn_outs is not null records the state after each instruction in it.
+ */
+template <typename T, typename BlockTrans>
+std::unique_ptr<std::unordered_map<IRInstruction*, T>>
+backwards_dataflow_fixpoint(const std::vector<Block*>& blocks,
+                            const T& bottom,
+                            size_t insns_size_hint,
+                            const BlockTrans& block_trans) {
   std::vector<T> block_ins(blocks.size(), bottom);
   std::deque<Block*> work_list(blocks.begin(), blocks.end());
   while (!work_list.empty()) {
@@ -91,13 +99,7 @@ std::unique_ptr<std::unordered_map<IRInstruction*, T>> backwards_dataflow(
     for (Block* succ : block->succs()) {
       insn_out.meet(block_ins[succ->id()]);
     }
-    for (auto it = block->rbegin(); it != block->rend(); ++it) {
-      if (it->type != MFLOW_OPCODE) {
-        continue;
-      }
-      IRInstruction* insn = it->insn;
-      trans(insn, &insn_out);
-    }
+    block_trans(block, &insn_out, nullptr);
     if (insn_out != block_ins[block->id()]) {
       block_ins[block->id()] = std::move(insn_out);
       for (auto pred : block->preds()) {
@@ -116,20 +118,65 @@ std::unique_ptr<std::unordered_map<IRInstruction*, T>> backwards_dataflow(
   // dynamic_bitsets is very expensive.
   auto insn_out_map =
       std::make_unique<std::unordered_map<IRInstruction*, T>>();
+  insn_out_map->reserve(insns_size_hint);
   for (const auto& block : blocks) {
     auto insn_out = bottom;
     for (Block* succ : block->succs()) {
       insn_out.meet(block_ins[succ->id()]);
     }
-    for (auto it = block->rbegin(); it != block->rend(); ++it) {
-      if (it->type != MFLOW_OPCODE) {
-        continue;
-      }
-      IRInstruction* insn = it->insn;
-      insn_out_map->emplace(insn, insn_out);
-      trans(insn, &insn_out);
-    }
+    block_trans(block, &insn_out, insn_out_map.get());
   }
 
   return insn_out_map;
 }
+
+template <typename T>
+std::unique_ptr<std::unordered_map<IRInstruction*, T>> backwards_dataflow(
+    const std::vector<Block*>& blocks,
+    const T& bottom,
+    const std::function<void(const IRInstruction*, T*)>& trans) {
+  return backwards_dataflow_fixpoint(
+      blocks,
+      bottom,
+      0,
+      [&](Block* block,
+          T* insn_out,
+          std::unordered_map<IRInstruction*, T>* insn_outs) {
+        for (auto it = block->rbegin(); it != block->rend(); ++it) {
+          if (it->type != MFLOW_OPCODE) {
+            continue;
+          }
+          IRInstruction* insn = it->insn;
+          if (insn_outs != nullptr) {
+            insn_outs->emplace(insn, *insn_out);
+          }
+          trans(insn, insn_out);
+        }
+      });
+}
+
+/*
+ * The same analysis over a flat snapshot of the code the blocks belong to.
+ */
+template <typename T>
+std::unique_ptr<std::unordered_map<IRInstruction*, T>> backwards_dataflow(
+    const FlatCode& code,
+    const std::vector<Block*>& blocks,
+    const T& bottom,
+    const std::function<void(const FlatCode::Insn&, T*)>& trans) {
+  return backwards_dataflow_fixpoint(
+      blocks,
+      bottom,
+      code.size(),
+      [&](Block* block,
+          T* insn_out,
+          std::unordered_map<IRInstruction*, T>* insn_outs) {
+        for (auto it = code.end(block->id()); it != code.begin(block->id());) {
+          --it;
+          if (insn_outs != nullptr) {
+            insn_outs->emplace(it->insn, *insn_out);
+          }
+          trans(*it, insn_out);
+        }
+      });
+}
@@ -15,6 +15,7 @@
 #include <sstream>
 
 #include "Gatherable.h"
+#include "MemoryAccounting.h"
 #include "Show.h"
 
 class DexField;
@@ -52,7 +53,9 @@ enum DexAnnotationVisibility : uint8_t {
   DAV_SYSTEM = 2,
 };
 
-class DexEncodedValue : public Gatherable {
+class DexEncodedValue
+    : public Gatherable,
+      public memory_accounting::Accounted<memory_accounting::ANNOTATIONS> {
  protected:
   DexEncodedValueTypes m_evtype;
   uint64_t m_value;
@@ -321,7 +324,9 @@ class DexEncodedValueAnnotation : public DexEncodedValue {
   virtual std::string show() const;
 };
 
-class DexAnnotation : public Gatherable {
+class DexAnnotation
+    : public Gatherable,
+      public memory_accounting::Accounted<memory_accounting::ANNOTATIONS> {
   EncodedAnnotations m_anno_elems;
   DexType* m_type;
   DexAnnotationVisibility m_viz;
@@ -362,7 +367,9 @@ class DexAnnotation : public Gatherable {
   friend std::string show(const DexAnnotation*);
 };
 
-class DexAnnotationSet : public Gatherable {
+class DexAnnotationSet
+    : public Gatherable,
+      public memory_accounting::Accounted<memory_accounting::ANNOTATIONS> {
   std::vector<DexAnnotation*> m_annotations;
 
  public:
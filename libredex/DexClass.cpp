@@ -25,6 +25,7 @@
 #include "DexOutput.h"
 #include "DexUtil.h"
 #include "IRInstruction.h"
+#include "Resolver.h"
 #include "Transform.h"
 #include "Util.h"
 #include "Warning.h"
@@ -538,6 +539,7 @@ void DexClass::remove_method(const DexMethod* m) {
     meths.erase(it);
   }
   assert(erased);
+  clear_shared_ref_caches();
 }
 
 void DexMethod::become_virtual() {
@@ -661,6 +663,7 @@ void DexClass::add_method(DexMethod* m) {
   } else {
     insert_sorted(m_dmethods, m, compare_dexmethods);
   }
+  clear_shared_ref_caches();
 }
 
 void DexClass::add_field(DexField* f) {
@@ -674,6 +677,7 @@ void DexClass::add_field(DexField* f) {
   } else {
     insert_sorted(m_ifields, f, compare_dexfields);
   }
+  clear_shared_ref_caches();
 }
 
 void DexClass::remove_field(const DexField* f) {
@@ -686,6 +690,7 @@ void DexClass::remove_field(const DexField* f) {
     fields.erase(it);
   }
   assert(erase);
+  clear_shared_ref_caches();
 }
 
 
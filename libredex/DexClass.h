@@ -25,6 +25,7 @@
 #include "DexIdx.h"
 #include "DexInstruction.h"
 #include "DexPosition.h"
+#include "MemoryAccounting.h"
 #include "RedexContext.h"
 #include "ReferencedState.h"
 #include "Show.h"
@@ -64,7 +65,7 @@ std::string proguard_name(const DexClass* cls);
 std::string proguard_name(const DexMethod* method);
 std::string proguard_name(const DexField* field);
 
-class DexString {
+class DexString : public memory_accounting::Accounted<memory_accounting::CONTEXT> {
   friend struct RedexContext;
 
   std::string m_storage;
@@ -73,6 +74,13 @@ class DexString {
   // See UNIQUENESS above for the rationale for the private constructor pattern.
   DexString(std::string nstr, uint32_t utfsize) :
     m_storage(std::move(nstr)), m_utfsize(utfsize) {
+    memory_accounting::record_resize(memory_accounting::CONTEXT,
+                                     m_storage.size() + 1);
+  }
+
+  ~DexString() {
+    memory_accounting::record_resize(memory_accounting::CONTEXT,
+                                     -int64_t(m_storage.size() + 1));
   }
 
  public:
@@ -161,7 +169,7 @@ inline bool compare_dexstrings(const DexString* a, const DexString* b) {
   }
 }
 
-class DexType {
+class DexType : public memory_accounting::Accounted<memory_accounting::CONTEXT> {
   friend struct RedexContext;
 
   DexString* m_name;
@@ -226,7 +234,7 @@ struct dextypes_comparator {
   }
 };
 
-class DexField {
+class DexField : public memory_accounting::Accounted<memory_accounting::CONTEXT> {
   friend struct RedexContext;
 
   DexFieldRef m_ref;
@@ -343,7 +351,7 @@ inline bool compare_dexfields(const DexField* a, const DexField* b) {
   return compare_dextypes(a->get_type(), b->get_type());
 }
 
-class DexTypeList {
+class DexTypeList : public memory_accounting::Accounted<memory_accounting::CONTEXT> {
   friend struct RedexContext;
 
   std::deque<DexType*> m_list;
@@ -399,7 +407,7 @@ inline bool compare_dextypelists(DexTypeList* a, DexTypeList* b) {
   return *a < *b;
 }
 
-class DexProto {
+class DexProto : public memory_accounting::Accounted<memory_accounting::CONTEXT> {
   friend struct RedexContext;
 
   DexTypeList* m_args;
@@ -525,7 +533,7 @@ struct DexTryItem {
 
 class IRCode;
 
-class DexCode {
+class DexCode : public memory_accounting::Accounted<memory_accounting::DEX_CODE> {
   friend class DexMethod;
 
   uint16_t m_registers_size;
@@ -611,7 +619,7 @@ class DexCode {
   friend std::string show(const DexCode*);
 };
 
-class DexMethod {
+class DexMethod : public memory_accounting::Accounted<memory_accounting::CONTEXT> {
   friend struct RedexContext;
 
   DexMethodRef m_ref;
@@ -810,7 +818,7 @@ inline bool compare_dexmethods(const DexMethod* a, const DexMethod* b) {
 
 typedef std::map<DexCode*, uint32_t> dexcode_to_offset;
 
-class DexClass {
+class DexClass : public memory_accounting::Accounted<memory_accounting::CONTEXT> {
  private:
   DexAccessFlags m_access_flags;
   DexType* m_super_class;
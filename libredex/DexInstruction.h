@@ -19,13 +19,16 @@
 #include "DexDefs.h"
 #include "DexOpcode.h"
 #include "Gatherable.h"
+#include "MemoryAccounting.h"
 
 #define MAX_ARG_COUNT (4)
 
 class DexIdx;
 class DexOutputIdx;
 
-class DexInstruction : public Gatherable {
+class DexInstruction
+    : public Gatherable,
+      public memory_accounting::Accounted<memory_accounting::DEX_CODE> {
  protected:
   enum {
     REF_NONE,
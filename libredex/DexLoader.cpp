@@ -16,6 +16,7 @@
 #include "DexDefs.h"
 #include "DexAccess.h"
 #include "Trace.h"
+#include "TraceEvents.h"
 #include "Transform.h"
 #include "Walkers.h"
 #include "WorkQueue.h"
@@ -141,6 +142,7 @@ static void balloon_all(const Scope& scope) {
 }
 
 DexClasses load_classes_from_dex(const char* location, bool balloon) {
+  ScopedTraceEvent event("DexLoader", std::string("Load ") + location);
   DexLoader dl;
   auto classes = dl.load_dex(location);
   if (balloon) {
@@ -26,6 +26,7 @@
 #include "Resolver.h"
 #include "Sha1.h"
 #include "Trace.h"
+#include "TraceEvents.h"
 #include "Transform.h"
 #include "Walkers.h"
 #include "WorkQueue.h"
@@ -1207,7 +1208,7 @@ void write_method_mapping(
       if (cls) {
         auto intf_mr = resolve_intf_methodref(method);
         if (intf_mr) return intf_mr;
-        auto resm = resolve_method(method, MethodSearch::Any);
+        auto resm = resolve_method_cached(method, MethodSearch::Any);
         if (resm) return resm;
       }
       return method;
@@ -1405,6 +1406,7 @@ write_classes_to_dex(
   if (sort_bytecode == "class_order") {
     code_sort_mode = CLASS_ORDER;
   }
+  ScopedTraceEvent event("DexOutput", "Write " + filename);
   DexOutput dout = DexOutput(
     filename.c_str(),
     classes,
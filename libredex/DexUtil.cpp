@@ -172,6 +172,10 @@ bool has_hierarchy_in_scope(DexClass* cls) {
   return super == get_object_type();
 }
 
+void remove_from_type_system(DexClass* cls) {
+  g_redex->remove_from_type_system(cls);
+}
+
 void get_all_children(const DexType* type, TypeVector& children) {
   const auto& direct = get_children(type);
   for (const auto& child : direct) {
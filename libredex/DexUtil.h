@@ -163,16 +163,27 @@ inline DexClass* type_class_internal(const DexType* t) {
  * However the check is only within classes known to the app. So
  * you may effectively get false for a check_cast that would succeed at
  * runtime. Otherwise 'true' implies the type can cast.
+ * This walks the hierarchy on every call, passes doing many such queries
+ * should use TypeSystem::is_assignable_to() instead.
  */
 bool check_cast(DexType* type, DexType* base_type);
 
 /**
- * Return the direct children of a type.
+ * Return the direct children of a type. The range is invalidated when classes
+ * are added to or removed from the type system.
  */
-inline const TypeVector& get_children(const DexType* type) {
+inline ClassHierarchyIndex::TypeRange get_children(const DexType* type) {
   return g_redex->get_children(type);
 }
 
+/**
+ * Return true if `child` is `parent` or one of its subclasses. Only the
+ * superclass chain is considered, not interfaces.
+ */
+inline bool is_subclass(const DexType* parent, const DexType* child) {
+  return g_redex->is_subclass(parent, child);
+}
+
 /**
  * Return true if the type is an array type.
  */
@@ -250,6 +261,13 @@ DexAccessFlags merge_visibility(uint32_t vis1, uint32_t vis2);
  */
 void build_type_system(DexClass* cls);
 
+/**
+ * Take a class out of the class hierarchy once a pass has deleted it from
+ * the scope. The class is still returned by type_class() so that remaining
+ * references to its type can be rewritten.
+ */
+void remove_from_type_system(DexClass* cls);
+
 /**
  * Sorts and unique-ifies the given vector.
  */
@@ -0,0 +1,86 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree. An additional grant
+ * of patent rights can be found in the PATENTS file in the same directory.
+ */
+
+#include "FlatCode.h"
+
+#include <algorithm>
+
+#include "Debug.h"
+
+static_assert(sizeof(FlatCode::Insn) <= 24,
+              "instruction records should stay small");
+
+FlatCode::FlatCode(const ControlFlowGraph& cfg) {
+  const auto& blocks = cfg.blocks();
+  m_block_offsets.reserve(blocks.size() + 1);
+  for (auto block : blocks) {
+    always_assert(block->id() == m_block_offsets.size());
+    m_block_offsets.push_back(m_insns.size());
+    for (auto it = block->begin(); it != block->end(); ++it) {
+      switch (it->type) {
+      case MFLOW_OPCODE:
+        push_insn(it->insn, block->id());
+        break;
+      case MFLOW_POSITION:
+        m_positions.push_back(Marker{uint32_t(m_insns.size()), &*it});
+        break;
+      case MFLOW_FALLTHROUGH:
+        break;
+      default:
+        m_markers.push_back(Marker{uint32_t(m_insns.size()), &*it});
+        break;
+      }
+    }
+  }
+  m_block_offsets.push_back(m_insns.size());
+}
+
+void FlatCode::push_insn(IRInstruction* insn, size_t block) {
+  Insn flat;
+  flat.insn = insn;
+  flat.uses = m_uses.size();
+  flat.block = block;
+  flat.opcode = insn->opcode();
+  flat.dest = 0;
+  flat.flags = 0;
+  if (insn->dests_size()) {
+    flat.dest = insn->dest();
+    flat.flags |= Insn::HAS_DEST;
+    if (insn->dest_is_wide()) {
+      flat.flags |= Insn::DEST_WIDE;
+    }
+  }
+  auto nsrcs = insn->srcs_size();
+  always_assert_log(nsrcs <= Insn::MAX_SRCS, "Too many sources: %s",
+                    SHOW(insn));
+  flat.nsrcs = nsrcs;
+  for (size_t i = 0; i < nsrcs; ++i) {
+    m_uses.push_back(insn->src(i));
+    if (insn->src_is_wide(i)) {
+      flat.flags |= Insn::SRC_WIDE << i;
+    }
+  }
+  if (opcode::has_range(insn->opcode())) {
+    for (size_t i = 0; i < insn->range_size(); ++i) {
+      m_uses.push_back(insn->range_base() + i);
+    }
+  }
+  flat.nuses = m_uses.size() - flat.uses;
+  m_insns.push_back(flat);
+}
+
+const DexPosition* FlatCode::position_at(size_t i) const {
+  auto it = std::upper_bound(
+      m_positions.begin(), m_positions.end(), i,
+      [](size_t i, const Marker& marker) { return i < marker.index; });
+  if (it == m_positions.begin()) {
+    return nullptr;
+  }
+  return std::prev(it)->entry->pos.get();
+}
@@ -0,0 +1,124 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree. An additional grant
+ * of patent rights can be found in the PATENTS file in the same directory.
+ */
+
+#pragma once
+
+#include <vector>
+
+#include "ControlFlow.h"
+#include "IRInstruction.h"
+#include "Transform.h"
+
+/*
+ * A read-only snapshot of the instructions of a method, laid out as one array
+ * of fixed-size records in the order of the blocks of its CFG, so that the
+ * instructions of a block are contiguous. The registers read by each
+ * instruction -- its sources followed by its range, if any -- live in a side
+ * array, and so do the entries of the method that are not instructions (try
+ * and catch markers, branch targets, debug info and positions), each indexed
+ * by the instruction that follows it.
+ *
+ * Analyses that scan the code many times without changing it, like dataflow
+ * fixpoints, can run over it instead of chasing the pointers of the list IR
+ * and skipping its non-instruction entries along the way.
+ *
+ * It is not kept in sync with the IRCode: build it from the CFG when the
+ * analysis starts and drop it along with the results. Editing the code or
+ * rebuilding the CFG invalidates it.
+ */
+class FlatCode {
+ public:
+  struct Insn {
+    enum : uint8_t {
+      HAS_DEST = 1,
+      DEST_WIDE = 1 << 1,
+      // shifted left by the index of the source
+      SRC_WIDE = 1 << 2,
+    };
+    static constexpr size_t MAX_SRCS = 6;
+
+    IRInstruction* insn;
+    // the registers read start there in FlatCode::uses()
+    uint32_t uses;
+    uint32_t block;
+    uint16_t opcode;
+    uint16_t dest;
+    // the sources, then the range of range instructions
+    uint16_t nuses;
+    uint8_t nsrcs;
+    uint8_t flags;
+
+    DexOpcode op() const { return static_cast<DexOpcode>(opcode); }
+    bool has_dest() const { return flags & HAS_DEST; }
+    bool dest_is_wide() const { return flags & DEST_WIDE; }
+    bool src_is_wide(size_t i) const { return flags & (SRC_WIDE << i); }
+  };
+
+  struct Marker {
+    // the index of the instruction following the entry
+    uint32_t index;
+    const MethodItemEntry* entry;
+  };
+
+  using iterator = const Insn*;
+
+  FlatCode() {}
+  explicit FlatCode(const ControlFlowGraph& cfg);
+
+  FlatCode(const FlatCode&) = delete;
+  FlatCode& operator=(const FlatCode&) = delete;
+  FlatCode(FlatCode&&) = default;
+  FlatCode& operator=(FlatCode&&) = default;
+
+  size_t size() const { return m_insns.size(); }
+  const Insn& at(size_t i) const { return m_insns.at(i); }
+  size_t index_of(const Insn& insn) const { return &insn - m_insns.data(); }
+
+  iterator begin() const { return m_insns.data(); }
+  iterator end() const { return m_insns.data() + m_insns.size(); }
+
+  /*
+   * The instructions of the block with the given id.
+   */
+  iterator begin(size_t block) const {
+    return begin() + m_block_offsets.at(block);
+  }
+  iterator end(size_t block) const {
+    return begin() + m_block_offsets.at(block + 1);
+  }
+
+  const uint16_t* uses(const Insn& insn) const {
+    return m_uses.data() + insn.uses;
+  }
+  size_t uses_size() const { return m_uses.size(); }
+
+  /*
+   * The try, catch, target and debug entries of the method, in order.
+   * Fallthrough entries are left out.
+   */
+  const std::vector<Marker>& markers() const { return m_markers; }
+
+  /*
+   * The position of the i-th instruction, i.e. the closest position entry
+   * before it, or nullptr if there is none. This is logarithmic in the number
+   * of positions.
+   */
+  const DexPosition* position_at(size_t i) const;
+
+ private:
+  void push_insn(IRInstruction* insn, size_t block);
+
+  std::vector<Insn> m_insns;
+  std::vector<uint16_t> m_uses;
+  // the instructions of block b are in [m_block_offsets[b],
+  // m_block_offsets[b + 1])
+  std::vector<uint32_t> m_block_offsets;
+  std::vector<Marker> m_markers;
+  std::vector<Marker> m_positions;
+};
@@ -12,13 +12,17 @@
 #include <boost/optional.hpp>
 
 #include "DexInstruction.h"
+#include "MemoryAccounting.h"
 
-class IRInstruction : public Gatherable {
+class IRInstruction
+    : public Gatherable,
+      public memory_accounting::Accounted<memory_accounting::IR> {
  public:
   explicit IRInstruction(DexOpcode op);
 
   static IRInstruction* make(const DexInstruction*);
   virtual IRInstruction* clone() const { return new IRInstruction(*this); }
+
   virtual DexInstruction* to_dex_instruction() const;
   uint16_t size() const;
   bool operator==(const IRInstruction&) const;
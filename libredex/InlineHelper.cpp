@@ -13,6 +13,7 @@
 #include "Mutators.h"
 #include "Resolver.h"
 #include "Walkers.h"
+#include "WorkQueue.h"
 
 namespace {
 
@@ -145,123 +146,176 @@ MultiMethodInliner::MultiMethodInliner(
     const std::vector<DexClass*>& scope,
     const DexClasses& primary_dex,
     const std::unordered_set<DexMethod*>& candidates,
+    CallGraph& call_graph,
+    CodeSummaries& summaries,
     std::function<DexMethod*(DexMethod*, MethodSearch)> resolver,
     const Config& config)
-    : resolver(resolver), m_scope(scope), m_config(config) {
+    : resolver(resolver),
+      m_scope(scope),
+      m_call_graph(call_graph),
+      m_summaries(summaries),
+      m_config(config) {
   for (const auto& cls : primary_dex) {
     primary.insert(cls->get_type());
   }
-  // walk every opcode in scope looking for calls to inlinable candidates
-  // and build a map of callers to callees and the reverse callees to callers
-  walk_opcodes(scope, [](DexMethod* meth) { return true; },
-      [&](DexMethod* meth, IRInstruction* opcode) {
-        if (is_invoke(opcode->opcode())) {
-          auto mop = static_cast<IRMethodInstruction*>(opcode);
-          auto callee = resolver(mop->get_method(), opcode_to_search(opcode));
-          if (callee != nullptr && callee->is_concrete() &&
-              candidates.find(callee) != candidates.end()) {
-            callee_caller[callee].push_back(meth);
-            caller_callee[meth].push_back(callee);
-          }
+  // build a map of callers to callees restricted to the calls to inlinable
+  // candidates
+  m_call_graph.for_each_callsite(
+      [&](CallGraph::CallSiteId, const CallGraph::CallSite& site) {
+        auto callee = site.callee;
+        if (callee->is_concrete() &&
+            candidates.find(callee) != candidates.end()) {
+          caller_callee[site.caller].push_back(callee);
         }
       });
 }
 
+namespace {
+
+struct InlineWork {
+  MultiMethodInliner* inliner;
+  DexMethod* caller;
+  const std::vector<DexMethod*>* callees;
+  std::vector<DexMethod*> inlined;
+};
+
+}
+
 void MultiMethodInliner::inline_methods() {
-  // we want to inline bottom up, so as a first step we identify all the
-  // top level callers, then we recurse into all inlinable callees until we
-  // hit a leaf and we start inlining from there
-  for (auto it : caller_callee) {
-    auto caller = it.first;
-    // if the caller is not a top level keep going, it will be traversed
-    // when inlining a top level caller
-    if (callee_caller.find(caller) != callee_caller.end()) continue;
-    std::unordered_set<DexMethod*> visited;
-    visited.insert(caller);
-    caller_inline(caller, it.second, visited);
+  // we want to inline bottom up, so that a callee is completely resolved by
+  // the time it is inlined. The callers of a level only read the code of
+  // lower levels, so they are inlined into in parallel.
+  auto levels = caller_levels();
+  std::vector<InlineWork> work;
+  std::vector<work_item> work_items;
+  WorkQueue wq;
+  for (size_t level = 0; level < levels.size(); ++level) {
+    const auto& callers = levels[level];
+    if (callers.empty()) continue;
+    work.clear();
+    work.reserve(callers.size());
+    for (auto caller : callers) {
+      work.push_back(InlineWork{this, caller, &caller_callee.at(caller), {}});
+    }
+    work_items.clear();
+    for (auto& w : work) {
+      work_items.push_back(work_item{
+          [](void* arg) {
+            auto w = static_cast<InlineWork*>(arg);
+            w->inlined = w->inliner->inline_callees(w->caller, *w->callees);
+          },
+          &w});
+    }
+    TRACE(MMINL, 2, "inlining into %ld callers of level %ld\n",
+        callers.size(), level);
+    wq.run_work_items(work_items.data(), (int)work_items.size());
+
+    // The code of this level is final now. Relax the visibility of what was
+    // moved out of the inlined callees, and record the calls the callers have
+    // instead of the inlined ones, in an order that doesn't depend on how the
+    // work was scheduled.
+    std::vector<DexMethod*> inlined_callees;
+    for (const auto& w : work) {
+      for (auto callee : w.inlined) {
+        if (inlined.insert(callee).second) {
+          inlined_callees.push_back(callee);
+        }
+      }
+      if (!w.inlined.empty()) {
+        m_call_graph.update_callsites(w.caller);
+      }
+    }
+    std::sort(inlined_callees.begin(), inlined_callees.end(),
+              compare_dexmethods);
+    for (auto callee : inlined_callees) {
+      change_visibility(callee);
+    }
   }
 
   invoke_direct_to_static();
 }
 
-void MultiMethodInliner::caller_inline(
-    DexMethod* caller,
-    const std::vector<DexMethod*>& callees,
-    std::unordered_set<DexMethod*>& visited) {
-  std::vector<DexMethod*> nonrecursive_callees;
-  nonrecursive_callees.reserve(callees.size());
-  // recurse into the callees in case they have something to inline on
-  // their own. We want to inline bottom up so that a callee is
-  // completely resolved by the time it is inlined.
-  for (auto callee : callees) {
-    // if the call chain hits a call loop, ignore and keep going
-    if (visited.count(callee) > 0) {
-      info.recursive++;
-      continue;
-    }
-    nonrecursive_callees.push_back(callee);
-
-    auto maybe_caller = caller_callee.find(callee);
-    if (maybe_caller != caller_callee.end()) {
-      visited.insert(callee);
-      caller_inline(callee, maybe_caller->second, visited);
-      visited.erase(callee);
-    }
+std::vector<std::vector<DexMethod*>> MultiMethodInliner::caller_levels() {
+  static const std::vector<DexMethod*> no_callees;
+  std::vector<DexMethod*> callers;
+  for (auto& it : caller_callee) {
+    callers.push_back(it.first);
   }
-  inline_callees(caller, nonrecursive_callees);
+  auto result = call_levels(
+      callers, [&](DexMethod* method) -> const std::vector<DexMethod*>& {
+        auto it = caller_callee.find(method);
+        return it == caller_callee.end() ? no_callees : it->second;
+      });
+
+  // if the call chain hits a call loop, ignore and keep going
+  const auto& component = result.component;
+  for (auto& it : caller_callee) {
+    auto caller = it.first;
+    auto& callees = it.second;
+    auto recursive = std::remove_if(
+        callees.begin(), callees.end(), [&](DexMethod* callee) {
+          return component.at(callee) == component.at(caller);
+        });
+    info.recursive += callees.end() - recursive;
+    callees.erase(recursive, callees.end());
+  }
+  return std::move(result.levels);
 }
 
-void MultiMethodInliner::inline_callees(
+std::vector<DexMethod*> MultiMethodInliner::inline_callees(
     DexMethod* caller, const std::vector<DexMethod*>& callees) {
   size_t found = 0;
+  std::vector<DexMethod*> inlined_callees;
 
-  // walk the caller opcodes collecting all candidates to inline
+  // walk the caller call sites collecting all candidates to inline
   // Build a callee to opcode map
   std::vector<std::pair<DexMethod*, IRMethodInstruction*>> inlinables;
-  for (auto& mie : InstructionIterable(caller->get_code())) {
-    auto insn = mie.insn;
-    if (!is_invoke(insn->opcode())) continue;
-    auto mop = static_cast<IRMethodInstruction*>(insn);
-    auto callee = resolver(mop->get_method(), opcode_to_search(insn));
-    if (callee == nullptr) continue;
-    if (std::find(callees.begin(), callees.end(), callee) == callees.end()) {
-      continue;
-    }
-    always_assert(callee->is_concrete());
-    found++;
-    inlinables.push_back(std::make_pair(callee, mop));
-    if (found == callees.size()) break;
-  }
+  m_call_graph.for_each_callsite_in(
+      caller, [&](CallGraph::CallSiteId, const CallGraph::CallSite& site) {
+        auto callee = site.callee;
+        if (found == callees.size() ||
+            std::find(callees.begin(), callees.end(), callee) ==
+                callees.end()) {
+          return;
+        }
+        always_assert(callee->is_concrete());
+        found++;
+        inlinables.push_back(std::make_pair(callee, site.insn));
+      });
   if (found != callees.size()) {
     always_assert(found <= callees.size());
     info.not_found += callees.size() - found;
   }
 
   // attempt to inline all inlinable candidates
-  InlineContext inline_context(caller, m_config.use_liveness);
+  InlineContext inline_context(
+      caller, m_config.use_liveness, m_summaries.get(caller).insn_size);
   for (auto inlinable : inlinables) {
     auto callee = inlinable.first;
     auto mop = inlinable.second;
 
     if (!is_inlinable(inline_context, callee, caller)) continue;
 
+    const auto& summary = m_summaries.get(callee);
     TRACE(MMINL, 4, "inline %s (%d) in %s (%d)\n",
         SHOW(callee), caller->get_code()->get_registers_size(),
-        SHOW(caller),
-        callee->get_code()->get_registers_size() -
-        callee->get_code()->get_ins_size());
+        SHOW(caller), summary.registers - summary.ins);
     if (!IRCode::inline_method(
             inline_context, callee, mop, m_config.no_exceed_16regs)) {
       info.more_than_16regs++;
       continue;
     }
     TRACE(INL, 2, "caller: %s\tcallee: %s\n", SHOW(caller), SHOW(callee));
-    inline_context.estimated_insn_size +=
-        callee->get_code()->sum_opcode_sizes();
-    change_visibility(callee);
+    // only an estimate as the invoke and the return are gone and moves may
+    // have been added; the summary of the caller is redone once we are done
+    inline_context.estimated_insn_size += summary.insn_size;
     info.calls_inlined++;
-    inlined.insert(callee);
+    inlined_callees.push_back(callee);
+  }
+  if (!inlined_callees.empty()) {
+    m_summaries.update(caller);
   }
+  return inlined_callees;
 }
 
 /**
@@ -309,7 +363,7 @@ bool MultiMethodInliner::caller_too_large(InlineContext& ctx,
   // INSTRUCTION_BUFFER is added because the final method size is often larger
   // than our estimate -- during the sync phase, we may have to pick larger
   // branch opcodes to encode large jumps.
-  auto insns_size = callee->get_code()->sum_opcode_sizes();
+  auto insns_size = m_summaries.get(callee).insn_size;
   if (ctx.estimated_insn_size + insns_size >
       MAX_INSTRUCTION_SIZE - INSTRUCTION_BUFFER) {
     info.caller_too_large++;
@@ -332,15 +386,7 @@ bool MultiMethodInliner::caller_is_blacklisted(DexMethod* caller) {
  * in which case we cannot inline.
  */
 bool MultiMethodInliner::has_external_catch(DexMethod* callee) {
-  std::vector<DexType*> types;
-  callee->get_code()->gather_catch_types(types);
-  for (auto type : types) {
-    auto cls = type_class(type);
-    if (cls != nullptr && cls->is_external() && !is_public(cls)) {
-      return true;
-    }
-  }
-  return false;
+  return m_summaries.get(callee).nonpublic_external_catch;
 }
 
 /**
@@ -348,27 +394,31 @@ bool MultiMethodInliner::has_external_catch(DexMethod* callee) {
  */
 bool MultiMethodInliner::cannot_inline_opcodes(DexMethod* callee,
                                                DexMethod* caller) {
-  int ret_count = 0;
-  for (auto& mie : InstructionIterable(callee->get_code())) {
-    auto insn = mie.insn;
-    if (create_vmethod(insn)) return true;
-    if (nonrelocatable_invoke_super(insn, callee, caller)) return true;
-    if (unknown_virtual(insn, callee, caller)) return true;
-    if (unknown_field(insn, callee, caller)) return true;
-    if (insn->opcode() == OPCODE_THROW) {
-      info.throws++;
-      return true;
-    }
-    if (is_return(insn->opcode())) ret_count++;
+  const auto& summary = m_summaries.get(callee);
+  if (summary.throws) {
+    info.throws++;
+    return true;
   }
   // no callees that have more than a return statement (normally one, the
   // way dx generates code).
   // That allows us to make a simple inline strategy where we don't have to
   // worry about creating branches from the multiple returns to the main code
-  if (ret_count > 1) {
+  if (summary.multiple_returns) {
     info.multi_ret++;
     return true;
   }
+  // the checks below only ever fail on an invoke-super or on a reference to
+  // a member that is not public
+  if (summary.nonpublic_refs == 0 && !summary.invokes_super) {
+    return false;
+  }
+  for (auto& mie : InstructionIterable(callee->get_code())) {
+    auto insn = mie.insn;
+    if (create_vmethod(insn)) return true;
+    if (nonrelocatable_invoke_super(insn, callee, caller)) return true;
+    if (unknown_virtual(insn, callee, caller)) return true;
+    if (unknown_field(insn, callee, caller)) return true;
+  }
   return false;
 }
 
@@ -399,6 +449,7 @@ bool MultiMethodInliner::create_vmethod(IRInstruction* insn) {
     }
     if (m_config.callee_direct_invoke_inline &&
         !is_native(method)) {
+      std::lock_guard<std::mutex> lock(m_make_static_lock);
       m_make_static.insert(method);
     } else {
       info.need_vmethod++;
@@ -687,27 +738,14 @@ void MultiMethodInliner::invoke_direct_to_static() {
 }
 
 void select_single_called(
-    const Scope& scope,
+    const CallGraph& call_graph,
     const std::unordered_set<DexMethod*>& methods,
-    MethodRefCache& resolved_refs,
     std::unordered_set<DexMethod*>* inlinable) {
-  std::unordered_map<DexMethod*, int> calls;
+  // count call sites for each method
+  std::unordered_map<DexMethod*, size_t> calls;
   for (const auto& method : methods) {
-    calls[method] = 0;
+    calls[method] = call_graph.num_callsites_of(method);
   }
-  // count call sites for each method
-  walk_opcodes(scope, [](DexMethod* meth) { return true; },
-      [&](DexMethod* meth, IRInstruction* insn) {
-        if (is_invoke(insn->opcode())) {
-          auto mop = static_cast<IRMethodInstruction*>(insn);
-          auto callee = resolve_method(
-              mop->get_method(), opcode_to_search(insn), resolved_refs);
-          if (callee != nullptr && callee->is_concrete()
-              && methods.count(callee) > 0) {
-            calls[callee]++;
-          }
-        }
-      });
 
   // pick methods with a single call site and add to candidates.
   // This vector usage is only because of logging we should remove it
@@ -9,23 +9,29 @@
 
 #pragma once
 
+#include "CallGraph.h"
+#include "CodeSummary.h"
 #include "DexClass.h"
 #include "Transform.h"
 #include "Resolver.h"
 
+#include <atomic>
 #include <functional>
 #include <map>
+#include <mutex>
 #include <set>
 #include <vector>
 
 /**
  * Helper class to inline a set of condidates.
- * Take a set of candidates and a scope and walk all instructions in scope
- * to find and inline all calls to candidate.
+ * Take a set of candidates and the call graph of a scope to find and inline
+ * all calls to candidate. The call graph and the code summaries of the
+ * callers are kept up to date as callees are inlined.
  * A resolver is used to map a method reference to a method definition.
  * Not all methods may be inlined both for restriction on the caller or the
  * callee.
- * Perform inlining bottom up.
+ * Perform inlining bottom up, in parallel over the callers of each level of
+ * the condensed caller -> callee graph. The resolver must be thread safe.
  */
 class MultiMethodInliner {
  public:
@@ -43,6 +49,8 @@ class MultiMethodInliner {
       const std::vector<DexClass*>& scope,
       const DexClasses& primary_dex,
       const std::unordered_set<DexMethod*>& candidates,
+      CallGraph& call_graph,
+      CodeSummaries& summaries,
       std::function<DexMethod*(DexMethod*, MethodSearch)> resolver,
       const Config& config);
 
@@ -60,21 +68,24 @@ class MultiMethodInliner {
 
  private:
   /**
-   * Inline all callees into caller.
-   * Recurse in a callee if that has inlinable candidates of its own.
-   * Inlining is bottom up.
+   * Group the callers of candidates by level: the callees of a caller are
+   * callers of a lower level only, or in the same strongly connected
+   * component. Calls within a component are not inlined and are dropped from
+   * caller_callee. Levels and the callers within them are in a deterministic
+   * order.
    */
-  void caller_inline(
-      DexMethod* caller,
-      const std::vector<DexMethod*>& callees,
-      std::unordered_set<DexMethod*>& visited);
+  std::vector<std::vector<DexMethod*>> caller_levels();
 
   /**
    * Inline callees in the caller defined by InlineContext if is_inlinable
-   * below returns true.
+   * below returns true. Return the callees that were inlined.
+   *
+   * Runs in parallel with the other callers of a level. It only mutates the
+   * code of the caller, and leaves the updates shared with other callers,
+   * which are not order independent, to the end of the level.
    */
-  void inline_callees(DexMethod* caller,
-                      const std::vector<DexMethod*>& callees);
+  std::vector<DexMethod*> inline_callees(
+      DexMethod* caller, const std::vector<DexMethod*>& callees);
 
   /**
    * Return true if the callee is inlinable into the caller.
@@ -187,10 +198,9 @@ class MultiMethodInliner {
   std::unordered_set<DexMethod*> inlined;
 
   //
-  // Maps from callee to callers and reverse map from caller to callees.
-  // Those are used to perform bottom up inlining.
+  // Map from caller to the candidates it calls, used to perform bottom up
+  // inlining.
   //
-  std::unordered_map<DexMethod*, std::vector<DexMethod*>> callee_caller;
   // this map is ordered in order that we inline our methods in a repeatable
   // fashion so as to create reproducible binaries
   std::map<DexMethod*, std::vector<DexMethod*>, dexmethods_comparator>
@@ -198,33 +208,38 @@ class MultiMethodInliner {
 
  private:
   /**
-   * Info about inling.
+   * Info about inling, counted from all the threads.
    */
   struct InliningInfo {
-    size_t calls_inlined{0};
-    size_t recursive{0};
-    size_t not_found{0};
-    size_t blacklisted{0};
-    size_t more_than_16regs{0};
-    size_t throws{0};
-    size_t multi_ret{0};
-    size_t need_vmethod{0};
-    size_t invoke_super{0};
-    size_t write_over_ins{0};
-    size_t escaped_virtual{0};
-    size_t non_pub_virtual{0};
-    size_t escaped_field{0};
-    size_t non_pub_field{0};
-    size_t non_pub_ctor{0};
-    size_t not_in_primary{0};
-    size_t caller_too_large{0};
+    std::atomic<size_t> calls_inlined{0};
+    std::atomic<size_t> recursive{0};
+    std::atomic<size_t> not_found{0};
+    std::atomic<size_t> blacklisted{0};
+    std::atomic<size_t> more_than_16regs{0};
+    std::atomic<size_t> throws{0};
+    std::atomic<size_t> multi_ret{0};
+    std::atomic<size_t> need_vmethod{0};
+    std::atomic<size_t> invoke_super{0};
+    std::atomic<size_t> write_over_ins{0};
+    std::atomic<size_t> escaped_virtual{0};
+    std::atomic<size_t> non_pub_virtual{0};
+    std::atomic<size_t> escaped_field{0};
+    std::atomic<size_t> non_pub_field{0};
+    std::atomic<size_t> non_pub_ctor{0};
+    std::atomic<size_t> not_in_primary{0};
+    std::atomic<size_t> caller_too_large{0};
   };
   InliningInfo info;
 
   const std::vector<DexClass*>& m_scope;
 
+  CallGraph& m_call_graph;
+
+  CodeSummaries& m_summaries;
+
   const Config& m_config;
 
+  std::mutex m_make_static_lock;
   std::unordered_set<DexMethod*> m_make_static;
 
  public:
@@ -237,7 +252,6 @@ class MultiMethodInliner {
  * Add the single-callsite methods to the inlinable set.
  */
 void select_single_called(
-    const Scope& scope,
+    const CallGraph& call_graph,
     const std::unordered_set<DexMethod*>& methods,
-    MethodRefCache& resolved_refs,
     std::unordered_set<DexMethod*>* inlinable);
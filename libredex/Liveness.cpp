@@ -11,12 +11,72 @@
 #include <deque>
 
 #include "Dataflow.h"
+#include "FlatCode.h"
 #include "IRInstruction.h"
 #include "Liveness.h"
 #include "Transform.h"
 
 //////////////////////////////////////////////////////////////////////////////
 
+namespace {
+
+/*
+ * The transfer function, shared by the list IR and the flat instructions so
+ * that they cannot disagree. The view gives the register the instruction
+ * writes, if any, and the registers it reads: its sources, then its range.
+ */
+template <typename InsnView>
+void transfer(const InsnView& insn, Liveness* liveness) {
+  if (insn.has_dest()) {
+    liveness->kill(insn.dest());
+    if (insn.dest_is_wide()) {
+      liveness->kill(insn.dest() + 1);
+    }
+  }
+  for (size_t i = 0; i < insn.uses_size(); i++) {
+    liveness->gen(insn.use(i));
+    if (insn.use_is_wide(i)) {
+      liveness->gen(insn.use(i) + 1);
+    }
+  }
+}
+
+struct ListInsnView {
+  const IRInstruction* insn;
+
+  bool has_dest() const { return insn->dests_size() != 0; }
+  uint16_t dest() const { return insn->dest(); }
+  bool dest_is_wide() const { return insn->dest_is_wide(); }
+  size_t uses_size() const {
+    return insn->srcs_size() +
+           (opcode::has_range(insn->opcode()) ? insn->range_size() : 0);
+  }
+  uint16_t use(size_t i) const {
+    return i < insn->srcs_size()
+               ? insn->src((int)i)
+               : insn->range_base() + (i - insn->srcs_size());
+  }
+  bool use_is_wide(size_t i) const {
+    return i < insn->srcs_size() && insn->src_is_wide((int)i);
+  }
+};
+
+struct FlatInsnView {
+  const FlatCode& code;
+  const FlatCode::Insn& insn;
+
+  bool has_dest() const { return insn.has_dest(); }
+  uint16_t dest() const { return insn.dest; }
+  bool dest_is_wide() const { return insn.dest_is_wide(); }
+  size_t uses_size() const { return insn.nuses; }
+  uint16_t use(size_t i) const { return code.uses(insn)[i]; }
+  bool use_is_wide(size_t i) const {
+    return i < insn.nsrcs && insn.src_is_wide(i);
+  }
+};
+
+}
+
 bool Liveness::operator==(const Liveness& that) const {
   return m_reg_set == that.m_reg_set;
 }
@@ -25,6 +85,7 @@ void Liveness::enlarge(uint16_t ins_size, uint16_t newregs) {
   if (m_reg_set.size() < newregs) {
     auto oldregs = m_reg_set.size();
     m_reg_set.resize(newregs);
+    m_counted.set_bytes(footprint());
     for (uint16_t i = 0; i < ins_size; ++i) {
       m_reg_set[newregs - 1 - i] = m_reg_set[oldregs - 1 - i];
       m_reg_set[oldregs - 1 - i] = false;
@@ -33,23 +94,7 @@ void Liveness::enlarge(uint16_t ins_size, uint16_t newregs) {
 }
 
 void Liveness::trans(const IRInstruction* inst, Liveness* liveness) {
-  if (inst->dests_size()) {
-    liveness->m_reg_set.reset(inst->dest());
-    if (inst->dest_is_wide()) {
-      liveness->m_reg_set.reset(inst->dest() + 1);
-    }
-  }
-  for (size_t i = 0; i < inst->srcs_size(); i++) {
-    liveness->m_reg_set.set(inst->src((int)i));
-    if (inst->src_is_wide((int)i)) {
-      liveness->m_reg_set.set(inst->src((int)i) + 1);
-    }
-  }
-  if (opcode::has_range(inst->opcode())) {
-    for (size_t i = 0; i < inst->range_size(); i++) {
-      liveness->m_reg_set.set(inst->range_base() + i);
-    }
-  }
+  transfer(ListInsnView{inst}, liveness);
 }
 
 void Liveness::meet(const Liveness& that) {
@@ -60,8 +105,27 @@ std::unique_ptr<LivenessMap> Liveness::analyze(ControlFlowGraph& cfg,
                                                uint16_t nregs) {
   TRACE(REG, 5, "%s\n", SHOW(cfg));
   auto blocks = postorder_sort(cfg.blocks());
-  auto liveness = backwards_dataflow<Liveness>(blocks, Liveness(nregs),
-      Liveness::trans);
+  // The postorder leaves out the cycles that nothing enters. Their
+  // instructions still need a liveness, e.g. to get registers.
+  if (blocks.size() < cfg.blocks().size()) {
+    std::vector<bool> sorted(cfg.blocks().size());
+    for (auto block : blocks) {
+      sorted[block->id()] = true;
+    }
+    for (auto block : cfg.blocks()) {
+      if (!sorted[block->id()]) {
+        blocks.push_back(block);
+      }
+    }
+  }
+  FlatCode code(cfg);
+  auto liveness = backwards_dataflow<Liveness>(
+      code,
+      blocks,
+      Liveness(nregs),
+      [&](const FlatCode::Insn& insn, Liveness* live) {
+        transfer(FlatInsnView{code, insn}, live);
+      });
 
   auto DEBUG_ONLY dump_liveness = [&](const LivenessMap& amap) {
     for (auto& block : cfg.blocks()) {
@@ -13,6 +13,7 @@
 #include <memory>
 
 #include "DexClass.h"
+#include "MemoryAccounting.h"
 
 struct Block;
 
@@ -21,12 +22,24 @@ using LivenessMap = std::unordered_map<IRInstruction*, Liveness>;
 
 class Liveness {
   RegSet m_reg_set;
+  memory_accounting::Counted<memory_accounting::LIVENESS> m_counted;
+
+  size_t footprint() const {
+    return sizeof(Liveness) +
+           m_reg_set.num_blocks() * sizeof(RegSet::block_type);
+  }
+
  public:
-  Liveness(int nregs): m_reg_set(nregs) {}
-  Liveness(const RegSet&& reg_set): m_reg_set(std::move(reg_set)) {}
+  Liveness(int nregs): m_reg_set(nregs), m_counted(footprint()) {}
+  Liveness(const RegSet&& reg_set)
+      : m_reg_set(std::move(reg_set)), m_counted(footprint()) {}
 
   const RegSet& bits() { return m_reg_set; }
 
+  bool is_live(uint16_t reg) const { return m_reg_set.test(reg); }
+  void gen(uint16_t reg) { m_reg_set.set(reg); }
+  void kill(uint16_t reg) { m_reg_set.reset(reg); }
+
   void meet(const Liveness&);
   bool operator==(const Liveness&) const;
   bool operator!=(const Liveness& that) const {
@@ -65,28 +65,88 @@ namespace m {
 // N.B. recursive template for matching opcode pattern against insn sequence
 template<typename T, typename N>
 struct insns_matcher {
-  static bool matches_at(
-    int at,
-    const std::vector<IRInstruction*>& insns,
-    const T& t) {
-    const auto& insn = insns.at(at);
-    typename std::tuple_element<N::value, T>::type insn_match = std::get<N::value>(t);
-    return insn_match.matches(insn) &&
-        insns_matcher<T, std::integral_constant<size_t, N::value+1> >::matches_at(at+1, insns, t);
+  static bool matches_at(const MethodItemEntry* const* insns, const T& t) {
+    const auto& insn_match = std::get<N::value>(t);
+    return insn_match.matches(insns[N::value]->insn) &&
+        insns_matcher<T, std::integral_constant<size_t, N::value+1> >::matches_at(insns, t);
   }
 };
 
 // N.B. base case of recursive template where N = opcode pattern length
 template<typename T>
 struct insns_matcher<T, std::integral_constant<size_t, std::tuple_size<T>::value> > {
-  static bool matches_at(
-    int at,
-    const std::vector<IRInstruction*>& insns,
-    const T& t) {
+  static bool matches_at(const MethodItemEntry* const* insns, const T& t) {
     return true;
   }
 };
 
+/**
+ * Stream the opcodes in [begin, end) through a ring buffer of the last N
+ * entries, N being the length of the opcode pattern p, and call back
+ * v(insns) with the N instructions, in order, every time they match.
+ * Matches may overlap. The walk stops early when v returns false.
+ *
+ * Every entry is written twice in a buffer of 2N, so that the last N are
+ * always contiguous and can be matched in place. The ring holds the
+ * MethodItemEntries rather than their instructions, and the instructions are
+ * read from them when matching: the callback may replace the matched
+ * instructions in their entries (e.g. with IRCode::replace_opcode, which
+ * deletes the old ones), and the matches overlapping them see the new ones.
+ * It may also remove matched instructions with IRCode::remove_opcode, which
+ * leaves their entries behind as fallthroughs; those are dropped from the
+ * ring. It must not erase the matched entries, nor change the ones that
+ * follow. Nothing is allocated.
+ */
+template <
+    typename P,
+    typename Iter,
+    typename V = bool(IRInstruction**),
+    size_t N = std::tuple_size<P>::value>
+bool match_insns(Iter begin, Iter end, const P& p, const V& v) {
+  static_assert(N > 0, "empty opcode pattern");
+  const MethodItemEntry* ring[2 * N];
+  IRInstruction* insns[N];
+  size_t count = 0;
+  for (auto it = begin; it != end;) {
+    auto cur = it++;
+    if (cur->type != MFLOW_OPCODE) {
+      continue;
+    }
+    auto slot = count++ % N;
+    ring[slot] = ring[slot + N] = &*cur;
+    if (count < N) {
+      continue;
+    }
+    auto window = ring + count % N;
+    if (!insns_matcher<P, std::integral_constant<size_t, 0> >::matches_at(
+            window, p)) {
+      continue;
+    }
+    for (size_t i = 0; i < N; ++i) {
+      insns[i] = window[i]->insn;
+    }
+    if (!v(insns)) {
+      return false;
+    }
+    // Refill the ring with the matched entries that still hold an
+    // instruction, in order, so that no window sees a removed one.
+    const MethodItemEntry* kept[N];
+    size_t nkept = 0;
+    for (size_t i = 0; i < N; ++i) {
+      if (window[i]->type == MFLOW_OPCODE) {
+        kept[nkept++] = window[i];
+      }
+    }
+    if (nkept < N) {
+      for (size_t i = 0; i < nkept; ++i) {
+        ring[i] = ring[i + N] = kept[i];
+      }
+      count = nkept;
+    }
+  }
+  return true;
+}
+
 } // namespace
 
 namespace m {
@@ -396,22 +456,9 @@ template <typename ...T>
     [](const DexMethod* meth, const std::tuple<T...>& t) {
       auto code = meth->get_code();
       if (code) {
-        const size_t N = std::tuple_size<std::tuple<T...> >::value;
-        std::vector<IRInstruction*> insns;
-        for (auto& mie : InstructionIterable(code)) {
-          insns.push_back(mie.insn);
-        }
-        // No way to match if we have less insns than N
-        if (insns.size() < N) {
-          return false;
-        }
-        // Try to match starting at i, we advance along insns until the length of the tuple
-        // would cause us to extend beyond the end of insns to make the match.
-        for (size_t i = 0 ; i <= insns.size() - N ; ++i) {
-          if (insns_matcher<std::tuple<T...>, std::integral_constant<size_t, 0> >::matches_at(i, insns, t)) {
-            return true;
-          }
-        }
+        // stop at the first match
+        return !match_insns(code->begin(), code->end(), t,
+                            [](IRInstruction**) { return false; });
       }
       return false;
     },
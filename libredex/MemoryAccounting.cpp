@@ -0,0 +1,134 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree. An additional grant
+ * of patent rights can be found in the PATENTS file in the same directory.
+ */
+
+#include "MemoryAccounting.h"
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+
+namespace {
+
+using namespace memory_accounting;
+
+/*
+ * Objects are allocated from all the threads of the WorkQueue, give each of
+ * them its own cache line to count on.
+ */
+constexpr size_t kNumStripes = 64;
+
+struct alignas(64) Stripe {
+  std::atomic<int64_t> bytes[NUM_CATEGORIES];
+  std::atomic<int64_t> objects[NUM_CATEGORIES];
+  std::atomic<uint64_t> allocations[NUM_CATEGORIES];
+};
+
+Stripe s_stripes[kNumStripes];
+std::atomic<size_t> s_next_stripe{0};
+
+Stripe& this_thread_stripe() {
+  thread_local Stripe* stripe =
+      &s_stripes[s_next_stripe.fetch_add(1) % kNumStripes];
+  return *stripe;
+}
+
+double to_mb(int64_t bytes) {
+  return bytes / (1024.0 * 1024.0);
+}
+
+}
+
+namespace memory_accounting {
+
+const char* category_name(Category category) {
+  switch (category) {
+  case CONTEXT:
+    return "context";
+  case DEX_CODE:
+    return "dex_code";
+  case IR:
+    return "ir";
+  case CFG:
+    return "cfg";
+  case LIVENESS:
+    return "liveness";
+  case ANNOTATIONS:
+    return "annotations";
+  case NUM_CATEGORIES:
+    break;
+  }
+  return "unknown";
+}
+
+void record_alloc(Category category, size_t bytes) {
+  auto& stripe = this_thread_stripe();
+  stripe.bytes[category].fetch_add(bytes, std::memory_order_relaxed);
+  stripe.objects[category].fetch_add(1, std::memory_order_relaxed);
+  stripe.allocations[category].fetch_add(1, std::memory_order_relaxed);
+}
+
+void record_free(Category category, size_t bytes) {
+  auto& stripe = this_thread_stripe();
+  stripe.bytes[category].fetch_sub(bytes, std::memory_order_relaxed);
+  stripe.objects[category].fetch_sub(1, std::memory_order_relaxed);
+}
+
+void record_resize(Category category, int64_t delta_bytes) {
+  this_thread_stripe().bytes[category].fetch_add(delta_bytes,
+                                                 std::memory_order_relaxed);
+}
+
+Breakdown snapshot() {
+  Breakdown breakdown;
+  for (const auto& stripe : s_stripes) {
+    for (size_t c = 0; c < NUM_CATEGORIES; ++c) {
+      auto& usage = breakdown[c];
+      usage.live_bytes += stripe.bytes[c].load(std::memory_order_relaxed);
+      usage.live_objects += stripe.objects[c].load(std::memory_order_relaxed);
+      usage.allocations +=
+          stripe.allocations[c].load(std::memory_order_relaxed);
+    }
+  }
+  return breakdown;
+}
+
+uint64_t allocations(Category category) {
+  uint64_t total = 0;
+  for (const auto& stripe : s_stripes) {
+    total += stripe.allocations[category].load(std::memory_order_relaxed);
+  }
+  return total;
+}
+
+void report(const std::string& label, const Breakdown& breakdown) {
+  static const bool enabled = getenv("REDEX_MEMORY_REPORT") != nullptr;
+  if (!enabled) {
+    return;
+  }
+  fprintf(stderr, "Live memory after %s:\n", label.c_str());
+  int64_t total_bytes = 0;
+  int64_t total_objects = 0;
+  for (size_t c = 0; c < NUM_CATEGORIES; ++c) {
+    const auto& usage = breakdown[c];
+    fprintf(stderr,
+            "  %-12s %10.1f MB %12ld objects\n",
+            category_name(static_cast<Category>(c)),
+            to_mb(usage.live_bytes),
+            (long)usage.live_objects);
+    total_bytes += usage.live_bytes;
+    total_objects += usage.live_objects;
+  }
+  fprintf(stderr,
+          "  %-12s %10.1f MB %12ld objects\n",
+          "total",
+          to_mb(total_bytes),
+          (long)total_objects);
+}
+
+}
@@ -0,0 +1,165 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree. An additional grant
+ * of patent rights can be found in the PATENTS file in the same directory.
+ */
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <new>
+#include <string>
+#include <unordered_map>
+
+/**
+ * Live heap memory per subsystem, to tell where the peak RSS of a run goes.
+ *
+ * Objects are counted by their class specific operator new and delete (see
+ * Accounted), or by an intrusive member for memory they own (see Counted),
+ * and the tables of RedexContext by their allocator. Only the objects
+ * themselves are counted, e.g. not the buffers of their std::vector members,
+ * so the numbers are a lower bound.
+ */
+namespace memory_accounting {
+
+enum Category {
+  // DexStrings, DexTypes, DexFields, DexMethods, DexProtos, DexTypeLists,
+  // DexClasses and the RedexContext tables interning them
+  CONTEXT,
+  // DexCode and DexInstructions, i.e. code that is not ballooned
+  DEX_CODE,
+  // IRInstructions and MethodItemEntries
+  IR,
+  // ControlFlowGraphs and their Blocks
+  CFG,
+  // Liveness register sets
+  LIVENESS,
+  // DexAnnotationSets, DexAnnotations and DexEncodedValues
+  ANNOTATIONS,
+  NUM_CATEGORIES,
+};
+
+const char* category_name(Category category);
+
+void record_alloc(Category category, size_t bytes);
+void record_free(Category category, size_t bytes);
+// memory owned by an object growing or shrinking
+void record_resize(Category category, int64_t delta_bytes);
+
+struct Usage {
+  int64_t live_bytes{0};
+  int64_t live_objects{0};
+  // allocations since the process started
+  uint64_t allocations{0};
+};
+
+using Breakdown = std::array<Usage, NUM_CATEGORIES>;
+
+Breakdown snapshot();
+
+uint64_t allocations(Category category);
+
+/**
+ * Print the breakdown to stderr, if the REDEX_MEMORY_REPORT environment
+ * variable is set.
+ */
+void report(const std::string& label, const Breakdown& breakdown);
+
+/**
+ * Base class counting the instances of a class (and of its subclasses, if
+ * the destructor is virtual) under the given category.
+ */
+template <Category C>
+struct Accounted {
+  static void* operator new(size_t size) {
+    record_alloc(C, size);
+    return ::operator new(size);
+  }
+  static void operator delete(void* ptr, size_t size) {
+    record_free(C, size);
+    ::operator delete(ptr);
+  }
+};
+
+/**
+ * Member counting an object, and the heap memory it owns, under the given
+ * category. The owner calls set_bytes() when that memory changes size.
+ */
+template <Category C>
+class Counted {
+ public:
+  explicit Counted(size_t bytes = 0) : m_bytes(bytes) {
+    record_alloc(C, m_bytes);
+  }
+  Counted(const Counted& that) : Counted(that.m_bytes) {}
+  Counted& operator=(const Counted& that) {
+    set_bytes(that.m_bytes);
+    return *this;
+  }
+  ~Counted() { record_free(C, m_bytes); }
+
+  void set_bytes(size_t bytes) {
+    record_resize(C, static_cast<int64_t>(bytes) - m_bytes);
+    m_bytes = bytes;
+  }
+
+ private:
+  size_t m_bytes;
+};
+
+/**
+ * STL allocator counting the nodes of a container under the given category.
+ */
+template <typename T, Category C>
+struct Allocator {
+  using value_type = T;
+
+  template <typename U>
+  struct rebind {
+    using other = Allocator<U, C>;
+  };
+
+  Allocator() = default;
+  template <typename U>
+  Allocator(const Allocator<U, C>&) {}
+
+  T* allocate(size_t n) {
+    record_alloc(C, n * sizeof(T));
+    return static_cast<T*>(::operator new(n * sizeof(T)));
+  }
+  void deallocate(T* ptr, size_t n) {
+    record_free(C, n * sizeof(T));
+    ::operator delete(ptr);
+  }
+
+  template <typename U>
+  bool operator==(const Allocator<U, C>&) const {
+    return true;
+  }
+  template <typename U>
+  bool operator!=(const Allocator<U, C>&) const {
+    return false;
+  }
+};
+
+template <Category C,
+          typename K,
+          typename V,
+          typename Compare = std::less<K>>
+using map = std::map<K, V, Compare, Allocator<std::pair<const K, V>, C>>;
+
+template <Category C,
+          typename K,
+          typename V,
+          typename Hash = std::hash<K>,
+          typename Equal = std::equal_to<K>>
+using unordered_map =
+    std::unordered_map<K, V, Hash, Equal, Allocator<std::pair<const K, V>, C>>;
+
+}
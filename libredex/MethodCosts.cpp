@@ -0,0 +1,163 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree. An additional grant
+ * of patent rights can be found in the PATENTS file in the same directory.
+ */
+
+#include "MethodCosts.h"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+#include "DexClass.h"
+#include "Show.h"
+#include "Transform.h"
+
+namespace {
+
+struct Accumulated {
+  double secs{0};
+  size_t visits{0};
+};
+
+/*
+ * Costs are accumulated per thread, for walkers running on the WorkQueue. The
+ * lock only guards against a concurrent take_slowest().
+ */
+struct ThreadCosts {
+  std::mutex lock;
+  std::unordered_map<const DexMethod*, Accumulated> costs;
+};
+
+std::atomic<bool> s_enabled{false};
+std::mutex s_threads_lock;
+std::vector<std::unique_ptr<ThreadCosts>> s_threads;
+
+ThreadCosts& this_thread_costs() {
+  thread_local ThreadCosts* costs = [] {
+    std::lock_guard<std::mutex> guard(s_threads_lock);
+    s_threads.emplace_back(new ThreadCosts());
+    return s_threads.back().get();
+  }();
+  return *costs;
+}
+
+// depth of MethodCostScopes on this thread
+thread_local size_t t_depth = 0;
+
+}
+
+namespace method_costs {
+
+void set_enabled(bool enabled) {
+  s_enabled.store(enabled, std::memory_order_relaxed);
+}
+
+bool enabled() {
+  return s_enabled.load(std::memory_order_relaxed);
+}
+
+std::vector<MethodCost> take_slowest(size_t top_n) {
+  std::unordered_map<const DexMethod*, Accumulated> all;
+  {
+    std::lock_guard<std::mutex> guard(s_threads_lock);
+    for (auto& thread : s_threads) {
+      std::lock_guard<std::mutex> thread_guard(thread->lock);
+      for (const auto& it : thread->costs) {
+        auto& acc = all[it.first];
+        acc.secs += it.second.secs;
+        acc.visits += it.second.visits;
+      }
+      thread->costs.clear();
+    }
+  }
+  using Entry = std::pair<const DexMethod*, Accumulated>;
+  std::vector<Entry> entries(all.begin(), all.end());
+  auto by_cost = [](const Entry& a, const Entry& b) {
+    return a.second.secs > b.second.secs;
+  };
+  if (entries.size() > top_n) {
+    std::partial_sort(entries.begin(), entries.begin() + top_n, entries.end(),
+                      by_cost);
+    entries.resize(top_n);
+  } else {
+    std::sort(entries.begin(), entries.end(), by_cost);
+  }
+  std::vector<MethodCost> slowest;
+  slowest.reserve(entries.size());
+  for (const auto& entry : entries) {
+    auto method = entry.first;
+    MethodCost cost;
+    cost.method = method->get_deobfuscated_name();
+    if (cost.method.empty()) {
+      cost.method = show(method);
+    }
+    cost.secs = entry.second.secs;
+    cost.visits = entry.second.visits;
+    cost.instructions = 0;
+    cost.blocks = 0;
+    auto code = method->get_code();
+    if (code != nullptr) {
+      cost.instructions = code->count_opcodes();
+      cost.blocks = count_blocks(*code);
+    }
+    slowest.push_back(std::move(cost));
+  }
+  return slowest;
+}
+
+size_t count_blocks(const IRCode& code) {
+  size_t blocks = 0;
+  bool at_block_start = true;
+  for (const auto& mie : code) {
+    if (mie.type == MFLOW_TARGET || mie.type == MFLOW_CATCH ||
+        mie.type == MFLOW_TRY) {
+      at_block_start = true;
+      continue;
+    }
+    if (mie.type != MFLOW_OPCODE) {
+      continue;
+    }
+    if (at_block_start) {
+      ++blocks;
+      at_block_start = false;
+    }
+    auto op = mie.insn->opcode();
+    if (is_branch(op) || is_return(op) || op == OPCODE_THROW) {
+      at_block_start = true;
+    }
+  }
+  return blocks;
+}
+
+}
+
+void MethodCostScope::start(const DexMethod* method) {
+  m_started = true;
+  if (t_depth++ > 0) {
+    return;
+  }
+  m_method = method;
+  m_start = std::chrono::steady_clock::now();
+}
+
+void MethodCostScope::finish() {
+  --t_depth;
+  if (m_method == nullptr) {
+    return;
+  }
+  auto secs = std::chrono::duration<double>(
+                  std::chrono::steady_clock::now() - m_start)
+                  .count();
+  auto& thread = this_thread_costs();
+  std::lock_guard<std::mutex> guard(thread.lock);
+  auto& acc = thread.costs[m_method];
+  acc.secs += secs;
+  ++acc.visits;
+}
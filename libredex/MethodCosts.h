@@ -0,0 +1,88 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree. An additional grant
+ * of patent rights can be found in the PATENTS file in the same directory.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+class DexMethod;
+class IRCode;
+
+/**
+ * Attribution of the time spent in a pass to the methods it processed, to
+ * find the methods that make a pass slow.
+ *
+ * The walkers (see Walkers.h) time every call of their callback with a
+ * MethodCostScope; passes that iterate over methods by other means can use
+ * one themselves. Only the outermost scope on a thread counts, so walkers
+ * nested in the callback of another walker do not count twice.
+ *
+ * Disabled by default. PassManager enables it when the config has a
+ * "method_costs_output" file.
+ */
+struct MethodCost {
+  // Deobfuscated name of the method when the costs were taken. Not the
+  // DexMethod, which later passes may rename or drop the code of.
+  std::string method;
+  double secs;
+  // number of times the method was timed
+  size_t visits;
+  // size of the method after the pass
+  size_t instructions;
+  size_t blocks;
+};
+
+namespace method_costs {
+
+void set_enabled(bool enabled);
+bool enabled();
+
+/**
+ * Return the `top_n` most expensive methods recorded on all threads since the
+ * last call, most expensive first, and start over. Must not be called while
+ * methods are being timed.
+ */
+std::vector<MethodCost> take_slowest(size_t top_n);
+
+/**
+ * Number of basic blocks of the code, without splitting blocks at
+ * instructions that may throw. Does not build a CFG.
+ */
+size_t count_blocks(const IRCode& code);
+
+}
+
+class MethodCostScope {
+ public:
+  explicit MethodCostScope(const DexMethod* method) {
+    if (method_costs::enabled()) {
+      start(method);
+    }
+  }
+
+  ~MethodCostScope() {
+    if (m_started) {
+      finish();
+    }
+  }
+
+  MethodCostScope(const MethodCostScope&) = delete;
+  MethodCostScope& operator=(const MethodCostScope&) = delete;
+
+ private:
+  void start(const DexMethod* method);
+  void finish();
+
+  bool m_started{false};
+  const DexMethod* m_method{nullptr};
+  std::chrono::steady_clock::time_point m_start;
+};
@@ -0,0 +1,163 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree. An additional grant
+ * of patent rights can be found in the PATENTS file in the same directory.
+ */
+
+#include "MethodSummaries.h"
+
+#include <algorithm>
+
+#include "CallGraph.h"
+#include "DexUtil.h"
+#include "MethodCosts.h"
+#include "ReachableClasses.h"
+#include "Trace.h"
+#include "Walkers.h"
+#include "WorkQueue.h"
+
+namespace {
+
+using CalleeMap = std::unordered_map<DexMethod*, std::vector<DexMethod*>>;
+
+bool has_exact_target(const IRInstruction* insn) {
+  switch (insn->opcode()) {
+  case OPCODE_INVOKE_STATIC:
+  case OPCODE_INVOKE_STATIC_RANGE:
+  case OPCODE_INVOKE_DIRECT:
+  case OPCODE_INVOKE_DIRECT_RANGE:
+    return true;
+  default:
+    return false;
+  }
+}
+
+// Whether all the callers of the method are visible to the call graph
+bool has_known_callers(const DexMethod* method) {
+  auto m = const_cast<DexMethod*>(method);
+  return !m->is_virtual() && can_rename(m) && m->get_code() != nullptr;
+}
+
+struct SummaryWork {
+  DexMethod* method;
+  const MethodSummaries* summaries;
+  AbstractValue ret;
+  std::vector<ValueAnalysis::Call> calls;
+};
+
+}
+
+MethodSummaries::MethodSummaries(
+    const Scope& scope,
+    const CallGraph& call_graph,
+    const std::unordered_set<DexType*>& blacklist) {
+  std::vector<DexMethod*> methods;
+  walk_methods(scope, [&](DexMethod* m) {
+    if (m->get_code() != nullptr) {
+      methods.push_back(m);
+    }
+  });
+  CalleeMap callees;
+  for (auto caller : methods) {
+    call_graph.for_each_callsite_in(
+        caller, [&](CallGraph::CallSiteId, const CallGraph::CallSite& site) {
+          if (has_exact_target(site.insn) &&
+              site.callee->get_code() != nullptr) {
+            callees[caller].push_back(site.callee);
+          }
+        });
+  }
+
+  // The summaries of a level are only added once it is done, so the analysis
+  // of a method sees those of the levels below and nothing else.
+  std::vector<SummaryWork> work;
+  std::vector<work_item> work_items;
+  std::vector<ValueAnalysis::Call> calls;
+  WorkQueue wq;
+  static const std::vector<DexMethod*> no_callees;
+  auto levels =
+      call_levels(methods,
+                  [&](DexMethod* method) -> const std::vector<DexMethod*>& {
+                    auto it = callees.find(method);
+                    return it == callees.end() ? no_callees : it->second;
+                  })
+          .levels;
+  for (size_t level = 0; level < levels.size(); ++level) {
+    const auto& level_methods = levels[level];
+    if (level_methods.empty()) continue;
+    work.clear();
+    work.reserve(level_methods.size());
+    for (auto method : level_methods) {
+      work.push_back(SummaryWork{method, this, AbstractValue(), {}});
+    }
+    work_items.clear();
+    for (auto& w : work) {
+      work_items.push_back(work_item{
+          [](void* arg) {
+            auto w = static_cast<SummaryWork*>(arg);
+            MethodCostScope cost(w->method);
+            ValueAnalysis analysis(w->method, w->summaries);
+            analysis.set_record_calls(true);
+            analysis.run();
+            w->ret = analysis.return_value();
+            w->calls = analysis.calls();
+          },
+          &w});
+    }
+    TRACE(CONSTP, 2, "summarizing %ld methods of level %ld\n",
+        level_methods.size(), level);
+    wq.run_work_items(work_items.data(), (int)work_items.size());
+    for (auto& w : work) {
+      // the callers of blacklisted methods must not rely on what they return
+      if (!w.ret.top && !w.ret.is_bottom() &&
+          blacklist.count(w.method->get_class()) == 0) {
+        m_summaries[w.method].ret = w.ret;
+      }
+      for (auto& call : w.calls) {
+        calls.push_back(std::move(call));
+      }
+    }
+  }
+
+  // A parameter is the meet of what all the call sites pass in. Calls within
+  // a strongly connected component were analyzed without the summaries of
+  // each other, so their arguments are no less precise than they should be.
+  std::unordered_map<const DexMethod*, std::vector<AbstractValue>> params;
+  for (const auto& call : calls) {
+    auto ins_size = call.callee->get_code()->get_ins_size();
+    if (!has_known_callers(call.callee)) {
+      continue;
+    }
+    auto& callee_params = params[call.callee];
+    if (call.args.size() != ins_size) {
+      // Nothing is known about what a call that doesn't match the parameters
+      // passes in, and later calls must not undo that.
+      callee_params.assign(ins_size, AbstractValue::bottom());
+    } else if (callee_params.empty()) {
+      callee_params = call.args;
+    } else {
+      for (size_t i = 0; i < ins_size; ++i) {
+        callee_params[i].meet(call.args[i]);
+      }
+    }
+  }
+  for (auto& it : params) {
+    bool useful = std::any_of(
+        it.second.begin(), it.second.end(), [](const AbstractValue& value) {
+          return !value.top && !value.is_bottom();
+        });
+    if (useful) {
+      m_summaries[it.first].params = std::move(it.second);
+    }
+  }
+  TRACE(CONSTP, 1, "Summarized %ld methods in %ld levels\n",
+      m_summaries.size(), levels.size());
+}
+
+const MethodSummary* MethodSummaries::get(const DexMethod* method) const {
+  auto it = m_summaries.find(method);
+  return it == m_summaries.end() ? nullptr : &it->second;
+}
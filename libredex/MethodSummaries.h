@@ -0,0 +1,68 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree. An additional grant
+ * of patent rights can be found in the PATENTS file in the same directory.
+ */
+
+#pragma once
+
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "DexClass.h"
+#include "ValueAnalysis.h"
+
+class CallGraph;
+
+/**
+ * What every execution of a method agrees on.
+ */
+struct MethodSummary {
+  // the meet of the values it returns, TOP if it never returns
+  AbstractValue ret;
+  // The meet of the values its callers pass in, one per ins register. Empty
+  // unless all the callers are known and there is at least one: the method
+  // is not virtual, is not kept and has code.
+  std::vector<AbstractValue> params;
+};
+
+/**
+ * Interprocedural summaries of the methods of a scope, see MethodSummary.
+ *
+ * Return values are computed bottom up: the strongly connected components of
+ * the call graph (restricted to invoke-static and invoke-direct) are grouped
+ * into levels, one above the highest level they call, and the methods of a
+ * level are analyzed in parallel with the summaries of the levels below. The
+ * calls within a component see nothing from each other.
+ *
+ * The parameters of a method are the meet of the arguments at its call sites,
+ * as seen by the analysis of the callers during the same walk. Parameter
+ * summaries do not feed back into the analysis of the callees, so a single
+ * walk of the call graph is enough.
+ *
+ * Nothing is recorded about the return values of the methods of blacklisted
+ * classes, so that their callers don't depend on them.
+ */
+class MethodSummaries {
+ public:
+  MethodSummaries(const Scope& scope,
+                  const CallGraph& call_graph,
+                  const std::unordered_set<DexType*>& blacklist = {});
+
+  MethodSummaries(const MethodSummaries&) = delete;
+  MethodSummaries& operator=(const MethodSummaries&) = delete;
+
+  /**
+   * The summary of a method, nullptr if nothing is known about it.
+   */
+  const MethodSummary* get(const DexMethod* method) const;
+
+  size_t size() const { return m_summaries.size(); }
+
+ private:
+  std::unordered_map<const DexMethod*, MethodSummary> m_summaries;
+};
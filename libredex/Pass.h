@@ -15,6 +15,7 @@
 #include <iostream>
 #include <algorithm>
 
+#include "AnalysisManager.h"
 #include "DexStore.h"
 #include "ConfigFiles.h"
 #include "PassRegistry.h"
@@ -114,6 +115,13 @@ class Pass {
   virtual void eval_pass(DexStoresVector& stores, ConfigFiles& cfg, PassManager& mgr) {};
   virtual void run_pass(DexStoresVector& stores, ConfigFiles& cfg, PassManager& mgr) = 0;
 
+  /**
+   * Declare which of the analyses cached by the PassManager are still valid
+   * after run_pass. Everything else is invalidated once the pass has run.
+   * By default a pass preserves nothing.
+   */
+  virtual void get_preserved_analyses(PreservedAnalyses&) const {}
+
  private:
   std::string m_name;
 };
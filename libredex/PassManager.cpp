@@ -11,6 +11,7 @@
 
 #include <cstdio>
 
+#include "Analyses.h"
 #include "ConfigFiles.h"
 #include "Debug.h"
 #include "DexClass.h"
@@ -18,11 +19,13 @@
 #include "DexOutput.h"
 #include "DexUtil.h"
 #include "InterDex.h"
+#include "MemoryAccounting.h"
 #include "PrintSeeds.h"
 #include "ProguardMatcher.h"
 #include "ProguardPrintConfiguration.h"
 #include "ProguardReporting.h"
 #include "ReachableClasses.h"
+#include "Resolver.h"
 #include "Timer.h"
 #include "Transform.h"
 
@@ -67,17 +70,55 @@ PassManager::PassManager(const std::vector<Pass*>& passes,
 }
 
 const std::string PASS_ORDER_KEY = "pass_order";
+const std::string ANALYSES_BUILT_KEY = "analyses_built";
+const std::string ANALYSES_REUSED_KEY = "analyses_reused";
+const std::string ANALYSES_BUILD_MS_KEY = "analyses_build_ms";
+const int DEFAULT_METHOD_COSTS_TOP_N = 20;
+
+namespace {
+
+void record_analysis_metrics(const AnalysisManager::Stats& before,
+                             const AnalysisManager::Stats& after,
+                             std::unordered_map<std::string, int>& metrics) {
+  if (after.builds == before.builds && after.hits == before.hits) {
+    return;
+  }
+  metrics[ANALYSES_BUILT_KEY] += after.builds - before.builds;
+  metrics[ANALYSES_REUSED_KEY] += after.hits - before.hits;
+  metrics[ANALYSES_BUILD_MS_KEY] +=
+      static_cast<int>((after.build_secs - before.build_secs) * 1000);
+}
+
+void trace_profile(const std::string& pass_name,
+                   const char* phase,
+                   const PhaseProfile& profile) {
+  TRACE(PM, 2,
+        "%s (%s): %.2lf s wall, %.2lf s cpu, rss %+ld kB, peak rss %ld kB, "
+        "%lu IR allocations\n",
+        pass_name.c_str(), phase, profile.wall_secs, profile.cpu_secs,
+        (long)profile.rss_delta_kb, (long)profile.peak_rss_kb,
+        (unsigned long)profile.ir_allocations);
+}
+
+void trace_analysis_stats(const AnalysisManager& am) {
+  for (const auto& it : am.get_stats()) {
+    const auto& stats = it.second;
+    TRACE(PM, 1,
+          "Analysis %s: built %lu times in %.1lf seconds, reused %lu times, "
+          "invalidated %lu times\n",
+          it.first.c_str(), stats.builds, stats.build_secs, stats.hits,
+          stats.invalidations);
+  }
+}
+
+}
 
 
 void PassManager::run_passes(DexStoresVector& stores, ConfigFiles& cfg) {
-  DexStoreClassesIterator it(stores);
-  Scope scope = build_class_scope(it);
+  auto& scope = get_analysis<ClassScopeAnalysis>(stores).scope;
   {
     Timer t("Initializing reachable classes");
-    init_reachable_classes(scope,
-                           m_config,
-                           m_pg_config,
-                           cfg.get_no_optimizations_annos());
+    init_reachable_classes(scope, m_config, m_pg_config, cfg);
   }
   {
     Timer t("Processing proguard rules");
@@ -126,26 +167,63 @@ void PassManager::run_passes(DexStoresVector& stores, ConfigFiles& cfg) {
     m_pass_metrics[i].name = pass->name() + "#" + std::to_string(count);
     m_pass_metrics[i].metrics[PASS_ORDER_KEY] = i;
     m_current_pass_metrics = &m_pass_metrics[i].metrics;
+    auto analysis_stats = m_analyses.get_total_stats();
+    PhaseProfiler profiler;
     pass->eval_pass(stores, cfg, *this);
+    m_pass_metrics[i].eval_profile = profiler.stop();
+    trace_profile(pass->name(), "eval", m_pass_metrics[i].eval_profile);
+    record_analysis_metrics(analysis_stats,
+                            m_analyses.get_total_stats(),
+                            *m_current_pass_metrics);
     m_current_pass_metrics = nullptr;
   }
+  bool record_method_costs =
+      !m_config.get("method_costs_output", "").asString().empty();
+  size_t method_costs_top_n =
+      m_config.get("method_costs_top_n", DEFAULT_METHOD_COSTS_TOP_N).asUInt();
+  method_costs::set_enabled(record_method_costs);
+  memory_accounting::report("the eval phase", memory_accounting::snapshot());
   for (size_t i = 0; i < m_activated_passes.size(); ++i) {
     Pass* pass = m_activated_passes[i];
     TRACE(PM, 1, "Running %s...\n", pass->name().c_str());
     Timer t(pass->name() + " (run)");
     m_current_pass_metrics = &m_pass_metrics[i].metrics;
+    auto analysis_stats = m_analyses.get_total_stats();
+    if (record_method_costs) {
+      // Drop what was recorded outside of the run phase.
+      method_costs::take_slowest(0);
+    }
+    PhaseProfiler profiler;
     pass->run_pass(stores, cfg, *this);
+    m_pass_metrics[i].run_profile = profiler.stop();
+    if (record_method_costs) {
+      m_pass_metrics[i].slowest_methods =
+          method_costs::take_slowest(method_costs_top_n);
+    }
+    trace_profile(pass->name(), "run", m_pass_metrics[i].run_profile);
+    record_analysis_metrics(analysis_stats,
+                            m_analyses.get_total_stats(),
+                            *m_current_pass_metrics);
     m_current_pass_metrics = nullptr;
+    PreservedAnalyses preserved;
+    pass->get_preserved_analyses(preserved);
+    m_analyses.invalidate(preserved);
+    // Passes may have edited class members in place, behind the back of the
+    // resolution caches.
+    clear_shared_ref_caches();
+    m_pass_metrics[i].memory = memory_accounting::snapshot();
+    memory_accounting::report(m_pass_metrics[i].name, m_pass_metrics[i].memory);
   }
+  method_costs::set_enabled(false);
+  trace_analysis_stats(m_analyses);
 
   if (!cfg.get_printseeds().empty()) {
     Timer t("Writing outgoing classes to file " + cfg.get_printseeds() +
             ".outgoing");
-    // Recompute the scope.
-    scope = build_class_scope(it);
+    auto& outgoing_scope = get_analysis<ClassScopeAnalysis>(stores).scope;
     std::ofstream outgoig(cfg.get_printseeds() + ".outgoing");
-    redex::print_classes(outgoig, cfg.get_proguard_map(), scope);
-    redex::alert_seeds(std::cerr, scope);
+    redex::print_classes(outgoig, cfg.get_proguard_map(), outgoing_scope);
+    redex::alert_seeds(std::cerr, outgoing_scope);
   }
 }
 
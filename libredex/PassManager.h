@@ -9,7 +9,11 @@
 
 #pragma once
 
+#include "AnalysisManager.h"
+#include "MemoryAccounting.h"
+#include "MethodCosts.h"
 #include "Pass.h"
+#include "Profiler.h"
 #include "ProguardConfiguration.h"
 
 #include <string>
@@ -26,6 +30,12 @@ class PassManager {
   struct PassMetrics {
     std::string name;
     std::unordered_map<std::string, int> metrics;
+    PhaseProfile eval_profile;
+    PhaseProfile run_profile;
+    // most expensive methods of the run phase, if method costs are enabled
+    std::vector<MethodCost> slowest_methods;
+    // live memory per category once the pass and its analyses are done
+    memory_accounting::Breakdown memory;
   };
   void run_passes(DexStoresVector&, ConfigFiles&);
   void incr_metric(const std::string& key, int value);
@@ -34,6 +44,26 @@ class PassManager {
   std::vector<PassManager::PassMetrics> get_metrics() const;
   const Json::Value& get_config() const { return m_config; }
 
+  /**
+   * Return the result of analysis T (see Analyses.h), reusing the cached
+   * result when no pass has invalidated it since it was computed.
+   */
+  template <class T>
+  T& get_analysis(DexStoresVector& stores) {
+    return m_analyses.get<T>(stores);
+  }
+
+  /**
+   * Drop analysis T right away. Passes that change what T depends on halfway
+   * through run_pass and then request T again must call this in between.
+   */
+  template <class T>
+  void invalidate_analysis() {
+    m_analyses.invalidate<T>();
+  }
+
+  const AnalysisManager& get_analysis_manager() const { return m_analyses; }
+
   // A temporary hack to return the interdex metrics. Will be removed later.
   std::unordered_map<std::string, int> get_interdex_metrics();
 
@@ -67,4 +97,6 @@ class PassManager {
 
   redex::ProguardConfiguration m_pg_config;
   bool m_testing_mode{false};
+
+  AnalysisManager m_analyses;
 };
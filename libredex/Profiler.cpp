@@ -0,0 +1,139 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree. An additional grant
+ * of patent rights can be found in the PATENTS file in the same directory.
+ */
+
+#include "Profiler.h"
+
+#include <cstdio>
+#include <cstring>
+#include <sys/resource.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#ifdef __APPLE__
+#include <mach/mach.h>
+#endif
+
+#include "MemoryAccounting.h"
+
+namespace {
+
+double to_secs(const timeval& tv) {
+  return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+double get_cpu_secs() {
+  rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) != 0) {
+    return 0;
+  }
+  return to_secs(usage.ru_utime) + to_secs(usage.ru_stime);
+}
+
+int64_t get_max_rss_kb() {
+  rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) != 0) {
+    return 0;
+  }
+#ifdef __APPLE__
+  return usage.ru_maxrss / 1024;
+#else
+  return usage.ru_maxrss;
+#endif
+}
+
+#ifdef __linux__
+
+int64_t get_rss_kb() {
+  FILE* fp = fopen("/proc/self/statm", "r");
+  if (fp == nullptr) {
+    return 0;
+  }
+  long pages = 0;
+  long resident = 0;
+  if (fscanf(fp, "%ld %ld", &pages, &resident) != 2) {
+    resident = 0;
+  }
+  fclose(fp);
+  return static_cast<int64_t>(resident) * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+/*
+ * Writing 5 to clear_refs resets VmHWM to the current RSS (Linux 4.0+).
+ */
+bool reset_peak_rss() {
+  FILE* fp = fopen("/proc/self/clear_refs", "w");
+  if (fp == nullptr) {
+    return false;
+  }
+  bool ok = fputs("5", fp) >= 0;
+  ok = fclose(fp) == 0 && ok;
+  return ok;
+}
+
+int64_t get_peak_rss_kb() {
+  FILE* fp = fopen("/proc/self/status", "r");
+  if (fp == nullptr) {
+    return get_max_rss_kb();
+  }
+  char line[256];
+  long peak = -1;
+  while (fgets(line, sizeof(line), fp) != nullptr) {
+    if (strncmp(line, "VmHWM:", 6) == 0) {
+      sscanf(line + 6, "%ld", &peak);
+      break;
+    }
+  }
+  fclose(fp);
+  return peak >= 0 ? peak : get_max_rss_kb();
+}
+
+#else
+
+int64_t get_rss_kb() {
+#ifdef __APPLE__
+  mach_task_basic_info info;
+  mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+  if (task_info(mach_task_self(),
+                MACH_TASK_BASIC_INFO,
+                reinterpret_cast<task_info_t>(&info),
+                &count) == KERN_SUCCESS) {
+    return info.resident_size / 1024;
+  }
+#endif
+  return 0;
+}
+
+bool reset_peak_rss() { return false; }
+
+int64_t get_peak_rss_kb() { return get_max_rss_kb(); }
+
+#endif
+
+}
+
+PhaseProfiler::PhaseProfiler() {
+  reset_peak_rss();
+  m_rss_kb = get_rss_kb();
+  m_ir_allocations = memory_accounting::allocations(memory_accounting::IR);
+  m_cpu_secs = get_cpu_secs();
+  m_wall = std::chrono::steady_clock::now();
+}
+
+PhaseProfile PhaseProfiler::stop() const {
+  PhaseProfile profile;
+  profile.wall_secs = std::chrono::duration<double>(
+                          std::chrono::steady_clock::now() - m_wall)
+                          .count();
+  profile.cpu_secs = get_cpu_secs() - m_cpu_secs;
+  profile.ir_allocations =
+      memory_accounting::allocations(memory_accounting::IR) - m_ir_allocations;
+  profile.rss_delta_kb = get_rss_kb() - m_rss_kb;
+  profile.peak_rss_kb = get_peak_rss_kb();
+  return profile;
+}
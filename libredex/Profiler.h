@@ -0,0 +1,52 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree. An additional grant
+ * of patent rights can be found in the PATENTS file in the same directory.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+/**
+ * Resource usage of a phase of the optimization, e.g. the eval or run phase
+ * of a pass.
+ */
+struct PhaseProfile {
+  double wall_secs{0};
+  // user + system time of all the threads of the process. A ratio to
+  // wall_secs well above 1 means the phase ran in parallel.
+  double cpu_secs{0};
+  // change of the resident set size over the phase
+  int64_t rss_delta_kb{0};
+  // highest resident set size reached during the phase. Where the high-water
+  // mark of the process cannot be reset (anything but Linux), the highest
+  // resident set size since the process started.
+  int64_t peak_rss_kb{0};
+  // IRInstructions and MethodItemEntries allocated during the phase, see
+  // MemoryAccounting.h
+  uint64_t ir_allocations{0};
+};
+
+/**
+ * Measures the resource usage from its construction until stop().
+ *
+ * The process has a single high-water mark, so profiles must not overlap:
+ * starting a PhaseProfiler resets the peak of any running one.
+ */
+class PhaseProfiler {
+ public:
+  PhaseProfiler();
+
+  PhaseProfile stop() const;
+
+ private:
+  std::chrono::steady_clock::time_point m_wall;
+  double m_cpu_secs;
+  int64_t m_rss_kb;
+  uint64_t m_ir_allocations;
+};
@@ -0,0 +1,275 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree. An additional grant
+ * of patent rights can be found in the PATENTS file in the same directory.
+ */
+
+#include "Purity.h"
+
+#include <unordered_map>
+#include <vector>
+
+#include "DexUtil.h"
+#include "ReachableClasses.h"
+#include "Resolver.h"
+#include "Trace.h"
+#include "Transform.h"
+#include "Walkers.h"
+
+namespace {
+
+bool has_exact_target(DexOpcode op) {
+  switch (op) {
+  case OPCODE_INVOKE_STATIC:
+  case OPCODE_INVOKE_STATIC_RANGE:
+  case OPCODE_INVOKE_DIRECT:
+  case OPCODE_INVOKE_DIRECT_RANGE:
+    return true;
+  default:
+    return false;
+  }
+}
+
+DexMethod* exact_target(const IRInstruction* insn) {
+  auto mop = const_cast<IRMethodInstruction*>(
+      static_cast<const IRMethodInstruction*>(insn));
+  return resolve_method_cached(mop->get_method(), opcode_to_search(mop));
+}
+
+/*
+ * The instructions with a side effect other than altering the control flow
+ * of the method or throwing implicitly. Invokes are dealt with separately.
+ */
+bool writes_or_throws(DexOpcode opc) {
+  switch (opc) {
+  case OPCODE_MONITOR_ENTER:
+  case OPCODE_MONITOR_EXIT:
+  case OPCODE_FILL_ARRAY_DATA:
+  case OPCODE_THROW:
+  case OPCODE_APUT:
+  case OPCODE_APUT_WIDE:
+  case OPCODE_APUT_OBJECT:
+  case OPCODE_APUT_BOOLEAN:
+  case OPCODE_APUT_BYTE:
+  case OPCODE_APUT_CHAR:
+  case OPCODE_APUT_SHORT:
+  case OPCODE_IPUT:
+  case OPCODE_IPUT_WIDE:
+  case OPCODE_IPUT_OBJECT:
+  case OPCODE_IPUT_BOOLEAN:
+  case OPCODE_IPUT_BYTE:
+  case OPCODE_IPUT_CHAR:
+  case OPCODE_IPUT_SHORT:
+  case OPCODE_SPUT:
+  case OPCODE_SPUT_WIDE:
+  case OPCODE_SPUT_OBJECT:
+  case OPCODE_SPUT_BOOLEAN:
+  case OPCODE_SPUT_BYTE:
+  case OPCODE_SPUT_CHAR:
+  case OPCODE_SPUT_SHORT:
+    return true;
+  default:
+    return false;
+  }
+}
+
+/*
+ * Whether initializing the class may run code: it is not one of ours, or it
+ * or one of its superclasses has a static initializer.
+ */
+bool may_run_clinit(const DexType* type) {
+  while (type != nullptr && type != get_object_type()) {
+    auto cls = type_class(type);
+    if (cls == nullptr || cls->is_external() ||
+        cls->get_clinit() != nullptr) {
+      return true;
+    }
+    type = cls->get_super_class();
+  }
+  return false;
+}
+
+/*
+ * Whether the instruction may be the first use of a class, which then gets
+ * initialized. Invokes are dealt with separately.
+ */
+bool may_initialize_class(IRInstruction* insn) {
+  auto op = insn->opcode();
+  if (is_sget(op)) {
+    auto field = resolve_field_cached(
+        static_cast<IRFieldInstruction*>(insn)->field(), FieldSearch::Static);
+    return field == nullptr || may_run_clinit(field->get_class());
+  }
+  if (op == OPCODE_NEW_INSTANCE) {
+    return may_run_clinit(static_cast<IRTypeInstruction*>(insn)->get_type());
+  }
+  return false;
+}
+
+bool may_be_pure(DexMethod* method) {
+  if (method->get_code() == nullptr || is_synchronized(method) ||
+      is_declared_synchronized(method)) {
+    return false;
+  }
+  return !may_run_clinit(method->get_class());
+}
+
+}
+
+bool has_side_effects(DexOpcode opc) {
+  switch (opc) {
+  case OPCODE_RETURN_VOID:
+  case OPCODE_RETURN:
+  case OPCODE_RETURN_WIDE:
+  case OPCODE_RETURN_OBJECT:
+  case OPCODE_MONITOR_ENTER:
+  case OPCODE_MONITOR_EXIT:
+  case OPCODE_CHECK_CAST:
+  case OPCODE_FILL_ARRAY_DATA:
+  case OPCODE_THROW:
+  case OPCODE_GOTO:
+  case OPCODE_GOTO_16:
+  case OPCODE_GOTO_32:
+  case OPCODE_PACKED_SWITCH:
+  case OPCODE_SPARSE_SWITCH:
+  case OPCODE_IF_EQ:
+  case OPCODE_IF_NE:
+  case OPCODE_IF_LT:
+  case OPCODE_IF_GE:
+  case OPCODE_IF_GT:
+  case OPCODE_IF_LE:
+  case OPCODE_IF_EQZ:
+  case OPCODE_IF_NEZ:
+  case OPCODE_IF_LTZ:
+  case OPCODE_IF_GEZ:
+  case OPCODE_IF_GTZ:
+  case OPCODE_IF_LEZ:
+  case OPCODE_APUT:
+  case OPCODE_APUT_WIDE:
+  case OPCODE_APUT_OBJECT:
+  case OPCODE_APUT_BOOLEAN:
+  case OPCODE_APUT_BYTE:
+  case OPCODE_APUT_CHAR:
+  case OPCODE_APUT_SHORT:
+  case OPCODE_IPUT:
+  case OPCODE_IPUT_WIDE:
+  case OPCODE_IPUT_OBJECT:
+  case OPCODE_IPUT_BOOLEAN:
+  case OPCODE_IPUT_BYTE:
+  case OPCODE_IPUT_CHAR:
+  case OPCODE_IPUT_SHORT:
+  case OPCODE_SPUT:
+  case OPCODE_SPUT_WIDE:
+  case OPCODE_SPUT_OBJECT:
+  case OPCODE_SPUT_BOOLEAN:
+  case OPCODE_SPUT_BYTE:
+  case OPCODE_SPUT_CHAR:
+  case OPCODE_SPUT_SHORT:
+  case OPCODE_INVOKE_VIRTUAL:
+  case OPCODE_INVOKE_SUPER:
+  case OPCODE_INVOKE_DIRECT:
+  case OPCODE_INVOKE_STATIC:
+  case OPCODE_INVOKE_INTERFACE:
+  case OPCODE_INVOKE_VIRTUAL_RANGE:
+  case OPCODE_INVOKE_SUPER_RANGE:
+  case OPCODE_INVOKE_DIRECT_RANGE:
+  case OPCODE_INVOKE_STATIC_RANGE:
+  case OPCODE_INVOKE_INTERFACE_RANGE:
+  case FOPCODE_PACKED_SWITCH:
+  case FOPCODE_SPARSE_SWITCH:
+  case FOPCODE_FILLED_ARRAY:
+    return true;
+  default:
+    return false;
+  }
+  not_reached();
+}
+
+PureMethods::PureMethods() {
+  m_builtin.emplace(DexMethod::make_method(
+      "Ljava/lang/Class;", "getSimpleName", "Ljava/lang/String;", {}));
+}
+
+PureMethods::PureMethods(const Scope& scope) : PureMethods() {
+  // For each method that may be pure, the number of callees not proven pure
+  // yet, and for each callee the methods waiting on it.
+  std::unordered_map<const DexMethod*, size_t> pending;
+  std::unordered_map<const DexMethod*, std::vector<const DexMethod*>> waiting;
+  std::vector<const DexMethod*> ready;
+  walk_methods(scope, [&](DexMethod* method) {
+    if (!may_be_pure(method)) {
+      return;
+    }
+    std::unordered_set<const DexMethod*> callees;
+    std::unordered_set<const MethodItemEntry*> branches;
+    for (auto& mie : *method->get_code()) {
+      if (mie.type == MFLOW_TARGET && !branches.count(mie.target->src)) {
+        // a branch back to here, the loop may never end
+        return;
+      }
+      if (mie.type != MFLOW_OPCODE) {
+        continue;
+      }
+      auto op = mie.insn->opcode();
+      if (writes_or_throws(op) || may_initialize_class(mie.insn)) {
+        return;
+      }
+      if (is_branch(op)) {
+        branches.insert(&mie);
+      }
+      if (!is_invoke(op) || is_declared_pure(static_cast<IRMethodInstruction*>(
+                                mie.insn)->get_method())) {
+        continue;
+      }
+      auto callee = has_exact_target(op) ? exact_target(mie.insn) : nullptr;
+      if (callee == nullptr || callee == method || !may_be_pure(callee)) {
+        return;
+      }
+      callees.insert(callee);
+    }
+    pending[method] = callees.size();
+    if (callees.empty()) {
+      ready.push_back(method);
+    }
+    for (auto callee : callees) {
+      waiting[callee].push_back(method);
+    }
+  });
+
+  while (!ready.empty()) {
+    auto method = ready.back();
+    ready.pop_back();
+    m_summarized.insert(method);
+    auto it = waiting.find(method);
+    if (it == waiting.end()) {
+      continue;
+    }
+    for (auto caller : it->second) {
+      if (--pending.at(caller) == 0) {
+        ready.push_back(caller);
+      }
+    }
+  }
+  TRACE(DCE, 1, "Pure methods: %lu of %lu candidates\n",
+        m_summarized.size(), pending.size());
+}
+
+bool PureMethods::is_declared_pure(DexMethod* method) const {
+  return assumenosideeffects(method) || m_builtin.count(method);
+}
+
+bool PureMethods::is_pure_call(const IRInstruction* invoke) const {
+  auto method =
+      static_cast<const IRMethodInstruction*>(invoke)->get_method();
+  if (is_declared_pure(method)) {
+    return true;
+  }
+  if (m_summarized.empty() || !has_exact_target(invoke->opcode())) {
+    return false;
+  }
+  auto callee = exact_target(invoke);
+  return callee != nullptr && m_summarized.count(callee);
+}
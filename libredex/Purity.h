@@ -0,0 +1,66 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree. An additional grant
+ * of patent rights can be found in the PATENTS file in the same directory.
+ */
+
+#pragma once
+
+#include <unordered_set>
+
+#include "DexClass.h"
+#include "IRInstruction.h"
+
+/*
+ * These instructions have observable side effects or alter the control flow,
+ * so must always be considered live, regardless of whether their output is
+ * consumed by another instruction. Invokes are live unless they call a pure
+ * method.
+ */
+bool has_side_effects(DexOpcode opc);
+
+/**
+ * The methods that can be called without any observable effect but their
+ * return value, so a call whose result is unused can be removed.
+ *
+ * Besides the methods ProGuard is told about with -assumenosideeffects and a
+ * few well known library methods, a method with code is pure when it writes
+ * no field or array, takes no lock, throws nothing explicitly, and only calls
+ * pure methods through invoke-static or invoke-direct. It must also not be
+ * synchronized, and must have no loop, which may not end. Neither its class
+ * nor the classes it reads static fields of or instantiates may have a static
+ * initializer, in them or their superclasses, which the call could be the one
+ * to trigger; classes outside of the scope are assumed to have one.
+ *
+ * This is a least fixpoint: a method is only proven pure once all its callees
+ * are, so no recursive method is. As elsewhere in DCE, exceptions that may be
+ * raised implicitly (null dereferences, out of bounds array accesses) are not
+ * considered side effects.
+ */
+class PureMethods {
+ public:
+  // only the well known methods and the -assumenosideeffects ones
+  PureMethods();
+  explicit PureMethods(const Scope& scope);
+
+  PureMethods(const PureMethods&) = delete;
+  PureMethods& operator=(const PureMethods&) = delete;
+
+  /*
+   * Whether the invoke calls a pure method. The methods proven pure from their
+   * code are only known to be the target of invoke-static and invoke-direct.
+   */
+  bool is_pure_call(const IRInstruction* invoke) const;
+
+  // the number of methods proven pure from their code
+  size_t size() const { return m_summarized.size(); }
+
+ private:
+  bool is_declared_pure(DexMethod* method) const;
+
+  std::unordered_set<const DexMethod*> m_builtin;
+  std::unordered_set<const DexMethod*> m_summarized;
+};
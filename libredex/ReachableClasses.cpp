@@ -9,7 +9,7 @@
 
 #include "ReachableClasses.h"
 
-#include <chrono>
+#include <mutex>
 #include <string>
 #include <unordered_set>
 #include <fstream>
@@ -193,36 +193,23 @@ bool in_reflected_pkg(DexClass* dclass,
 }
 
 /*
- * Initializes list of classes that are reachable via reflection, and calls
- * or from code.
- *
- * These include:
- *  - Classes used in the manifest (e.g. activities, services, etc)
- *  - View or Fragment classes used in layouts
- *  - Classes that are in certain packages (specified in the reflected_packages
- *    section of the config) and classes that extend from them
- *  - Classes marked with special annotations (keep_annotations in config)
- *  - Classes reachable from native libraries
+ * Marks reachable the classes named by the strings passed to Class.forName,
+ * looking for them in all the methods of the scope in parallel.
  */
-void init_permanently_reachable_classes(
-  const Scope& scope,
-  const Json::Value& config,
-  const std::unordered_set<DexType*>& no_optimizations_anno
-) {
-  PassConfig pc(config);
-
-  auto match = std::make_tuple(
+void mark_class_for_name_reachable(const Scope& scope) {
+  static const auto match = std::make_tuple(
       m::const_string(/* const-string {vX}, <any string> */),
       m::invoke_static(/* invoke-static {vX}, java.lang.Class;.forName */
                        m::opcode_method(
                            m::named<DexMethod>("forName") &&
                            m::on_class<DexMethod>("Ljava/lang/Class;")) &&
                        m::has_n_args(1)));
-
-  walk_matching_opcodes(
+  std::mutex class_names_lock;
+  std::vector<const DexString*> class_names;
+  walk_matching_opcodes_parallel(
       scope,
       match,
-      [&](const DexMethod* meth, size_t n, IRInstruction** insns) {
+      [&](const DexMethod*, size_t, IRInstruction** insns) {
         auto const_string = static_cast<IRStringInstruction*>(insns[0]);
         auto invoke_static = static_cast<IRMethodInstruction*>(insns[1]);
         // Make sure that the registers agree
@@ -230,27 +217,52 @@ void init_permanently_reachable_classes(
                        ? invoke_static->range_base()
                        : invoke_static->src(0);
         if (const_string->dest() == src) {
-          auto classname = JavaNameUtil::external_to_internal(
-              const_string->get_string()->c_str());
-          TRACE(RENAME, 4, "Found Class.forName of: %s, marking %s reachable\n",
-                const_string->get_string()->c_str(),
-                classname.c_str());
-          mark_reachable_by_classname(classname, true);
+          std::lock_guard<std::mutex> guard(class_names_lock);
+          class_names.push_back(const_string->get_string());
         }
       });
 
-  std::string apk_dir;
+  for (const auto& name : class_names) {
+    auto classname = JavaNameUtil::external_to_internal(name->c_str());
+    TRACE(RENAME, 4, "Found Class.forName of: %s, marking %s reachable\n",
+          name->c_str(),
+          classname.c_str());
+    mark_reachable_by_classname(classname, true);
+  }
+}
+
+/*
+ * Initializes list of classes that are reachable via reflection, and calls
+ * or from code.
+ *
+ * These include:
+ *  - Classes used in the manifest (e.g. activities, services, etc)
+ *  - View or Fragment classes used in layouts
+ *  - Classes that are in certain packages (specified in the reflected_packages
+ *    section of the config) and classes that extend from them
+ *  - Classes marked with special annotations (keep_annotations in config)
+ *  - Classes reachable from native libraries
+ */
+void init_permanently_reachable_classes(
+  const Scope& scope,
+  const Json::Value& config,
+  ConfigFiles& cfg
+) {
+  PassConfig pc(config);
+
   std::vector<std::string> reflected_package_names;
   std::vector<std::string> annotations;
   std::vector<std::string> class_members;
   std::vector<std::string> methods;
 
-  pc.get("apk_dir", "", apk_dir);
   pc.get("keep_packages", {}, reflected_package_names);
   pc.get("keep_annotations", {}, annotations);
   pc.get("keep_class_members", {}, class_members);
   pc.get("keep_methods", {}, methods);
 
+  mark_class_for_name_reachable(scope);
+
+  const auto& no_optimizations_anno = cfg.get_no_optimizations_annos();
   std::unordered_set<DexType*> annotation_types(
     no_optimizations_anno.begin(),
     no_optimizations_anno.end());
@@ -264,22 +276,22 @@ void init_permanently_reachable_classes(
   keep_class_members(scope, class_members);
   keep_methods(scope, methods);
 
-  if (apk_dir.size()) {
+  {
+    const auto& classes = cfg.get_resource_classes();
     // Classes present in manifest
-    std::string manifest = apk_dir + std::string("/AndroidManifest.xml");
-    for (std::string classname : get_manifest_classes(manifest)) {
+    for (std::string classname : classes.manifest) {
       TRACE(PGR, 3, "manifest: %s\n", classname.c_str());
       mark_reachable_by_classname(classname, false);
     }
 
     // Classes present in XML layouts
-    for (std::string classname : get_layout_classes(apk_dir)) {
+    for (std::string classname : classes.layout) {
       TRACE(PGR, 3, "xml_layout: %s\n", classname.c_str());
       mark_reachable_by_classname(classname, false);
     }
 
     // Classnames present in native libraries (lib/*/*.so)
-    for (std::string classname : get_native_classes(apk_dir)) {
+    for (std::string classname : classes.native) {
       auto type = DexType::get_type(classname.c_str());
       if (type == nullptr) continue;
       TRACE(PGR, 3, "native_lib: %s\n", classname.c_str());
@@ -337,11 +349,11 @@ void init_reachable_classes(
     const Scope& scope,
     const Json::Value& config,
     const redex::ProguardConfiguration& pg_config,
-    const std::unordered_set<DexType*>& no_optimizations_anno) {
+    ConfigFiles& cfg) {
   // Find classes that are reachable in such a way that none of the redex
   // passes will cause them to be no longer reachable.  For example, if a
   // class is referenced from the manifest.
-  init_permanently_reachable_classes(scope, config, no_optimizations_anno);
+  init_permanently_reachable_classes(scope, config, cfg);
 
   // Classes that are reachable in ways that could change as Redex runs. For
   // example, a class might be instantiated from a method, but if that method
@@ -11,6 +11,7 @@
 
 #include <string>
 
+#include "ConfigFiles.h"
 #include "DexClass.h"
 #include "DexUtil.h"
 
@@ -18,7 +19,7 @@ void init_reachable_classes(
   const Scope& scope,
   const Json::Value& config,
   const redex::ProguardConfiguration& pg_config,
-  const std::unordered_set<DexType*>& no_optimizations_anno);
+  ConfigFiles& cfg);
 void recompute_classes_reachable_from_code(const Scope& scope);
 unsigned int init_seed_classes(
   const std::string seeds_filename,
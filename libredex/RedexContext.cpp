@@ -14,12 +14,17 @@
 
 #include "Debug.h"
 #include "DexClass.h"
+#include "Resolver.h"
 
 RedexContext* g_redex;
 
-RedexContext::RedexContext() {}
+RedexContext::RedexContext() {
+  clear_shared_ref_caches();
+}
 
 RedexContext::~RedexContext() {
+  // The shared resolution caches hold pointers into this context.
+  clear_shared_ref_caches();
   // Delete DexStrings.
   for (auto const& p : s_string_map) {
     delete p.second;
@@ -166,6 +171,7 @@ void RedexContext::mutate_field(DexField* field,
   r.type = ref.type != nullptr ? ref.type : field->m_ref.type;
   field->m_ref = r;
   s_field_map.emplace(r, field);
+  clear_shared_ref_caches();
 }
 
 DexTypeList* RedexContext::make_type_list(std::deque<DexType*>&& p) {
@@ -250,6 +256,7 @@ DexMethod* RedexContext::get_method(DexType* type,
 void RedexContext::erase_method(DexMethod* method) {
   std::lock_guard<std::mutex> lock(s_method_lock);
   s_method_map.erase(method->m_ref);
+  clear_shared_ref_caches();
 }
 
 void RedexContext::mutate_method(DexMethod* method,
@@ -275,14 +282,21 @@ void RedexContext::mutate_method(DexMethod* method,
   always_assert_log(s_method_map.find(r) == s_method_map.end(),
                     "Another method of the same signature already exists");
   s_method_map.emplace(r, method);
+  clear_shared_ref_caches();
 }
 
 void RedexContext::build_type_system(DexClass* cls) {
   std::lock_guard<std::mutex> l(m_type_system_mutex);
   const DexType* type = cls->get_type();
   m_type_to_class.emplace(type, cls);
-  const auto& super = cls->get_super_class();
-  if (super) m_class_hierarchy[super].push_back(type);
+  m_class_hierarchy.add_class(type, cls->get_super_class());
+  clear_shared_ref_caches();
+}
+
+void RedexContext::remove_from_type_system(DexClass* cls) {
+  std::lock_guard<std::mutex> l(m_type_system_mutex);
+  m_class_hierarchy.remove_class(cls->get_type());
+  clear_shared_ref_caches();
 }
 
 DexClass* RedexContext::type_class(const DexType* t) {
@@ -290,9 +304,12 @@ DexClass* RedexContext::type_class(const DexType* t) {
   return it != m_type_to_class.end() ? it->second : nullptr;
 }
 
-const std::vector<const DexType*>& RedexContext::get_children(
+ClassHierarchyIndex::TypeRange RedexContext::get_children(
   const DexType* type
 ) {
-  const auto& it = m_class_hierarchy.find(type);
-  return it != m_class_hierarchy.end() ? it->second : m_empty_types;
+  return m_class_hierarchy.get_children(type);
+}
+
+bool RedexContext::is_subclass(const DexType* parent, const DexType* child) {
+  return m_class_hierarchy.is_subclass(parent, child);
 }
@@ -18,7 +18,9 @@
 #include <pthread.h>
 #include <unordered_map>
 
+#include "ClassHierarchyIndex.h"
 #include "DexMemberRefs.h"
+#include "MemoryAccounting.h"
 
 class DexDebugInstruction;
 class DexString;
@@ -80,8 +82,10 @@ struct RedexContext {
   DexDebugEntry* make_dbg_entry(DexPosition* pos);
 
   void build_type_system(DexClass*);
+  void remove_from_type_system(DexClass*);
   DexClass* type_class(const DexType* t);
-  const std::vector<const DexType*>& get_children(const DexType* type);
+  ClassHierarchyIndex::TypeRange get_children(const DexType* type);
+  bool is_subclass(const DexType* parent, const DexType* child);
 
  private:
   struct carray_cmp {
@@ -91,36 +95,49 @@ struct RedexContext {
   };
 
   // DexString
-  std::map<const char*, DexString*, carray_cmp> s_string_map;
+  memory_accounting::
+      map<memory_accounting::CONTEXT, const char*, DexString*, carray_cmp>
+          s_string_map;
   std::mutex s_string_lock;
 
   // DexType
-  std::map<DexString*, DexType*> s_type_map;
+  memory_accounting::map<memory_accounting::CONTEXT, DexString*, DexType*>
+      s_type_map;
   std::mutex s_type_lock;
 
   // DexField
-  std::unordered_map<DexFieldRef, DexField*> s_field_map;
+  memory_accounting::
+      unordered_map<memory_accounting::CONTEXT, DexFieldRef, DexField*>
+          s_field_map;
   std::mutex s_field_lock;
 
   // DexTypeList
-  std::map<std::deque<DexType*>, DexTypeList*> s_typelist_map;
+  memory_accounting::
+      map<memory_accounting::CONTEXT, std::deque<DexType*>, DexTypeList*>
+          s_typelist_map;
   std::mutex s_typelist_lock;
 
   // DexProto
-  std::map<DexType*, std::map<DexTypeList*, DexProto*>> s_proto_map;
+  memory_accounting::map<
+      memory_accounting::CONTEXT,
+      DexType*,
+      memory_accounting::
+          map<memory_accounting::CONTEXT, DexTypeList*, DexProto*>>
+      s_proto_map;
   std::mutex s_proto_lock;
 
   // DexMethod
-  std::unordered_map<DexMethodRef, DexMethod*> s_method_map;
+  memory_accounting::
+      unordered_map<memory_accounting::CONTEXT, DexMethodRef, DexMethod*>
+          s_method_map;
   std::mutex s_method_lock;
 
   // Type-to-class map and class hierarchy
   std::mutex m_type_system_mutex;
-  std::unordered_map<const DexType*, DexClass*> m_type_to_class;
-  std::unordered_map<
-    const DexType*, std::vector<const DexType*>> m_class_hierarchy;
-
-  const std::vector<const DexType*> m_empty_types;
+  memory_accounting::
+      unordered_map<memory_accounting::CONTEXT, const DexType*, DexClass*>
+          m_type_to_class;
+  ClassHierarchyIndex m_class_hierarchy;
 };
 
 template <typename V>
@@ -18,3 +18,14 @@ std::unordered_set<std::string> get_native_classes(
     const std::string& apk_directory);
 std::unordered_set<std::string> get_layout_classes(
     const std::string& apk_directory);
+
+/**
+ * Class names referenced from the resources of an unpacked apk.
+ */
+struct ResourceClasses {
+  std::unordered_set<std::string> manifest;
+  std::unordered_set<std::string> layout;
+  std::unordered_set<std::string> native;
+};
+
+ResourceClasses get_resource_classes(const std::string& apk_directory);
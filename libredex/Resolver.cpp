@@ -172,3 +172,18 @@ DexField* resolve_field(
   }
   return nullptr;
 }
+
+MethodRefCache& shared_method_ref_cache() {
+  static MethodRefCache cache;
+  return cache;
+}
+
+FieldRefCache& shared_field_ref_cache() {
+  static FieldRefCache cache;
+  return cache;
+}
+
+void clear_shared_ref_caches() {
+  shared_method_ref_cache().clear();
+  shared_field_ref_cache().clear();
+}
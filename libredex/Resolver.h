@@ -6,11 +6,13 @@
 #include "DexUtil.h"
 #include "IRInstruction.h"
 
+#include <array>
+#include <atomic>
+#include <functional>
+#include <mutex>
 #include <unordered_map>
 #include <unordered_set>
 
-
-using MethodRefCache = std::unordered_map<DexMethod*, DexMethod*>;
 using MethodSet = std::unordered_set<DexMethod*>;
 
 /**
@@ -30,6 +32,97 @@ enum class MethodSearch {
   Any // any method (vmethods or dmethods) in class and up the hierarchy
 };
 
+/**
+ * Type of fields to resolve.
+ */
+enum class FieldSearch {
+  Static, Instance, Any
+};
+
+/**
+ * A thread safe map from (ref, search) to the definition the ref resolves
+ * to. The map is split in shards, each with its own lock, so that parallel
+ * walkers resolving refs don't all contend on the same mutex.
+ */
+template <typename Ref, typename Search>
+class RefCache {
+ public:
+  bool get(const Ref* ref, Search search, Ref*& def) const {
+    Key key{ref, search};
+    auto& shard = m_shards[KeyHash()(key) % N_SHARDS];
+    std::lock_guard<std::mutex> lock(shard.lock);
+    auto it = shard.map.find(key);
+    if (it == shard.map.end()) return false;
+    def = it->second;
+    return true;
+  }
+
+  void put(const Ref* ref, Search search, Ref* def) {
+    Key key{ref, search};
+    auto& shard = m_shards[KeyHash()(key) % N_SHARDS];
+    std::lock_guard<std::mutex> lock(shard.lock);
+    // Flag the cache before inserting, under the shard lock: a concurrent
+    // clear() either resets the flag first and then empties this shard after
+    // the insert, or sees the flag and empties it.
+    m_dirty = true;
+    shard.map[key] = def;
+  }
+
+  void clear() {
+    // Mutations are frequent in some passes, avoid walking the shards when
+    // nothing was cached since the last clear.
+    if (!m_dirty.exchange(false)) return;
+    for (auto& shard : m_shards) {
+      std::lock_guard<std::mutex> lock(shard.lock);
+      shard.map.clear();
+    }
+  }
+
+ private:
+  static constexpr size_t N_SHARDS = 16;
+
+  struct Key {
+    const Ref* ref;
+    Search search;
+    bool operator==(const Key& that) const {
+      return ref == that.ref && search == that.search;
+    }
+  };
+
+  struct KeyHash {
+    size_t operator()(const Key& key) const {
+      return std::hash<const Ref*>()(key.ref) * 31 +
+             static_cast<size_t>(key.search);
+    }
+  };
+
+  struct Shard {
+    std::mutex lock;
+    std::unordered_map<Key, Ref*, KeyHash> map;
+  };
+
+  mutable std::array<Shard, N_SHARDS> m_shards;
+  std::atomic<bool> m_dirty{false};
+};
+
+using MethodRefCache = RefCache<DexMethod, MethodSearch>;
+using FieldRefCache = RefCache<DexField, FieldSearch>;
+
+/**
+ * Process-wide resolution caches, shared by all passes and threads.
+ *
+ * They are cleared whenever the set of methods or fields visible to
+ * resolution changes through the DexClass / RedexContext APIs (add_method,
+ * remove_method, add_field, remove_field, DexMethod::change,
+ * DexField::change, new classes entering the type system) and by the
+ * PassManager between passes. Code that edits the member vectors of a class
+ * in place must call clear_shared_ref_caches() itself before resolving
+ * through the shared caches again.
+ */
+MethodRefCache& shared_method_ref_cache();
+FieldRefCache& shared_field_ref_cache();
+void clear_shared_ref_caches();
+
 /**
  * Helper to map an opcode to a MethodSearch rule.
  */
@@ -118,18 +211,26 @@ inline DexMethod* resolve_method(
   if (method->is_def()) return method;
   auto cls = type_class(method->get_class());
   if (cls == nullptr) return nullptr;
-  auto def = ref_cache.find(method);
-  if (def != ref_cache.end()) {
-    return def->second;
+  DexMethod* mdef;
+  if (ref_cache.get(method, search, mdef)) {
+    return mdef;
   }
-  auto mdef = resolve_method(
+  mdef = resolve_method(
       cls, method->get_name(), method->get_proto(), search);
   if (mdef != nullptr) {
-    ref_cache[method] = mdef;
+    ref_cache.put(method, search, mdef);
   }
   return mdef;
 }
 
+/**
+ * Resolve a method through the process-wide cache.
+ */
+inline DexMethod* resolve_method_cached(DexMethod* method,
+                                        MethodSearch search) {
+  return resolve_method(method, search, shared_method_ref_cache());
+}
+
 /**
  * Given a scope defined by DexClass, a name and a proto look for the vmethod
  * on the top ancestor. Essentially finds where the method was introduced.
@@ -177,13 +278,6 @@ inline DexMethod* find_collision(
   return find_collision_excepting(nullptr, name, proto, cls, is_virtual, false);
 }
 
-/**
- * Type of fields to resolve.
- */
-enum class FieldSearch {
-  Static, Instance, Any
-};
-
 /**
  * Given a scope, a field name and a field type search the class
  * hierarchy for a definition of the field
@@ -207,3 +301,32 @@ inline DexField* resolve_field(
   return resolve_field(
       field->get_class(), field->get_name(), field->get_type(), search);
 }
+
+/**
+ * Resolve a field and cache the mapping, like the MethodRefCache overload
+ * of resolve_method.
+ */
+inline DexField* resolve_field(
+    DexField* field, FieldSearch search, FieldRefCache& ref_cache) {
+  if (field->is_def()) {
+    return field;
+  }
+  DexField* fdef;
+  if (ref_cache.get(field, search, fdef)) {
+    return fdef;
+  }
+  fdef = resolve_field(
+      field->get_class(), field->get_name(), field->get_type(), search);
+  if (fdef != nullptr) {
+    ref_cache.put(field, search, fdef);
+  }
+  return fdef;
+}
+
+/**
+ * Resolve a field through the process-wide cache.
+ */
+inline DexField* resolve_field_cached(
+    DexField* field, FieldSearch search = FieldSearch::Any) {
+  return resolve_field(field, search, shared_field_ref_cache());
+}
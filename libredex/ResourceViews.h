@@ -0,0 +1,115 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree. An additional grant
+ * of patent rights can be found in the PATENTS file in the same directory.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace android {
+class ResStringPool;
+class ResXMLParser;
+}
+
+/**
+ * Read-only UTF-8 access to the strings of binary resource files, without
+ * going through String16/String8.
+ */
+
+/**
+ * A borrowed UTF-8 string, in the spirit of C++17's std::string_view. It
+ * points into a resource file or into the cache of a StringPoolView and is
+ * only valid as long as those are.
+ *
+ * A default constructed view has a null data() and stands for "no string",
+ * which is different from an empty string.
+ */
+class Utf8View {
+ public:
+  Utf8View() = default;
+  Utf8View(const char* data, size_t size) : m_data(data), m_size(size) {}
+
+  const char* data() const { return m_data; }
+  size_t size() const { return m_size; }
+  bool empty() const { return m_size == 0; }
+  const char* begin() const { return m_data; }
+  const char* end() const { return m_data + m_size; }
+
+  bool contains(char c) const {
+    return m_size != 0 && memchr(m_data, c, m_size) != nullptr;
+  }
+
+  bool operator==(const char* str) const {
+    return m_data != nullptr && strlen(str) == m_size &&
+           memcmp(m_data, str, m_size) == 0;
+  }
+  bool operator!=(const char* str) const { return !(*this == str); }
+
+  std::string str() const { return std::string(m_data, m_size); }
+
+ private:
+  const char* m_data{nullptr};
+  size_t m_size{0};
+};
+
+/**
+ * UTF-8 view of a ResStringPool. Strings of UTF-8 pools, which is what aapt
+ * produces for most resource files, are returned in place. Strings of UTF-16
+ * pools are converted on first access and cached in the view.
+ *
+ * Not thread-safe, use one view per thread and pool.
+ */
+class StringPoolView {
+ public:
+  explicit StringPoolView(const android::ResStringPool& pool);
+
+  /**
+   * The string at index `idx`, or a null view if there is none.
+   */
+  Utf8View at(int32_t idx);
+
+  size_t size() const { return m_size; }
+
+ private:
+  const android::ResStringPool& m_pool;
+  size_t m_size;
+  bool m_utf8;
+  std::vector<std::string> m_decoded;
+  std::vector<bool> m_is_decoded;
+};
+
+/**
+ * Names and string values of the current element of a ResXMLParser, as UTF-8
+ * views. `strings` must be a view of the parser's string pool.
+ */
+class XmlElementView {
+ public:
+  XmlElementView(const android::ResXMLParser& parser, StringPoolView& strings)
+      : m_parser(parser), m_strings(strings) {}
+
+  int32_t name_id() const;
+  Utf8View name() { return m_strings.at(name_id()); }
+
+  size_t attribute_count() const;
+  int32_t attribute_name_id(size_t idx) const;
+  Utf8View attribute_name(size_t idx) {
+    return m_strings.at(attribute_name_id(idx));
+  }
+
+  /**
+   * The value of the attribute if it is a string, a null view otherwise.
+   */
+  Utf8View attribute_string_value(size_t idx);
+
+ private:
+  const android::ResXMLParser& m_parser;
+  StringPoolView& m_strings;
+};
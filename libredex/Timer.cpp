@@ -15,7 +15,8 @@ unsigned Timer::s_indent = 0;
 
 Timer::Timer(std::string msg)
   : m_msg(msg),
-    m_start(std::chrono::high_resolution_clock::now())
+    m_start(std::chrono::high_resolution_clock::now()),
+    m_event("Timer", m_msg)
 {
   ++s_indent;
 }
@@ -12,6 +12,8 @@
 #include <string>
 #include <chrono>
 
+#include "TraceEvents.h"
+
 struct Timer {
   Timer(std::string msg);
   ~Timer();
@@ -20,4 +22,5 @@ struct Timer {
   static unsigned s_indent;
   std::string m_msg;
   std::chrono::high_resolution_clock::time_point m_start;
+  ScopedTraceEvent m_event;
 };
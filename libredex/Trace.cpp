@@ -9,26 +9,309 @@
 
 #include "Trace.h"
 
+#include <algorithm>
 #include <array>
+#include <atomic>
+#include <chrono>
 #include <cstdarg>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <mutex>
 #include <string>
 #include <unordered_map>
 #include <utility>
+#include <vector>
+
+int g_trace_levels[N_TRACE_MODULES];
+bool trace_detail::g_buffered{false};
 
 namespace {
 
+using trace_detail::Arg;
+
+/*
+ * Ring buffer of binary trace records. Only the thread owning the ring
+ * writes to it; the dumper reads it once the run is over. The oldest records
+ * are dropped to make room for new ones.
+ *
+ * Records are 8-byte aligned and never wrap around the end of the buffer,
+ * the space left at the end is marked as padding instead. Positions grow
+ * monotonically, their offset in the buffer is position % capacity.
+ *
+ * A record is a RecordHeader followed by one kind byte per argument (padded
+ * to 8 bytes) and the argument values: 8 bytes for scalars, a 4-byte length
+ * followed by the characters (padded to 8 bytes) for strings.
+ */
+struct RecordHeader {
+  uint32_t size;
+  uint16_t module;
+  uint8_t level;
+  uint8_t nargs;
+  uint64_t nanos;
+  const char* fmt;
+};
+
+constexpr uint32_t PADDING = 0xffffffff;
+constexpr size_t MIN_BUFFER_SIZE = 64 * 1024;
+// Longer strings are truncated, so that any record fits a buffer.
+constexpr size_t MAX_STRING_ARG = 2048;
+constexpr size_t MAX_ARGS = 16;
+
+size_t align8(size_t size) { return (size + 7) & ~size_t(7); }
+
+class Ring {
+ public:
+  explicit Ring(size_t capacity)
+      : m_data(new uint8_t[capacity]), m_capacity(capacity) {}
+
+  /*
+   * Space for a record of `size` bytes, made by evicting the oldest records
+   * as needed. publish() makes it visible to the dumper.
+   */
+  uint8_t* reserve(size_t size) {
+    auto head = m_head.load(std::memory_order_relaxed);
+    auto tail = m_tail.load(std::memory_order_relaxed);
+    size_t offset = head % m_capacity;
+    size_t pad = offset + size > m_capacity ? m_capacity - offset : 0;
+    while (head + pad + size - tail > m_capacity) {
+      tail += record_size_at(tail);
+    }
+    m_tail.store(tail, std::memory_order_release);
+    if (pad != 0) {
+      memcpy(&m_data[offset], &PADDING, sizeof(PADDING));
+      head += pad;
+    }
+    m_pending = head + size;
+    return &m_data[head % m_capacity];
+  }
+
+  void publish() { m_head.store(m_pending, std::memory_order_release); }
+
+  template <typename Fn>
+  void for_each_record(Fn fn) const {
+    auto tail = m_tail.load(std::memory_order_acquire);
+    auto head = m_head.load(std::memory_order_acquire);
+    while (tail < head) {
+      uint32_t size;
+      memcpy(&size, &m_data[tail % m_capacity], sizeof(size));
+      if (size != PADDING) {
+        fn(&m_data[tail % m_capacity]);
+      }
+      tail += record_size_at(tail);
+    }
+  }
+
+ private:
+  size_t record_size_at(uint64_t pos) const {
+    uint32_t size;
+    memcpy(&size, &m_data[pos % m_capacity], sizeof(size));
+    return size == PADDING ? m_capacity - pos % m_capacity : size;
+  }
+
+  std::unique_ptr<uint8_t[]> m_data;
+  size_t m_capacity;
+  std::atomic<uint64_t> m_head{0};
+  std::atomic<uint64_t> m_tail{0};
+  uint64_t m_pending{0};
+};
+
+struct ThreadBuffers {
+  uint32_t id;
+  std::array<std::atomic<Ring*>, N_TRACE_MODULES> rings;
+
+  explicit ThreadBuffers(uint32_t id) : id(id) {
+    for (auto& ring : rings) {
+      ring.store(nullptr, std::memory_order_relaxed);
+    }
+  }
+
+  ~ThreadBuffers() {
+    for (auto& ring : rings) {
+      delete ring.load();
+    }
+  }
+};
+
+/*
+ * Formats a recorded message with snprintf, one conversion at a time.
+ */
+class Formatter {
+ public:
+  Formatter(const char* fmt, const Arg* args, size_t nargs)
+      : m_fmt(fmt), m_args(args), m_nargs(nargs) {}
+
+  std::string format() {
+    std::string out;
+    const char* p = m_fmt;
+    while (*p != '\0') {
+      if (*p != '%') {
+        out += *p++;
+        continue;
+      }
+      if (p[1] == '%') {
+        out += '%';
+        p += 2;
+        continue;
+      }
+      p = format_conversion(p, out);
+    }
+    return out;
+  }
+
+ private:
+  const Arg* next_arg() {
+    return m_next < m_nargs ? &m_args[m_next++] : nullptr;
+  }
+
+  template <typename T>
+  static int print(char* buf,
+                   size_t size,
+                   const std::string& spec,
+                   const std::vector<int>& stars,
+                   T value) {
+    switch (stars.size()) {
+    case 0:
+      return snprintf(buf, size, spec.c_str(), value);
+    case 1:
+      return snprintf(buf, size, spec.c_str(), stars[0], value);
+    default:
+      return snprintf(buf, size, spec.c_str(), stars[0], stars[1], value);
+    }
+  }
+
+  template <typename T>
+  void append(std::string& out,
+              const std::string& spec,
+              const std::vector<int>& stars,
+              T value) {
+    char buf[256];
+    int len = print(buf, sizeof(buf), spec, stars, value);
+    if (len < 0) {
+      return;
+    }
+    if (static_cast<size_t>(len) < sizeof(buf)) {
+      out.append(buf, len);
+      return;
+    }
+    std::vector<char> big(len + 1);
+    print(big.data(), big.size(), spec, stars, value);
+    out.append(big.data(), len);
+  }
+
+  // Parses the conversion starting at `p` and returns the position after it.
+  const char* format_conversion(const char* p, std::string& out) {
+    std::string spec("%");
+    std::vector<int> stars;
+    ++p;
+    while (*p != '\0' && strchr("-+ #0'", *p) != nullptr) {
+      spec += *p++;
+    }
+    auto width_or_precision = [&]() {
+      if (*p == '*') {
+        auto arg = next_arg();
+        stars.push_back(arg != nullptr && arg->kind == Arg::INT ? arg->i : 0);
+        spec += *p++;
+      }
+      while (*p >= '0' && *p <= '9') {
+        spec += *p++;
+      }
+    };
+    width_or_precision();
+    if (*p == '.') {
+      spec += *p++;
+      width_or_precision();
+    }
+    // h and hh are kept, anything longer is printed as long long.
+    std::string narrow;
+    bool wide = false;
+    while (*p != '\0' && strchr("hlLqjzt", *p) != nullptr) {
+      wide = wide || *p != 'h';
+      narrow += *p++;
+    }
+    char conv = *p;
+    if (conv == '\0') {
+      return p;
+    }
+    ++p;
+    auto arg = next_arg();
+    auto kind = arg != nullptr ? arg->kind : Arg::NONE;
+    switch (conv) {
+    case 'd':
+    case 'i':
+    case 'u':
+    case 'o':
+    case 'x':
+    case 'X':
+    case 'c': {
+      if (kind != Arg::INT) {
+        break;
+      }
+      bool is_signed = conv == 'd' || conv == 'i';
+      if (conv == 'c') {
+        append(out, spec + conv, stars, static_cast<int>(arg->i));
+      } else if (wide && is_signed) {
+        append(out, spec + "ll" + conv, stars,
+               static_cast<long long>(arg->i));
+      } else if (wide) {
+        append(out, spec + "ll" + conv, stars,
+               static_cast<unsigned long long>(arg->i));
+      } else if (is_signed) {
+        append(out, spec + narrow + conv, stars, static_cast<int>(arg->i));
+      } else {
+        append(out, spec + narrow + conv, stars,
+               static_cast<unsigned>(arg->i));
+      }
+      return p;
+    }
+    case 'f':
+    case 'F':
+    case 'e':
+    case 'E':
+    case 'g':
+    case 'G':
+    case 'a':
+    case 'A':
+      if (kind == Arg::DOUBLE) {
+        append(out, spec + conv, stars, arg->d);
+        return p;
+      }
+      break;
+    case 's':
+      if (kind == Arg::STRING) {
+        append(out, spec + conv, stars, arg->s);
+        return p;
+      }
+      break;
+    case 'p':
+      if (kind == Arg::POINTER || kind == Arg::INT) {
+        append(out, spec + conv, stars, arg->p);
+        return p;
+      }
+      break;
+    default:
+      break;
+    }
+    out += "<?>";
+    return p;
+  }
+
+  const char* m_fmt;
+  const Arg* m_args;
+  size_t m_nargs;
+  size_t m_next{0};
+};
+
 struct Tracer {
 
   bool m_show_timestamps{false};
   const char* m_method_filter;
 
-  Tracer() {
+  Tracer() : m_origin(std::chrono::steady_clock::now()) {
     const char* traceenv = getenv("TRACE");
     const char* envfile = getenv("TRACEFILE");
     const char* show_timestamps = getenv("SHOW_TIMESTAMPS");
+    const char* buffer_kb = getenv("TRACE_BUFFER_KB");
     m_method_filter = getenv("TRACE_METHOD_FILTER");
     if (!traceenv) {
       return;
@@ -39,24 +322,31 @@ struct Tracer {
     if (show_timestamps) {
       m_show_timestamps = true;
     }
+    if (buffer_kb) {
+      m_buffer_size = std::max(
+          MIN_BUFFER_SIZE, align8(strtoul(buffer_kb, nullptr, 10) * 1024));
+      trace_detail::g_buffered = true;
+    }
   }
 
   ~Tracer() {
+    dump();
+    // Nothing can be traced anymore.
+    std::fill(std::begin(g_trace_levels), std::end(g_trace_levels), 0);
     if (m_file) {
       fclose(m_file);
     }
   }
 
-  bool traceEnabled(TraceModule module, int level) {
-    return level <= m_level || level <= m_traces[module];
+  bool filtered_out() const {
+    return m_method_filter && TraceContext::s_current_method &&
+           strstr(TraceContext::s_current_method->c_str(), m_method_filter) ==
+               nullptr;
   }
 
   void trace(const char* fmt, va_list ap) {
-    if (m_method_filter && TraceContext::s_current_method) {
-      if (strstr(TraceContext::s_current_method->c_str(), m_method_filter) ==
-          nullptr) {
-        return;
-      }
+    if (filtered_out()) {
+      return;
     }
     if (m_show_timestamps) {
       char buf[26];
@@ -69,7 +359,164 @@ struct Tracer {
     fflush(m_file);
   }
 
+  void record(TraceModule module,
+              int level,
+              const char* fmt,
+              const Arg* args,
+              size_t nargs) {
+    if (filtered_out()) {
+      return;
+    }
+    nargs = std::min(nargs, MAX_ARGS);
+    size_t string_lens[MAX_ARGS];
+    size_t size = sizeof(RecordHeader) + align8(nargs);
+    for (size_t i = 0; i < nargs; ++i) {
+      if (args[i].kind == Arg::STRING) {
+        string_lens[i] = args[i].s != nullptr
+                             ? strnlen(args[i].s, MAX_STRING_ARG)
+                             : strlen("(null)");
+        size += align8(sizeof(uint32_t) + string_lens[i]);
+      } else {
+        size += sizeof(uint64_t);
+      }
+    }
+
+    auto& ring = get_ring(module);
+    uint8_t* out = ring.reserve(size);
+    RecordHeader header{static_cast<uint32_t>(size),
+                        static_cast<uint16_t>(module),
+                        static_cast<uint8_t>(level),
+                        static_cast<uint8_t>(nargs),
+                        nanos_since_start(),
+                        fmt};
+    memcpy(out, &header, sizeof(header));
+    uint8_t* kinds = out + sizeof(header);
+    uint8_t* values = kinds + align8(nargs);
+    for (size_t i = 0; i < nargs; ++i) {
+      kinds[i] = args[i].kind;
+      if (args[i].kind == Arg::STRING) {
+        uint32_t len = string_lens[i];
+        memcpy(values, &len, sizeof(len));
+        memcpy(values + sizeof(len), args[i].s ? args[i].s : "(null)", len);
+        values += align8(sizeof(len) + len);
+      } else {
+        memcpy(values, &args[i].i, sizeof(uint64_t));
+        values += sizeof(uint64_t);
+      }
+    }
+    ring.publish();
+  }
+
+  void dump() {
+    if (!trace_detail::g_buffered || m_dumped.exchange(true)) {
+      return;
+    }
+    std::lock_guard<std::mutex> guard(m_threads_lock);
+    auto file = m_dump_file != nullptr ? m_dump_file : m_file;
+    struct Entry {
+      uint64_t nanos;
+      uint32_t thread;
+      const uint8_t* record;
+    };
+    std::vector<Entry> entries;
+    for (const auto& thread : m_threads) {
+      for (const auto& ring : thread->rings) {
+        auto r = ring.load(std::memory_order_acquire);
+        if (r == nullptr) {
+          continue;
+        }
+        r->for_each_record([&](const uint8_t* record) {
+          RecordHeader header;
+          memcpy(&header, record, sizeof(header));
+          entries.push_back(Entry{header.nanos, thread->id, record});
+        });
+      }
+    }
+    std::stable_sort(entries.begin(), entries.end(),
+                     [](const Entry& a, const Entry& b) {
+                       return a.nanos < b.nanos;
+                     });
+    std::vector<Arg> args;
+    std::vector<std::string> strings;
+    for (const auto& entry : entries) {
+      decode(entry.record, args, strings);
+      RecordHeader header;
+      memcpy(&header, entry.record, sizeof(header));
+      if (m_show_timestamps) {
+        fprintf(file, "[%.6f T%u] ", header.nanos / 1e9, entry.thread);
+      }
+      fputs(Formatter(header.fmt, args.data(), args.size()).format().c_str(),
+            file);
+    }
+    fflush(file);
+  }
+
+  void set_buffering(size_t buffer_size, FILE* file) {
+    std::lock_guard<std::mutex> guard(m_threads_lock);
+    for (const auto& thread : m_threads) {
+      for (auto& ring : thread->rings) {
+        delete ring.exchange(nullptr);
+      }
+    }
+    m_buffer_size =
+        buffer_size != 0 ? std::max(MIN_BUFFER_SIZE, align8(buffer_size)) : 0;
+    m_dump_file = file;
+    m_dumped = false;
+    trace_detail::g_buffered = buffer_size != 0;
+  }
+
  private:
+  uint64_t nanos_since_start() const {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now() - m_origin)
+        .count();
+  }
+
+  Ring& get_ring(TraceModule module) {
+    thread_local ThreadBuffers* buffers = nullptr;
+    if (buffers == nullptr) {
+      std::lock_guard<std::mutex> guard(m_threads_lock);
+      if (m_threads.empty()) {
+        // Registered after static initialization, so that the buffers are
+        // dumped before any static destructor runs.
+        atexit(dump_trace_buffers);
+      }
+      m_threads.emplace_back(new ThreadBuffers(m_threads.size()));
+      buffers = m_threads.back().get();
+    }
+    auto ring = buffers->rings[module].load(std::memory_order_relaxed);
+    if (ring == nullptr) {
+      ring = new Ring(m_buffer_size);
+      buffers->rings[module].store(ring, std::memory_order_release);
+    }
+    return *ring;
+  }
+
+  static void decode(const uint8_t* record,
+                     std::vector<Arg>& args,
+                     std::vector<std::string>& strings) {
+    RecordHeader header;
+    memcpy(&header, record, sizeof(header));
+    args.assign(header.nargs, Arg());
+    strings.assign(header.nargs, std::string());
+    const uint8_t* kinds = record + sizeof(header);
+    const uint8_t* values = kinds + align8(header.nargs);
+    for (size_t i = 0; i < header.nargs; ++i) {
+      args[i].kind = static_cast<Arg::Kind>(kinds[i]);
+      if (args[i].kind == Arg::STRING) {
+        uint32_t len;
+        memcpy(&len, values, sizeof(len));
+        strings[i].assign(reinterpret_cast<const char*>(values + sizeof(len)),
+                          len);
+        args[i].s = strings[i].c_str();
+        values += align8(sizeof(len) + len);
+      } else {
+        memcpy(&args[i].i, values, sizeof(uint64_t));
+        values += sizeof(uint64_t);
+      }
+    }
+  }
+
   void init_trace_modules(const char* traceenv) {
     std::unordered_map<std::string, int> module_id_map;
 #define TM(x) module_id_map[ #x ] = x;
@@ -79,6 +526,7 @@ struct Tracer {
     const char* sep = ",: ";
     const char* tok = strtok(tracespec, sep);
     const char* module = nullptr;
+    int level_all = 0;
     while (tok) {
       auto level = strtol(tok, nullptr, 10);
       if (level) {
@@ -87,9 +535,9 @@ struct Tracer {
             fprintf(stderr, "Unknown trace level %s\n", module);
             abort();
           }
-          m_traces[module_id_map[module]] = level;
+          g_trace_levels[module_id_map[module]] = level;
         } else {
-          m_level = level;
+          level_all = level;
         }
         module = nullptr;
       } else {
@@ -98,6 +546,9 @@ struct Tracer {
       tok = strtok(nullptr, sep);
     }
     free(tracespec);
+    for (auto& level : g_trace_levels) {
+      level = std::max(level, level_all);
+    }
   }
 
   void init_trace_file(const char* envfile) {
@@ -117,17 +568,18 @@ struct Tracer {
 
  private:
   FILE* m_file{nullptr};
-  long m_level{0};
-  std::array<long, N_TRACE_MODULES> m_traces;
+  // set by set_buffering(), not owned
+  FILE* m_dump_file{nullptr};
+  std::chrono::steady_clock::time_point m_origin;
+  size_t m_buffer_size{0};
+  std::mutex m_threads_lock;
+  std::vector<std::unique_ptr<ThreadBuffers>> m_threads;
+  std::atomic<bool> m_dumped{false};
 };
 
 static Tracer tracer;
 }
 
-bool traceEnabled(TraceModule module, int level) {
-  return tracer.traceEnabled(module, level);
-}
-
 void trace(const char* fmt, ...) {
   va_list ap;
   va_start(ap, fmt);
@@ -135,4 +587,26 @@ void trace(const char* fmt, ...) {
   va_end(ap);
 }
 
+void dump_trace_buffers() {
+  tracer.dump();
+}
+
+void trace_detail::record(TraceModule module,
+                          int level,
+                          const char* fmt,
+                          const Arg* args,
+                          size_t nargs) {
+  tracer.record(module, level, fmt, args, nargs);
+}
+
+void trace_detail::set_buffering(size_t buffer_size, FILE* file) {
+  tracer.set_buffering(buffer_size, file);
+}
+
+std::string trace_detail::format(const char* fmt,
+                                 const Arg* args,
+                                 size_t nargs) {
+  return Formatter(fmt, args, nargs).format();
+}
+
 std::unique_ptr<std::string> TraceContext::s_current_method;
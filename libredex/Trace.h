@@ -7,8 +7,12 @@
  * of patent rights can be found in the PATENTS file in the same directory.
  */
 
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
 #include <memory>
 #include <string>
+#include <type_traits>
 
 #include "Util.h"
 
@@ -71,18 +75,129 @@ TMS
   N_TRACE_MODULES,
 };
 
-#ifdef NDEBUG
-#define TRACE(...)
-#else
-bool traceEnabled(TraceModule module, int level);
+/**
+ * TRACE is available in all builds. Tracing is configured through the
+ * environment:
+ *
+ *   TRACE=<level> or TRACE=<MODULE>:<level>,...  what to trace
+ *   TRACEFILE=<path or fd>                       where to write, stderr if unset
+ *   TRACE_BUFFER_KB=<n>                          buffer instead of writing
+ *   TRACE_METHOD_FILTER=<substring>              only trace in these methods
+ *   SHOW_TIMESTAMPS=1                            prefix messages with the time
+ *
+ * Checking whether a TRACE is enabled is a single load, and the arguments are
+ * only evaluated if it is.
+ *
+ * By default every message is formatted and written right away. With
+ * TRACE_BUFFER_KB, messages are instead recorded in binary form into a ring
+ * buffer of that size per thread and module, without locking, and formatted
+ * when the buffers are dumped at exit. Formatting is not async-signal-safe,
+ * so a crash loses the buffered messages. Only the most recent
+ * messages of each module and thread are kept. The format string must then
+ * outlive the run, i.e. be a literal.
+ */
+
+// The higher of the global and the module's trace level. Set before main()
+// from the environment and not changed after.
+extern int g_trace_levels[N_TRACE_MODULES];
+
+inline bool traceEnabled(TraceModule module, int level) {
+  return level <= g_trace_levels[module];
+}
+
 void trace(const char* fmt, ...);
-#define TRACE(module, level, fmt, ...) \
-  do {                                 \
-    if (traceEnabled(module, level)) { \
-      trace(fmt, ##__VA_ARGS__);       \
-    }                                  \
+
+/**
+ * Format and write the buffered messages of all threads, oldest first. Does
+ * nothing if messages are not buffered or were already dumped.
+ */
+void dump_trace_buffers();
+
+namespace trace_detail {
+
+extern bool g_buffered;
+
+/**
+ * A TRACE argument as recorded in the ring buffers.
+ */
+struct Arg {
+  enum Kind : uint8_t { NONE, INT, DOUBLE, STRING, POINTER };
+
+  Arg() : kind(NONE), i(0) {}
+
+  template <typename T,
+            typename std::enable_if<std::is_integral<T>::value ||
+                                        std::is_enum<T>::value,
+                                    int>::type = 0>
+  Arg(T value) : kind(INT), i(static_cast<int64_t>(value)) {}
+
+  template <typename T,
+            typename std::enable_if<std::is_floating_point<T>::value,
+                                    int>::type = 0>
+  Arg(T value) : kind(DOUBLE), d(value) {}
+
+  Arg(const char* value) : kind(STRING), s(value) {}
+  Arg(char* value) : kind(STRING), s(value) {}
+  Arg(const unsigned char* value)
+      : kind(STRING), s(reinterpret_cast<const char*>(value)) {}
+  Arg(std::nullptr_t) : kind(POINTER), p(nullptr) {}
+
+  template <typename T>
+  Arg(T* value) : kind(POINTER), p(value) {}
+
+  Kind kind;
+  union {
+    int64_t i;
+    double d;
+    const char* s;
+    const void* p;
+  };
+};
+
+void record(TraceModule module,
+            int level,
+            const char* fmt,
+            const Arg* args,
+            size_t nargs);
+
+/**
+ * Buffer messages in rings of `buffer_size` bytes, and dump them to `file`,
+ * instead of what TRACE_BUFFER_KB and TRACEFILE configured. A size of 0 stops
+ * buffering. Drops the messages buffered so far and allows another dump. The
+ * caller keeps ownership of `file`. No other thread may trace meanwhile; for
+ * tests.
+ */
+void set_buffering(size_t buffer_size, FILE* file);
+
+/**
+ * printf of recorded arguments, as done when dumping the buffers.
+ */
+std::string format(const char* fmt, const Arg* args, size_t nargs);
+
+template <typename... Args>
+std::string format(const char* fmt, Args... args) {
+  const Arg packed[] = {Arg(args)..., Arg()};
+  return format(fmt, packed, sizeof...(Args));
+}
+
+template <typename... Args>
+void log(TraceModule module, int level, const char* fmt, Args... args) {
+  if (g_buffered) {
+    const Arg packed[] = {Arg(args)..., Arg()};
+    record(module, level, fmt, packed, sizeof...(Args));
+  } else {
+    trace(fmt, args...);
+  }
+}
+
+}
+
+#define TRACE(module, level, fmt, ...)                        \
+  do {                                                        \
+    if (traceEnabled(module, level)) {                        \
+      trace_detail::log(module, level, fmt, ##__VA_ARGS__);   \
+    }                                                         \
   } while (0)
-#endif // NDEBUG
 
 struct TraceContext {
   explicit TraceContext(const std::string& current_method) {
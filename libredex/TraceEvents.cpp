@@ -0,0 +1,195 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree. An additional grant
+ * of patent rights can be found in the PATENTS file in the same directory.
+ */
+
+#include "TraceEvents.h"
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+using clock_type = std::chrono::steady_clock;
+
+struct Event {
+  const char* category;
+  std::string name;
+  clock_type::time_point start;
+  clock_type::time_point end;
+};
+
+/*
+ * Events are buffered per thread so that the WorkQueue threads do not contend
+ * while recording. The lock only guards against a concurrent write().
+ */
+struct ThreadEvents {
+  uint32_t tid;
+  std::string name;
+  std::mutex lock;
+  std::vector<Event> events;
+};
+
+void write_escaped(FILE* fp, const std::string& str) {
+  fputc('"', fp);
+  for (unsigned char c : str) {
+    switch (c) {
+    case '"':
+      fputs("\\\"", fp);
+      break;
+    case '\\':
+      fputs("\\\\", fp);
+      break;
+    default:
+      if (c < 0x20) {
+        fprintf(fp, "\\u%04x", c);
+      } else {
+        fputc(c, fp);
+      }
+    }
+  }
+  fputc('"', fp);
+}
+
+struct Recorder {
+  std::atomic<bool> m_enabled{false};
+  bool m_written{false};
+  std::string m_path;
+  clock_type::time_point m_origin;
+  std::mutex m_lock;
+  std::vector<std::unique_ptr<ThreadEvents>> m_threads;
+
+  Recorder() {
+    const char* path = getenv("TRACE_EVENTS_FILE");
+    init(path != nullptr ? path : "");
+  }
+
+  void init(const std::string& path) {
+    std::lock_guard<std::mutex> guard(m_lock);
+    for (const auto& thread : m_threads) {
+      std::lock_guard<std::mutex> thread_guard(thread->lock);
+      thread->events.clear();
+    }
+    m_path = path;
+    m_written = false;
+    m_origin = clock_type::now();
+    m_enabled = !m_path.empty();
+  }
+
+  ~Recorder() {
+    if (m_enabled && !m_written) {
+      write();
+    }
+  }
+
+  ThreadEvents* register_thread() {
+    std::lock_guard<std::mutex> guard(m_lock);
+    m_threads.emplace_back(new ThreadEvents());
+    auto thread = m_threads.back().get();
+    thread->tid = m_threads.size();
+    return thread;
+  }
+
+  double to_us(clock_type::time_point time) const {
+    return std::chrono::duration<double, std::micro>(time - m_origin).count();
+  }
+
+  void write() {
+    std::lock_guard<std::mutex> guard(m_lock);
+    FILE* fp = fopen(m_path.c_str(), "w");
+    if (fp == nullptr) {
+      perror("Error writing trace events");
+      return;
+    }
+    auto pid = getpid();
+    fprintf(fp, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    fprintf(fp,
+            "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":0,"
+            "\"args\":{\"name\":\"redex\"}}",
+            pid);
+    for (const auto& thread : m_threads) {
+      std::lock_guard<std::mutex> thread_guard(thread->lock);
+      if (!thread->name.empty()) {
+        fprintf(fp,
+                ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,"
+                "\"tid\":%u,\"args\":{\"name\":",
+                pid, thread->tid);
+        write_escaped(fp, thread->name);
+        fprintf(fp, "}}");
+      }
+      for (const auto& event : thread->events) {
+        fprintf(fp, ",\n{\"name\":");
+        write_escaped(fp, event.name);
+        fprintf(fp,
+                ",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,"
+                "\"pid\":%d,\"tid\":%u}",
+                event.category, to_us(event.start),
+                to_us(event.end) - to_us(event.start), pid, thread->tid);
+      }
+    }
+    fprintf(fp, "\n]}\n");
+    fclose(fp);
+    m_written = true;
+  }
+};
+
+Recorder& recorder() {
+  static Recorder s_recorder;
+  return s_recorder;
+}
+
+ThreadEvents& this_thread_events() {
+  thread_local ThreadEvents* events = recorder().register_thread();
+  return *events;
+}
+
+}
+
+namespace trace_events {
+
+bool enabled() {
+  return recorder().m_enabled.load(std::memory_order_relaxed);
+}
+
+void init(const std::string& path) {
+  recorder().init(path);
+}
+
+void set_thread_name(const std::string& name) {
+  if (!enabled()) {
+    return;
+  }
+  auto& thread = this_thread_events();
+  std::lock_guard<std::mutex> guard(thread.lock);
+  thread.name = name;
+}
+
+void write() {
+  if (enabled()) {
+    recorder().write();
+  }
+}
+
+}
+
+void ScopedTraceEvent::start(const char* category, std::string name) {
+  m_category = category;
+  m_name = std::move(name);
+  m_start = clock_type::now();
+}
+
+void ScopedTraceEvent::finish() {
+  auto end = clock_type::now();
+  auto& thread = this_thread_events();
+  std::lock_guard<std::mutex> guard(thread.lock);
+  thread.events.push_back(Event{m_category, std::move(m_name), m_start, end});
+}
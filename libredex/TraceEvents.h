@@ -0,0 +1,87 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree. An additional grant
+ * of patent rights can be found in the PATENTS file in the same directory.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <string>
+
+/**
+ * Timeline of a run in the Chrome trace-event format, for viewing in
+ * chrome://tracing or Perfetto.
+ *
+ * Recording is enabled by pointing TRACE_EVENTS_FILE at the file to write,
+ * e.g.
+ *
+ *   TRACE_EVENTS_FILE=/tmp/redex.json redex-all ...
+ *
+ * Timers, passes, the dex loader and writer and every WorkQueue work item
+ * record a span on the thread that ran them. When recording is disabled a
+ * span costs a single branch.
+ */
+namespace trace_events {
+
+bool enabled();
+
+/**
+ * Record to `path` from now on, or stop recording if it is empty, overriding
+ * TRACE_EVENTS_FILE. Drops the events recorded so far. Meant for tests, which
+ * cannot count on being the first to use the recorder.
+ */
+void init(const std::string& path);
+
+/**
+ * Name the calling thread in the timeline. Threads that are not named show up
+ * by their number.
+ */
+void set_thread_name(const std::string& name);
+
+/**
+ * Write the events recorded so far to TRACE_EVENTS_FILE. Called at exit if
+ * nobody did it before; tools that may not exit cleanly should call it
+ * themselves.
+ */
+void write();
+
+}
+
+/**
+ * Records a span from construction to destruction on the calling thread.
+ */
+class ScopedTraceEvent {
+ public:
+  ScopedTraceEvent(const char* category, const char* name) {
+    if (trace_events::enabled()) {
+      start(category, name);
+    }
+  }
+
+  ScopedTraceEvent(const char* category, const std::string& name) {
+    if (trace_events::enabled()) {
+      start(category, name);
+    }
+  }
+
+  ~ScopedTraceEvent() {
+    if (m_category != nullptr) {
+      finish();
+    }
+  }
+
+  ScopedTraceEvent(const ScopedTraceEvent&) = delete;
+  ScopedTraceEvent& operator=(const ScopedTraceEvent&) = delete;
+
+ private:
+  void start(const char* category, std::string name);
+  void finish();
+
+  const char* m_category{nullptr};
+  std::string m_name;
+  std::chrono::steady_clock::time_point m_start;
+};
@@ -206,10 +206,16 @@ void MethodItemEntry::gather_types(std::vector<DexType*>& ltype) const {
 ////////////////////////////////////////////////////////////////////////////////
 
 InlineContext::InlineContext(DexMethod* caller, bool use_liveness)
-    : original_regs(caller->get_code()->get_registers_size()),
+    : InlineContext(
+          caller, use_liveness, caller->get_code()->sum_opcode_sizes()) {}
+
+InlineContext::InlineContext(DexMethod* caller,
+                             bool use_liveness,
+                             uint64_t insn_size)
+    : estimated_insn_size(insn_size),
+      original_regs(caller->get_code()->get_registers_size()),
       caller_code(&*caller->get_code()) {
   auto mtcaller = caller_code;
-  estimated_insn_size = mtcaller->sum_opcode_sizes();
   if (use_liveness) {
     mtcaller->build_cfg(false);
     m_liveness = Liveness::analyze(mtcaller->cfg(), original_regs);
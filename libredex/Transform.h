@@ -107,7 +107,8 @@ enum MethodItemType {
  * that is necessary when inserting into a FatMethod; it gets done when the
  * FatMethod gets translated back into a DexMethod by IRCode::sync().
  */
-struct MethodItemEntry {
+struct MethodItemEntry
+    : memory_accounting::Accounted<memory_accounting::IR> {
   boost::intrusive::list_member_hook<> list_hook_;
   MethodItemType type;
   uint32_t addr;
@@ -371,6 +372,8 @@ class IRCode {
 
   FatMethod::iterator begin() { return m_fmethod->begin(); }
   FatMethod::iterator end() { return m_fmethod->end(); }
+  FatMethod::const_iterator begin() const { return m_fmethod->begin(); }
+  FatMethod::const_iterator end() const { return m_fmethod->end(); }
   FatMethod::iterator erase(FatMethod::iterator it) {
     return m_fmethod->erase(it);
   }
@@ -391,6 +394,10 @@ class InlineContext {
   uint16_t original_regs;
   IRCode* caller_code;
   InlineContext(DexMethod* caller, bool use_liveness);
+  /**
+   * Start from a known caller size rather than counting its instructions.
+   */
+  InlineContext(DexMethod* caller, bool use_liveness, uint64_t insn_size);
   Liveness live_out(IRInstruction*);
 };
 
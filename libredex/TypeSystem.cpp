@@ -0,0 +1,168 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree. An additional grant
+ * of patent rights can be found in the PATENTS file in the same directory.
+ */
+
+#include "TypeSystem.h"
+
+#include <algorithm>
+#include <functional>
+
+#include "DexUtil.h"
+#include "Trace.h"
+
+TypeSystem::TypeSystem(const Scope& scope) {
+  for (const auto& cls : scope) {
+    discover(cls->get_type());
+  }
+
+  m_words = (m_bit_ids.size() + 63) / 64;
+  m_bits.assign(m_classes.size() * m_words, 0);
+  auto set_bits = [&](type_id row, const DexType* type) {
+    auto from = m_classes.get_id(type);
+    auto dst = &m_bits[row * m_words];
+    if (is_known_class(from)) {
+      auto src = &m_bits[from * m_words];
+      for (size_t i = 0; i < m_words; ++i) {
+        dst[i] |= src[i];
+      }
+    }
+    auto bit = m_bit_ids.find(type);
+    if (bit != m_bit_ids.end()) {
+      dst[bit->second / 64] |= uint64_t(1) << (bit->second % 64);
+    }
+  };
+  for (const auto& cls : m_topo_order) {
+    auto row = m_classes.get_id(cls->get_type());
+    if (cls->get_super_class() != nullptr) {
+      set_bits(row, cls->get_super_class());
+    }
+    for (const auto& intf : cls->get_interfaces()->get_type_list()) {
+      set_bits(row, intf);
+    }
+  }
+  snapshot();
+  TRACE(VIRT, 2, "TypeSystem: %ld types, %ld interfaces\n",
+        m_pre.size(), m_bit_ids.size());
+}
+
+void TypeSystem::snapshot() {
+  m_classes.get_intervals(m_pre, m_post);
+  std::unordered_map<const DexType*, TypeEntry> entries;
+  for (type_id id = 0; id < m_pre.size(); ++id) {
+    auto type = m_classes.get_type(id);
+    entries.emplace(type, TypeEntry{type, id, NO_BIT});
+  }
+  for (const auto& it : m_bit_ids) {
+    auto entry = entries.emplace(
+        it.first,
+        TypeEntry{it.first, ClassHierarchyIndex::NO_TYPE, NO_BIT});
+    entry.first->second.bit = it.second;
+  }
+  m_entries.reserve(entries.size());
+  for (const auto& it : entries) {
+    m_entries.push_back(it.second);
+  }
+  std::sort(m_entries.begin(), m_entries.end(),
+            [](const TypeEntry& a, const TypeEntry& b) {
+              return std::less<const DexType*>()(a.type, b.type);
+            });
+}
+
+const TypeSystem::TypeEntry* TypeSystem::find(const DexType* type) const {
+  auto it = std::lower_bound(m_entries.begin(), m_entries.end(), type,
+                             [](const TypeEntry& entry, const DexType* t) {
+                               return std::less<const DexType*>()(entry.type,
+                                                                  t);
+                             });
+  return it != m_entries.end() && it->type == type ? &*it : nullptr;
+}
+
+uint32_t TypeSystem::intern_bit(const DexType* type) {
+  auto it = m_bit_ids.find(type);
+  if (it != m_bit_ids.end()) {
+    return it->second;
+  }
+  uint32_t bit = m_bit_ids.size();
+  m_bit_ids.emplace(type, bit);
+  return bit;
+}
+
+void TypeSystem::discover(DexType* type) {
+  auto id = m_classes.get_id(type);
+  if (is_known_class(id)) {
+    return;
+  }
+  const auto cls = type_class(type);
+  if (cls == nullptr) {
+    return;
+  }
+  auto super = cls->get_super_class();
+  m_classes.add_class(type, super);
+  id = m_classes.get_id(type);
+  if (m_is_class.size() < m_classes.size()) {
+    m_is_class.resize(m_classes.size(), false);
+  }
+  m_is_class[id] = true;
+  if (super != nullptr) {
+    if (is_interface(cls)) {
+      intern_bit(super);
+    }
+    discover(super);
+  }
+  for (const auto& intf : cls->get_interfaces()->get_type_list()) {
+    intern_bit(intf);
+    discover(intf);
+  }
+  m_topo_order.push_back(cls);
+}
+
+bool TypeSystem::is_subclass(const DexType* parent,
+                             const DexType* child) const {
+  if (parent == child) {
+    return true;
+  }
+  auto child_entry = find(child);
+  if (!is_known_class(child_entry)) {
+    return ::is_subclass(parent, child);
+  }
+  auto parent_entry = find(parent);
+  return parent_entry != nullptr &&
+         parent_entry->id != ClassHierarchyIndex::NO_TYPE &&
+         is_subclass_id(parent_entry->id, child_entry->id);
+}
+
+bool TypeSystem::implements(const DexType* type, const DexType* intf) const {
+  auto entry = find(type);
+  if (!is_known_class(entry)) {
+    return type != intf && check_cast(const_cast<DexType*>(type),
+                                      const_cast<DexType*>(intf));
+  }
+  auto intf_entry = find(intf);
+  return intf_entry != nullptr && intf_entry->bit != NO_BIT &&
+         test_bit(entry->id, intf_entry->bit);
+}
+
+bool TypeSystem::is_assignable_to(const DexType* from,
+                                  const DexType* to) const {
+  if (from == to) {
+    return true;
+  }
+  auto from_entry = find(from);
+  if (!is_known_class(from_entry)) {
+    return check_cast(const_cast<DexType*>(from), const_cast<DexType*>(to));
+  }
+  auto to_entry = find(to);
+  if (to_entry == nullptr) {
+    return false;
+  }
+  if (to_entry->id != ClassHierarchyIndex::NO_TYPE &&
+      is_subclass_id(to_entry->id, from_entry->id)) {
+    return true;
+  }
+  return to_entry->bit != NO_BIT && test_bit(from_entry->id, to_entry->bit);
+}
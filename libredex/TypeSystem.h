@@ -0,0 +1,115 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree. An additional grant
+ * of patent rights can be found in the PATENTS file in the same directory.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <unordered_map>
+#include <vector>
+
+#include "ClassHierarchyIndex.h"
+#include "DexClass.h"
+
+/**
+ * Snapshot of the type hierarchy reachable from a scope, answering subtype
+ * queries without walking the hierarchy.
+ *
+ * Superclass relations are answered by the DFS interval numbering of a
+ * ClassHierarchyIndex. On top of that every class gets a bitset of all the
+ * interfaces it implements, directly or through its superclasses and
+ * superinterfaces, so an implements query is a single bit test.
+ *
+ * Once built the snapshot is flat and immutable: the types are looked up by
+ * binary search in an array sorted by address, and the intervals and bitsets
+ * are indexed by type id, so queries take no lock and hash nothing.
+ *
+ * The snapshot includes every class in the scope plus all the classes
+ * (internal or external) reachable from them through superclasses and
+ * interfaces. Queries about types outside of the snapshot fall back to
+ * check_cast(). The snapshot is not updated when the hierarchy changes,
+ * rebuild it (or get it through the AnalysisManager) after such changes.
+ *
+ * The bitsets take (#types * #interfaces) bits, a few tens of MB for a
+ * large app.
+ */
+class TypeSystem {
+ public:
+  explicit TypeSystem(const Scope& scope);
+
+  /**
+   * True if `child` is `parent` or one of its subclasses. Interfaces are not
+   * considered.
+   */
+  bool is_subclass(const DexType* parent, const DexType* child) const;
+
+  /**
+   * True if the class `type` implements the interface `intf`, directly or
+   * through its superclasses or superinterfaces.
+   */
+  bool implements(const DexType* type, const DexType* intf) const;
+
+  /**
+   * True if a value of type `from` can be stored in a location of type `to`,
+   * i.e. a check-cast of `from` to `to` always succeeds. Same result as
+   * check_cast(from, to), including its limitations when parts of the
+   * hierarchy are missing.
+   */
+  bool is_assignable_to(const DexType* from, const DexType* to) const;
+
+  size_t num_types() const { return m_pre.size(); }
+  // interfaces, plus java.lang.Object as their superclass
+  size_t num_interfaces() const { return m_bit_ids.size(); }
+
+ private:
+  using type_id = ClassHierarchyIndex::type_id;
+  static constexpr uint32_t NO_BIT = std::numeric_limits<uint32_t>::max();
+
+  struct TypeEntry {
+    const DexType* type;
+    // id in m_classes, NO_TYPE for interfaces that are not classes
+    type_id id;
+    // bit in the bitsets, NO_BIT for types that have none
+    uint32_t bit;
+  };
+
+  void discover(DexType* type);
+  uint32_t intern_bit(const DexType* type);
+  void snapshot();
+  const TypeEntry* find(const DexType* type) const;
+  bool is_known_class(type_id id) const {
+    return id < m_is_class.size() && m_is_class[id];
+  }
+  bool is_known_class(const TypeEntry* entry) const {
+    return entry != nullptr && is_known_class(entry->id);
+  }
+  bool is_subclass_id(type_id parent, type_id child) const {
+    return m_pre[parent] <= m_pre[child] && m_post[child] <= m_post[parent];
+  }
+  bool test_bit(type_id row, uint32_t bit) const {
+    return (m_bits[row * m_words + bit / 64] >> (bit % 64)) & 1;
+  }
+
+  // only used while building the snapshot
+  ClassHierarchyIndex m_classes;
+  std::unordered_map<const DexType*, uint32_t> m_bit_ids;
+  // classes in an order where supertypes come before their subtypes
+  std::vector<const DexClass*> m_topo_order;
+
+  // types whose class was found while building the snapshot
+  std::vector<bool> m_is_class;
+  // every type with an id or a bit, sorted by address
+  std::vector<TypeEntry> m_entries;
+  // DFS interval of every type id, see ClassHierarchyIndex
+  std::vector<uint32_t> m_pre;
+  std::vector<uint32_t> m_post;
+  // one row of m_words words per type id in m_classes
+  std::vector<uint64_t> m_bits;
+  size_t m_words{0};
+};
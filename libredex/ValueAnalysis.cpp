@@ -0,0 +1,485 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree. An additional grant
+ * of patent rights can be found in the PATENTS file in the same directory.
+ */
+
+#include "ValueAnalysis.h"
+
+#include <deque>
+#include <limits>
+
+#include "ControlFlow.h"
+#include "DexUtil.h"
+#include "MethodSummaries.h"
+#include "Resolver.h"
+#include "Transform.h"
+
+namespace {
+
+constexpr uint32_t NO_SLOT = std::numeric_limits<uint32_t>::max();
+
+bool has_exact_target(DexOpcode op) {
+  switch (op) {
+  case OPCODE_INVOKE_STATIC:
+  case OPCODE_INVOKE_STATIC_RANGE:
+  case OPCODE_INVOKE_DIRECT:
+  case OPCODE_INVOKE_DIRECT_RANGE:
+    return true;
+  default:
+    return false;
+  }
+}
+
+// The method with code that an invoke-static or invoke-direct calls
+DexMethod* exact_callee(const IRInstruction* insn) {
+  if (!has_exact_target(insn->opcode())) {
+    return nullptr;
+  }
+  auto mop = const_cast<IRMethodInstruction*>(
+      static_cast<const IRMethodInstruction*>(insn));
+  auto callee = resolve_method_cached(mop->get_method(), opcode_to_search(mop));
+  if (callee == nullptr || callee->get_code() == nullptr) {
+    return nullptr;
+  }
+  return callee;
+}
+
+// Opcodes whose destination gets a value that does not depend on other
+// registers
+bool defines_value(DexOpcode op) {
+  switch (op) {
+  case OPCODE_CONST_4:
+  case OPCODE_CONST_16:
+  case OPCODE_CONST:
+  case OPCODE_CONST_STRING:
+  case OPCODE_CONST_STRING_JUMBO:
+  case OPCODE_CONST_CLASS:
+  case OPCODE_NEW_INSTANCE:
+  case OPCODE_NEW_ARRAY:
+    return true;
+  default:
+    return false;
+  }
+}
+
+}
+
+AbstractValue AbstractValue::bottom() {
+  AbstractValue value;
+  value.top = false;
+  return value;
+}
+
+AbstractValue AbstractValue::of_constant(int64_t constant) {
+  auto value = bottom();
+  value.is_constant = true;
+  value.constant = constant;
+  return value;
+}
+
+AbstractValue AbstractValue::of_object(const DexType* type) {
+  auto value = bottom();
+  value.non_null = true;
+  value.type = type;
+  return value;
+}
+
+bool AbstractValue::meet(const AbstractValue& that) {
+  if (that.top) {
+    return false;
+  }
+  if (top) {
+    *this = that;
+    return true;
+  }
+  auto old = *this;
+  if (!that.is_constant || that.constant != constant) {
+    is_constant = false;
+    constant = 0;
+  }
+  non_null = non_null && that.non_null;
+  if (that.type != type) {
+    type = nullptr;
+  }
+  return *this != old;
+}
+
+bool AbstractValue::operator==(const AbstractValue& that) const {
+  return top == that.top && is_constant == that.is_constant &&
+         constant == that.constant && non_null == that.non_null &&
+         type == that.type;
+}
+
+ValueAnalysis::ValueAnalysis(DexMethod* method,
+                             const MethodSummaries* summaries)
+    : m_method(method), m_summaries(summaries) {}
+
+void ValueAnalysis::run() {
+  auto code = m_method->get_code();
+  if (!track_registers()) {
+    // nothing to propagate, but the returns and calls are still there
+    record_all_calls();
+    return;
+  }
+  code->build_cfg(/* end_block_before_throw */ true);
+  const auto& cfg = code->cfg();
+  const auto& blocks = cfg.blocks();
+  if (blocks.empty()) {
+    return;
+  }
+  m_entry_states.resize(blocks.size());
+  auto& entry = m_entry_states.at(0);
+  entry.resize(m_nslots);
+  for (uint16_t reg = 0; reg < m_slot.size(); ++reg) {
+    if (m_slot[reg] != NO_SLOT) {
+      entry[m_slot[reg]] = entry_value(reg);
+    }
+  }
+
+  std::deque<Block*> work_list{blocks.at(0)};
+  std::vector<bool> queued(blocks.size(), false);
+  queued[0] = true;
+  std::vector<AbstractValue> state;
+  std::vector<AbstractValue> throw_state;
+  auto propagate = [&](Block* succ, const std::vector<AbstractValue>& out) {
+    auto& succ_entry = m_entry_states[succ->id()];
+    if (succ_entry.empty()) {
+      succ_entry = out;
+      return true;
+    }
+    bool changed = false;
+    for (size_t i = 0; i < m_nslots; ++i) {
+      changed |= succ_entry[i].meet(out[i]);
+    }
+    return changed;
+  };
+  while (!work_list.empty()) {
+    auto block = work_list.front();
+    work_list.pop_front();
+    queued[block->id()] = false;
+    state = m_entry_states[block->id()];
+    bool throws = false;
+    for (auto succ : block->succs()) {
+      throws |= cfg.edge(block, succ)[EDGE_THROW];
+    }
+    auto branch =
+        transfer(block, &state, throws ? &throw_state : nullptr, false);
+    for (auto succ : block->succs()) {
+      const auto& edge = cfg.edge(block, succ);
+      bool changed = false;
+      // The handlers see the registers as they were before the instruction
+      // that threw, which never wrote its destination.
+      if (edge[EDGE_THROW]) {
+        changed |= propagate(succ, throw_state);
+      }
+      if (is_executable(edge, branch)) {
+        changed |= propagate(succ, state);
+      }
+      if (changed && !queued[succ->id()]) {
+        queued[succ->id()] = true;
+        work_list.push_back(succ);
+      }
+    }
+  }
+
+  // the fixpoint is reached, record what the reachable code shows
+  for (auto block : blocks) {
+    if (m_entry_states[block->id()].empty()) {
+      continue;
+    }
+    state = m_entry_states[block->id()];
+    transfer(block, &state, nullptr, true);
+  }
+}
+
+bool ValueAnalysis::track_registers() {
+  auto code = m_method->get_code();
+  auto nregs = code->get_registers_size();
+  m_slot.assign(nregs, NO_SLOT);
+  for (uint16_t reg = nregs - code->get_ins_size(); reg < nregs; ++reg) {
+    if (!entry_value(reg).is_bottom()) {
+      track(reg);
+    }
+  }
+  std::vector<const IRInstruction*> moves;
+  const IRInstruction* last_insn = nullptr;
+  for (auto& mie : InstructionIterable(code)) {
+    auto insn = mie.insn;
+    auto op = insn->opcode();
+    if (defines_value(op) || op == OPCODE_INSTANCE_OF) {
+      track(insn->dest());
+    } else if (is_move_result(op) && last_insn != nullptr &&
+               (is_filled_new_array(last_insn->opcode()) ||
+                summarized_result(last_insn) != nullptr)) {
+      track(insn->dest());
+    } else if (is_move(op) && !insn->dest_is_wide()) {
+      moves.push_back(insn);
+    }
+    last_insn = insn;
+  }
+  if (m_nslots == 0) {
+    return false;
+  }
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (auto move : moves) {
+      if (m_slot[move->src(0)] != NO_SLOT && m_slot[move->dest()] == NO_SLOT) {
+        track(move->dest());
+        changed = true;
+      }
+    }
+  }
+  return true;
+}
+
+void ValueAnalysis::track(uint16_t reg) {
+  if (m_slot[reg] == NO_SLOT) {
+    m_slot[reg] = m_nslots++;
+  }
+}
+
+AbstractValue ValueAnalysis::entry_value(uint16_t reg) const {
+  auto code = m_method->get_code();
+  auto first_param = code->get_registers_size() - code->get_ins_size();
+  if (reg < first_param) {
+    return AbstractValue::bottom();
+  }
+  auto value = AbstractValue::bottom();
+  auto summary = m_summaries == nullptr ? nullptr : m_summaries->get(m_method);
+  if (summary != nullptr && !summary->params.empty()) {
+    value = summary->params.at(reg - first_param);
+  }
+  if (!is_static(m_method) && reg == first_param) {
+    // invoking a method on null throws before getting there
+    value.non_null = true;
+  }
+  return value;
+}
+
+const AbstractValue* ValueAnalysis::summarized_result(
+    const IRInstruction* invoke) const {
+  if (m_summaries == nullptr) {
+    return nullptr;
+  }
+  auto callee = exact_callee(invoke);
+  if (callee == nullptr) {
+    return nullptr;
+  }
+  auto summary = m_summaries->get(callee);
+  if (summary == nullptr || summary->ret.top || summary->ret.is_bottom()) {
+    return nullptr;
+  }
+  return &summary->ret;
+}
+
+AbstractValue ValueAnalysis::value(const std::vector<AbstractValue>& state,
+                                   uint16_t reg) const {
+  auto slot = m_slot[reg];
+  return slot == NO_SLOT ? AbstractValue::bottom() : state[slot];
+}
+
+void ValueAnalysis::set(std::vector<AbstractValue>* state,
+                        uint16_t reg,
+                        const AbstractValue& value) const {
+  auto slot = m_slot[reg];
+  if (slot != NO_SLOT) {
+    (*state)[slot] = value;
+  }
+}
+
+ValueAnalysis::Branch ValueAnalysis::transfer(
+    Block* block,
+    std::vector<AbstractValue>* state,
+    std::vector<AbstractValue>* throw_state,
+    bool last) {
+  const IRInstruction* last_insn = nullptr;
+  auto branch = Branch::UNKNOWN;
+  if (throw_state != nullptr) {
+    *throw_state = *state;
+  }
+  for (auto it = block->begin(); it != block->end(); ++it) {
+    if (throw_state != nullptr &&
+        ((it->type == MFLOW_FALLTHROUGH && it->throwing_mie != nullptr) ||
+         (it->type == MFLOW_OPCODE && (may_throw(it->insn->opcode()) ||
+                                       it->insn->opcode() == OPCODE_THROW)))) {
+      // the last of these in the block is where its throw edges leave from
+      *throw_state = *state;
+    }
+    if (it->type != MFLOW_OPCODE) {
+      continue;
+    }
+    auto insn = it->insn;
+    auto op = insn->opcode();
+    if (is_conditional_branch(op)) {
+      branch = evaluate(insn, *state);
+      if (last && branch != Branch::UNKNOWN) {
+        m_constant_branches.emplace(insn, branch == Branch::TAKEN);
+      }
+    } else if (last && is_return_value(op)) {
+      m_return_value.meet(value(*state, insn->src(0)));
+    } else if (last && m_record_calls && is_invoke(op)) {
+      record_call(insn, *state);
+    }
+    if (insn->dests_size()) {
+      auto result = AbstractValue::bottom();
+      const AbstractValue* summarized;
+      if (op == OPCODE_CONST_4 || op == OPCODE_CONST_16 ||
+          op == OPCODE_CONST) {
+        result = AbstractValue::of_constant(insn->literal());
+      } else if (op == OPCODE_CONST_STRING ||
+                 op == OPCODE_CONST_STRING_JUMBO) {
+        result = AbstractValue::of_object(get_string_type());
+      } else if (op == OPCODE_CONST_CLASS) {
+        result = AbstractValue::of_object(get_class_type());
+      } else if (op == OPCODE_NEW_INSTANCE || op == OPCODE_NEW_ARRAY) {
+        result = AbstractValue::of_object(
+            static_cast<const IRTypeInstruction*>(insn)->get_type());
+      } else if (op == OPCODE_INSTANCE_OF) {
+        result = instance_of(insn, *state);
+      } else if (is_move(op) && !insn->dest_is_wide()) {
+        result = value(*state, insn->src(0));
+      } else if (is_move_result(op) && last_insn != nullptr &&
+                 is_filled_new_array(last_insn->opcode())) {
+        result = AbstractValue::of_object(
+            static_cast<const IRTypeInstruction*>(last_insn)->get_type());
+      } else if (is_move_result(op) && last_insn != nullptr &&
+                 (summarized = summarized_result(last_insn)) != nullptr) {
+        result = *summarized;
+        if (last) {
+          m_summarized_results++;
+        }
+      }
+      set(state, insn->dest(), result);
+      if (insn->dest_is_wide()) {
+        set(state, insn->dest() + 1, AbstractValue::bottom());
+      }
+    }
+    last_insn = insn;
+  }
+  return branch;
+}
+
+ValueAnalysis::Branch ValueAnalysis::evaluate(
+    const IRInstruction* insn, const std::vector<AbstractValue>& state) const {
+  auto left = value(state, insn->src(0));
+  auto op = insn->opcode();
+  if (insn->srcs_size() == 1 && !left.is_constant && left.non_null) {
+    // comparing an object that is not null against null
+    if (op == OPCODE_IF_EQZ) {
+      return Branch::NOT_TAKEN;
+    } else if (op == OPCODE_IF_NEZ) {
+      return Branch::TAKEN;
+    }
+    return Branch::UNKNOWN;
+  }
+  auto right = insn->srcs_size() > 1 ? value(state, insn->src(1))
+                                     : AbstractValue::of_constant(0);
+  if (!left.is_constant || !right.is_constant) {
+    return Branch::UNKNOWN;
+  }
+  bool taken;
+  switch (op) {
+  case OPCODE_IF_EQ:
+  case OPCODE_IF_EQZ:
+    taken = left.constant == right.constant;
+    break;
+  case OPCODE_IF_NE:
+  case OPCODE_IF_NEZ:
+    taken = left.constant != right.constant;
+    break;
+  case OPCODE_IF_LT:
+  case OPCODE_IF_LTZ:
+    taken = left.constant < right.constant;
+    break;
+  case OPCODE_IF_GE:
+  case OPCODE_IF_GEZ:
+    taken = left.constant >= right.constant;
+    break;
+  case OPCODE_IF_GT:
+  case OPCODE_IF_GTZ:
+    taken = left.constant > right.constant;
+    break;
+  case OPCODE_IF_LE:
+  case OPCODE_IF_LEZ:
+    taken = left.constant <= right.constant;
+    break;
+  default:
+    always_assert_log(false, "Unexpected branch %s", SHOW(insn));
+    not_reached();
+  }
+  return taken ? Branch::TAKEN : Branch::NOT_TAKEN;
+}
+
+AbstractValue ValueAnalysis::instance_of(
+    const IRInstruction* insn, const std::vector<AbstractValue>& state) const {
+  auto object = value(state, insn->src(0));
+  if (object.is_constant && object.constant == 0) {
+    return AbstractValue::of_constant(0);
+  }
+  // check_cast may say no for a class whose hierarchy is not all known, so
+  // only its yes is used
+  auto target = static_cast<const IRTypeInstruction*>(insn)->get_type();
+  if (object.type != nullptr &&
+      check_cast(const_cast<DexType*>(object.type),
+                 const_cast<DexType*>(target))) {
+    return AbstractValue::of_constant(1);
+  }
+  return AbstractValue::bottom();
+}
+
+void ValueAnalysis::record_call(const IRInstruction* insn,
+                                const std::vector<AbstractValue>& state) {
+  auto callee = exact_callee(insn);
+  if (callee == nullptr) {
+    return;
+  }
+  Call call;
+  call.callee = callee;
+  if (is_invoke_range(insn->opcode())) {
+    for (uint16_t i = 0; i < insn->range_size(); ++i) {
+      call.args.push_back(value(state, insn->range_base() + i));
+    }
+  } else {
+    for (size_t i = 0; i < insn->srcs_size(); ++i) {
+      call.args.push_back(value(state, insn->src(i)));
+    }
+  }
+  m_calls.push_back(std::move(call));
+}
+
+void ValueAnalysis::record_all_calls() {
+  for (auto& mie : InstructionIterable(m_method->get_code())) {
+    auto insn = mie.insn;
+    if (is_return_value(insn->opcode())) {
+      m_return_value = AbstractValue::bottom();
+    } else if (m_record_calls && is_invoke(insn->opcode())) {
+      auto callee = exact_callee(insn);
+      if (callee != nullptr) {
+        Call call;
+        call.callee = callee;
+        call.args.resize(is_invoke_range(insn->opcode()) ? insn->range_size()
+                                                         : insn->srcs_size(),
+                         AbstractValue::bottom());
+        m_calls.push_back(std::move(call));
+      }
+    }
+  }
+}
+
+bool ValueAnalysis::is_executable(const ControlFlowGraph::EdgeFlags& edge,
+                                  Branch branch) {
+  switch (branch) {
+  case Branch::UNKNOWN:
+    return edge[EDGE_GOTO] || edge[EDGE_BRANCH];
+  case Branch::TAKEN:
+    return edge[EDGE_BRANCH];
+  case Branch::NOT_TAKEN:
+    return edge[EDGE_GOTO];
+  }
+  not_reached();
+}
@@ -0,0 +1,155 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree. An additional grant
+ * of patent rights can be found in the PATENTS file in the same directory.
+ */
+
+#pragma once
+
+#include <unordered_map>
+#include <vector>
+
+#include "ControlFlow.h"
+#include "DexClass.h"
+#include "IRInstruction.h"
+
+class MethodSummaries;
+
+/**
+ * What is known about a value: the constant it is, whether it can be null and
+ * the exact type of the object it holds. Each of these is a small lattice of
+ * its own, and a value with none of them known is the bottom of their
+ * product. TOP
+ * sits above all of these, for registers no value has reached yet.
+ */
+struct AbstractValue {
+  bool top{true};
+  bool is_constant{false};
+  int64_t constant{0};
+  bool non_null{false};
+  // the class of the object, not one of its subclasses
+  const DexType* type{nullptr};
+
+  static AbstractValue bottom();
+  static AbstractValue of_constant(int64_t value);
+  // a new object, never null
+  static AbstractValue of_object(const DexType* type);
+
+  bool is_bottom() const {
+    return !top && !is_constant && !non_null && type == nullptr;
+  }
+
+  /**
+   * Keep what this and that agree on, returns whether this changed.
+   */
+  bool meet(const AbstractValue& that);
+
+  bool operator==(const AbstractValue& that) const;
+  bool operator!=(const AbstractValue& that) const { return !(*this == that); }
+};
+
+/**
+ * Sparse conditional propagation of AbstractValues over the CFG of a method.
+ *
+ * Only the registers that may hold something known are tracked: the
+ * destinations of constants and allocations, of move-results of methods
+ * whose summary knows something about their return value, the parameters
+ * with a summary, and the registers these get moved into. All the others are
+ * bottom. A CFG edge is only followed once it is known to be executable, so
+ * all the branches of the method are solved in a single fixpoint.
+ *
+ * An instance-of is known to be 1 when the exact type of the object is
+ * known to be an instance of the class, and 0 on null.
+ *
+ * The summaries are only used for invoke-static and invoke-direct, whose
+ * target is known exactly.
+ */
+class ValueAnalysis {
+ public:
+  struct Call {
+    DexMethod* callee;
+    // the values of the registers passed in
+    std::vector<AbstractValue> args;
+  };
+
+  /**
+   * Without summaries, nothing is known about what callers pass in and what
+   * callees return.
+   */
+  ValueAnalysis(DexMethod* method, const MethodSummaries* summaries);
+
+  void run();
+
+  /**
+   * The conditional branches that always (true) or never (false) jump.
+   */
+  const std::unordered_map<IRInstruction*, bool>& constant_branches() const {
+    return m_constant_branches;
+  }
+
+  /**
+   * The meet of the values of the reachable returns, TOP when none are.
+   */
+  const AbstractValue& return_value() const { return m_return_value; }
+
+  /**
+   * The reachable invoke-static and invoke-direct that resolve to a method
+   * with code, in code order. Only recorded when record_calls is set.
+   */
+  const std::vector<Call>& calls() const { return m_calls; }
+  void set_record_calls(bool record_calls) { m_record_calls = record_calls; }
+
+  /**
+   * The number of reachable move-results whose value came from a summary.
+   */
+  size_t summarized_results() const { return m_summarized_results; }
+
+ private:
+  enum class Branch { UNKNOWN, TAKEN, NOT_TAKEN };
+
+  bool track_registers();
+  void track(uint16_t reg);
+  AbstractValue entry_value(uint16_t reg) const;
+  const AbstractValue* summarized_result(const IRInstruction* invoke) const;
+  AbstractValue value(const std::vector<AbstractValue>& state,
+                      uint16_t reg) const;
+  void set(std::vector<AbstractValue>* state,
+           uint16_t reg,
+           const AbstractValue& value) const;
+  /**
+   * Run the instructions of the block over state. When throw_state is given
+   * it gets the state before the last instruction of the block that may
+   * throw, the one its throw edges leave from.
+   */
+  Branch transfer(Block* block,
+                  std::vector<AbstractValue>* state,
+                  std::vector<AbstractValue>* throw_state,
+                  bool last);
+  Branch evaluate(const IRInstruction* insn,
+                  const std::vector<AbstractValue>& state) const;
+  AbstractValue instance_of(const IRInstruction* insn,
+                            const std::vector<AbstractValue>& state) const;
+  void record_call(const IRInstruction* insn,
+                   const std::vector<AbstractValue>& state);
+  void record_all_calls();
+  // whether the non-exceptional part of the edge can be taken
+  static bool is_executable(const ControlFlowGraph::EdgeFlags& edge,
+                            Branch branch);
+
+  DexMethod* m_method;
+  const MethodSummaries* m_summaries;
+  bool m_record_calls{false};
+  // the index of each register in the states
+  std::vector<uint32_t> m_slot;
+  uint32_t m_nslots{0};
+  // the state at the entry of each block, empty until the block is reached
+  std::vector<std::vector<AbstractValue>> m_entry_states;
+
+  std::unordered_map<IRInstruction*, bool> m_constant_branches;
+  AbstractValue m_return_value;
+  std::vector<Call> m_calls;
+  size_t m_summarized_results{0};
+};
@@ -670,21 +670,6 @@ void build_class_hierarchy(ClassHierarchy& hierarchy, DexClass* cls) {
   }
 }
 
-/**
- * Subclass check.
- * We can make this much faster in time.
- */
-bool is_subclass(const DexType* parent, const DexType* child) {
-  auto super = child;
-  while (super != nullptr) {
-    if (parent == super) return true;
-    const auto cls = type_class(super);
-    if (cls == nullptr) break;
-    super = cls->get_super_class();
-  }
-  return false;
-}
-
 /**
  * Find all scopes rooted to a given type and adds it to
  * ClassScope for the given type.
@@ -15,7 +15,9 @@
 #include "DexAnnotation.h"
 #include "DexClass.h"
 #include "Match.h"
+#include "MethodCosts.h"
 #include "Transform.h"
+#include "WorkQueue.h"
 
 /**
  * Walk all methods of all classes defined in 'scope' calling back
@@ -26,15 +28,53 @@ void walk_methods(const T& scope, MethodWalkerFn walker) {
   for (const auto& cls : scope) {
     for (auto dmethod : cls->get_dmethods()) {
       TraceContext context(dmethod->get_deobfuscated_name());
+      MethodCostScope cost(dmethod);
       walker(dmethod);
     }
     for (auto vmethod : cls->get_vmethods()) {
       TraceContext context(vmethod->get_deobfuscated_name());
+      MethodCostScope cost(vmethod);
       walker(vmethod);
     }
   };
 }
 
+/**
+ * walk_methods() with one work item per method on the WorkQueue, so the
+ * walker function is called from several threads at once. It runs without
+ * the TraceContext of walk_methods(), which is not thread safe; the
+ * MethodCostScope keeps its state per thread.
+ */
+template <class T, class MethodWalkerFn = void(DexMethod*)>
+void walk_methods_parallel(const T& scope, const MethodWalkerFn& walker) {
+  struct MethodWork {
+    const MethodWalkerFn* walker;
+    DexMethod* method;
+  };
+  std::vector<MethodWork> work;
+  for (const auto& cls : scope) {
+    for (auto dmethod : cls->get_dmethods()) {
+      work.push_back(MethodWork{&walker, dmethod});
+    }
+    for (auto vmethod : cls->get_vmethods()) {
+      work.push_back(MethodWork{&walker, vmethod});
+    }
+  }
+  std::vector<work_item> work_items;
+  work_items.reserve(work.size());
+  for (auto& w : work) {
+    work_items.push_back(work_item{
+        [](void* arg) {
+          auto w = static_cast<MethodWork*>(arg);
+          MethodCostScope cost(w->method);
+          (*w->walker)(w->method);
+        },
+        &w});
+  }
+  WorkQueue wq;
+  wq.run_work_items(work_items.data(), (int)work_items.size());
+}
+
 /**
  * Walk all fields of all classes defined in 'scope' calling back
  * the walker function.
@@ -65,13 +105,19 @@ void walk_code(const T& scope,
     for (auto dmethod : cls->get_dmethods()) {
       if (methodFilter(dmethod)) {
         auto code = dmethod->get_code();
-        if (code) codeWalker(dmethod, *code);
+        if (code) {
+          MethodCostScope cost(dmethod);
+          codeWalker(dmethod, *code);
+        }
       }
     }
     for (auto vmethod : cls->get_vmethods()) {
       if (methodFilter(vmethod)) {
         auto code = vmethod->get_code();
-        if (code) codeWalker(vmethod, *code);
+        if (code) {
+          MethodCostScope cost(vmethod);
+          codeWalker(vmethod, *code);
+        }
       }
     }
   };
@@ -88,6 +134,7 @@ void walk_opcodes(const T& scope,
       if (methodFilter(dmethod)) {
         auto code = dmethod->get_code();
         if (code) {
+          MethodCostScope cost(dmethod);
           for (auto& mie : *code) {
             if (mie.type != MFLOW_OPCODE) {
               continue;
@@ -101,6 +148,7 @@ void walk_opcodes(const T& scope,
       if (methodFilter(vmethod)) {
         auto code = vmethod->get_code();
         if (code) {
+          MethodCostScope cost(vmethod);
           for (auto& mie : *code) {
             if (mie.type != MFLOW_OPCODE) {
               continue;
@@ -201,28 +249,65 @@ void walk_matching_opcodes(
     [&](const DexMethod* m) {
       auto code = m->get_code();
       if (code) {
-        std::vector<IRInstruction*> insns;
-        for (auto& mie : InstructionIterable(code)) {
-          insns.emplace_back(mie.insn);
-        }
-        // No way to match if we have less insns than N
-        if (insns.size() < N) {
-          return;
-        }
-        // Try to match starting at i
-        for (size_t i = 0 ; i <= insns.size() - N ; ++i) {
-          if (m::insns_matcher<P, std::integral_constant<size_t, 0> >::matches_at(i, insns, p)) {
-            IRInstruction* insns_array[N];
-            for ( size_t c = 0 ; c < N ; ++c ) {
-              insns_array[c] = insns.at(i+c);
-            }
-            v(m, N, insns_array);
-          }
-        }
+        m::match_insns(
+            code->begin(), code->end(), p, [&](IRInstruction** insns) {
+              v(m, N, insns);
+              return true;
+            });
+      }
+    });
+}
+
+/**
+ * walk_matching_opcodes() with the methods spread over the WorkQueue, see
+ * walk_methods_parallel(). The walker function is called from several
+ * threads, but never for two matches of the same method at once.
+ */
+template<
+    typename P,
+    size_t N = std::tuple_size<P>::value,
+    typename V = void(const DexMethod*, size_t n, IRInstruction**)>
+void walk_matching_opcodes_parallel(
+  const Scope& scope, const P& p, const V& v) {
+  walk_methods_parallel(
+    scope,
+    [&](const DexMethod* m) {
+      auto code = m->get_code();
+      if (code) {
+        m::match_insns(
+            code->begin(), code->end(), p, [&](IRInstruction** insns) {
+              v(m, N, insns);
+              return true;
+            });
       }
     });
 }
 
+/**
+ * The matches of walk_matching_opcodes_in_block() within one method.
+ */
+template <
+    typename P,
+    size_t N = std::tuple_size<P>::value,
+    typename V = void(
+        const DexMethod*, IRCode*, Block*, size_t n, IRInstruction**)>
+void walk_matching_opcodes_in_method_blocks(DexMethod* m,
+                                            const P& p,
+                                            const V& v) {
+  auto code = m->get_code();
+  if (!code) {
+    return;
+  }
+  code->build_cfg();
+  for (Block* block : code->cfg().blocks()) {
+    m::match_insns(
+        block->begin(), block->end(), p, [&](IRInstruction** insns) {
+          v(m, &*code, block, N, insns);
+          return true;
+        });
+  }
+}
+
 /**
  * walker that respects basic block boundaries.
  *
@@ -239,32 +324,26 @@ void walk_matching_opcodes_in_block(const Scope& scope,
   walk_methods(
     scope,
     [&](DexMethod* m) {
-      auto code = m->get_code();
-      if (!code) {
-        return;
-      }
-      code->build_cfg();
-      for (Block* block : code->cfg().blocks()) {
-        std::vector<IRInstruction*> insns;
-        for (auto mie = block->begin() ; mie != block->end() ; mie++) {
-          if (mie->type == MFLOW_OPCODE) {
-            insns.emplace_back(mie->insn);
-          }
-        }
-        // No way to match if we have less insns than N
-        if (insns.size() >= N) {
-          // Try to match starting at i
-          for (size_t i = 0 ; i <= insns.size() - N ; ++i) {
-            if (m::insns_matcher<P, std::integral_constant<size_t, 0>>::
-                    matches_at(i, insns, p)) {
-              IRInstruction* insns_array[N];
-              for (size_t c = 0 ; c < N ; ++c) {
-                insns_array[c] = insns.at(i+c);
-              }
-              v(m, &*code, block, N, insns_array);
-            }
-          }
-        }
-      }
+      walk_matching_opcodes_in_method_blocks<P, N, V>(m, p, v);
+    });
+}
+
+/**
+ * walk_matching_opcodes_in_block() with the methods spread over the
+ * WorkQueue, see walk_methods_parallel(). The walker function is called from
+ * several threads, but never for two matches of the same method at once.
+ */
+template <
+    typename P,
+    size_t N = std::tuple_size<P>::value,
+    typename V = void(
+        const DexMethod*, IRCode*, Block*, size_t n, IRInstruction**)>
+void walk_matching_opcodes_in_block_parallel(const Scope& scope,
+                                             const P& p,
+                                             const V& v) {
+  walk_methods_parallel(
+    scope,
+    [&](DexMethod* m) {
+      walk_matching_opcodes_in_method_blocks<P, N, V>(m, p, v);
     });
 }
@@ -12,6 +12,7 @@
 #include <stdio.h>
 
 #include "Trace.h"
+#include "TraceEvents.h"
 
 /*
  * Question: What happens when you alot yourself 30 minutes
@@ -65,11 +66,14 @@ bool WorkQueue::steal_work(per_thread* self) {
 
 void* WorkQueue::worker_thread(void* priv) {
   per_thread* self = (per_thread*)priv;
+  trace_events::set_thread_name("WorkQueue worker " +
+                                std::to_string(self->thread_num));
   while (1) {
     std::unique_lock<std::mutex> self_unique_lock(self->lock);
     if (self->next < self->last) {
       work_item* todo = &self->wi[self->next++];
       self_unique_lock.unlock();
+      ScopedTraceEvent event("WorkQueue", "work item");
       todo->function(todo->arg);
       continue;
     }
@@ -109,6 +113,7 @@ WorkQueue::WorkQueue() {
 
 /* Caller owns memory for witems.  WorkQueue does not free it. */
 void WorkQueue::run_work_items(work_item* witems, int count) {
+  ScopedTraceEvent event("WorkQueue", "run_work_items");
   std::lock_guard<std::mutex> guard(s_work_running);
   std::unique_lock<std::mutex> s_unique_lock(s_lock);
   while (s_threads_complete < WORKER_THREADS) {
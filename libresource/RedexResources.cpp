@@ -7,21 +7,35 @@
  * of patent rights can be found in the PATENTS file in the same directory.
  */
 
+#include <algorithm>
 #include <cstdio>
 #include <cstdlib>
-#include <fstream>
-#include <sstream>
+#include <cstring>
+#include <fcntl.h>
+#include <initializer_list>
+#include <memory>
 #include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <unordered_map>
 #include <unordered_set>
 #include <vector>
 #include <boost/filesystem.hpp>
 
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 #include "androidfw/ResourceTypes.h"
 #include "utils/TypeHelpers.h"
-#include "utils/String16.h"
-#include "utils/String8.h"
 
+#include "RedexResources.h"
+#include "ResourceViews.h"
 #include "StringUtil.h"
+#include "WorkQueue.h"
 
 constexpr size_t MIN_CLASSNAME_LENGTH = 10;
 constexpr size_t MAX_CLASSNAME_LENGTH = 500;
@@ -30,30 +44,115 @@ using path_t = boost::filesystem::path;
 using dir_iterator = boost::filesystem::directory_iterator;
 using rdir_iterator = boost::filesystem::recursive_directory_iterator;
 
+namespace {
+
+/*
+ * Read-only mapping of a whole file. data() is null if the file could not be
+ * mapped or is empty.
+ */
+class MappedFile {
+ public:
+  explicit MappedFile(const std::string& filename) {
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+      return;
+    }
+    struct stat buf;
+    if (fstat(fd, &buf) == 0 && buf.st_size > 0) {
+      auto mapping = mmap(nullptr, buf.st_size, PROT_READ,
+                          MAP_FILE | MAP_SHARED, fd, 0);
+      if (mapping != MAP_FAILED) {
+        m_data = static_cast<const char*>(mapping);
+        m_size = buf.st_size;
+      }
+    }
+    close(fd);
+  }
+
+  ~MappedFile() {
+    if (m_data != nullptr) {
+      munmap(const_cast<char*>(m_data), m_size);
+    }
+  }
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  const char* data() const { return m_data; }
+  size_t size() const { return m_size; }
+
+ private:
+  const char* m_data{nullptr};
+  size_t m_size{0};
+};
 
-std::string convert_from_string16(const android::String16& string16) {
-  android::String8 string8(string16);
-  std::string converted(string8.string());
-  return converted;
 }
 
 
-// Returns the attribute with the given name for the current XML element
+namespace {
+
+/*
+ * Matches the entries of a binary XML string pool against a fixed list of
+ * strings. Element and attribute names are string pool indices, so each
+ * entry is compared at most once per document instead of once per element.
+ */
+class StringPoolMatcher {
+ public:
+  StringPoolMatcher(StringPoolView& pool,
+                    std::initializer_list<const char*> strings)
+      : m_pool(pool), m_strings(strings), m_matches(pool.size(), UNKNOWN) {}
+
+  /*
+   * Returns the position in the list of the string at pool index `idx`, or
+   * -1 if it is not in the list.
+   */
+  int match(int32_t idx) {
+    if (idx < 0 || static_cast<size_t>(idx) >= m_matches.size()) {
+      return NO_MATCH;
+    }
+    auto& result = m_matches[idx];
+    if (result == UNKNOWN) {
+      result = NO_MATCH;
+      auto str = m_pool.at(idx);
+      for (size_t i = 0; i < m_strings.size(); ++i) {
+        if (str == m_strings[i]) {
+          result = i;
+          break;
+        }
+      }
+    }
+    return result;
+  }
+
+  static constexpr int NO_MATCH = -1;
+
+ private:
+  static constexpr int8_t UNKNOWN = -2;
+
+  StringPoolView& m_pool;
+  std::vector<const char*> m_strings;
+  std::vector<int8_t> m_matches;
+};
+
+constexpr int StringPoolMatcher::NO_MATCH;
+constexpr int8_t StringPoolMatcher::UNKNOWN;
+
+}
+
+// Returns the attribute at position `which` in `attributes` for the current
+// XML element
 std::string get_attribute_value(
-    const android::ResXMLTree& parser,
-    const android::String16& attribute_name) {
+    XmlElementView& element,
+    StringPoolMatcher& attributes,
+    int which) {
 
-  const size_t attr_count = parser.getAttributeCount();
+  const size_t attr_count = element.attribute_count();
 
   for (size_t i = 0; i < attr_count; ++i) {
-    size_t len;
-    android::String16 key(parser.getAttributeName(i, &len));
-    if (key == attribute_name) {
-      const char16_t* p = parser.getAttributeStringValue(i, &len);
-      if (p != nullptr) {
-        android::String16 target(p, len);
-        std::string converted = convert_from_string16(target);
-        return converted;
+    if (attributes.match(element.attribute_name_id(i)) == which) {
+      auto value = element.attribute_string_value(i);
+      if (value.data() != nullptr) {
+        return value.str();
       }
     }
   }
@@ -73,24 +172,10 @@ std::string dotname_to_dexname(const std::string& classname) {
 /*
  * Parse AndroidManifest from buffer, return a list of class names that are referenced
  */
-std::unordered_set<std::string> extract_classes_from_manifest(const std::string& manifest_contents) {
-
-  // Tags
-  android::String16 activity("activity");
-  android::String16 activity_alias("activity-alias");
-  android::String16 application("application");
-  android::String16 provider("provider");
-  android::String16 receiver("receiver");
-  android::String16 service("service");
-  android::String16 instrumentation("instrumentation");
-
-  // Attributes
-  android::String16 authorities("authorities");
-  android::String16 name("name");
-  android::String16 target_activity("targetActivity");
+std::unordered_set<std::string> extract_classes_from_manifest(const char* data, size_t size) {
 
   android::ResXMLTree parser;
-  parser.setTo(manifest_contents.data(), manifest_contents.size());
+  parser.setTo(data, size);
 
   std::unordered_set<std::string> result;
 
@@ -98,26 +183,38 @@ std::unordered_set<std::string> extract_classes_from_manifest(const std::string&
     return result;
   }
 
+  enum { ACTIVITY, ACTIVITY_ALIAS, APPLICATION, PROVIDER, RECEIVER, SERVICE,
+         INSTRUMENTATION };
+  StringPoolView strings(parser.getStrings());
+  XmlElementView element(parser, strings);
+  StringPoolMatcher tags(strings,
+                         {"activity", "activity-alias", "application",
+                          "provider", "receiver", "service",
+                          "instrumentation"});
+  enum { AUTHORITIES, NAME, TARGET_ACTIVITY };
+  StringPoolMatcher attributes(strings,
+                               {"authorities", "name", "targetActivity"});
+
   android::ResXMLParser::event_code_t type;
   do {
     type = parser.next();
     if (type == android::ResXMLParser::START_TAG) {
-      size_t len;
-      android::String16 tag(parser.getElementName(&len));
-      if (tag == activity ||
-          tag == application ||
-          tag == provider ||
-          tag == receiver ||
-          tag == service ||
-          tag == instrumentation) {
-
-        std::string classname = get_attribute_value(parser, name);
+      auto tag = tags.match(element.name_id());
+      if (tag == ACTIVITY ||
+          tag == APPLICATION ||
+          tag == PROVIDER ||
+          tag == RECEIVER ||
+          tag == SERVICE ||
+          tag == INSTRUMENTATION) {
+
+        std::string classname = get_attribute_value(element, attributes, NAME);
         if (classname.size()) {
           result.insert(dotname_to_dexname(classname));
         }
 
-        if (tag == provider) {
-          std::string text = get_attribute_value(parser, authorities);
+        if (tag == PROVIDER) {
+          std::string text =
+              get_attribute_value(element, attributes, AUTHORITIES);
           size_t start = 0;
           size_t end = 0;
           while ((end = text.find(';', start)) != std::string::npos) {
@@ -126,12 +223,13 @@ std::unordered_set<std::string> extract_classes_from_manifest(const std::string&
           }
           result.insert(dotname_to_dexname(text.substr(start)));
         }
-      } else if (tag == activity_alias) {
-        std::string classname = get_attribute_value(parser, target_activity);
+      } else if (tag == ACTIVITY_ALIAS) {
+        std::string classname =
+            get_attribute_value(element, attributes, TARGET_ACTIVITY);
         if (classname.size()) {
           result.insert(dotname_to_dexname(classname));
         }
-        classname = get_attribute_value(parser, name);
+        classname = get_attribute_value(element, attributes, NAME);
         if (classname.size()) {
           result.insert(dotname_to_dexname(classname));
         }
@@ -143,32 +241,42 @@ std::unordered_set<std::string> extract_classes_from_manifest(const std::string&
 }
 
 
-std::unordered_set<std::string> extract_classes_from_layout(const std::string& layout_contents) {
+void extract_classes_from_layout(const char* data,
+                                 size_t size,
+                                 std::unordered_set<std::string>& result) {
 
   android::ResXMLTree parser;
-  parser.setTo(layout_contents.data(), layout_contents.size());
-
-  std::unordered_set<std::string> result;
-
-  android::String16 name("name");
-  android::String16 klazz("class");
+  parser.setTo(data, size);
 
   if (parser.getError() != android::NO_ERROR) {
-    return result;
+    return;
   }
 
+  enum { FRAGMENT, VIEW };
+  StringPoolView strings(parser.getStrings());
+  XmlElementView element(parser, strings);
+  StringPoolMatcher tags(strings, {"fragment", "view"});
+  enum { CLASS, NAME };
+  StringPoolMatcher attributes(strings, {"class", "name"});
+
   android::ResXMLParser::event_code_t type;
   do {
     type = parser.next();
     if (type == android::ResXMLParser::START_TAG) {
-      size_t len;
-      android::String16 tag(parser.getElementName(&len));
-      std::string classname = convert_from_string16(tag);
-      if (!strcmp(classname.c_str(), "fragment") || !strcmp(classname.c_str(), "view")) {
-        classname = get_attribute_value(parser, klazz);
+      std::string classname;
+      auto tag = tags.match(element.name_id());
+      if (tag == FRAGMENT || tag == VIEW) {
+        classname = get_attribute_value(element, attributes, CLASS);
         if (classname.empty()) {
-          classname = get_attribute_value(parser, name);
+          classname = get_attribute_value(element, attributes, NAME);
         }
+      } else {
+        // Only custom views, whose tag is a class name, are of interest.
+        auto name = element.name();
+        if (!name.contains('.')) {
+          continue;
+        }
+        classname = name.str();
       }
       std::string converted = std::string("L") + classname + std::string(";");
 
@@ -180,78 +288,185 @@ std::unordered_set<std::string> extract_classes_from_layout(const std::string& l
     }
   } while (type != android::ResXMLParser::BAD_DOCUMENT &&
            type != android::ResXMLParser::END_DOCUMENT);
-  return result;
 }
 
 
+namespace {
+
 /*
- * Returns all strings that look like java class names from a native library.
- *
- * Return values will be formatted the way that the dex spec formats class names:
- *
- *   "Ljava/lang/String;"
- *
+ * Characters that can appear in a class name: [a-zA-Z0-9/_$]
  */
-std::unordered_set<std::string> extract_classes_from_native_lib(const std::string& lib_contents) {
-  std::unordered_set<std::string> classes;
-  char buffer[MAX_CLASSNAME_LENGTH + 2]; // +2 for the trailing ";\0"
-  const char* inptr = lib_contents.data();
-  char* outptr = buffer;
-  const char* end = inptr + lib_contents.size();
-
-  size_t length = 0;
-
-  while (inptr < end) {
-    outptr = buffer;
-    length = 0;
-    // All classnames start with a package, which starts with a lowercase letter. Some of them are
-    // preceded by an 'L' and followed by a ';' in native libraries while others are not.
-    if ((*inptr >= 'a' && *inptr <= 'z') || *inptr == 'L') {
-
-      if (*inptr != 'L') {
-        *outptr++ = 'L';
-        length++;
-      }
+inline bool is_classname_char(char c) {
+  return (c >= 'a' && c <= 'z') ||
+         (c >= 'A' && c <= 'Z') ||
+         (c >= '0' && c <= '9') ||
+         c == '/' || c == '_' || c == '$';
+}
+
+/*
+ * Characters that can start a class name: all classnames start with a
+ * package, which starts with a lowercase letter. Some of them are preceded by
+ * an 'L' and followed by a ';' in native libraries while others are not.
+ */
+inline bool is_classname_start(char c) {
+  return (c >= 'a' && c <= 'z') || c == 'L';
+}
 
-      while (( // This loop is safe since lib_contents.data() ends with a \0
-          (*inptr >= 'a' && *inptr <= 'z') ||
-          (*inptr >= 'A' && *inptr <= 'Z') ||
-          (*inptr >= '0' && *inptr <= '9') ||
-          *inptr == '/' || *inptr == '_' || *inptr == '$')
-          && length < MAX_CLASSNAME_LENGTH) {
+#if defined(__AVX2__) || defined(__SSE2__)
+
+#if defined(__AVX2__)
+using vec_t = __m256i;
+#define VEC_LOAD(p) _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p))
+#define VEC_SET1(c) _mm256_set1_epi8(c)
+#define VEC_SUB(a, b) _mm256_sub_epi8(a, b)
+#define VEC_MIN(a, b) _mm256_min_epu8(a, b)
+#define VEC_EQ(a, b) _mm256_cmpeq_epi8(a, b)
+#define VEC_OR(a, b) _mm256_or_si256(a, b)
+#define VEC_MASK(a) static_cast<uint32_t>(_mm256_movemask_epi8(a))
+#else
+using vec_t = __m128i;
+#define VEC_LOAD(p) _mm_loadu_si128(reinterpret_cast<const __m128i*>(p))
+#define VEC_SET1(c) _mm_set1_epi8(c)
+#define VEC_SUB(a, b) _mm_sub_epi8(a, b)
+#define VEC_MIN(a, b) _mm_min_epu8(a, b)
+#define VEC_EQ(a, b) _mm_cmpeq_epi8(a, b)
+#define VEC_OR(a, b) _mm_or_si128(a, b)
+#define VEC_MASK(a) static_cast<uint32_t>(_mm_movemask_epi8(a))
+#endif
+
+constexpr size_t VEC_WIDTH = sizeof(vec_t);
+
+// Bytes of v in [lo, lo + span], using unsigned wrap-around.
+inline vec_t in_range(vec_t v, char lo, char span) {
+  auto shifted = VEC_SUB(v, VEC_SET1(lo));
+  return VEC_EQ(VEC_MIN(shifted, VEC_SET1(span)), shifted);
+}
 
-        *outptr++ = *inptr++;
-        length++;
-      }
-      if (length >= MIN_CLASSNAME_LENGTH) {
-        *outptr++ = ';';
-        *outptr = '\0';
-        classes.insert(std::string(buffer));
+// Bit i is set iff p[i] is a classname character.
+inline uint32_t classname_char_mask(const char* p) {
+  auto v = VEC_LOAD(p);
+  // Setting 0x20 maps A-Z onto a-z and leaves a-z alone.
+  auto letter = in_range(VEC_OR(v, VEC_SET1(0x20)), 'a', 'z' - 'a');
+  auto digit = in_range(v, '0', '9' - '0');
+  auto other = VEC_OR(VEC_EQ(v, VEC_SET1('/')),
+                      VEC_OR(VEC_EQ(v, VEC_SET1('_')), VEC_EQ(v, VEC_SET1('$'))));
+  return VEC_MASK(VEC_OR(letter, VEC_OR(digit, other)));
+}
+
+/*
+ * Returns the first position in [p, end) whose byte is (if `want` is true) or
+ * is not (if `want` is false) a classname character, or `end`.
+ */
+const char* find_classname_boundary(const char* p, const char* end, bool want) {
+  constexpr uint32_t all =
+      VEC_WIDTH == 32 ? 0xffffffffu : (1u << (VEC_WIDTH % 32)) - 1;
+  while (static_cast<size_t>(end - p) >= VEC_WIDTH) {
+    auto mask = classname_char_mask(p);
+    if (!want) {
+      mask = ~mask & all;
+    }
+    if (mask != 0) {
+      return p + __builtin_ctz(mask);
+    }
+    p += VEC_WIDTH;
+  }
+  while (p < end && is_classname_char(*p) != want) {
+    p++;
+  }
+  return p;
+}
+
+#undef VEC_LOAD
+#undef VEC_SET1
+#undef VEC_SUB
+#undef VEC_MIN
+#undef VEC_EQ
+#undef VEC_OR
+#undef VEC_MASK
+
+#else
+
+const char* find_classname_boundary(const char* p, const char* end, bool want) {
+  while (p < end && is_classname_char(*p) != want) {
+    p++;
+  }
+  return p;
+}
+
+#endif
+
+/*
+ * Extracts the candidates from a maximal run of classname characters. A
+ * candidate starts at the first start character, extends to the end of the
+ * run (or MAX_CLASSNAME_LENGTH) and the character following it is skipped.
+ */
+void extract_classes_from_run(const char* p,
+                              const char* end,
+                              std::unordered_set<std::string>& classes) {
+  std::string candidate;
+  while (p < end) {
+    if (!is_classname_start(*p)) {
+      p++;
+      continue;
+    }
+    size_t prefix = *p == 'L' ? 0 : 1;
+    size_t n = std::min(static_cast<size_t>(end - p),
+                        MAX_CLASSNAME_LENGTH - prefix);
+    if (prefix + n >= MIN_CLASSNAME_LENGTH) {
+      candidate.clear();
+      if (prefix) {
+        candidate += 'L';
       }
+      candidate.append(p, n);
+      candidate += ';';
+      classes.insert(candidate);
     }
-    inptr++;
+    p += n + 1;
   }
-  return classes;
 }
 
+}
 
 /*
- * Reads an entire file into a std::string. Returns an empty string if anything
- * went wrong (e.g. file not found).
+ * Returns all strings that look like java class names from a native library.
+ *
+ * Return values will be formatted the way that the dex spec formats class names:
+ *
+ *   "Ljava/lang/String;"
+ *
+ * Most of a library is machine code, so we look for runs of classname
+ * characters a vector at a time and only inspect runs that are long enough to
+ * hold a class name byte by byte.
  */
-std::string read_entire_file(const std::string& filename) {
-  std::ifstream in(filename, std::ios::in | std::ios::binary);
-  std::stringstream sstr;
-  sstr << in.rdbuf();
-  return sstr.str();
+void extract_classes_from_native_lib(const char* data,
+                                     size_t size,
+                                     std::unordered_set<std::string>& classes) {
+  const char* p = data;
+  const char* end = data + size;
+  while (p < end) {
+    auto run = find_classname_boundary(p, end, true);
+    auto run_end = find_classname_boundary(run, end, false);
+    // With the 'L' we may add, a run of n characters gives at most n + 1.
+    if (static_cast<size_t>(run_end - run) + 1 >= MIN_CLASSNAME_LENGTH) {
+      extract_classes_from_run(run, run_end, classes);
+    }
+    p = run_end;
+  }
+}
+
+std::unordered_set<std::string> extract_classes_from_native_lib(const std::string& lib_contents) {
+  std::unordered_set<std::string> classes;
+  extract_classes_from_native_lib(
+      lib_contents.data(), lib_contents.size(), classes);
+  return classes;
 }
 
 
 std::unordered_set<std::string> get_manifest_classes(const std::string& filename) {
-  std::string manifest = read_entire_file(filename);
+  MappedFile manifest(filename);
   std::unordered_set<std::string> classes;
-  if (manifest.size()) {
-    classes = extract_classes_from_manifest(manifest);
+  if (manifest.data() != nullptr) {
+    classes = extract_classes_from_manifest(manifest.data(), manifest.size());
   } else {
     fprintf(stderr, "Unable to read manifest file: %s\n", filename.data());
   }
@@ -286,13 +501,41 @@ std::vector<std::string> find_layout_files(const std::string& apk_directory) {
   return layout_files;
 }
 
+namespace {
+
+struct layout_work {
+  const std::string* filename;
+  std::unordered_set<std::string> classes;
+};
+
+void scan_layout(void* arg) {
+  auto work = static_cast<layout_work*>(arg);
+  MappedFile layout(*work->filename);
+  if (layout.data() != nullptr) {
+    extract_classes_from_layout(layout.data(), layout.size(), work->classes);
+  }
+}
+
+}
+
 std::unordered_set<std::string> get_layout_classes(const std::string& apk_directory) {
-  std::vector<std::string> tmp = find_layout_files(apk_directory);
+  std::vector<std::string> layout_files = find_layout_files(apk_directory);
+  std::vector<layout_work> works;
+  works.reserve(layout_files.size());
+  for (const auto& layout_file : layout_files) {
+    works.push_back(layout_work{&layout_file, {}});
+  }
+  std::vector<work_item> workitems;
+  workitems.reserve(works.size());
+  for (auto& work : works) {
+    workitems.push_back(work_item{scan_layout, &work});
+  }
+  WorkQueue wq;
+  wq.run_work_items(workitems.data(), (int)workitems.size());
+
   std::unordered_set<std::string> all_classes;
-  for (auto layout_file : tmp) {
-    std::string contents = read_entire_file(layout_file);
-    std::unordered_set<std::string> classes_from_layout = extract_classes_from_layout(contents);
-    all_classes.insert(classes_from_layout.begin(), classes_from_layout.end());
+  for (const auto& work : works) {
+    all_classes.insert(work.classes.begin(), work.classes.end());
   }
   return all_classes;
 }
@@ -323,16 +566,72 @@ std::vector<std::string> find_native_library_files(const std::string& apk_direct
 }
 
 
+namespace {
+
+struct native_lib_work {
+  const MappedFile* lib;
+  std::unordered_set<std::string> classes;
+};
+
+void scan_native_lib(void* arg) {
+  auto work = static_cast<native_lib_work*>(arg);
+  extract_classes_from_native_lib(
+      work->lib->data(), work->lib->size(), work->classes);
+}
+
+}
+
 /**
  * Return all potential java class names located in native libraries.
+ *
+ * The libraries are mapped rather than read and scanned in parallel. The same
+ * library is often shipped unchanged for several ABIs, so libraries whose
+ * contents are identical to one already seen are skipped.
  */
 std::unordered_set<std::string> get_native_classes(const std::string& apk_directory) {
   std::vector<std::string> native_libs = find_native_library_files(apk_directory);
+  std::vector<std::unique_ptr<MappedFile>> mapped;
+  std::unordered_map<size_t, std::vector<const MappedFile*>> by_size;
+  std::vector<native_lib_work> works;
+  for (const auto& native_lib : native_libs) {
+    mapped.emplace_back(new MappedFile(native_lib));
+    const MappedFile* lib = mapped.back().get();
+    if (lib->data() == nullptr) {
+      continue;
+    }
+    auto& same_size = by_size[lib->size()];
+    bool duplicate = std::any_of(
+        same_size.begin(), same_size.end(), [&](const MappedFile* other) {
+          return memcmp(lib->data(), other->data(), lib->size()) == 0;
+        });
+    if (duplicate) {
+      continue;
+    }
+    same_size.push_back(lib);
+    works.push_back(native_lib_work{lib, {}});
+  }
+
+  std::vector<work_item> workitems;
+  workitems.reserve(works.size());
+  for (auto& work : works) {
+    workitems.push_back(work_item{scan_native_lib, &work});
+  }
+  WorkQueue wq;
+  wq.run_work_items(workitems.data(), (int)workitems.size());
+
   std::unordered_set<std::string> all_classes;
-  for (auto native_lib : native_libs) {
-    std::string contents = read_entire_file(native_lib);
-    std::unordered_set<std::string> classes_from_layout = extract_classes_from_native_lib(contents);
-    all_classes.insert(classes_from_layout.begin(), classes_from_layout.end());
+  for (const auto& work : works) {
+    all_classes.insert(work.classes.begin(), work.classes.end());
   }
   return all_classes;
 }
+
+
+ResourceClasses get_resource_classes(const std::string& apk_directory) {
+  ResourceClasses classes;
+  classes.manifest =
+      get_manifest_classes(apk_directory + std::string("/AndroidManifest.xml"));
+  classes.layout = get_layout_classes(apk_directory);
+  classes.native = get_native_classes(apk_directory);
+  return classes;
+}
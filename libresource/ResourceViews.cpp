@@ -0,0 +1,65 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree. An additional grant
+ * of patent rights can be found in the PATENTS file in the same directory.
+ */
+
+#include "ResourceViews.h"
+
+#include "androidfw/ResourceTypes.h"
+#include "utils/Unicode.h"
+
+StringPoolView::StringPoolView(const android::ResStringPool& pool)
+    : m_pool(pool), m_size(pool.size()), m_utf8(pool.isUTF8()) {
+  if (!m_utf8) {
+    m_decoded.resize(m_size);
+    m_is_decoded.resize(m_size, false);
+  }
+}
+
+Utf8View StringPoolView::at(int32_t idx) {
+  if (idx < 0 || static_cast<size_t>(idx) >= m_size) {
+    return Utf8View();
+  }
+  size_t len;
+  if (m_utf8) {
+    // The length string8At reports is in UTF-16 units. The strings are NUL
+    // terminated, which gives us the length in bytes.
+    const char* str = m_pool.string8At(idx, &len);
+    return str != nullptr ? Utf8View(str, strlen(str)) : Utf8View();
+  }
+  auto& decoded = m_decoded[idx];
+  if (!m_is_decoded[idx]) {
+    const char16_t* str16 = m_pool.stringAt(idx, &len);
+    if (str16 == nullptr) {
+      return Utf8View();
+    }
+    ssize_t utf8_len = utf16_to_utf8_length(str16, len);
+    if (utf8_len > 0) {
+      decoded.resize(utf8_len + 1);
+      utf16_to_utf8(str16, len, &decoded[0]);
+      decoded.resize(utf8_len);
+    }
+    m_is_decoded[idx] = true;
+  }
+  return Utf8View(decoded.data(), decoded.size());
+}
+
+int32_t XmlElementView::name_id() const {
+  return m_parser.getElementNameID();
+}
+
+size_t XmlElementView::attribute_count() const {
+  return m_parser.getAttributeCount();
+}
+
+int32_t XmlElementView::attribute_name_id(size_t idx) const {
+  return m_parser.getAttributeNameID(idx);
+}
+
+Utf8View XmlElementView::attribute_string_value(size_t idx) {
+  return m_strings.at(m_parser.getAttributeValueStringID(idx));
+}
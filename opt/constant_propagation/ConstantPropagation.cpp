@@ -9,15 +9,17 @@
 
 #include "ConstantPropagation.h"
 
+#include <memory>
 #include <vector>
-#include <stack>
 
-#include "ControlFlow.h"
 #include "DexClass.h"
 #include "IRInstruction.h"
 #include "DexUtil.h"
+#include "MethodCosts.h"
 #include "Transform.h"
+#include "ValueAnalysis.h"
 #include "Walkers.h"
+#include "WorkQueue.h"
 
 namespace {
 
@@ -26,251 +28,63 @@ namespace {
   constexpr const char* METRIC_METHOD_RETURN_PROPAGATED =
     "num_method_return_propagated";
 
-  // The struct AbstractRegister contains a bool value of whether the value of
-  // register is known and the constant value of this register
-  struct AbstractRegister {
-    bool known;
-    int64_t val;
-  };
-
   class ConstantPropagation {
   private:
     const Scope& m_scope;
-    // The index of the reg_values is the index of registers
-    std::vector<AbstractRegister> reg_values;
-    // method_returns keeps track of constant returned by methods
-    std::unordered_map<DexMethod*, int64_t> method_returns;
-    // Store dead instructions to be removed
-    std::vector<IRInstruction*> dead_instructions;
-    // Store pairs of intructions to be replaced
-    std::vector<std::pair<IRInstruction*, IRInstruction*>> replacements;
-    std::vector<std::pair<IRInstruction*, IRInstruction*>>
-        branch_replacements;
+    const MethodSummaries& m_summaries;
     size_t m_branch_propagated{0};
     size_t m_method_return_propagated{0};
 
-    void propagate(DexMethod* method) {
-      reg_values.clear();
-      for (int i = 0; i < method->get_code()->get_registers_size(); i++) {
-        AbstractRegister r = {.known = false, .val = 0};
-        reg_values.push_back(AbstractRegister(r));
-      }
-
-      bool changed = true;
-      TRACE(CONSTP, 5, "Class: %s\n", SHOW(method->get_class()));
-      TRACE(CONSTP, 5, "Method: %s\n", SHOW(method->get_name()));
-      // The loop traverses all blocks in the method until no more branch is converted
-      while (changed) {
-        auto code = method->get_code();
-        code->build_cfg();
-        auto& cfg = code->cfg();
-        TRACE(CONSTP, 5, "CFG: %s\n", SHOW(cfg));
-        auto first_block = cfg.blocks()[0];
-        // block_preds saves the re-calculated number of predecessors of each block
-        // This number may change as new unreachable blocks are added in each loop
-        std::unordered_map<Block*, int> block_to_predecessors_count;
-        find_reachable_predecessors(cfg.blocks(), block_to_predecessors_count);
-        changed = propagate_constant_in_method(
-            method, first_block, block_to_predecessors_count);
-        apply_changes(code);
-      }
-    }
-
-    bool propagate_constant_in_method(
-        DexMethod* method,
-        Block* first_block,
-        std::unordered_map<Block*, int>& block_preds) {
-      bool changed = false;
-      std::stack<Block*> dfs_front;
-      dfs_front.push(first_block);
-      std::unordered_map<Block*, bool> visited;
-      visited[first_block] = true;
-      // This loop traverses each block by depth-first
-      while (!dfs_front.empty() && !changed) {
-        auto current_block = dfs_front.top();
-        dfs_front.pop();
-        TRACE(CONSTP, 5, "Processing block %d\n", current_block->id());
-        if (block_preds[current_block] != 1) {
-          TRACE(CONSTP, 5, "More than one pred, removing constants\n");
-          remove_constants();
-        }
-        IRInstruction* last_inst = nullptr;
-        for (auto it = current_block->begin();
-             it != current_block->end() && !changed;
-             ++it) {
-          if (it->type != MFLOW_OPCODE) {
-            continue;
-          }
-          auto inst = it->insn;
-          TRACE(CONSTP, 5, "instruction: %s\n", SHOW(inst));
-          if (is_const(inst->opcode())) {
-            propagate_constant(inst);
-          } else {
-            changed = propagate_insn(inst, last_inst, method);
-          }
-        }
-        // Propagate successive blocks
-        int succ_num = 0;
-        for (auto successor_block : current_block->succs()) {
-          if (!visited[successor_block]) {
-            dfs_front.push(successor_block);
-            visited[successor_block] = true;
-            succ_num++;
-          }
-        }
-        if (succ_num != 1) {
-          TRACE(CONSTP, 5, "More than one successor, removing constants\n");
-          remove_constants();
-        }
-      }
-      return changed;
-    }
-
-    void apply_changes(IRCode* code) {
-      for (auto const& p : replacements) {
-        auto const& old_op = p.first;
-        auto const& new_op = p.second;
-        code->replace_opcode(old_op, new_op);
-      }
-      replacements.clear();
-
-      for (auto const& p : branch_replacements) {
-        auto const& old_op = p.first;
-        auto const& new_op = p.second;
-        code->replace_branch(old_op, new_op);
-      }
-      branch_replacements.clear();
-
-      for (auto dead : dead_instructions) {
-        code->remove_opcode(dead);
-      }
-      dead_instructions.clear();
-    }
-
-    bool propagate_insn(IRInstruction *inst, IRInstruction *&last_inst, DexMethod *method) {
-      bool changed = false;
-      switch (inst->opcode()) {
-        case OPCODE_IF_NEZ:
-        case OPCODE_IF_EQZ:
-          if (propagate_branch(inst)) {
-            TRACE(CONSTP, 2, "Changed conditional branch %s\n", SHOW(inst));
-            auto new_inst = new IRInstruction(OPCODE_GOTO_16);
-            branch_replacements.emplace_back(inst, new_inst);
-            m_branch_propagated++;
-            changed = true;
-          }
-          break;
-        // For return instruction, save the return value for future use
-        case OPCODE_RETURN:
-          if (reg_values[inst->src(0)].known)
-            method_returns[method] = reg_values[inst->src(0)].val;
-          break;
-        // For move-result instruction following a static-invoke insn
-        // Check if there is a constant returned. If so, propagate the value
-        case OPCODE_MOVE_RESULT:
-          reg_values[inst->dest()].known = false;
-          if (false && // deactivate return propagation for now
-              last_inst != nullptr &&
-              last_inst->opcode() == OPCODE_INVOKE_STATIC &&
-              last_inst->has_methods()) {
-              IRMethodInstruction *referred_method = static_cast<IRMethodInstruction *>(last_inst);
-              if (method_returns.find(referred_method->get_method()) != method_returns.end()) {
-                auto return_val = method_returns[referred_method->get_method()];
-                TRACE(CONSTP, 2, "Find method %s return value: %d\n", SHOW(referred_method), return_val);
-                m_method_return_propagated++;
-                auto new_inst = (new IRInstruction(OPCODE_CONST_16))
-                                    ->set_dest(inst->dest())
-                                    ->set_literal(return_val);
-                replacements.emplace_back(inst, new_inst);
-                dead_instructions.push_back(referred_method);
-                propagate_constant(new_inst);
-              }
-          }
-          break;
-        // For move instruction, propagate known status and the value to the dest register
-        case OPCODE_MOVE:
-        case OPCODE_MOVE_OBJECT:
-          reg_values[inst->dest()].known = reg_values[inst->src(0)].known;
-          reg_values[inst->dest()].val = reg_values[inst->src(0)].val;
-          break;
-        default:
-          if (inst->dests_size()) {
-            reg_values[inst->dest()].known = false;
-          }
-          break;
-      }
-      last_inst = inst;
-      return changed;
+    struct MethodWork {
+      ConstantPropagation* self;
+      DexMethod* method;
+      size_t branches;
+      size_t return_propagated;
+    };
+
+    static void propagate_work(void* arg) {
+      auto work = static_cast<MethodWork*>(arg);
+      MethodCostScope cost(work->method);
+      TRACE(CONSTP, 5, "Method: %s\n", SHOW(work->method));
+      ValueAnalysis analysis(work->method, &work->self->m_summaries);
+      analysis.run();
+      apply_changes(work->method->get_code(), analysis.constant_branches());
+      work->branches = analysis.constant_branches().size();
+      work->return_propagated = analysis.summarized_results();
     }
 
-    // Propagate const instruction value to registers
-    void propagate_constant(IRInstruction *inst) {
-      // Only deal with const/4 and OPCODE_CONST_16 for simplicity
-      if (inst->opcode() == OPCODE_CONST_4 ||
-          inst->opcode() == OPCODE_CONST_16) {
-          reg_values[inst->dest()].known = true;
-          reg_values[inst->dest()].val = inst->literal();
-      } else {
-        reg_values[inst->dest()].known = false;
+    static void apply_changes(
+        IRCode* code,
+        const std::unordered_map<IRInstruction*, bool>& branches) {
+      if (branches.empty()) {
+        return;
       }
-    }
-
-    // If a branch reads the value from a register loaded in earlier step,
-    // the branch will read value from register, do the evaluation and
-    // change the conditional branch to a goto branch if possible
-    bool propagate_branch(IRInstruction *inst) {
-      auto src_reg = inst->src(0);
-      if (reg_values[src_reg].known) {
-        if (inst->opcode() == OPCODE_IF_EQZ && reg_values[src_reg].val == 0) {
-            return true;
-        }
-        if (inst->opcode() == OPCODE_IF_NEZ && reg_values[src_reg].val != 0) {
-            return true;
+      for (auto it = code->begin(); it != code->end(); ++it) {
+        if (it->type != MFLOW_OPCODE) {
+          continue;
         }
-      }
-      return false;
-    }
-
-    // This function reads the vector of reg_values and marks all regs to unknown
-    void remove_constants() {
-      for (auto &r: reg_values) {
-        r.known = false;
-      }
-    }
-
-    // This method calculates number of reachable predecessors of each block
-    // The difference between this method and remove_unreachable_blocks in
-    // LocalDCE is that
-    // this method only finds unreachable blocks without deleting any edge
-    // or block
-    void find_reachable_predecessors(
-        std::vector<Block*>& original_blocks,
-        std::unordered_map<Block*, int>& block_to_predecessors_count) {
-      std::vector<Block*> unreachable_blocks;
-      for (size_t i = 1; i < original_blocks.size(); ++i) {
-        auto pred_size = original_blocks[i]->preds().size();
-        block_to_predecessors_count[original_blocks[i]] = pred_size;
-        if (pred_size == 0) {
-          unreachable_blocks.push_back(original_blocks[i]);
+        auto branch = branches.find(it->insn);
+        if (branch == branches.end()) {
+          continue;
         }
-      }
-      while (unreachable_blocks.size() > 0) {
-        auto b = unreachable_blocks.back();
-        unreachable_blocks.pop_back();
-        for (auto succs_b : b->succs()) {
-          if (--block_to_predecessors_count[succs_b] == 0) {
-            unreachable_blocks.push_back(succs_b);
-          }
+        TRACE(CONSTP, 2, "Folding conditional branch %s\n", SHOW(it->insn));
+        if (branch->second) {
+          auto insn = it->insn;
+          it->insn = new IRInstruction(OPCODE_GOTO_16);
+          delete insn;
+        } else {
+          code->remove_opcode(it);
         }
       }
     }
 
   public:
-    ConstantPropagation(const Scope& scope) : m_scope(scope) {
-    }
+    ConstantPropagation(const Scope& scope, const MethodSummaries& summaries)
+        : m_scope(scope), m_summaries(summaries) {}
 
     void run(const std::unordered_set<DexType*> &blacklist_classes) {
       TRACE(CONSTP, 1, "Running ConstantPropagation pass\n");
+      std::vector<MethodWork> work;
       walk_methods(m_scope,
         [&](DexMethod* m) {
           if (!m->get_code()) {
@@ -281,14 +95,28 @@ namespace {
             TRACE(CONSTP, 2, "Skipping %s\n", show(m->get_class()).c_str());
             return;
           }
-          propagate(m);
+          work.push_back(MethodWork{this, m, 0, 0});
         });
 
+      // The summaries were computed before any branch got folded. Folding
+      // only removes paths, so what they say still holds.
+      std::vector<work_item> work_items;
+      work_items.reserve(work.size());
+      for (auto& w : work) {
+        work_items.push_back(work_item{propagate_work, &w});
+      }
+      WorkQueue wq;
+      wq.run_work_items(work_items.data(), (int)work_items.size());
+
+      for (const auto& w : work) {
+        m_branch_propagated += w.branches;
+        m_method_return_propagated += w.return_propagated;
+      }
       TRACE(CONSTP, 1,
         "Branch condition removed: %lu\n",
         m_branch_propagated);
       TRACE(CONSTP, 1,
-        "Static function invocation removed: %lu\n",
+        "Method return values propagated: %lu\n",
         m_method_return_propagated);
     }
 
@@ -319,9 +147,22 @@ std::unordered_set<DexType*> get_black_list(
 }
 
 void ConstantPropagationPass::run_pass(DexStoresVector& stores, ConfigFiles& cfg, PassManager& mgr) {
-  auto scope = build_class_scope(stores);
+  auto& scope = mgr.get_analysis<ClassScopeAnalysis>(stores).scope;
   auto blacklist_classes = get_black_list(m_blacklist);
-  ConstantPropagation constant_prop(scope);
+  // The shared summaries know the return values of blacklisted methods, the
+  // pass builds its own when there are any.
+  std::unique_ptr<MethodSummaries> own_summaries;
+  const MethodSummaries* summaries;
+  if (blacklist_classes.empty()) {
+    summaries = &mgr.get_analysis<MethodSummariesAnalysis>(stores).summaries;
+  } else {
+    own_summaries.reset(new MethodSummaries(
+        scope,
+        mgr.get_analysis<CallGraphAnalysis>(stores).graph,
+        blacklist_classes));
+    summaries = own_summaries.get();
+  }
+  ConstantPropagation constant_prop(scope, *summaries);
   constant_prop.run(blacklist_classes);
   mgr.incr_metric(
     METRIC_BRANCH_PROPAGATED,
@@ -9,6 +9,7 @@
 
 #pragma once
 
+#include "Analyses.h"
 #include "Pass.h"
 
 class ConstantPropagationPass : public Pass {
@@ -19,6 +20,9 @@ class ConstantPropagationPass : public Pass {
     pc.get("blacklist", {}, m_blacklist);
   }
   virtual void run_pass(DexStoresVector&, ConfigFiles&, PassManager&) override;
+  virtual void get_preserved_analyses(PreservedAnalyses& pa) const override {
+    preserve_structural_analyses(pa);
+  }
 
 private:
   std::vector<std::string> m_blacklist;
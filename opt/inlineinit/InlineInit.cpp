@@ -7,6 +7,7 @@
  * of patent rights can be found in the PATENTS file in the same directory.
  */
 
+#include "Analyses.h"
 #include "Deleter.h"
 #include "InlineHelper.h"
 #include "InlineInit.h"
@@ -20,21 +21,22 @@
  *   - {methods that are called from the primary dex}
  */
 std::unordered_set<DexMethod*> InlineInitPass::gather_init_candidates(
-    const Scope& scope, const DexClasses& primary_dex) {
+    const Scope& scope,
+    const CallGraph& call_graph,
+    const CodeSummaries& summaries) {
   constexpr int SMALL_CODE_SIZE = 3;
   std::unordered_set<DexMethod*> candidates;
   std::unordered_set<DexMethod*> deletable_ctors;
   walk_methods(scope, [&](DexMethod* method) {
-    auto code = method->get_code();
     if (is_constructor(method) && !is_static(method)) {
-      if (code->count_opcodes() < SMALL_CODE_SIZE) {
+      if (summaries.get(method).insn_count < SMALL_CODE_SIZE) {
         candidates.emplace(method);
       } else if (!can_delete(method)) {
         deletable_ctors.insert(method);
       }
     }
   });
-  select_single_called(scope, deletable_ctors, m_resolved_refs, &candidates);
+  select_single_called(call_graph, deletable_ctors, &candidates);
 
   return candidates;
 }
@@ -56,14 +58,21 @@ void InlineInitPass::run_pass(DexStoresVector& stores,
     return resolve_method(method, search, m_resolved_refs);
   };
 
-  auto inlinable = gather_init_candidates(scope, primary_dex);
+  auto& call_graph = mgr.get_analysis<CallGraphAnalysis>(stores).graph;
+  auto& summaries = mgr.get_analysis<CodeSummaryAnalysis>(stores).summaries;
+  auto inlinable = gather_init_candidates(scope, call_graph, summaries);
 
   for (auto cls : primary_dex) {
     m_inliner_config.caller_black_list.emplace(cls->get_type());
   }
 
-  MultiMethodInliner inliner(
-      scope, primary_dex, inlinable, resolver, m_inliner_config);
+  MultiMethodInliner inliner(scope,
+                             primary_dex,
+                             inlinable,
+                             call_graph,
+                             summaries,
+                             resolver,
+                             m_inliner_config);
   inliner.inline_methods();
 
   auto inlined = inliner.get_inlined();
@@ -16,7 +16,9 @@
 class InlineInitPass : public Pass {
   MethodRefCache m_resolved_refs;
   std::unordered_set<DexMethod*> gather_init_candidates(
-      const Scope& scope, const DexClasses& primary_dex);
+      const Scope& scope,
+      const CallGraph& call_graph,
+      const CodeSummaries& summaries);
 
   MultiMethodInliner::Config m_inliner_config;
 
@@ -9,228 +9,105 @@
 
 #include "LocalDce.h"
 
-#include <iostream>
-#include <array>
 #include <unordered_set>
 #include <vector>
 
-#include <boost/dynamic_bitset.hpp>
-
 #include "ControlFlow.h"
+#include "Dataflow.h"
 #include "DexClass.h"
 #include "IRInstruction.h"
 #include "DexUtil.h"
+#include "Liveness.h"
+#include "MethodCosts.h"
+#include "Purity.h"
 #include "Transform.h"
 #include "Walkers.h"
+#include "WorkQueue.h"
 
 namespace {
 
 constexpr const char* METRIC_INSTRS_ELIMINATED = "num_instrs_eliminated";
 constexpr const char* METRIC_TOTAL_INSTRS = "num_total_instrs";
-
-/*
- * These instructions have observable side effects so must always be considered
- * live, regardless of whether their output is consumed by another instruction.
- */
-static bool has_side_effects(DexOpcode opc) {
-  switch (opc) {
-  case OPCODE_RETURN_VOID:
-  case OPCODE_RETURN:
-  case OPCODE_RETURN_WIDE:
-  case OPCODE_RETURN_OBJECT:
-  case OPCODE_MONITOR_ENTER:
-  case OPCODE_MONITOR_EXIT:
-  case OPCODE_CHECK_CAST:
-  case OPCODE_FILL_ARRAY_DATA:
-  case OPCODE_THROW:
-  case OPCODE_GOTO:
-  case OPCODE_GOTO_16:
-  case OPCODE_GOTO_32:
-  case OPCODE_PACKED_SWITCH:
-  case OPCODE_SPARSE_SWITCH:
-  case OPCODE_IF_EQ:
-  case OPCODE_IF_NE:
-  case OPCODE_IF_LT:
-  case OPCODE_IF_GE:
-  case OPCODE_IF_GT:
-  case OPCODE_IF_LE:
-  case OPCODE_IF_EQZ:
-  case OPCODE_IF_NEZ:
-  case OPCODE_IF_LTZ:
-  case OPCODE_IF_GEZ:
-  case OPCODE_IF_GTZ:
-  case OPCODE_IF_LEZ:
-  case OPCODE_APUT:
-  case OPCODE_APUT_WIDE:
-  case OPCODE_APUT_OBJECT:
-  case OPCODE_APUT_BOOLEAN:
-  case OPCODE_APUT_BYTE:
-  case OPCODE_APUT_CHAR:
-  case OPCODE_APUT_SHORT:
-  case OPCODE_IPUT:
-  case OPCODE_IPUT_WIDE:
-  case OPCODE_IPUT_OBJECT:
-  case OPCODE_IPUT_BOOLEAN:
-  case OPCODE_IPUT_BYTE:
-  case OPCODE_IPUT_CHAR:
-  case OPCODE_IPUT_SHORT:
-  case OPCODE_SPUT:
-  case OPCODE_SPUT_WIDE:
-  case OPCODE_SPUT_OBJECT:
-  case OPCODE_SPUT_BOOLEAN:
-  case OPCODE_SPUT_BYTE:
-  case OPCODE_SPUT_CHAR:
-  case OPCODE_SPUT_SHORT:
-  case OPCODE_INVOKE_VIRTUAL:
-  case OPCODE_INVOKE_SUPER:
-  case OPCODE_INVOKE_DIRECT:
-  case OPCODE_INVOKE_STATIC:
-  case OPCODE_INVOKE_INTERFACE:
-  case OPCODE_INVOKE_VIRTUAL_RANGE:
-  case OPCODE_INVOKE_SUPER_RANGE:
-  case OPCODE_INVOKE_DIRECT_RANGE:
-  case OPCODE_INVOKE_STATIC_RANGE:
-  case OPCODE_INVOKE_INTERFACE_RANGE:
-  case FOPCODE_PACKED_SWITCH:
-  case FOPCODE_SPARSE_SWITCH:
-  case FOPCODE_FILLED_ARRAY:
-    return true;
-  default:
-    return false;
-  }
-  not_reached();
-}
-
-template <typename... T>
-std::string show(const boost::dynamic_bitset<T...>& bits) {
-  std::string ret;
-  to_string(bits, ret);
-  return ret;
-}
+constexpr const char* METRIC_PURE_METHODS = "num_pure_methods";
 
 ////////////////////////////////////////////////////////////////////////////////
 
 class LocalDce {
-  size_t m_instructions_eliminated{0};
-  size_t m_total_instructions{0};
-  std::unordered_set<DexMethod*> m_pure_methods;
+  const PureMethods& m_pure_methods;
 
   /*
-   * Eliminate dead code using a standard backward dataflow analysis for
-   * liveness.  The algorithm is as follows:
-   *
-   * - Maintain a bitvector for each block representing the liveness for each
-   *   register.  Function call results are represented by bit #num_regs.
-   *
-   * - Walk the blocks in postorder. Compute each block's output state by
-   *   OR-ing the liveness of its successors
-   *
-   * - Walk each block's instructions in reverse to determine its input state.
-   *   An instruction's input registers are live if (a) it has side effects, or
-   *   (b) its output registers are live.
-   *
-   * - If the liveness of any block changes during a pass, repeat it.  Since
-   *   anything live in one pass is guaranteed to be live in the next, this is
-   *   guaranteed to reach a fixed point and terminate.  Visiting blocks in
-   *   postorder guarantees a minimum number of passes.
+   * Eliminate dead code using the standard backward dataflow analysis for
+   * liveness, with a twist: an instruction only makes its sources live if it
+   * is required, i.e. it has side effects or its outputs are live. Function
+   * call results are represented by an extra register past the last one.
    *
-   * - Catch blocks are handled slightly differently; since any instruction
-   *   inside a `try` region can jump to a catch block, we assume that any
-   *   registers that are live-in to a catch block must be kept live throughout
-   *   the `try` region.  (This is actually conservative, since only
-   *   potentially-excepting instructions can jump to a catch.)
+   * Catch blocks are successors of the blocks that may throw to them, so any
+   * registers that are live-in to a catch block are kept live throughout the
+   * `try` region.
    */
  public:
-  LocalDce() {
-    /*
-     * Pure methods have no observable side effects, so they can be removed
-     * if their outputs are not used.
-     *
-     * TODO: Derive this list with static analysis rather than hard-coding
-     * it.
-     */
-    m_pure_methods.emplace(DexMethod::make_method( "Ljava/lang/Class;",
-          "getSimpleName", "Ljava/lang/String;", {}));
-  }
+  struct Stats {
+    size_t instructions_before{0};
+    size_t instructions_after{0};
+  };
+
+  explicit LocalDce(const PureMethods& pure_methods)
+      : m_pure_methods(pure_methods) {}
 
-  void dce(DexMethod* method) {
+  Stats dce(DexMethod* method) const {
+    Stats stats;
     auto code = method->get_code();
+    stats.instructions_before = code->count_opcodes();
     code->build_cfg();
     auto& cfg = code->cfg();
     auto blocks = postorder_sort(cfg.blocks());
-    auto regs = method->get_code()->get_registers_size();
-    std::vector<boost::dynamic_bitset<>> liveness(
-        cfg.blocks().size(), boost::dynamic_bitset<>(regs + 1));
-    bool changed;
-    std::vector<FatMethod::iterator> dead_instructions;
+    uint16_t result_reg = code->get_registers_size();
 
     TRACE(DCE, 5, "%s\n", SHOW(method));
     TRACE(DCE, 5, "%s", SHOW(cfg));
 
-    // Iterate liveness analysis to a fixed point.
-    do {
-      changed = false;
-      dead_instructions.clear();
-      for (auto& b : blocks) {
-        auto prev_liveness = liveness.at(b->id());
-        auto& bliveness = liveness.at(b->id());
-        bliveness.reset();
-        TRACE(DCE, 5, "B%lu: %s\n", b->id(), show(bliveness).c_str());
-
-        // Compute live-out for this block from its successors.
-        for (auto& s : b->succs()) {
-          if(s->id() == b->id()) {
-            bliveness |= prev_liveness;
+    auto liveness = backwards_dataflow<Liveness>(
+        blocks,
+        Liveness(result_reg + 1),
+        [&](const IRInstruction* insn, Liveness* live) {
+          if (is_required(insn, *live, result_reg)) {
+            update_liveness(insn, live, result_reg);
           }
-          TRACE(DCE,
-                5,
-                "  S%lu: %s\n",
-                s->id(),
-                show(liveness[s->id()]).c_str());
-          bliveness |= liveness[s->id()];
-        }
+        });
 
-        // Compute live-in for this block by walking its instruction list in
-        // reverse and applying the liveness rules.
-        for (auto it = b->rbegin(); it != b->rend(); ++it) {
-          m_total_instructions++;
-          if (it->type != MFLOW_OPCODE) {
-            continue;
-          }
-          bool required = is_required(it->insn, bliveness);
-          if (required) {
-            update_liveness(it->insn, bliveness);
-          } else {
-            dead_instructions.push_back(std::prev(it.base()));
-          }
-          TRACE(CFG,
-                5,
-                "%s\n%s\n",
-                show(it->insn).c_str(),
-                show(bliveness).c_str());
-        }
-        if (bliveness != prev_liveness) {
-          changed = true;
+    // Only the blocks of the postorder have a liveness. The others are in
+    // cycles that nothing enters, and go away with the unreachable blocks.
+    std::vector<FatMethod::iterator> dead_instructions;
+    for (auto& b : blocks) {
+      for (auto it = b->begin(); it != b->end(); ++it) {
+        if (it->type == MFLOW_OPCODE &&
+            !is_required(it->insn, liveness->at(it->insn), result_reg)) {
+          dead_instructions.push_back(it);
         }
       }
-    } while (changed);
+    }
 
     // Remove dead instructions.
     TRACE(DCE, 2, "%s\n", SHOW(method));
     for (auto dead : dead_instructions) {
       TRACE(DCE, 2, "DEAD: %s\n", SHOW(dead->insn));
       code->remove_opcode(dead);
-      m_instructions_eliminated++;
     }
 
     remove_unreachable_blocks(method, &*code, cfg);
+    stats.instructions_after = code->count_opcodes();
 
     TRACE(DCE, 5, "=== Post-DCE CFG ===\n");
     TRACE(DCE, 5, "%s", SHOW(cfg));
+    if (stats.instructions_after != stats.instructions_before) {
+      TRACE(DCE, 2, "%s: %lu -> %lu instructions\n", SHOW(method),
+            stats.instructions_before, stats.instructions_after);
+    }
+    return stats;
   }
 
  private:
-  void remove_block(IRCode* code, Block* b) {
+  static void remove_block(IRCode* code, Block* b) {
     for (auto& mei : *b) {
       if (mei.type == MFLOW_OPCODE) {
         code->remove_opcode(mei.insn);
@@ -238,9 +115,9 @@ class LocalDce {
     }
   }
 
-  void remove_unreachable_blocks(DexMethod* method,
-                                 IRCode* code,
-                                 ControlFlowGraph& cfg) {
+  static void remove_unreachable_blocks(DexMethod* method,
+                                        IRCode* code,
+                                        ControlFlowGraph& cfg) {
     auto& blocks = cfg.blocks();
     // Remove edges to catch blocks that no longer exist.
     std::vector<std::pair<Block*, Block*>> remove_edges;
@@ -315,99 +192,104 @@ class LocalDce {
    * An instruction is required (i.e., live) if it has side effects or if its
    * destination register is live.
    */
-  bool is_required(IRInstruction* inst, const boost::dynamic_bitset<>& bliveness) {
-    if (has_side_effects(inst->opcode())) {
-      if (is_invoke(inst->opcode())) {
-        auto invoke = static_cast<IRMethodInstruction*>(inst);
-        if (!is_pure(invoke->get_method())) {
-          return true;
-        }
-        return bliveness.test(bliveness.size() - 1);
+  bool is_required(const IRInstruction* inst,
+                   const Liveness& live,
+                   uint16_t result_reg) const {
+    auto op = inst->opcode();
+    if (has_side_effects(op)) {
+      if (is_invoke(op) && m_pure_methods.is_pure_call(inst)) {
+        return live.is_live(result_reg);
       }
       return true;
     } else if (inst->dests_size()) {
-      return bliveness.test(inst->dest());
-    } else if (is_filled_new_array(inst->opcode())) {
+      return live.is_live(inst->dest()) ||
+             (inst->dest_is_wide() && live.is_live(inst->dest() + 1));
+    } else if (is_filled_new_array(op)) {
       // filled-new-array passes its dest via the return-value slot, but isn't
       // inherently live like the invoke-* instructions.
-      return bliveness.test(bliveness.size() - 1);
+      return live.is_live(result_reg);
     }
     return false;
   }
 
-  bool is_pure(DexMethod* method) {
-    if (assumenosideeffects(method)) {
-      return true;
-    }
-    return m_pure_methods.find(method) != m_pure_methods.end();
-  }
-
-
   /*
-   * Update the liveness vector given that `inst` is live.
+   * Update the liveness given that `inst` is live.
    */
-  void update_liveness(const IRInstruction* inst,
-                       boost::dynamic_bitset<>& bliveness) {
-    // The destination register is killed, so it isn't live before this.
-    if (inst->dests_size()) {
-      bliveness.reset(inst->dest());
-    }
-    // The destination of an `invoke` is its return value, which is encoded as
-    // the max position in the bitvector.
+  static void update_liveness(const IRInstruction* inst,
+                              Liveness* live,
+                              uint16_t result_reg) {
+    // The destination of an `invoke` is its return value.
     if (is_invoke(inst->opcode()) || is_filled_new_array(inst->opcode())) {
-      bliveness.reset(bliveness.size() - 1);
-    }
-    // Source registers are live.
-    for (size_t i = 0; i < inst->srcs_size(); i++) {
-      bliveness.set(inst->src((int)i));
+      live->kill(result_reg);
     }
-    // `invoke-range` instructions need special handling since their sources
-    // are encoded as a range.
-    if (opcode::has_range(inst->opcode())) {
-      for (size_t i = 0; i < inst->range_size(); i++) {
-        bliveness.set(inst->range_base() + i);
-      }
-    }
-    // The source of a `move-result` is the return value of the prior call,
-    // which is encoded as the max position in the bitvector.
+    Liveness::trans(inst, live);
+    // The source of a `move-result` is the return value of the prior call.
     if (is_move_result(inst->opcode())) {
-      bliveness.set(bliveness.size() - 1);
+      live->gen(result_reg);
     }
   }
 
  public:
-  void run(const Scope& scope) {
-	  TRACE(DCE, 1, "Running LocalDCE pass\n");
+  /*
+   * Run on every method of the scope in parallel, and return the stats of
+   * all of them summed up.
+   */
+  Stats run(const Scope& scope) const {
+    TRACE(DCE, 1, "Running LocalDCE pass\n");
+    struct MethodWork {
+      const LocalDce* self;
+      DexMethod* method;
+      Stats stats;
+    };
+    std::vector<MethodWork> work;
     walk_methods(scope,
                  [&](DexMethod* m) {
                    if (!m->get_code()) {
                      return;
                    }
-                   dce(m);
+                   work.push_back(MethodWork{this, m, Stats()});
                  });
+    std::vector<work_item> work_items;
+    work_items.reserve(work.size());
+    for (auto& w : work) {
+      work_items.push_back(work_item{
+          [](void* arg) {
+            auto w = static_cast<MethodWork*>(arg);
+            MethodCostScope cost(w->method);
+            w->stats = w->self->dce(w->method);
+          },
+          &w});
+    }
+    WorkQueue wq;
+    wq.run_work_items(work_items.data(), (int)work_items.size());
+
+    Stats total;
+    for (const auto& w : work) {
+      total.instructions_before += w.stats.instructions_before;
+      total.instructions_after += w.stats.instructions_after;
+    }
+    auto eliminated = total.instructions_before - total.instructions_after;
     TRACE(DCE, 1,
             "Dead instructions eliminated: %lu\n",
-            m_instructions_eliminated);
+            eliminated);
     TRACE(DCE, 1,
             "Total instructions: %lu\n",
-            m_total_instructions);
+            total.instructions_before);
     TRACE(DCE, 1,
             "Percentage of instructions identified as dead code: %f%%\n",
-            m_instructions_eliminated * 100 / double(m_total_instructions));
-  }
-
-  size_t num_instrs_eliminated() const {
-    return m_instructions_eliminated;
-  }
-
-  size_t num_total_instrs() const {
-    return m_total_instructions;
+            eliminated * 100 / double(total.instructions_before));
+    return total;
   }
 };
 }
 
 void LocalDcePass::run(DexMethod* m) {
-  LocalDce().dce(m);
+  PureMethods pure_methods;
+  run(m, pure_methods);
+}
+
+void LocalDcePass::run(DexMethod* m, const PureMethods& pure_methods) {
+  LocalDce(pure_methods).dce(m);
 }
 
 void LocalDcePass::run_pass(DexStoresVector& stores, ConfigFiles& cfg, PassManager& mgr) {
@@ -415,11 +297,13 @@ void LocalDcePass::run_pass(DexStoresVector& stores, ConfigFiles& cfg, PassManag
     TRACE(DCE, 1, "LocalDcePass not run because no ProGuard configuration was provided.");
     return;
   }
-  auto scope = build_class_scope(stores);
-  LocalDce ldce;
-  ldce.run(scope);
-  mgr.incr_metric(METRIC_INSTRS_ELIMINATED, ldce.num_instrs_eliminated());
-  mgr.incr_metric(METRIC_TOTAL_INSTRS, ldce.num_total_instrs());
+  auto& scope = mgr.get_analysis<ClassScopeAnalysis>(stores).scope;
+  auto& pure_methods = mgr.get_analysis<PurityAnalysis>(stores).pure_methods;
+  auto stats = LocalDce(pure_methods).run(scope);
+  mgr.incr_metric(METRIC_INSTRS_ELIMINATED,
+                  stats.instructions_before - stats.instructions_after);
+  mgr.incr_metric(METRIC_TOTAL_INSTRS, stats.instructions_before);
+  mgr.incr_metric(METRIC_PURE_METHODS, pure_methods.size());
 }
 
 static LocalDcePass s_pass;
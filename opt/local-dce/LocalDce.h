@@ -9,6 +9,7 @@
 
 #pragma once
 
+#include "Analyses.h"
 #include "Pass.h"
 
 class LocalDcePass : public Pass {
@@ -16,6 +17,10 @@ class LocalDcePass : public Pass {
   LocalDcePass() : Pass("LocalDcePass") {}
 
   static void run(DexMethod* method);
+  static void run(DexMethod* method, const PureMethods& pure_methods);
 
   virtual void run_pass(DexStoresVector&, ConfigFiles&, PassManager&) override;
+  virtual void get_preserved_analyses(PreservedAnalyses& pa) const override {
+    preserve_structural_analyses(pa);
+  }
 };
@@ -62,6 +62,7 @@ class PeepholeOptimizer {
   const ssize_t kInvalid = -1;
 
   const std::vector<DexClass*>& m_scope;
+  const TypeSystem& m_type_system;
   PassManager& m_pass_mgr;
   std::unordered_map<IRInstruction*, IRInstruction*> m_replacements;
   ssize_t m_last_call;
@@ -138,7 +139,7 @@ class PeepholeOptimizer {
       auto invoke_return_type = invoke->get_method()->get_proto()->get_rtype();
       auto check_type = static_cast<IRTypeInstruction*>(insn)->get_type();
       if (check_type != invoke_return_type) {
-        if (!check_cast(invoke_return_type, check_type)) {
+        if (!m_type_system.is_assignable_to(invoke_return_type, check_type)) {
           return insn;
         }
         m_stats_check_casts_super_removed++;
@@ -221,8 +222,11 @@ class PeepholeOptimizer {
   }
 
  public:
-  PeepholeOptimizer(const std::vector<DexClass*>& scope, PassManager& mgr)
+  PeepholeOptimizer(const std::vector<DexClass*>& scope,
+                    const TypeSystem& type_system,
+                    PassManager& mgr)
       : m_scope(scope),
+        m_type_system(type_system),
         m_pass_mgr(mgr),
         m_stats_check_casts_removed(0),
         m_stats_check_casts_super_removed(0),
@@ -243,8 +247,10 @@ class PeepholeOptimizer {
 ////////////////////////////////////////////////////////////////////////////////
 
 void PeepholePass::run_pass(DexStoresVector& stores, ConfigFiles& cfg, PassManager& mgr) {
-  auto scope = build_class_scope(stores);
-  PeepholeOptimizer(scope, mgr).run();
+  auto& scope = mgr.get_analysis<ClassScopeAnalysis>(stores).scope;
+  auto& type_system =
+      mgr.get_analysis<TypeSystemAnalysis>(stores).type_system;
+  PeepholeOptimizer(scope, type_system, mgr).run();
 }
 
 static PeepholePass s_pass;
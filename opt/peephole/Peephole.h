@@ -9,6 +9,7 @@
 
 #pragma once
 
+#include "Analyses.h"
 #include "Pass.h"
 
 class PeepholePass : public Pass {
@@ -16,4 +17,7 @@ class PeepholePass : public Pass {
   PeepholePass() : Pass("PeepholePass") {}
 
   virtual void run_pass(DexStoresVector&, ConfigFiles&, PassManager&) override;
+  virtual void get_preserved_analyses(PreservedAnalyses& pa) const override {
+    preserve_structural_analyses(pa);
+  }
 };
@@ -1192,11 +1192,13 @@ class PeepholeOptimizerV2 {
 void PeepholePassV2::run_pass(DexStoresVector& stores,
                               ConfigFiles& /*cfg*/,
                               PassManager& mgr) {
-  auto scope = build_class_scope(stores);
+  auto& scope = mgr.get_analysis<ClassScopeAnalysis>(stores).scope;
   PeepholeOptimizerV2(scope, config.disabled_peepholes).run();
   if (!contains<std::string>(config.disabled_peepholes,
                              RedundantCheckCastRemover::get_name())) {
-    RedundantCheckCastRemover(mgr, scope).run();
+    auto& type_system =
+        mgr.get_analysis<TypeSystemAnalysis>(stores).type_system;
+    RedundantCheckCastRemover(mgr, scope, type_system).run();
   } else {
     TRACE(PEEPHOLE,
           2,
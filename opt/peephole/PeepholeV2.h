@@ -10,6 +10,7 @@
 #pragma once
 
 #include <vector>
+#include "Analyses.h"
 #include "Pass.h"
 
 class PeepholePassV2 : public Pass {
@@ -18,6 +19,10 @@ class PeepholePassV2 : public Pass {
 
   virtual void run_pass(DexStoresVector&, ConfigFiles&, PassManager&) override;
 
+  virtual void get_preserved_analyses(PreservedAnalyses& pa) const override {
+    preserve_structural_analyses(pa);
+  }
+
   virtual void configure_pass(const PassConfig& pc) override {
     pc.get("disabled_peepholes", {}, config.disabled_peepholes);
   }
@@ -8,8 +8,10 @@
 #include "Walkers.h"
 
 RedundantCheckCastRemover::RedundantCheckCastRemover(
-    PassManager& mgr, const std::vector<DexClass*>& scope)
-    : m_mgr(mgr), m_scope(scope) {}
+    PassManager& mgr,
+    const std::vector<DexClass*>& scope,
+    const TypeSystem& type_system)
+    : m_mgr(mgr), m_scope(scope), m_type_system(type_system) {}
 
 void remove_instructions(
     const std::unordered_map<DexMethod*, std::vector<IRInstruction*>>&
@@ -33,15 +35,17 @@ void RedundantCheckCastRemover::run() {
 
   auto& mgr =
       this->m_mgr; // so the lambda doesn't have to capture all of `this`
+  auto& type_system = this->m_type_system;
   walk_matching_opcodes_in_block(
       m_scope,
       match,
-      [&mgr, &to_remove](const DexMethod* method,
+      [&mgr, &type_system, &to_remove](const DexMethod* method,
                          IRCode* /* unused */,
                          Block* /* unused */,
                          size_t size,
                          IRInstruction** insns) {
-        if (RedundantCheckCastRemover::can_remove_check_cast(insns, size)) {
+        if (RedundantCheckCastRemover::can_remove_check_cast(
+                type_system, insns, size)) {
           to_remove[const_cast<DexMethod*>(method)].push_back(insns[2]);
           mgr.incr_metric("redundant_check_casts_removed", 1);
 
@@ -55,8 +59,8 @@ void RedundantCheckCastRemover::run() {
   remove_instructions(to_remove);
 }
 
-bool RedundantCheckCastRemover::can_remove_check_cast(IRInstruction** insns,
-                                                      size_t size) {
+bool RedundantCheckCastRemover::can_remove_check_cast(
+    const TypeSystem& type_system, IRInstruction** insns, size_t size) {
   always_assert(size == 3);
   IRMethodInstruction* invoke_op = static_cast<IRMethodInstruction*>(insns[0]);
   IRInstruction* move_result_op = insns[1];
@@ -65,5 +69,5 @@ bool RedundantCheckCastRemover::can_remove_check_cast(IRInstruction** insns,
   auto invoke_return = invoke_op->get_method()->get_proto()->get_rtype();
   auto check_type = check_cast_op->get_type();
   return move_result_op->dest() == check_cast_op->src(0) &&
-         check_cast(invoke_return, check_type);
+         type_system.is_assignable_to(invoke_return, check_type);
 }
@@ -5,6 +5,7 @@
 #include <vector>
 #include "DexClass.h"
 #include "PassManager.h"
+#include "TypeSystem.h"
 
 class RedundantCheckCastRemover {
  public:
@@ -14,12 +15,14 @@ class RedundantCheckCastRemover {
   }
 
   explicit RedundantCheckCastRemover(PassManager& mgr,
-                                     const std::vector<DexClass*>& scope);
+                                     const std::vector<DexClass*>& scope,
+                                     const TypeSystem& type_system);
   void run();
 
  private:
-  static bool can_remove_check_cast(IRInstruction**, size_t);
+  static bool can_remove_check_cast(const TypeSystem&, IRInstruction**, size_t);
 
   PassManager& m_mgr;
   const std::vector<DexClass*>& m_scope;
+  const TypeSystem& m_type_system;
 };
@@ -219,7 +219,7 @@ struct Rebinder {
     switch (invoke_type) {
       case InvokeType::Static:
         rebind_method_opcode(
-            mop, mref, resolve_method(mref, MethodSearch::Static));
+            mop, mref, resolve_method_cached(mref, MethodSearch::Static));
         return;
       case InvokeType::Interface:
         rebind_method_opcode(mop, mref, resolve_intf_methodref(mref));
@@ -294,7 +294,7 @@ struct Rebinder {
   void rebind_field(IRInstruction* insn, FieldSearch field_search) {
     const auto fop = static_cast<IRFieldInstruction*>(insn);
     const auto fref = fop->field();
-    const auto real_ref = resolve_field(fref, field_search);
+    const auto real_ref = resolve_field_cached(fref, field_search);
     if (real_ref && real_ref != fref) {
       auto cls = type_class(real_ref->get_class());
       always_assert(cls != nullptr);
@@ -0,0 +1,377 @@
+/**
+ * Copyright (c) 2017-present, Facebook, Inc.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree. An additional grant
+ * of patent rights can be found in the PATENTS file in the same directory.
+ */
+
+#include "GraphColoring.h"
+
+#include <algorithm>
+#include <limits>
+#include <unordered_set>
+
+#include "ControlFlow.h"
+#include "DexUtil.h"
+#include "IRInstruction.h"
+#include "Liveness.h"
+#include "Transform.h"
+
+namespace {
+
+constexpr uint32_t NO_UNIT = std::numeric_limits<uint32_t>::max();
+constexpr reg_t NO_REG = std::numeric_limits<reg_t>::max();
+
+bool is_local_op(const DexDebugInstruction& dbgop) {
+  switch (dbgop.opcode()) {
+  case DBG_START_LOCAL:
+  case DBG_START_LOCAL_EXTENDED:
+  case DBG_END_LOCAL:
+  case DBG_RESTART_LOCAL:
+    return true;
+  default:
+    return false;
+  }
+}
+
+/*
+ * Registers [lo, lo + size) of the original frame, allocated together.
+ */
+struct Unit {
+  reg_t lo;
+  reg_t size;
+  bool used {false};
+  // number of operands that can only address 4-bit / 8-bit registers
+  size_t nibble_uses {0};
+  size_t byte_uses {0};
+  // the unit this one was coalesced into, or itself
+  uint32_t rep;
+  reg_t color {NO_REG};
+};
+
+class Allocation {
+ public:
+  explicit Allocation(IRCode* code)
+      : m_code(code),
+        m_nregs(code->get_registers_size()),
+        m_ins(code->get_ins_size()) {}
+
+  void build_units();
+  void count_uses();
+  void build_interference();
+  // returns the number of moves coalesced
+  size_t coalesce();
+  // returns the size of the new frame
+  reg_t color();
+  // Applies the new assignment, the only step that changes the code. Returns
+  // the number of moves removed.
+  size_t rewrite(reg_t new_nregs);
+
+ private:
+  uint32_t find(uint32_t u) {
+    while (m_units[u].rep != u) {
+      m_units[u].rep = m_units[m_units[u].rep].rep;
+      u = m_units[u].rep;
+    }
+    return u;
+  }
+
+  void add_edge(uint32_t u, uint32_t v) {
+    m_adj[u].insert(v);
+    m_adj[v].insert(u);
+  }
+
+  void note_use(reg_t reg, int width) {
+    auto& unit = m_units[m_unit_of.at(reg)];
+    unit.used = true;
+    if (width <= 4) {
+      unit.nibble_uses++;
+    } else if (width <= 8) {
+      unit.byte_uses++;
+    }
+  }
+
+  reg_t new_reg(reg_t reg) const;
+
+  // the code never touches the register of this local, so it gets no
+  // register at all
+  bool is_unused_local(const MethodItemEntry& mie) const {
+    if (mie.type != MFLOW_DEBUG || !is_local_op(*mie.dbgop)) {
+      return false;
+    }
+    auto reg = mie.dbgop->uvalue();
+    return reg >= m_nregs || !m_units[m_unit_of[reg]].used;
+  }
+
+  IRCode* m_code;
+  reg_t m_nregs;
+  reg_t m_ins;
+  std::vector<uint32_t> m_unit_of;
+  std::vector<Unit> m_units;
+  std::vector<std::unordered_set<uint32_t>> m_adj;
+  // the unit holding the parameters, pinned to the top of the frame
+  uint32_t m_top {NO_UNIT};
+  // where the top unit starts in the new frame
+  reg_t m_top_base {0};
+};
+
+void Allocation::build_units() {
+  // joined[r] means that r and r + 1 belong to the same unit
+  std::vector<bool> joined(m_nregs, false);
+  auto join = [&](size_t base, size_t count) {
+    for (size_t i = 0; i + 1 < count; ++i) {
+      joined.at(base + i) = true;
+    }
+  };
+  for (auto& mie : InstructionIterable(m_code)) {
+    auto insn = mie.insn;
+    if (insn->dests_size() && insn->dest_is_wide()) {
+      join(insn->dest(), 2);
+    }
+    for (size_t i = 0; i < insn->srcs_size(); ++i) {
+      if (insn->src_is_wide(i)) {
+        join(insn->src(i), 2);
+      }
+    }
+    if (opcode::has_range(insn->opcode())) {
+      join(insn->range_base(), insn->range_size());
+    }
+  }
+  join(m_nregs - m_ins, m_ins);
+
+  m_unit_of.resize(m_nregs);
+  for (reg_t reg = 0; reg < m_nregs; ++reg) {
+    if (reg == 0 || !joined[reg - 1]) {
+      Unit unit;
+      unit.lo = reg;
+      unit.size = 0;
+      unit.rep = m_units.size();
+      m_units.push_back(unit);
+    }
+    m_units.back().size++;
+    m_unit_of[reg] = m_units.size() - 1;
+  }
+  if (m_ins > 0) {
+    m_top = m_unit_of[m_nregs - 1];
+    m_units[m_top].used = true;
+  }
+  m_adj.resize(m_units.size());
+}
+
+void Allocation::count_uses() {
+  for (auto& mie : InstructionIterable(m_code)) {
+    auto insn = mie.insn;
+    auto op = insn->opcode();
+    // moves get the smallest opcode that fits after allocation, and /range
+    // operands can address any register
+    bool any_width = is_move(op) || opcode::has_range(op);
+    if (insn->dests_size()) {
+      note_use(insn->dest(), any_width ? 16 : dest_bit_width(op));
+    }
+    for (size_t i = 0; i < insn->srcs_size(); ++i) {
+      note_use(insn->src(i), any_width ? 16 : src_bit_width(op, i));
+    }
+    if (opcode::has_range(op) && insn->range_size() > 0) {
+      note_use(insn->range_base(), 16);
+    }
+  }
+}
+
+void Allocation::build_interference() {
+  // end the blocks before the instructions that may throw, so that what is
+  // live in a catch handler is live across all of its try block
+  m_code->build_cfg(true);
+  auto liveness = Liveness::analyze(m_code->cfg(), m_nregs);
+  for (auto& mie : InstructionIterable(m_code)) {
+    auto insn = mie.insn;
+    if (!insn->dests_size()) {
+      continue;
+    }
+    auto def = m_unit_of[insn->dest()];
+    // the registers read by a move may be shared with the ones it writes
+    size_t copy_begin = 0;
+    size_t copy_end = 0;
+    if (is_move(insn->opcode())) {
+      copy_begin = insn->src(0);
+      copy_end = copy_begin + (insn->src_is_wide(0) ? 2 : 1);
+    }
+    const auto& live_out = liveness->at(insn).bits();
+    for (auto reg = live_out.find_first(); reg != RegSet::npos;
+         reg = live_out.find_next(reg)) {
+      auto unit = m_unit_of[reg];
+      if (unit != def && (reg < copy_begin || reg >= copy_end)) {
+        add_edge(def, unit);
+      }
+    }
+  }
+}
+
+size_t Allocation::coalesce() {
+  size_t coalesced = 0;
+  for (auto& mie : InstructionIterable(m_code)) {
+    auto insn = mie.insn;
+    if (!is_move(insn->opcode())) {
+      continue;
+    }
+    auto dest = insn->dest();
+    auto src = insn->src(0);
+    auto dest_unit = m_unit_of[dest];
+    auto src_unit = m_unit_of[src];
+    auto u = find(dest_unit);
+    auto v = find(src_unit);
+    if (u == v || u == m_top || v == m_top) {
+      continue;
+    }
+    // both sides must land on the same register once the units are colored
+    // together
+    if (m_units[u].size != m_units[v].size ||
+        dest - m_units[dest_unit].lo != src - m_units[src_unit].lo) {
+      continue;
+    }
+    if (m_adj[u].count(v)) {
+      continue;
+    }
+    m_units[v].rep = u;
+    m_units[u].nibble_uses += m_units[v].nibble_uses;
+    m_units[u].byte_uses += m_units[v].byte_uses;
+    for (auto n : m_adj[v]) {
+      m_adj[n].erase(v);
+      add_edge(u, n);
+    }
+    m_adj[v].clear();
+    coalesced++;
+  }
+  return coalesced;
+}
+
+reg_t Allocation::color() {
+  std::vector<uint32_t> order;
+  for (uint32_t u = 0; u < m_units.size(); ++u) {
+    if (u != m_top && find(u) == u && m_units[u].used) {
+      order.push_back(u);
+    }
+  }
+  // units used by operands that can only address low registers go first
+  std::stable_sort(order.begin(), order.end(), [&](uint32_t u, uint32_t v) {
+    const auto& a = m_units[u];
+    const auto& b = m_units[v];
+    if (a.nibble_uses != b.nibble_uses) {
+      return a.nibble_uses > b.nibble_uses;
+    }
+    return a.byte_uses > b.byte_uses;
+  });
+
+  size_t frame = 0;
+  std::vector<std::pair<size_t, size_t>> taken;
+  for (auto u : order) {
+    taken.clear();
+    for (auto n : m_adj[u]) {
+      const auto& neighbor = m_units[n];
+      if (neighbor.color != NO_REG) {
+        taken.emplace_back(neighbor.color, neighbor.color + neighbor.size);
+      }
+    }
+    std::sort(taken.begin(), taken.end());
+    size_t base = 0;
+    for (const auto& interval : taken) {
+      if (base + m_units[u].size <= interval.first) {
+        break;
+      }
+      base = std::max(base, interval.second);
+    }
+    m_units[u].color = base;
+    frame = std::max(frame, base + m_units[u].size);
+  }
+  m_top_base = frame;
+  if (m_top != NO_UNIT) {
+    frame += m_units[m_top].size;
+  }
+  always_assert(frame <= std::numeric_limits<reg_t>::max());
+  return frame;
+}
+
+reg_t Allocation::new_reg(reg_t reg) const {
+  auto unit_id = m_unit_of.at(reg);
+  const auto& unit = m_units[unit_id];
+  if (unit_id == m_top) {
+    return m_top_base + (reg - unit.lo);
+  }
+  auto rep = unit_id;
+  while (m_units[rep].rep != rep) {
+    rep = m_units[rep].rep;
+  }
+  if (m_units[rep].color == NO_REG) {
+    return NO_REG;
+  }
+  return m_units[rep].color + (reg - unit.lo);
+}
+
+size_t Allocation::rewrite(reg_t new_nregs) {
+  for (auto it = m_code->begin(); it != m_code->end();) {
+    if (is_unused_local(*it)) {
+      auto& mie = *it;
+      it = m_code->erase(it);
+      delete &mie;
+    } else {
+      ++it;
+    }
+  }
+  size_t moves_removed = 0;
+  for (auto it = m_code->begin(); it != m_code->end(); ++it) {
+    if (it->type == MFLOW_DEBUG && is_local_op(*it->dbgop)) {
+      it->dbgop->set_uvalue(new_reg(it->dbgop->uvalue()));
+    } else if (it->type == MFLOW_OPCODE) {
+      auto insn = it->insn;
+      auto op = insn->opcode();
+      if (insn->dests_size()) {
+        insn->set_dest(new_reg(insn->dest()));
+      }
+      for (size_t i = 0; i < insn->srcs_size(); ++i) {
+        insn->set_src(i, new_reg(insn->src(i)));
+      }
+      if (opcode::has_range(op) && insn->range_size() > 0) {
+        insn->set_range_base(new_reg(insn->range_base()));
+      }
+      if (is_move(op)) {
+        if (insn->dest() == insn->src(0)) {
+          m_code->remove_opcode(it);
+          moves_removed++;
+        } else {
+          insn->set_opcode(
+              move_opcode(dest_kind(op), insn->dest(), insn->src(0)));
+        }
+      }
+    }
+  }
+  m_code->set_registers_size(new_nregs);
+  return moves_removed;
+}
+
+}
+
+void GraphColoringAllocator::allocate(DexMethod* method) {
+  auto code = method->get_code();
+  if (code->get_registers_size() == 0) {
+    return;
+  }
+  Allocation allocation(&*code);
+  allocation.build_units();
+  allocation.count_uses();
+  allocation.build_interference();
+  auto coalesced = allocation.coalesce();
+  auto old_nregs = code->get_registers_size();
+  auto new_nregs = allocation.color();
+  if (new_nregs > old_nregs || (new_nregs == old_nregs && coalesced == 0)) {
+    TRACE(REG, 3, "Keeping the registers of %s: %d <= %d\n",
+          SHOW(method), old_nregs, new_nregs);
+    return;
+  }
+  auto moves_removed = allocation.rewrite(new_nregs);
+  TRACE(REG, 3, "Reallocated %s: %d -> %d regs, %d moves removed\n",
+        SHOW(method), old_nregs, new_nregs, moves_removed);
+  m_stats.methods_reallocated++;
+  m_stats.registers_saved += old_nregs - new_nregs;
+  m_stats.moves_removed += moves_removed;
+}
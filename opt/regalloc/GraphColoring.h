@@ -0,0 +1,48 @@
+/**
+ * Copyright (c) 2017-present, Facebook, Inc.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree. An additional grant
+ * of patent rights can be found in the PATENTS file in the same directory.
+ */
+
+#pragma once
+
+#include "DexClass.h"
+#include "RegAlloc.h"
+
+/*
+ * Reassigns the registers of a method from scratch, to undo the frame growth
+ * of passes like the inliner that only ever add registers.
+ *
+ * The registers of the method are treated as virtual registers and grouped
+ * into units of registers that have to stay adjacent: the two halves of wide
+ * values, the operands of /range instructions and the parameters. Two units
+ * interfere when one is defined while the other is live. Moves between units
+ * that do not interfere are coalesced, i.e. both sides get the same register
+ * and the move goes away. The units are then colored greedily, each getting
+ * the lowest registers not used by the units it interferes with; units that
+ * are operands of opcodes that can only address 4-bit (then 8-bit) registers
+ * go first so that they end up in the low registers. The parameters stay at
+ * the top of the frame.
+ *
+ * Operands that still end up out of reach of their opcode are left to
+ * HighRegMoveInserter, which runs afterwards. The new assignment is only
+ * applied when it makes the frame smaller or removes moves; otherwise the
+ * method, including its debug info, is left as it was.
+ */
+class GraphColoringAllocator {
+ public:
+  struct Stats {
+    size_t methods_reallocated {0};
+    size_t registers_saved {0};
+    size_t moves_removed {0};
+  };
+
+  void allocate(DexMethod* method);
+  const Stats& get_stats() const { return m_stats; }
+
+ private:
+  Stats m_stats;
+};
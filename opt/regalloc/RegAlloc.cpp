@@ -13,6 +13,7 @@
 
 #include "Dataflow.h"
 #include "DexUtil.h"
+#include "GraphColoring.h"
 #include "IRInstruction.h"
 #include "Transform.h"
 #include "Walkers.h"
@@ -77,7 +78,7 @@ IRInstruction* create_range_equivalent(IRInstruction* insn) {
 
 } // namespace
 
-IRInstruction* gen_move(RegisterKind kind, reg_t dest, reg_t src) {
+DexOpcode move_opcode(RegisterKind kind, reg_t dest, reg_t src) {
   static std::unordered_map<RegisterKind,
                             std::array<DexOpcode, 3>,
                             boost::hash<RegisterKind>>
@@ -92,15 +93,17 @@ IRInstruction* gen_move(RegisterKind kind, reg_t dest, reg_t src) {
              OPCODE_MOVE_OBJECT_16}}}};
   assert_log(move_map.find(kind) != move_map.end(),
       "Cannot generate move for register kind %s", SHOW(kind));
-  DexOpcode op;
   if (required_bit_width(dest) <= 4 && required_bit_width(src) <= 4) {
-    op = move_map.at(kind).at(0);
+    return move_map.at(kind).at(0);
   } else if (required_bit_width(dest) <= 8) {
-    op = move_map.at(kind).at(1);
+    return move_map.at(kind).at(1);
   } else {
-    op = move_map.at(kind).at(2);
+    return move_map.at(kind).at(2);
   }
-  auto insn = new IRInstruction(op);
+}
+
+IRInstruction* gen_move(RegisterKind kind, reg_t dest, reg_t src) {
+  auto insn = new IRInstruction(move_opcode(kind, dest, src));
   insn->set_dest(dest);
   insn->set_src(0, src);
   return insn;
@@ -207,7 +210,7 @@ void HighRegMoveInserter::increment_all_regs(IRCode* code,
 
 void HighRegMoveInserter::handle_rangeable(IRCode* code,
                                            InstructionIterator& it,
-                                           const KindVec& reg_kinds,
+                                           const RegisterKinds& reg_kinds,
                                            reg_t range_start) {
   auto insn = it->insn;
   auto op = insn->opcode();
@@ -234,7 +237,7 @@ void HighRegMoveInserter::handle_rangeable(IRCode* code,
   it->insn->set_range_base(range_start);
   it->insn->set_range_size(insn->srcs_size());
   for (size_t i = 0; i < insn->srcs_size(); ++i) {
-    auto reg_kind = reg_kinds.at(insn->src(i));
+    auto reg_kind = reg_kinds.src_kind(insn, i);
     auto mov = gen_move(reg_kind, range_start + i, insn->src(i));
     code->insert_before(it.unwrap(), mov);
     m_stats.add_move(mov);
@@ -249,9 +252,8 @@ void HighRegMoveInserter::handle_rangeable(IRCode* code,
   delete insn;
 }
 
-static std::string show_register_kinds(
-    IRCode* code,
-    const std::unordered_map<IRInstruction*, KindVec>& reg_kind_map) {
+static std::string show_register_kinds(IRCode* code,
+                                       const RegisterKinds& reg_kinds) {
   std::stringstream ss;
   auto ii = InstructionIterable(code);
   auto end = ii.end();
@@ -259,7 +261,7 @@ static std::string show_register_kinds(
     auto insn = it ->insn;
     ss << show(insn) << " ";
     for (size_t i = 0; i < insn->srcs_size(); ++i) {
-      ss << show(reg_kind_map.at(insn).at(insn->src(i))) << " ";
+      ss << show(reg_kinds.src_kind(insn, i)) << " ";
     }
     ss << "\n";
   }
@@ -268,9 +270,9 @@ static std::string show_register_kinds(
 
 void HighRegMoveInserter::insert_moves(
     DexMethod* method, const HighRegMoveInserter::SwapInfo& swap_info) {
-  auto reg_kind_map = analyze_register_kinds(method);
+  auto reg_kinds = analyze_register_kinds(method);
   auto code = method->get_code();
-  TRACE(REG, 5, "%s", show_register_kinds(&*code, *reg_kind_map).c_str());
+  TRACE(REG, 5, "%s", show_register_kinds(&*code, *reg_kinds).c_str());
   auto ii = InstructionIterable(code);
   auto end = ii.end();
   for (auto it = ii.begin(); it != end; ++it) {
@@ -278,16 +280,15 @@ void HighRegMoveInserter::insert_moves(
     auto op = insn->opcode();
     TRACE(REG, 6, "Processing %s\n", SHOW(insn));
     if (is_rangeable(op)) {
-      auto reg_kinds = reg_kind_map->at(insn);
       auto range_start = code->get_registers_size() - code->get_ins_size() -
                          swap_info.range_swap;
-      handle_rangeable(&*code, it, reg_kinds, range_start);
+      handle_rangeable(&*code, it, *reg_kinds, range_start);
       continue;
     }
     size_t swap_used {0};
     for (size_t i = 0; i < insn->srcs_size(); ++i) {
       if (required_bit_width(insn->src(i)) > src_bit_width(op, i)) {
-        auto reg_kind = reg_kind_map->at(insn).at(insn->src(i));
+        auto reg_kind = reg_kinds->src_kind(insn, i);
         auto mov = gen_move(reg_kind, swap_used, insn->src(i));
         code->insert_before(it.unwrap(), mov);
         insn->set_src(i, swap_used);
@@ -309,7 +310,8 @@ void HighRegMoveInserter::insert_moves(
 void RegAllocPass::run_pass(DexStoresVector& stores,
                             ConfigFiles&,
                             PassManager& mgr) {
-  auto scope = build_class_scope(stores);
+  auto& scope = mgr.get_analysis<ClassScopeAnalysis>(stores).scope;
+  GraphColoringAllocator allocator;
   HighRegMoveInserter move_inserter;
   walk_code(scope,
             [](DexMethod*) { return true; },
@@ -317,6 +319,9 @@ void RegAllocPass::run_pass(DexStoresVector& stores,
               TRACE(REG, 3, "Allocating %s regs: %d ins: %d\n",
                     SHOW(m), code.get_registers_size(), code.get_ins_size());
               try {
+                if (m_allocate) {
+                  allocator.allocate(m);
+                }
                 TRACE(REG, 5, "Before reservation:\n%s\n", SHOW(&code));
                 auto swap_info = HighRegMoveInserter::reserve_swap(m);
                 TRACE(REG, 3, "Swap info: %d %d\n",
@@ -329,6 +334,10 @@ void RegAllocPass::run_pass(DexStoresVector& stores,
                 throw;
               }
             });
+  auto& alloc_stats = allocator.get_stats();
+  mgr.incr_metric("methods_reallocated", alloc_stats.methods_reallocated);
+  mgr.incr_metric("registers_saved", alloc_stats.registers_saved);
+  mgr.incr_metric("moves_removed", alloc_stats.moves_removed);
   auto& stats = move_inserter.get_stats();
   mgr.incr_metric("moves_inserted", stats.moves_inserted);
   mgr.incr_metric("range_conversions", stats.range_conversions);
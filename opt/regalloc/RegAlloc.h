@@ -9,12 +9,18 @@
 
 #pragma once
 
+#include "Analyses.h"
 #include "DexInstruction.h"
 #include "RegisterKind.h"
 
 using reg_t = uint16_t;
 using bit_width_t = uint8_t;
 
+/*
+ * The smallest move opcode of the given kind that can address dest and src.
+ */
+DexOpcode move_opcode(RegisterKind kind, reg_t dest, reg_t src);
+
 IRInstruction* gen_move(RegisterKind kind, reg_t dest, reg_t src);
 
 /*
@@ -60,7 +66,7 @@ class HighRegMoveInserter {
  private:
   void handle_rangeable(IRCode* mt,
                         InstructionIterator& it,
-                        const KindVec& reg_kinds,
+                        const RegisterKinds& reg_kinds,
                         reg_t range_start);
   static size_t low_reg_space_needed(IRCode* code);
   static size_t range_space_needed(IRCode* code);
@@ -72,6 +78,16 @@ class HighRegMoveInserter {
 class RegAllocPass : public Pass {
 public:
   RegAllocPass() : Pass("RegAllocPass") {}
-  virtual void configure_pass(const PassConfig&) override {}
+  virtual void configure_pass(const PassConfig& pc) override {
+    // reassign all the registers with GraphColoringAllocator before fixing up
+    // the operands that are out of reach
+    pc.get("allocate", true, m_allocate);
+  }
   virtual void run_pass(DexStoresVector&, ConfigFiles&, PassManager&) override;
+  virtual void get_preserved_analyses(PreservedAnalyses& pa) const override {
+    preserve_structural_analyses(pa);
+  }
+
+ private:
+  bool m_allocate;
 };
@@ -9,7 +9,8 @@
 
 #include "RegisterKind.h"
 
-#include "Dataflow.h"
+#include <limits>
+
 #include "DexUtil.h"
 
 std::string show(RegisterKind kind) {
@@ -340,63 +341,352 @@ RegisterKind dest_kind(DexOpcode op) {
   }
 }
 
-void KindVec::meet(const KindVec& that) {
-  for (size_t i = 0; i < m_vec.size(); ++i) {
-    if (m_vec.at(i) == RegisterKind::UNKNOWN) {
-      m_vec.at(i) = that.at(i);
-    } else if (that.at(i) == RegisterKind::UNKNOWN) {
-      continue;
-    } else if ((m_vec.at(i) == RegisterKind::NORMAL &&
-                that.at(i) == RegisterKind::OBJECT) ||
-               (m_vec.at(i) == RegisterKind::OBJECT &&
-                that.at(i) == RegisterKind::NORMAL)) {
-      // const opcodes produce values that could be used either as object
-      // or non-object values... the analysis starts out assuming that they
-      // are non-objects and refines that choice if the value gets used in an
-      // object context
-      m_vec.at(i) = RegisterKind::OBJECT;
-    } else if (m_vec.at(i) != that.at(i)) {
-      m_vec.at(i) = RegisterKind::MIXED;
-    }
+RegisterKind meet(RegisterKind a, RegisterKind b) {
+  if (a == RegisterKind::UNKNOWN) {
+    return b;
+  } else if (b == RegisterKind::UNKNOWN || a == b) {
+    return a;
+  } else if ((a == RegisterKind::NORMAL && b == RegisterKind::OBJECT) ||
+             (a == RegisterKind::OBJECT && b == RegisterKind::NORMAL)) {
+    // const opcodes produce values that could be used either as object
+    // or non-object values... the analysis starts out assuming that they
+    // are non-objects and refines that choice if the value gets used in an
+    // object context
+    return RegisterKind::OBJECT;
   }
+  return RegisterKind::MIXED;
 }
 
-bool KindVec::operator==(const KindVec& that) const {
-  return m_vec == that.m_vec;
-}
+namespace {
+
+// the definition of the registers that nothing wrote
+constexpr uint32_t UNDEF = 0;
 
-std::unique_ptr<std::unordered_map<IRInstruction*, KindVec>>
-analyze_register_kinds(DexMethod* method) {
+uint32_t entry_def(uint16_t reg) { return 1 + reg; }
+
+uint32_t insn_def(uint16_t nregs, size_t index) { return 1 + nregs + index; }
+
+std::vector<RegisterKind> entry_kinds(DexMethod* method) {
   auto code = method->get_code();
-  KindVec entry_kinds(code->get_registers_size());
+  std::vector<RegisterKind> entry_kinds(code->get_registers_size(),
+                                        RegisterKind::UNKNOWN);
   auto args = method->get_proto()->get_args()->get_type_list();
   auto args_reg = code->get_registers_size() - code->get_ins_size();
   if (!is_static(method)) {
-    entry_kinds[args_reg] = RegisterKind::OBJECT;
+    entry_kinds.at(args_reg) = RegisterKind::OBJECT;
     ++args_reg;
   }
   for (DexType* arg : args) {
     if (is_wide_type(arg)) {
-      entry_kinds[args_reg] = RegisterKind::WIDE;
+      entry_kinds.at(args_reg) = RegisterKind::WIDE;
       args_reg += 2;
     } else {
       if (is_primitive(arg)) {
-        entry_kinds[args_reg] = RegisterKind::NORMAL;
+        entry_kinds.at(args_reg) = RegisterKind::NORMAL;
       } else {
-        entry_kinds[args_reg] = RegisterKind::OBJECT;
+        entry_kinds.at(args_reg) = RegisterKind::OBJECT;
       }
       ++args_reg;
     }
   }
   always_assert(args_reg == code->get_registers_size());
-  auto trans = [&](const IRInstruction* insn, KindVec* kinds) {
-    if (insn->dests_size()) {
-      (*kinds)[insn->dest()] = dest_kind(insn->opcode());
+  return entry_kinds;
+}
+
+/*
+ * Finds the definitions of registers that reach the entry of blocks, and
+ * places a phi wherever several of them merge. Chains of blocks with a
+ * single predecessor are walked through without a phi. The phis get their
+ * operands once the lookup that created them is done, so that the lookups
+ * never recurse, however deep the CFG.
+ */
+class ReachingDefs {
+ public:
+  ReachingDefs(const FlatCode& code,
+               const std::vector<uint32_t>& pred_offsets,
+               const std::vector<uint32_t>& preds,
+               uint16_t nregs,
+               std::vector<RegisterKind>* def_kinds)
+      : m_pred_offsets(pred_offsets),
+        m_preds(preds),
+        m_def_kinds(*def_kinds),
+        m_first_phi(def_kinds->size()) {
+    for (size_t block = 0; block + 1 < pred_offsets.size(); ++block) {
+      for (auto it = code.begin(block); it != code.end(block); ++it) {
+        if (it->has_dest()) {
+          m_last_defs[key(block, it->dest)] =
+              insn_def(nregs, code.index_of(*it));
+        }
+      }
+    }
+  }
+
+  /*
+   * The definition of reg that reaches the entry of block.
+   */
+  uint32_t at_entry(uint32_t block, uint16_t reg) {
+    auto def = find_entry(block, reg);
+    if (!m_filling) {
+      m_filling = true;
+      while (!m_unfilled.empty()) {
+        auto phi = m_unfilled.back();
+        m_unfilled.pop_back();
+        fill(phi);
+      }
+      m_filling = false;
+    }
+    return def;
+  }
+
+  /*
+   * Give every phi the meet of the kinds of its operands, iterating over the
+   * cycles of phis until none changes.
+   */
+  void solve() {
+    std::vector<std::vector<uint32_t>> users(m_phis.size());
+    for (uint32_t phi = 0; phi < m_phis.size(); ++phi) {
+      for (auto def : m_phis[phi].operands) {
+        if (def >= m_first_phi) {
+          users[def - m_first_phi].push_back(phi);
+        }
+      }
+    }
+    std::vector<uint32_t> work_list(m_phis.size());
+    std::vector<bool> queued(m_phis.size(), true);
+    for (uint32_t phi = 0; phi < m_phis.size(); ++phi) {
+      work_list[phi] = phi;
     }
+    while (!work_list.empty()) {
+      auto phi = work_list.back();
+      work_list.pop_back();
+      queued[phi] = false;
+      auto kind = RegisterKind::UNKNOWN;
+      for (auto def : m_phis[phi].operands) {
+        kind = meet(kind, m_def_kinds[def]);
+      }
+      auto& phi_kind = m_def_kinds[m_first_phi + phi];
+      if (kind == phi_kind) {
+        continue;
+      }
+      phi_kind = kind;
+      for (auto user : users[phi]) {
+        if (!queued[user]) {
+          queued[user] = true;
+          work_list.push_back(user);
+        }
+      }
+    }
+  }
+
+ private:
+  static constexpr uint32_t PENDING = std::numeric_limits<uint32_t>::max();
+
+  struct Phi {
+    uint32_t block;
+    uint16_t reg;
+    std::vector<uint32_t> operands;
   };
+
+  static uint64_t key(uint32_t block, uint16_t reg) {
+    return (uint64_t(block) << 16) | reg;
+  }
+
+  uint32_t at_exit(uint32_t block, uint16_t reg) {
+    auto it = m_last_defs.find(key(block, reg));
+    return it != m_last_defs.end() ? it->second : at_entry(block, reg);
+  }
+
+  uint32_t find_entry(uint32_t block, uint16_t reg) {
+    m_chain.clear();
+    uint32_t def;
+    auto cur = block;
+    while (true) {
+      auto it = m_entries.find(key(cur, reg));
+      if (it != m_entries.end()) {
+        // a pending block is one of the chain: the chain is a cycle that
+        // nothing enters, which still needs a phi to close it
+        def = it->second != PENDING ? it->second : new_phi(cur, reg);
+        break;
+      }
+      auto npreds = m_pred_offsets[cur + 1] - m_pred_offsets[cur];
+      if (cur != 0 && npreds == 1) {
+        m_entries[key(cur, reg)] = PENDING;
+        m_chain.push_back(cur);
+        auto pred = m_preds[m_pred_offsets[cur]];
+        auto last = m_last_defs.find(key(pred, reg));
+        if (last != m_last_defs.end()) {
+          def = last->second;
+          break;
+        }
+        cur = pred;
+      } else if (npreds == 0) {
+        def = cur == 0 ? entry_def(reg) : UNDEF;
+        m_entries[key(cur, reg)] = def;
+        break;
+      } else {
+        def = new_phi(cur, reg);
+        break;
+      }
+    }
+    for (auto b : m_chain) {
+      m_entries[key(b, reg)] = def;
+    }
+    return def;
+  }
+
+  uint32_t new_phi(uint32_t block, uint16_t reg) {
+    uint32_t def = m_def_kinds.size();
+    m_def_kinds.push_back(RegisterKind::UNKNOWN);
+    m_unfilled.push_back(m_phis.size());
+    m_phis.push_back(Phi{block, reg, {}});
+    m_entries[key(block, reg)] = def;
+    return def;
+  }
+
+  void fill(uint32_t phi) {
+    auto block = m_phis[phi].block;
+    auto reg = m_phis[phi].reg;
+    std::vector<uint32_t> operands;
+    if (block == 0) {
+      operands.push_back(entry_def(reg));
+    }
+    for (auto i = m_pred_offsets[block]; i < m_pred_offsets[block + 1]; ++i) {
+      operands.push_back(at_exit(m_preds[i], reg));
+    }
+    m_phis[phi].operands = std::move(operands);
+  }
+
+  const std::vector<uint32_t>& m_pred_offsets;
+  const std::vector<uint32_t>& m_preds;
+  std::vector<RegisterKind>& m_def_kinds;
+  const uint32_t m_first_phi;
+  std::vector<Phi> m_phis;
+  std::unordered_map<uint64_t, uint32_t> m_last_defs;
+  std::unordered_map<uint64_t, uint32_t> m_entries;
+  std::vector<uint32_t> m_unfilled;
+  std::vector<uint32_t> m_chain;
+  bool m_filling{false};
+};
+
+}
+
+RegisterKinds::RegisterKinds(DexMethod* method) {
+  auto code = method->get_code();
+  m_nregs = code->get_registers_size();
   code->build_cfg();
-  return forwards_dataflow<KindVec>(code->cfg().blocks(),
-                                    KindVec(code->get_registers_size()),
-                                    trans,
-                                    entry_kinds);
+  const auto& blocks = code->cfg().blocks();
+  if (blocks.empty()) {
+    return;
+  }
+  m_code = FlatCode(code->cfg());
+  m_pred_offsets.reserve(blocks.size() + 1);
+  for (auto block : blocks) {
+    m_pred_offsets.push_back(m_preds.size());
+    for (auto pred : block->preds()) {
+      m_preds.push_back(pred->id());
+    }
+  }
+  m_pred_offsets.push_back(m_preds.size());
+
+  m_def_kinds.reserve(1 + m_nregs + m_code.size());
+  m_def_kinds.push_back(RegisterKind::UNKNOWN);
+  auto entry = entry_kinds(method);
+  m_def_kinds.insert(m_def_kinds.end(), entry.begin(), entry.end());
+  for (const auto& insn : m_code) {
+    m_def_kinds.push_back(insn.has_dest() ? dest_kind(insn.op())
+                                          : RegisterKind::UNKNOWN);
+  }
+
+  // Link each source to its definition: the closest one before it in its
+  // block, or else the one reaching the entry of the block.
+  ReachingDefs reaching_defs(
+      m_code, m_pred_offsets, m_preds, m_nregs, &m_def_kinds);
+  m_insns.reserve(m_code.size());
+  m_src_defs.resize(m_code.uses_size(), UNDEF);
+  std::vector<uint32_t> local_defs(m_nregs, UNDEF);
+  std::vector<uint16_t> written;
+  for (auto block : blocks) {
+    for (auto it = m_code.begin(block->id()); it != m_code.end(block->id());
+         ++it) {
+      auto index = m_code.index_of(*it);
+      m_insns.emplace(it->insn, index);
+      auto uses = m_code.uses(*it);
+      for (size_t i = 0; i < it->nsrcs; ++i) {
+        auto def = local_defs[uses[i]];
+        m_src_defs[it->uses + i] =
+            def != UNDEF ? def : reaching_defs.at_entry(block->id(), uses[i]);
+      }
+      if (it->has_dest()) {
+        local_defs[it->dest] = insn_def(m_nregs, index);
+        written.push_back(it->dest);
+      }
+    }
+    for (auto reg : written) {
+      local_defs[reg] = UNDEF;
+    }
+    written.clear();
+  }
+  reaching_defs.solve();
+}
+
+RegisterKind RegisterKinds::src_kind(const IRInstruction* insn,
+                                     size_t i) const {
+  always_assert(i < insn->srcs_size());
+  return m_def_kinds.at(
+      m_src_defs.at(m_code.at(m_insns.at(insn)).uses + i));
+}
+
+const FlatCode::Insn* RegisterKinds::last_def(uint32_t block,
+                                              uint16_t reg) const {
+  for (auto it = m_code.end(block); it != m_code.begin(block);) {
+    --it;
+    if (it->has_dest() && it->dest == reg) {
+      return it;
+    }
+  }
+  return nullptr;
+}
+
+RegisterKind RegisterKinds::kind_at(const IRInstruction* insn,
+                                    uint16_t reg) const {
+  const auto& flat = m_code.at(m_insns.at(insn));
+  for (auto it = &flat; it != m_code.begin(flat.block);) {
+    --it;
+    if (it->has_dest() && it->dest == reg) {
+      return m_def_kinds[insn_def(m_nregs, m_code.index_of(*it))];
+    }
+  }
+  return kind_at_entry(flat.block, reg);
+}
+
+RegisterKind RegisterKinds::kind_at_entry(uint32_t block,
+                                          uint16_t reg) const {
+  // The meet of the definitions of reg that reach the entry of the block,
+  // found by walking the predecessors back until they write reg.
+  auto kind = RegisterKind::UNKNOWN;
+  std::vector<bool> visited(m_pred_offsets.size() - 1);
+  std::vector<uint32_t> stack{block};
+  visited[block] = true;
+  while (!stack.empty()) {
+    auto b = stack.back();
+    stack.pop_back();
+    if (b == 0) {
+      kind = meet(kind, m_def_kinds[entry_def(reg)]);
+    }
+    for (auto i = m_pred_offsets[b]; i < m_pred_offsets[b + 1]; ++i) {
+      auto pred = m_preds[i];
+      if (auto def = last_def(pred, reg)) {
+        kind = meet(kind,
+                    m_def_kinds[insn_def(m_nregs, m_code.index_of(*def))]);
+      } else if (!visited[pred]) {
+        visited[pred] = true;
+        stack.push_back(pred);
+      }
+    }
+  }
+  return kind;
+}
+
+std::unique_ptr<RegisterKinds> analyze_register_kinds(DexMethod* method) {
+  return std::make_unique<RegisterKinds>(method);
 }
@@ -9,6 +9,8 @@
 
 #pragma once
 
+#include "ControlFlow.h"
+#include "FlatCode.h"
 #include "IRInstruction.h"
 #include "Transform.h"
 
@@ -39,35 +41,65 @@
  * when we have a better idea of its usefulness.
  */
 
-enum class RegisterKind {
+enum class RegisterKind : uint8_t {
   UNKNOWN, NORMAL, WIDE, OBJECT,
   // note that having a register of a MIXED kind is fine as long as we don't
   // read from it
   MIXED
 };
 
-class KindVec {
-  std::vector<RegisterKind> m_vec;
- public:
-  explicit KindVec(size_t n) { m_vec.resize(n); }
-  RegisterKind& at(size_t i) { return m_vec.at(i); }
-  RegisterKind at(size_t i) const { return m_vec.at(i); }
-  RegisterKind& operator[](size_t i) {
-    if (i >= m_vec.size()) {
-      m_vec.resize(i + 1, RegisterKind::UNKNOWN);
-    }
-    return m_vec[i];
-  }
-  void meet(const KindVec&);
-  bool operator==(const KindVec&) const;
-  bool operator!=(const KindVec& that) const {
-    return !(*this == that);
-  }
-};
+RegisterKind meet(RegisterKind a, RegisterKind b);
 
 std::string show(RegisterKind);
 
 RegisterKind dest_kind(DexOpcode op);
 
-std::unique_ptr<std::unordered_map<IRInstruction*, KindVec>>
-analyze_register_kinds(DexMethod*);
+/*
+ * The kinds of the registers of a method, kept per definition: every
+ * instruction that writes a register defines a value of the kind of its
+ * opcode, and where the values of a register coming from several
+ * predecessors merge at the entry of a block, a phi defines their meet. Phis
+ * are only placed for the registers read below them, found by walking the
+ * predecessors back from each read, so the space taken is linear in the
+ * size of the code rather than in blocks times registers.
+ *
+ * Each source of each instruction is linked to the definition that reaches
+ * it. Queries on instructions added after the analysis, or after the CFG has
+ * been rebuilt, are not supported.
+ */
+class RegisterKinds {
+ public:
+  explicit RegisterKinds(DexMethod* method);
+
+  /*
+   * The kind of the i-th source register of insn, right before insn runs.
+   */
+  RegisterKind src_kind(const IRInstruction* insn, size_t i) const;
+
+  /*
+   * The kind of any register right before insn runs. This walks back from
+   * insn to the definitions of the register that reach it.
+   */
+  RegisterKind kind_at(const IRInstruction* insn, uint16_t reg) const;
+
+ private:
+  RegisterKind kind_at_entry(uint32_t block, uint16_t reg) const;
+  const FlatCode::Insn* last_def(uint32_t block, uint16_t reg) const;
+
+  FlatCode m_code;
+  uint16_t m_nregs{0};
+  // the kind of every definition: the undefined value, then the value of
+  // each register at the entry of the method, then each instruction of
+  // m_code, then the phis
+  std::vector<RegisterKind> m_def_kinds;
+  // the definition reaching each source, laid out like m_code.uses()
+  std::vector<uint32_t> m_src_defs;
+  // the predecessors of block b are in [m_pred_offsets[b],
+  // m_pred_offsets[b + 1])
+  std::vector<uint32_t> m_pred_offsets;
+  std::vector<uint32_t> m_preds;
+  // the index of each instruction in m_code
+  std::unordered_map<const IRInstruction*, uint32_t> m_insns;
+};
+
+std::unique_ptr<RegisterKinds> analyze_register_kinds(DexMethod*);
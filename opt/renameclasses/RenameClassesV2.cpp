@@ -170,33 +170,27 @@ bool has_anno(const T* t, const DexType* anno_type) {
 
 }
 
-void RenameClassesPassV2::build_dont_rename_resources(PassManager& mgr, std::set<std::string>& dont_rename_resources) {
-  const Json::Value& config = mgr.get_config();
-  PassConfig pc(config);
-  std::string apk_dir;
-  pc.get("apk_dir", "", apk_dir);
-
-  if (apk_dir.size()) {
-    // Classes present in manifest
-    std::string manifest = apk_dir + std::string("/AndroidManifest.xml");
-    for (std::string classname : get_manifest_classes(manifest)) {
-      TRACE(RENAME, 4, "manifest: %s\n", classname.c_str());
-      dont_rename_resources.insert(classname);
-    }
+void RenameClassesPassV2::build_dont_rename_resources(ConfigFiles& cfg, std::set<std::string>& dont_rename_resources) {
+  const auto& classes = cfg.get_resource_classes();
 
-    // Classes present in XML layouts
-    for (std::string classname : get_layout_classes(apk_dir)) {
-      TRACE(RENAME, 4, "xml_layout: %s\n", classname.c_str());
-      dont_rename_resources.insert(classname);
-    }
+  // Classes present in manifest
+  for (const std::string& classname : classes.manifest) {
+    TRACE(RENAME, 4, "manifest: %s\n", classname.c_str());
+    dont_rename_resources.insert(classname);
+  }
 
-    // Classnames present in native libraries (lib/*/*.so)
-    for (std::string classname : get_native_classes(apk_dir)) {
-      auto type = DexType::get_type(classname.c_str());
-      if (type == nullptr) continue;
-      TRACE(RENAME, 4, "native_lib: %s\n", classname.c_str());
-      dont_rename_resources.insert(classname);
-    }
+  // Classes present in XML layouts
+  for (const std::string& classname : classes.layout) {
+    TRACE(RENAME, 4, "xml_layout: %s\n", classname.c_str());
+    dont_rename_resources.insert(classname);
+  }
+
+  // Classnames present in native libraries (lib/*/*.so)
+  for (const std::string& classname : classes.native) {
+    auto type = DexType::get_type(classname.c_str());
+    if (type == nullptr) continue;
+    TRACE(RENAME, 4, "native_lib: %s\n", classname.c_str());
+    dont_rename_resources.insert(classname);
   }
 }
 
@@ -489,7 +483,7 @@ void RenameClassesPassV2::eval_classes(
   std::set<DexType*, dextypes_comparator> dont_rename_annotated;
 
   build_dont_rename_serde_relationships(scope, dont_rename_serde_relationships);
-  build_dont_rename_resources(mgr, dont_rename_resources);
+  build_dont_rename_resources(cfg, dont_rename_resources);
   build_dont_rename_class_for_name_literals(scope, dont_rename_class_for_name_literals);
   build_dont_rename_for_types_with_reflection(scope, cfg.get_proguard_map(),
     dont_rename_class_for_types_with_reflection);
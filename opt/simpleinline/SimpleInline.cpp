@@ -8,6 +8,7 @@
  */
 
 #include "SimpleInline.h"
+#include "Analyses.h"
 #include "InlineHelper.h"
 #include "Deleter.h"
 #include "DexClass.h"
@@ -81,17 +82,25 @@ void SimpleInlinePass::run_pass(DexStoresVector& stores, ConfigFiles& cfg, PassM
   const auto force_inline = force_inline_annos(m_force_inline_annos);
 
   auto scope = build_class_scope(stores);
+  auto& call_graph = mgr.get_analysis<CallGraphAnalysis>(stores).graph;
+  auto& summaries = mgr.get_analysis<CodeSummaryAnalysis>(stores).summaries;
   // gather all inlinable candidates
-  auto methods = gather_non_virtual_methods(scope, no_inline, force_inline);
-  select_single_called(scope, methods, resolved_refs, &inlinable);
+  auto methods =
+      gather_non_virtual_methods(scope, summaries, no_inline, force_inline);
+  select_single_called(call_graph, methods, &inlinable);
 
-  auto resolver = [&](DexMethod* method, MethodSearch search) {
-    return resolve_method(method, search, resolved_refs);
+  auto resolver = [](DexMethod* method, MethodSearch search) {
+    return resolve_method_cached(method, search);
   };
 
   // inline candidates
-  MultiMethodInliner inliner(
-      scope, stores[0].get_dexen()[0], inlinable, resolver, m_inliner_config);
+  MultiMethodInliner inliner(scope,
+                             stores[0].get_dexen()[0],
+                             inlinable,
+                             call_graph,
+                             summaries,
+                             resolver,
+                             m_inliner_config);
   inliner.inline_methods();
 
   // delete all methods that can be deleted
@@ -99,30 +108,28 @@ void SimpleInlinePass::run_pass(DexStoresVector& stores, ConfigFiles& cfg, PassM
   size_t inlined_count = inlined.size();
   size_t deleted = delete_methods(scope, inlined, resolver);
 
-  TRACE(SINL, 3, "recursive %ld\n", inliner.get_info().recursive);
-  TRACE(SINL, 3, "blacklisted meths %ld\n", inliner.get_info().blacklisted);
-  TRACE(SINL, 3, "more than 16 regs %ld\n",
-      inliner.get_info().more_than_16regs);
-  TRACE(SINL, 3, "virtualizing methods %ld\n", inliner.get_info().need_vmethod);
-  TRACE(SINL, 3, "invoke super %ld\n", inliner.get_info().invoke_super);
-  TRACE(SINL, 3, "override inputs %ld\n", inliner.get_info().write_over_ins);
-  TRACE(SINL, 3, "escaped virtual %ld\n", inliner.get_info().escaped_virtual);
-  TRACE(SINL, 3, "known non public virtual %ld\n",
-      inliner.get_info().non_pub_virtual);
-  TRACE(SINL, 3, "non public ctor %ld\n", inliner.get_info().non_pub_ctor);
-  TRACE(SINL, 3, "unknown field %ld\n", inliner.get_info().escaped_field);
-  TRACE(SINL, 3, "non public field %ld\n", inliner.get_info().non_pub_field);
-  TRACE(SINL, 3, "throws %ld\n", inliner.get_info().throws);
-  TRACE(SINL, 3, "multiple returns %ld\n", inliner.get_info().multi_ret);
+  const auto& info = inliner.get_info();
+  TRACE(SINL, 3, "recursive %ld\n", info.recursive.load());
+  TRACE(SINL, 3, "blacklisted meths %ld\n", info.blacklisted.load());
+  TRACE(SINL, 3, "more than 16 regs %ld\n", info.more_than_16regs.load());
+  TRACE(SINL, 3, "virtualizing methods %ld\n", info.need_vmethod.load());
+  TRACE(SINL, 3, "invoke super %ld\n", info.invoke_super.load());
+  TRACE(SINL, 3, "override inputs %ld\n", info.write_over_ins.load());
+  TRACE(SINL, 3, "escaped virtual %ld\n", info.escaped_virtual.load());
+  TRACE(SINL, 3, "known non public virtual %ld\n", info.non_pub_virtual.load());
+  TRACE(SINL, 3, "non public ctor %ld\n", info.non_pub_ctor.load());
+  TRACE(SINL, 3, "unknown field %ld\n", info.escaped_field.load());
+  TRACE(SINL, 3, "non public field %ld\n", info.non_pub_field.load());
+  TRACE(SINL, 3, "throws %ld\n", info.throws.load());
+  TRACE(SINL, 3, "multiple returns %ld\n", info.multi_ret.load());
   TRACE(SINL, 3, "reference outside of primary %ld\n",
-      inliner.get_info().not_in_primary);
-  TRACE(SINL, 3, "not found %ld\n", inliner.get_info().not_found);
-  TRACE(SINL, 3, "caller too large %ld\n", inliner.get_info().caller_too_large);
-  TRACE(SINL, 1,
-      "%ld inlined calls over %ld methods and %ld methods removed\n",
-      inliner.get_info().calls_inlined, inlined_count, deleted);
-
-  mgr.incr_metric("calls_inlined", inliner.get_info().calls_inlined);
+      info.not_in_primary.load());
+  TRACE(SINL, 3, "not found %ld\n", info.not_found.load());
+  TRACE(SINL, 3, "caller too large %ld\n", info.caller_too_large.load());
+  TRACE(SINL, 1, "%ld inlined calls over %ld methods and %ld methods removed\n",
+      info.calls_inlined.load(), inlined_count, deleted);
+
+  mgr.incr_metric("calls_inlined", info.calls_inlined.load());
   mgr.incr_metric("methods_removed", deleted);
 }
 
@@ -132,6 +139,7 @@ void SimpleInlinePass::run_pass(DexStoresVector& stores, ConfigFiles& cfg, PassM
  */
 std::unordered_set<DexMethod*> SimpleInlinePass::gather_non_virtual_methods(
     Scope& scope,
+    const CodeSummaries& summaries,
     const std::unordered_set<DexType*>& no_inline,
     const std::unordered_set<DexType*>& force_inline) {
   // trace counter
@@ -151,14 +159,14 @@ std::unordered_set<DexMethod*> SimpleInlinePass::gather_non_virtual_methods(
   // collect all non virtual methods (dmethods and vmethods)
   std::unordered_set<DexMethod*> methods;
 
-  const auto can_inline_method = [&](DexMethod* meth, const IRCode& code) {
+  const auto can_inline_method = [&](DexMethod* meth) {
     DexClass* cls = type_class(meth->get_class());
     if (has_anno(cls, no_inline) ||
         has_anno(meth, no_inline)) {
       no_inline_anno_count++;
       return;
     }
-    if (code.count_opcodes() < SMALL_CODE_SIZE) {
+    if (summaries.get(meth).insn_count < SMALL_CODE_SIZE) {
       // always inline small methods even if they are not deletable
       inlinable.insert(meth);
     } else {
@@ -195,7 +203,7 @@ std::unordered_set<DexMethod*> SimpleInlinePass::gather_non_virtual_methods(
 
         if (dont_inline) return;
 
-        can_inline_method(method, *code);
+        can_inline_method(method);
       });
   if (m_virtual_inline) {
     auto non_virtual = devirtualize(scope);
@@ -206,7 +214,7 @@ std::unordered_set<DexMethod*> SimpleInlinePass::gather_non_virtual_methods(
         non_virtual_no_code++;
         continue;
       }
-      can_inline_method(vmeth, *code);
+      can_inline_method(vmeth);
     }
   }
 
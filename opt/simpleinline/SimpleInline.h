@@ -48,6 +48,7 @@ public:
 private:
   std::unordered_set<DexMethod*> gather_non_virtual_methods(
     Scope& scope,
+    const CodeSummaries& summaries,
     const std::unordered_set<DexType*>& no_inline,
     const std::unordered_set<DexType*>& force_inline);
 
@@ -68,7 +69,4 @@ private:
 
   // set of inlinable methods
   std::unordered_set<DexMethod*> inlinable;
-
-  // keep a map from refs to defs or nullptr if no method was found
-  MethodRefCache resolved_refs;
 };
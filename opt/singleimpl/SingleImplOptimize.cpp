@@ -527,7 +527,10 @@ size_t OptimizationImpl::optimize(Scope& scope, const SingleImplConfig& config)
   // make a new scope deleting all single impl interfaces
   Scope new_scope;
   for (auto cls : scope) {
-    if (optimized.find(cls->get_type()) != optimized.end()) continue;
+    if (optimized.find(cls->get_type()) != optimized.end()) {
+      remove_from_type_system(cls);
+      continue;
+    }
     new_scope.push_back(cls);
   }
   scope.swap(new_scope);
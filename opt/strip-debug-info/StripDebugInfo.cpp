@@ -88,7 +88,7 @@ void strip_debug_info(Scope& scope,
 }
 
 void StripDebugInfoPass::run_pass(DexStoresVector& stores, ConfigFiles& cfg, PassManager& mgr) {
-  auto scope = build_class_scope(stores);
+  auto& scope = mgr.get_analysis<ClassScopeAnalysis>(stores).scope;
   strip_debug_info(scope,
       m_use_whitelist,
       m_cls_patterns,
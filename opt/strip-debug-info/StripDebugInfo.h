@@ -2,6 +2,7 @@
 
 #pragma once
 
+#include "Analyses.h"
 #include "Pass.h"
 
 class StripDebugInfoPass : public Pass {
@@ -19,6 +20,9 @@ class StripDebugInfoPass : public Pass {
   }
 
   virtual void run_pass(DexStoresVector&, ConfigFiles&, PassManager&) override;
+  virtual void get_preserved_analyses(PreservedAnalyses& pa) const override {
+    preserve_structural_analyses(pa);
+  }
 
  private:
   std::vector<std::string> m_cls_patterns;
@@ -89,7 +89,7 @@ DexField* trivial_get_field_wrapper(DexMethod* m) {
   if (it != end) return nullptr;
 
   // Check to make sure we have a concrete field reference.
-  auto def = resolve_field(iget->field(), FieldSearch::Instance);
+  auto def = resolve_field_cached(iget->field(), FieldSearch::Instance);
   if (def == nullptr) return nullptr;
   if (!def->is_concrete()) {
     return nullptr;
@@ -125,7 +125,7 @@ DexField* trivial_get_static_field_wrapper(DexMethod* m) {
   if (it != end) return nullptr;
 
   // Check to make sure we have a concrete field reference.
-  auto def = resolve_field(sget->field(), FieldSearch::Static);
+  auto def = resolve_field_cached(sget->field(), FieldSearch::Static);
   if (def == nullptr) return nullptr;
   if (!def->is_concrete()) {
     return nullptr;
@@ -544,7 +544,7 @@ void replace_wrappers(DexMethod* caller_method,
     if (insn->opcode() == OPCODE_INVOKE_STATIC) {
       // Replace calls to static getters and wrappers
       auto const meth_insn = static_cast<IRMethodInstruction*>(insn);
-      auto const callee = resolve_method(
+      auto const callee = resolve_method_cached(
           meth_insn->get_method(), MethodSearch::Static);
       if (callee == nullptr) continue;
 
@@ -577,7 +577,7 @@ void replace_wrappers(DexMethod* caller_method,
                insn->opcode() == OPCODE_INVOKE_DIRECT_RANGE) {
       auto const meth_insn = static_cast<IRMethodInstruction*>(insn);
       auto const callee =
-          resolve_method(meth_insn->get_method(), MethodSearch::Direct);
+          resolve_method_cached(meth_insn->get_method(), MethodSearch::Direct);
       if (callee == nullptr) continue;
 
       auto const found_get = ssms.getters.find(callee);
@@ -616,7 +616,7 @@ void replace_wrappers(DexMethod* caller_method,
     } else if (insn->opcode() == OPCODE_INVOKE_STATIC_RANGE) {
       // We don't handle this yet, but it's not hard.
       auto const meth_insn = static_cast<IRMethodInstruction*>(insn);
-      auto const callee = resolve_method(
+      auto const callee = resolve_method_cached(
           meth_insn->get_method(), MethodSearch::Static);
       if (callee == nullptr) continue;
       ssms.keepers.emplace(callee);
@@ -467,6 +467,8 @@ void UnterfacePass::run_pass(DexStoresVector& stores, ConfigFiles& cfg, PassMana
     auto cls = orig_classes.at(i);
     if (removed.find(cls) == removed.end()) {
       classes.at(pos++) = cls;
+    } else {
+      remove_from_type_system(cls);
     }
   }
   for (auto untf : untfs) {
@@ -0,0 +1,108 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree. An additional grant
+ * of patent rights can be found in the PATENTS file in the same directory.
+ */
+
+#include <gtest/gtest.h>
+
+#include "AnalysisManager.h"
+#include "DexStore.h"
+
+namespace {
+
+int s_base_builds = 0;
+int s_derived_builds = 0;
+int s_other_builds = 0;
+
+struct BaseAnalysis : public Analysis {
+  static const char* name() { return "Base"; }
+  BaseAnalysis(AnalysisManager&, DexStoresVector&) : value(42) {
+    ++s_base_builds;
+  }
+  int value;
+};
+
+struct DerivedAnalysis : public Analysis {
+  static const char* name() { return "Derived"; }
+  DerivedAnalysis(AnalysisManager& am, DexStoresVector& stores)
+      : value(am.get<BaseAnalysis>(stores).value + 1) {
+    ++s_derived_builds;
+  }
+  int value;
+};
+
+struct OtherAnalysis : public Analysis {
+  static const char* name() { return "Other"; }
+  OtherAnalysis(AnalysisManager&, DexStoresVector&) { ++s_other_builds; }
+};
+
+struct AnalysisManagerTest : testing::Test {
+  AnalysisManagerTest() {
+    s_base_builds = 0;
+    s_derived_builds = 0;
+    s_other_builds = 0;
+  }
+
+  AnalysisManager am;
+  DexStoresVector stores;
+};
+
+}
+
+TEST_F(AnalysisManagerTest, memoizes) {
+  EXPECT_EQ(am.get<DerivedAnalysis>(stores).value, 43);
+  EXPECT_EQ(am.get<DerivedAnalysis>(stores).value, 43);
+  EXPECT_EQ(am.get<BaseAnalysis>(stores).value, 42);
+  EXPECT_EQ(s_base_builds, 1);
+  EXPECT_EQ(s_derived_builds, 1);
+
+  auto total = am.get_total_stats();
+  EXPECT_EQ(total.builds, 2);
+  EXPECT_EQ(total.hits, 2);
+  EXPECT_EQ(am.get_stats().at("Derived").hits, 1);
+  EXPECT_EQ(am.get_stats().at("Base").hits, 1);
+}
+
+TEST_F(AnalysisManagerTest, invalidatesDependents) {
+  am.get<DerivedAnalysis>(stores);
+  am.get<OtherAnalysis>(stores);
+  am.invalidate<BaseAnalysis>();
+  EXPECT_FALSE(am.is_cached<BaseAnalysis>());
+  EXPECT_FALSE(am.is_cached<DerivedAnalysis>());
+  EXPECT_TRUE(am.is_cached<OtherAnalysis>());
+
+  am.get<DerivedAnalysis>(stores);
+  EXPECT_EQ(s_base_builds, 2);
+  EXPECT_EQ(s_derived_builds, 2);
+  EXPECT_EQ(s_other_builds, 1);
+}
+
+TEST_F(AnalysisManagerTest, keepsPreserved) {
+  am.get<DerivedAnalysis>(stores);
+  am.get<OtherAnalysis>(stores);
+
+  PreservedAnalyses pa;
+  pa.preserve<BaseAnalysis>();
+  pa.preserve<DerivedAnalysis>();
+  am.invalidate(pa);
+  EXPECT_TRUE(am.is_cached<BaseAnalysis>());
+  EXPECT_TRUE(am.is_cached<DerivedAnalysis>());
+  EXPECT_FALSE(am.is_cached<OtherAnalysis>());
+
+  // Preserving an analysis does not keep it alive once what it was built
+  // from goes away.
+  PreservedAnalyses derived_only;
+  derived_only.preserve<DerivedAnalysis>();
+  am.invalidate(derived_only);
+  EXPECT_FALSE(am.is_cached<BaseAnalysis>());
+  EXPECT_FALSE(am.is_cached<DerivedAnalysis>());
+
+  am.get<DerivedAnalysis>(stores);
+  am.invalidate_all();
+  EXPECT_FALSE(am.is_cached<DerivedAnalysis>());
+  EXPECT_EQ(am.get_stats().at("Derived").invalidations, 2);
+}
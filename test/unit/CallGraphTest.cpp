@@ -0,0 +1,169 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree. An additional grant
+ * of patent rights can be found in the PATENTS file in the same directory.
+ */
+
+#include <gtest/gtest.h>
+
+#include "CallGraph.h"
+#include "DexAsm.h"
+#include "DexUtil.h"
+#include "ScopeHelper.h"
+#include "Transform.h"
+
+using namespace dex_asm;
+
+namespace {
+
+std::vector<DexMethod*> callees_in(const CallGraph& graph, DexMethod* caller) {
+  std::vector<DexMethod*> callees;
+  graph.for_each_callsite_in(
+      caller, [&](CallGraph::CallSiteId, const CallGraph::CallSite& site) {
+        EXPECT_EQ(site.caller, caller);
+        callees.push_back(site.callee);
+      });
+  return callees;
+}
+
+std::vector<DexMethod*> callers_of(const CallGraph& graph, DexMethod* callee) {
+  std::vector<DexMethod*> callers;
+  graph.for_each_callsite_of(
+      callee, [&](CallGraph::CallSiteId, const CallGraph::CallSite& site) {
+        EXPECT_EQ(site.callee, callee);
+        callers.push_back(site.caller);
+      });
+  return callers;
+}
+
+}
+
+class CallGraphTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    g_redex = new RedexContext();
+    scope = create_empty_scope();
+    auto cls = create_internal_class(
+        DexType::make_type("LFoo;"), get_object_type(), {});
+    scope.push_back(cls);
+    auto proto = DexProto::make_proto(get_void_type(),
+                                      DexTypeList::make_type_list({}));
+    a = create_static_method(cls, "a", proto, 0);
+    b = create_static_method(cls, "b", proto, 0);
+    c = create_static_method(cls, "c", proto, 0);
+    a_calls_b_first = dasm(OPCODE_INVOKE_STATIC, b, {});
+    a->get_code()->push_back(a_calls_b_first);
+    a->get_code()->push_back(dasm(OPCODE_INVOKE_STATIC, c, {}));
+    a->get_code()->push_back(dasm(OPCODE_INVOKE_STATIC, b, {}));
+    b->get_code()->push_back(dasm(OPCODE_INVOKE_STATIC, c, {}));
+    // a reference to a method of an unknown class does not resolve
+    auto unknown = DexMethod::make_method("LUnknown;", "d", "V", {});
+    c->get_code()->push_back(dasm(OPCODE_INVOKE_STATIC, unknown, {}));
+    for (auto m : {a, b, c}) {
+      m->get_code()->push_back(dasm(OPCODE_RETURN_VOID));
+    }
+  }
+
+  void TearDown() override { delete g_redex; }
+
+  Scope scope;
+  DexMethod* a;
+  DexMethod* b;
+  DexMethod* c;
+  IRMethodInstruction* a_calls_b_first;
+};
+
+TEST_F(CallGraphTest, build) {
+  CallGraph graph(scope);
+  EXPECT_EQ(graph.num_callsites(), 4);
+  EXPECT_EQ(callees_in(graph, a), std::vector<DexMethod*>({b, c, b}));
+  EXPECT_EQ(callees_in(graph, b), std::vector<DexMethod*>({c}));
+  EXPECT_TRUE(callees_in(graph, c).empty());
+  EXPECT_EQ(callers_of(graph, b), std::vector<DexMethod*>({a, a}));
+  EXPECT_EQ(callers_of(graph, c), std::vector<DexMethod*>({a, b}));
+  EXPECT_TRUE(callers_of(graph, a).empty());
+  EXPECT_EQ(graph.num_callsites_of(a), 0);
+  EXPECT_EQ(graph.num_callsites_of(b), 2);
+  EXPECT_EQ(graph.num_callsites_of(c), 2);
+
+  size_t count = 0;
+  graph.for_each_callsite(
+      [&](CallGraph::CallSiteId id, const CallGraph::CallSite& site) {
+        EXPECT_EQ(&graph.callsite(id), &site);
+        if (count++ == 0) {
+          EXPECT_EQ(site.insn, a_calls_b_first);
+        }
+      });
+  EXPECT_EQ(count, 4);
+}
+
+TEST_F(CallGraphTest, removeCallsite) {
+  CallGraph graph(scope);
+  CallGraph::CallSiteId first = 0;
+  graph.for_each_callsite_in(
+      a, [&](CallGraph::CallSiteId id, const CallGraph::CallSite& site) {
+        if (site.insn == a_calls_b_first) {
+          first = id;
+        }
+      });
+  graph.remove_callsite(first);
+  EXPECT_TRUE(graph.callsite(first).removed);
+  EXPECT_EQ(graph.num_callsites(), 3);
+  EXPECT_EQ(graph.num_callsites_of(b), 1);
+  EXPECT_EQ(callees_in(graph, a), std::vector<DexMethod*>({c, b}));
+  EXPECT_EQ(callers_of(graph, b), std::vector<DexMethod*>({a}));
+}
+
+TEST_F(CallGraphTest, updateCallsites) {
+  CallGraph graph(scope);
+  // Replace a's first call to b with the body of b, as the inliner would.
+  auto code = a->get_code();
+  code->remove_opcode(a_calls_b_first);
+  auto inlined = new IRMethodInstruction(OPCODE_INVOKE_STATIC, c);
+  inlined->set_arg_word_count(0);
+  code->insert_before(code->begin(), inlined);
+  graph.update_callsites(a);
+
+  EXPECT_EQ(graph.num_callsites(), 4);
+  EXPECT_EQ(callees_in(graph, a), std::vector<DexMethod*>({c, c, b}));
+  EXPECT_EQ(graph.num_callsites_of(b), 1);
+  EXPECT_EQ(graph.num_callsites_of(c), 3);
+  EXPECT_EQ(callers_of(graph, c), std::vector<DexMethod*>({b, a, a}));
+}
+
+TEST(CallLevelsTest, componentsByLevel) {
+  g_redex = new RedexContext();
+  auto cls = create_internal_class(
+      DexType::make_type("LBar;"), get_object_type(), {});
+  auto proto = DexProto::make_proto(get_void_type(),
+                                    DexTypeList::make_type_list({}));
+  std::vector<DexMethod*> m;
+  for (auto name : {"top", "loop1", "loop2", "leaf", "other"}) {
+    m.push_back(create_static_method(cls, name, proto, 0));
+  }
+  // top -> loop1 <-> loop2 -> leaf, and other -> leaf
+  std::unordered_map<DexMethod*, std::vector<DexMethod*>> callees = {
+      {m[0], {m[1]}}, {m[1], {m[2]}}, {m[2], {m[1], m[3]}}, {m[4], {m[3]}}};
+  static const std::vector<DexMethod*> no_callees;
+
+  // leaf, on level 0, is only reached through the callees of the given
+  // methods and is left out of the levels
+  auto result = call_levels(
+      {m[0], m[4], m[2], m[1]},
+      [&](DexMethod* method) -> const std::vector<DexMethod*>& {
+        auto it = callees.find(method);
+        return it == callees.end() ? no_callees : it->second;
+      });
+  EXPECT_EQ(result.component.size(), 5);
+  EXPECT_EQ(result.component.at(m[1]), result.component.at(m[2]));
+  EXPECT_NE(result.component.at(m[0]), result.component.at(m[1]));
+  EXPECT_NE(result.component.at(m[3]), result.component.at(m[1]));
+  ASSERT_EQ(result.levels.size(), 3);
+  EXPECT_TRUE(result.levels[0].empty());
+  EXPECT_EQ(result.levels[1], std::vector<DexMethod*>({m[4], m[2], m[1]}));
+  EXPECT_EQ(result.levels[2], std::vector<DexMethod*>({m[0]}));
+  delete g_redex;
+}
@@ -0,0 +1,109 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree. An additional grant
+ * of patent rights can be found in the PATENTS file in the same directory.
+ */
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ClassHierarchyIndex.h"
+#include "DexClass.h"
+#include "RedexContext.h"
+
+namespace {
+
+std::vector<const DexType*> to_vector(ClassHierarchyIndex::TypeRange range) {
+  return std::vector<const DexType*>(range.begin(), range.end());
+}
+
+}
+
+TEST(ClassHierarchyIndex, subclassAndChildren) {
+  g_redex = new RedexContext();
+  auto obj = DexType::make_type("Ljava/lang/Object;");
+  auto a = DexType::make_type("LA;");
+  auto b = DexType::make_type("LB;");
+  auto c = DexType::make_type("LC;");
+  auto d = DexType::make_type("LD;");
+
+  ClassHierarchyIndex index;
+  index.add_class(obj, nullptr);
+  index.add_class(a, obj);
+  index.add_class(c, b);
+  index.add_class(b, a);
+  index.add_class(d, obj);
+
+  EXPECT_TRUE(index.is_subclass(obj, c));
+  EXPECT_TRUE(index.is_subclass(a, c));
+  EXPECT_TRUE(index.is_subclass(c, c));
+  EXPECT_FALSE(index.is_subclass(c, a));
+  EXPECT_FALSE(index.is_subclass(d, b));
+  EXPECT_EQ(index.get_super(b), a);
+  EXPECT_EQ(to_vector(index.get_children(obj)),
+            (std::vector<const DexType*>{a, d}));
+  EXPECT_TRUE(index.get_children(c).empty());
+
+  index.remove_class(b);
+  EXPECT_FALSE(index.is_subclass(a, c));
+  EXPECT_TRUE(index.is_subclass(b, c));
+  EXPECT_TRUE(index.get_children(a).empty());
+  EXPECT_EQ(index.get_super(b), nullptr);
+
+  index.add_class(b, d);
+  EXPECT_TRUE(index.is_subclass(d, c));
+  EXPECT_EQ(to_vector(index.get_children(d)),
+            (std::vector<const DexType*>{b}));
+  delete g_redex;
+}
+
+TEST(ClassHierarchyIndex, queriesDuringMutations) {
+  g_redex = new RedexContext();
+  auto obj = DexType::make_type("Ljava/lang/Object;");
+  auto a = DexType::make_type("LA;");
+  std::vector<const DexType*> types;
+  for (int i = 0; i < 2000; ++i) {
+    types.push_back(DexType::make_type(
+        DexString::make_string("LT" + std::to_string(i) + ";")));
+  }
+
+  ClassHierarchyIndex index;
+  index.add_class(obj, nullptr);
+  index.add_class(a, obj);
+
+  // every mutation dirties the index, so the readers keep rebuilding it
+  // while it grows
+  std::atomic<bool> done{false};
+  std::atomic<size_t> wrong{0};
+  std::vector<std::thread> readers;
+  for (int t = 0; t < 4; ++t) {
+    readers.emplace_back([&] {
+      while (!done) {
+        // the range itself may be rebuilt by another reader as soon as the
+        // lock is released, only its size is safe to look at
+        if (!index.is_subclass(obj, a) || index.get_super(a) != obj ||
+            index.get_children(obj).size() != 1) {
+          ++wrong;
+        }
+      }
+    });
+  }
+  for (auto type : types) {
+    index.add_class(type, a);
+  }
+  done = true;
+  for (auto& reader : readers) {
+    reader.join();
+  }
+  EXPECT_EQ(wrong, 0);
+  EXPECT_EQ(index.get_children(a).size(), types.size());
+  EXPECT_TRUE(index.is_subclass(obj, types.back()));
+  delete g_redex;
+}
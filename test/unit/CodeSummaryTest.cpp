@@ -0,0 +1,83 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree. An additional grant
+ * of patent rights can be found in the PATENTS file in the same directory.
+ */
+
+#include <gtest/gtest.h>
+
+#include "CodeSummary.h"
+#include "DexAsm.h"
+#include "DexUtil.h"
+#include "ScopeHelper.h"
+#include "Transform.h"
+
+using namespace dex_asm;
+
+class CodeSummaryTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    g_redex = new RedexContext();
+    scope = create_empty_scope();
+    cls = create_internal_class(
+        DexType::make_type("LFoo;"), get_object_type(), {});
+    scope.push_back(cls);
+    proto = DexProto::make_proto(get_void_type(),
+                                 DexTypeList::make_type_list({}));
+  }
+
+  void TearDown() override { delete g_redex; }
+
+  Scope scope;
+  DexClass* cls;
+  DexProto* proto;
+};
+
+TEST_F(CodeSummaryTest, summarize) {
+  auto pub = create_static_method(cls, "pub", proto, 1);
+  auto priv = create_static_method(cls, "priv", proto, 1, ACC_PRIVATE);
+  auto m = create_static_method(cls, "m", proto, 1);
+  auto code = m->get_code();
+  code->push_back(dasm(OPCODE_CONST_4, {0_v, 1_L}));
+  code->push_back(dasm(OPCODE_INVOKE_STATIC, pub, {}));
+  code->push_back(dasm(OPCODE_INVOKE_STATIC, priv, {}));
+  code->push_back(dasm(OPCODE_INVOKE_STATIC,
+                       DexMethod::make_method("LUnknown;", "u", "V", {}),
+                       {}));
+  code->push_back(dasm(OPCODE_RETURN_VOID));
+  pub->get_code()->push_back(dasm(OPCODE_THROW, {0_v}));
+  priv->get_code()->push_back(dasm(OPCODE_IF_EQZ, {0_v}));
+  priv->get_code()->push_back(dasm(OPCODE_RETURN_VOID));
+  priv->get_code()->push_back(dasm(OPCODE_RETURN_VOID));
+
+  CodeSummaries summaries(scope);
+  const auto& summary = summaries.get(m);
+  EXPECT_EQ(summary.insn_count, code->count_opcodes());
+  EXPECT_EQ(summary.insn_size, code->sum_opcode_sizes());
+  EXPECT_EQ(summary.registers, 1);
+  EXPECT_FALSE(summary.throws);
+  EXPECT_FALSE(summary.multiple_returns);
+  EXPECT_FALSE(summary.invokes_super);
+  // the private method and the one that does not resolve
+  EXPECT_EQ(summary.nonpublic_refs, 2);
+
+  EXPECT_TRUE(summaries.get(pub).throws);
+  EXPECT_TRUE(summaries.get(priv).multiple_returns);
+  EXPECT_EQ(summaries.get(priv).nonpublic_refs, 0);
+}
+
+TEST_F(CodeSummaryTest, update) {
+  auto m = create_static_method(cls, "m", proto, 1);
+  m->get_code()->push_back(dasm(OPCODE_RETURN_VOID));
+  CodeSummaries summaries(scope);
+  EXPECT_EQ(summaries.get(m).insn_count, 1);
+
+  m->get_code()->push_back(dasm(OPCODE_RETURN_VOID));
+  EXPECT_EQ(summaries.get(m).insn_count, 1);
+  summaries.update(m);
+  EXPECT_EQ(summaries.get(m).insn_count, 2);
+  EXPECT_TRUE(summaries.get(m).multiple_returns);
+}
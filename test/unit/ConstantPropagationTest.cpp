@@ -0,0 +1,292 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree. An additional grant
+ * of patent rights can be found in the PATENTS file in the same directory.
+ */
+
+#include <gtest/gtest.h>
+
+#include "ConfigFiles.h"
+#include "ConstantPropagation.h"
+#include "DexAsm.h"
+#include "DexStore.h"
+#include "DexUtil.h"
+#include "PassManager.h"
+#include "ScopeHelper.h"
+#include "Transform.h"
+
+using namespace dex_asm;
+
+namespace {
+
+MethodItemEntry* push_branch(IRCode* code, IRInstruction* insn) {
+  auto mie = new MethodItemEntry(insn);
+  code->push_back(*mie);
+  return mie;
+}
+
+void push_target(IRCode* code, MethodItemEntry* branch) {
+  auto target = new BranchTarget();
+  target->type = BRANCH_SIMPLE;
+  target->src = branch;
+  code->push_back(target);
+}
+
+std::vector<DexOpcode> opcodes(IRCode* code) {
+  std::vector<DexOpcode> ops;
+  for (auto& mie : InstructionIterable(code)) {
+    ops.push_back(mie.insn->opcode());
+  }
+  return ops;
+}
+
+}
+
+class ConstantPropagationTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    g_redex = new RedexContext();
+    scope = create_empty_scope();
+    cls = create_internal_class(
+        DexType::make_type("LFoo;"), get_object_type(), {});
+    scope.push_back(cls);
+    int_int = DexProto::make_proto(
+        get_int_type(), DexTypeList::make_type_list({get_int_type()}));
+  }
+
+  void TearDown() override { delete g_redex; }
+
+  void run_pass(const std::vector<std::string>& blacklist = {}) {
+    DexMetadata dm;
+    dm.set_id("classes");
+    DexStore store(dm);
+    store.add_classes(scope);
+    DexStoresVector stores;
+    stores.emplace_back(std::move(store));
+    auto pass = new ConstantPropagationPass();
+    Json::Value pass_config;
+    for (const auto& name : blacklist) {
+      pass_config["blacklist"].append(name);
+    }
+    pass->configure_pass(PassConfig(pass_config));
+    std::vector<Pass*> passes = {pass};
+    PassManager manager(passes);
+    manager.set_testing_mode();
+    Json::Value conf_obj = Json::nullValue;
+    ConfigFiles dummy_cfg(conf_obj);
+    manager.run_passes(stores, dummy_cfg);
+  }
+
+  Scope scope;
+  DexClass* cls;
+  // int (int), the parameter is the last register
+  DexProto* int_int;
+};
+
+TEST_F(ConstantPropagationTest, foldsAcrossMerges) {
+  auto m = create_static_method(cls, "merge", int_int, 3);
+  auto code = m->get_code();
+  code->push_back(dasm(OPCODE_CONST_4, {0_v, 0_L}));
+  auto if_param = push_branch(code, dasm(OPCODE_IF_EQZ, {2_v}));
+  code->push_back(dasm(OPCODE_CONST_4, {0_v, 0_L}));
+  push_target(code, if_param);
+  // v0 is 0 on both paths into the merge
+  auto if_const = push_branch(code, dasm(OPCODE_IF_NEZ, {0_v}));
+  code->push_back(dasm(OPCODE_CONST_4, {1_v, 1_L}));
+  code->push_back(dasm(OPCODE_RETURN, {1_v}));
+  push_target(code, if_const);
+  code->push_back(dasm(OPCODE_RETURN, {2_v}));
+
+  run_pass();
+
+  std::vector<DexOpcode> expected = {OPCODE_CONST_4,
+                                     OPCODE_IF_EQZ,
+                                     OPCODE_CONST_4,
+                                     OPCODE_CONST_4,
+                                     OPCODE_RETURN,
+                                     OPCODE_RETURN};
+  EXPECT_EQ(opcodes(code), expected);
+}
+
+TEST_F(ConstantPropagationTest, skipsUnexecutableEdges) {
+  auto m = create_static_method(cls, "chain", int_int, 3);
+  auto code = m->get_code();
+  code->push_back(dasm(OPCODE_CONST_4, {0_v, 1_L}));
+  auto first = push_branch(code, dasm(OPCODE_IF_EQZ, {0_v}));
+  code->push_back(dasm(OPCODE_CONST_4, {0_v, 0_L}));
+  push_target(code, first);
+  // the first branch never jumps here, so v0 can only be 0
+  auto second = push_branch(code, dasm(OPCODE_IF_EQZ, {0_v}));
+  code->push_back(dasm(OPCODE_RETURN, {2_v}));
+  push_target(code, second);
+  code->push_back(dasm(OPCODE_RETURN, {0_v}));
+
+  run_pass();
+
+  std::vector<DexOpcode> expected = {OPCODE_CONST_4,
+                                     OPCODE_CONST_4,
+                                     OPCODE_GOTO_16,
+                                     OPCODE_RETURN,
+                                     OPCODE_RETURN};
+  EXPECT_EQ(opcodes(code), expected);
+}
+
+TEST_F(ConstantPropagationTest, usesConstantReturns) {
+  auto callee = create_static_method(cls, "answer", int_int, 1);
+  callee->get_code()->push_back(dasm(OPCODE_CONST_16, {0_v, 42_L}));
+  callee->get_code()->push_back(dasm(OPCODE_RETURN, {0_v}));
+
+  auto caller = create_static_method(cls, "caller", int_int, 3);
+  auto code = caller->get_code();
+  code->push_back(dasm(OPCODE_INVOKE_STATIC, callee, {2_v}));
+  code->push_back(dasm(OPCODE_MOVE_RESULT, {0_v}));
+  code->push_back(dasm(OPCODE_CONST_16, {1_v, 42_L}));
+  auto if_ = push_branch(code, dasm(OPCODE_IF_NE, {0_v, 1_v}));
+  code->push_back(dasm(OPCODE_RETURN, {0_v}));
+  push_target(code, if_);
+  code->push_back(dasm(OPCODE_RETURN, {2_v}));
+
+  run_pass();
+
+  // the call stays, only its result is known
+  std::vector<DexOpcode> expected = {OPCODE_INVOKE_STATIC,
+                                     OPCODE_MOVE_RESULT,
+                                     OPCODE_CONST_16,
+                                     OPCODE_RETURN,
+                                     OPCODE_RETURN};
+  EXPECT_EQ(opcodes(code), expected);
+}
+
+TEST_F(ConstantPropagationTest, usesConstantParams) {
+  auto callee = create_static_method(cls, "callee", int_int, 1);
+  auto code = callee->get_code();
+  auto if_ = push_branch(code, dasm(OPCODE_IF_EQZ, {0_v}));
+  code->push_back(dasm(OPCODE_RETURN, {0_v}));
+  push_target(code, if_);
+  code->push_back(dasm(OPCODE_CONST_4, {0_v, 1_L}));
+  code->push_back(dasm(OPCODE_RETURN, {0_v}));
+
+  // every call site passes 0
+  for (auto name : {"first", "second"}) {
+    auto caller = create_static_method(cls, name, int_int, 2);
+    caller->get_code()->push_back(dasm(OPCODE_CONST_4, {0_v, 0_L}));
+    caller->get_code()->push_back(dasm(OPCODE_INVOKE_STATIC, callee, {0_v}));
+    caller->get_code()->push_back(dasm(OPCODE_MOVE_RESULT, {0_v}));
+    caller->get_code()->push_back(dasm(OPCODE_RETURN, {0_v}));
+  }
+
+  run_pass();
+
+  std::vector<DexOpcode> expected = {
+      OPCODE_GOTO_16, OPCODE_RETURN, OPCODE_CONST_4, OPCODE_RETURN};
+  EXPECT_EQ(opcodes(code), expected);
+}
+
+TEST_F(ConstantPropagationTest, ignoresReturnsOfBlacklistedClasses) {
+  auto bar = create_internal_class(
+      DexType::make_type("LBar;"), get_object_type(), {});
+  scope.push_back(bar);
+  auto callee = create_static_method(bar, "answer", int_int, 1);
+  callee->get_code()->push_back(dasm(OPCODE_CONST_16, {0_v, 42_L}));
+  callee->get_code()->push_back(dasm(OPCODE_RETURN, {0_v}));
+
+  auto caller = create_static_method(cls, "caller", int_int, 3);
+  auto code = caller->get_code();
+  code->push_back(dasm(OPCODE_INVOKE_STATIC, callee, {2_v}));
+  code->push_back(dasm(OPCODE_MOVE_RESULT, {0_v}));
+  code->push_back(dasm(OPCODE_CONST_16, {1_v, 42_L}));
+  auto if_ = push_branch(code, dasm(OPCODE_IF_NE, {0_v, 1_v}));
+  code->push_back(dasm(OPCODE_RETURN, {0_v}));
+  push_target(code, if_);
+  code->push_back(dasm(OPCODE_RETURN, {2_v}));
+
+  run_pass({"LBar;"});
+
+  // what the blacklisted callee returns is not relied on
+  std::vector<DexOpcode> expected = {OPCODE_INVOKE_STATIC,
+                                     OPCODE_MOVE_RESULT,
+                                     OPCODE_CONST_16,
+                                     OPCODE_IF_NE,
+                                     OPCODE_RETURN,
+                                     OPCODE_RETURN};
+  EXPECT_EQ(opcodes(code), expected);
+}
+
+TEST_F(ConstantPropagationTest, keepsBranchesOnRegistersWrittenByThrowers) {
+  auto int_object = DexProto::make_proto(
+      get_int_type(), DexTypeList::make_type_list({get_object_type()}));
+  auto m = create_static_method(cls, "thrower", int_object, 3);
+  auto code = m->get_code();
+  auto catch_start =
+      new MethodItemEntry(DexType::make_type("Ljava/lang/Exception;"));
+  code->push_back(dasm(OPCODE_MOVE_OBJECT, {0_v, 2_v}));
+  code->push_back(TRY_START, catch_start);
+  auto new_instance =
+      new IRTypeInstruction(OPCODE_NEW_INSTANCE, cls->get_type());
+  new_instance->set_dest(0);
+  code->push_back(new_instance);
+  code->push_back(TRY_END, catch_start);
+  code->push_back(dasm(OPCODE_CONST_4, {1_v, 1_L}));
+  code->push_back(dasm(OPCODE_RETURN, {1_v}));
+  code->push_back(*catch_start);
+  // if new-instance threw, v0 still holds the parameter, which may be null
+  auto if_null = push_branch(code, dasm(OPCODE_IF_EQZ, {0_v}));
+  code->push_back(dasm(OPCODE_CONST_4, {1_v, 1_L}));
+  code->push_back(dasm(OPCODE_RETURN, {1_v}));
+  push_target(code, if_null);
+  code->push_back(dasm(OPCODE_CONST_4, {1_v, 0_L}));
+  code->push_back(dasm(OPCODE_RETURN, {1_v}));
+
+  run_pass();
+
+  std::vector<DexOpcode> expected = {OPCODE_MOVE_OBJECT,
+                                     OPCODE_NEW_INSTANCE,
+                                     OPCODE_CONST_4,
+                                     OPCODE_RETURN,
+                                     OPCODE_IF_EQZ,
+                                     OPCODE_CONST_4,
+                                     OPCODE_RETURN,
+                                     OPCODE_CONST_4,
+                                     OPCODE_RETURN};
+  EXPECT_EQ(opcodes(code), expected);
+}
+
+TEST_F(ConstantPropagationTest, foldsInstanceOfOnKnownTypes) {
+  auto m = create_static_method(cls, "instance", int_int, 3);
+  auto code = m->get_code();
+  auto new_instance =
+      new IRTypeInstruction(OPCODE_NEW_INSTANCE, cls->get_type());
+  new_instance->set_dest(0);
+  code->push_back(new_instance);
+  auto instance_of =
+      new IRTypeInstruction(OPCODE_INSTANCE_OF, get_object_type());
+  instance_of->set_dest(1);
+  instance_of->set_src(0, 0);
+  code->push_back(instance_of);
+  // a Foo is always an Object
+  auto if_object = push_branch(code, dasm(OPCODE_IF_EQZ, {1_v}));
+  code->push_back(dasm(OPCODE_CONST_4, {0_v, 0_L}));
+  auto null_of = new IRTypeInstruction(OPCODE_INSTANCE_OF, cls->get_type());
+  null_of->set_dest(1);
+  null_of->set_src(0, 0);
+  code->push_back(null_of);
+  // and null never is a Foo
+  auto if_null = push_branch(code, dasm(OPCODE_IF_NEZ, {1_v}));
+  code->push_back(dasm(OPCODE_RETURN, {2_v}));
+  push_target(code, if_object);
+  push_target(code, if_null);
+  code->push_back(dasm(OPCODE_RETURN, {1_v}));
+
+  run_pass();
+
+  std::vector<DexOpcode> expected = {OPCODE_NEW_INSTANCE,
+                                     OPCODE_INSTANCE_OF,
+                                     OPCODE_CONST_4,
+                                     OPCODE_INSTANCE_OF,
+                                     OPCODE_RETURN,
+                                     OPCODE_RETURN};
+  EXPECT_EQ(opcodes(code), expected);
+}
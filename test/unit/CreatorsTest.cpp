@@ -0,0 +1,77 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree. An additional grant
+ * of patent rights can be found in the PATENTS file in the same directory.
+ */
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "Creators.h"
+#include "DexClass.h"
+#include "DexUtil.h"
+#include "RedexContext.h"
+#include "Transform.h"
+
+namespace {
+
+std::vector<IRInstruction*> instructions(DexMethod* method) {
+  std::vector<IRInstruction*> insns;
+  for (auto& mie : *method->get_code()) {
+    if (mie.type == MFLOW_OPCODE) {
+      insns.push_back(mie.insn);
+    }
+  }
+  return insns;
+}
+
+}
+
+/*
+ * The destination of a field read takes the type of the field, not of the
+ * class declaring it, so that it can be used as such afterwards.
+ */
+TEST(CreatorsTest, fieldReadsTypeTheirDestination) {
+  g_redex = new RedexContext();
+  auto foo = DexType::make_type("LFoo;");
+  auto long_field = DexField::make_field(
+      foo, DexString::make_string("l"), get_long_type());
+  long_field->make_concrete(ACC_PUBLIC);
+  auto string_field = DexField::make_field(
+      foo, DexString::make_string("s"), get_string_type());
+  string_field->make_concrete(ACC_PUBLIC | ACC_STATIC);
+
+  auto proto = DexProto::make_proto(get_void_type(),
+                                    DexTypeList::make_type_list({foo}));
+  MethodCreator mc(foo, DexString::make_string("bar"), proto,
+                   ACC_PUBLIC | ACC_STATIC);
+  auto obj = mc.get_local(0);
+  auto value = mc.make_local(get_double_type());
+  auto wide = mc.make_local(get_long_type());
+  auto ref = mc.make_local(get_object_type());
+  auto string = mc.make_local(get_string_type());
+  auto main_block = mc.get_main_block();
+
+  main_block->iget(long_field, obj, value);
+  EXPECT_EQ(value.get_type(), get_long_type());
+  main_block->move(value, wide);
+
+  main_block->sget(string_field, ref);
+  EXPECT_EQ(ref.get_type(), get_string_type());
+  main_block->move(ref, string);
+  main_block->ret_void();
+
+  auto insns = instructions(mc.create());
+  ASSERT_EQ(insns.size(), 5);
+  EXPECT_EQ(insns[0]->opcode(), OPCODE_IGET_WIDE);
+  EXPECT_EQ(insns[1]->opcode(), OPCODE_MOVE_WIDE);
+  EXPECT_EQ(insns[1]->src(0), insns[0]->dest());
+  EXPECT_EQ(insns[2]->opcode(), OPCODE_SGET_OBJECT);
+  EXPECT_EQ(insns[3]->opcode(), OPCODE_MOVE_OBJECT);
+  EXPECT_EQ(insns[3]->src(0), insns[2]->dest());
+  delete g_redex;
+}
@@ -20,3 +20,63 @@ TEST(ExtractNativeTest, empty) {
   auto overset = extract_classes_from_native_lib(over);
   EXPECT_EQ(overset.size(), 2);
 }
+
+namespace {
+
+// The byte at a time scanner the vectorized one replaced.
+std::unordered_set<std::string> reference_extract(const std::string& lib) {
+  std::unordered_set<std::string> classes;
+  const size_t min_length = 10;
+  const size_t max_length = 500;
+  size_t i = 0;
+  while (i < lib.size()) {
+    char c = lib[i];
+    if ((c >= 'a' && c <= 'z') || c == 'L') {
+      std::string name;
+      if (c != 'L') {
+        name += 'L';
+      }
+      while (i < lib.size() && name.size() < max_length &&
+             ((lib[i] >= 'a' && lib[i] <= 'z') ||
+              (lib[i] >= 'A' && lib[i] <= 'Z') ||
+              (lib[i] >= '0' && lib[i] <= '9') ||
+              lib[i] == '/' || lib[i] == '_' || lib[i] == '$')) {
+        name += lib[i++];
+      }
+      if (name.size() >= min_length) {
+        classes.insert(name + ";");
+      }
+    }
+    i++;
+  }
+  return classes;
+}
+
+}
+
+TEST(ExtractNativeTest, findsNames) {
+  const char data[] = "\x7f" "ELF\x01\x02" "Lcom/facebook/Foo;\0" "\xff"
+                     "com/facebook/Bar$Inner\0short/Name\0" "9xyz/abcdefghij";
+  std::string lib(data, sizeof(data) - 1);
+  auto classes = extract_classes_from_native_lib(lib);
+  EXPECT_EQ(classes.count("Lcom/facebook/Foo;"), 1);
+  EXPECT_EQ(classes.count("Lcom/facebook/Bar$Inner;"), 1);
+  EXPECT_EQ(classes.count("Lshort/Name;"), 1);
+  EXPECT_EQ(classes.count("Lxyz/abcdefghij;"), 1);
+  EXPECT_EQ(classes.size(), 4);
+}
+
+TEST(ExtractNativeTest, matchesReference) {
+  const char alphabet[] = "abcLXZ09/_$;\0\xc3\x80.";
+  unsigned seed = 1;
+  for (size_t size : {0, 1, 15, 16, 17, 31, 32, 33, 100, 4096}) {
+    std::string lib(size, '\0');
+    for (auto& c : lib) {
+      seed = seed * 1103515245 + 12345;
+      // Mostly classname characters so that runs of all lengths show up.
+      c = alphabet[(seed >> 16) % (sizeof(alphabet) - 1)];
+    }
+    EXPECT_EQ(extract_classes_from_native_lib(lib), reference_extract(lib))
+        << "size " << size;
+  }
+}
@@ -0,0 +1,164 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree. An additional grant
+ * of patent rights can be found in the PATENTS file in the same directory.
+ */
+
+#include <gtest/gtest.h>
+
+#include "Dataflow.h"
+#include "DexAsm.h"
+#include "DexUtil.h"
+#include "FlatCode.h"
+#include "Liveness.h"
+#include "RedexContext.h"
+#include "Transform.h"
+
+using namespace dex_asm;
+
+class FlatCodeTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    g_redex = new RedexContext();
+    method = DexMethod::make_method("LFoo;", "foo", "V", {});
+    method->make_concrete(ACC_PUBLIC | ACC_STATIC, false);
+    auto code = method->get_code();
+    code->set_registers_size(6);
+
+    code->push_back(dasm(OPCODE_CONST_WIDE, {0_v, 1_L}));
+    code->push_back(dasm(OPCODE_CONST_4, {2_v, 0_L}));
+    auto if_mie = new MethodItemEntry(dasm(OPCODE_IF_EQZ, {2_v}));
+    code->push_back(*if_mie);
+    code->push_back(dasm(OPCODE_ADD_LONG, {4_v, 0_v, 0_v}));
+    invoke = dasm(OPCODE_INVOKE_STATIC_RANGE,
+                  DexMethod::make_method("LFoo;", "bar", "V", {}),
+                  {});
+    invoke->set_range_base(0)->set_range_size(3);
+    code->push_back(invoke);
+    auto target = new BranchTarget();
+    target->type = BRANCH_SIMPLE;
+    target->src = if_mie;
+    code->push_back(target);
+    code->push_back(std::make_unique<DexPosition>(42));
+    code->push_back(dasm(OPCODE_RETURN_VOID));
+    code->build_cfg();
+  }
+
+  void TearDown() override { delete g_redex; }
+
+  DexMethod* method;
+  IRInstruction* invoke;
+};
+
+TEST_F(FlatCodeTest, blocksAndSideTables) {
+  auto& cfg = method->get_code()->cfg();
+  FlatCode code(cfg);
+  ASSERT_EQ(code.size(), 6);
+
+  // the blocks cover the instructions in order, and each knows its block
+  size_t index = 0;
+  for (auto block : cfg.blocks()) {
+    EXPECT_EQ(code.begin(block->id()), code.begin() + index);
+    for (auto it = block->begin(); it != block->end(); ++it) {
+      if (it->type != MFLOW_OPCODE) {
+        continue;
+      }
+      const auto& flat = code.at(index);
+      EXPECT_EQ(flat.insn, it->insn);
+      EXPECT_EQ(flat.block, block->id());
+      EXPECT_EQ(flat.op(), it->insn->opcode());
+      EXPECT_EQ(code.index_of(flat), index);
+      ++index;
+    }
+    EXPECT_EQ(code.end(block->id()), code.begin() + index);
+  }
+  EXPECT_EQ(code.end(), code.begin() + index);
+
+  const auto& const_wide = code.at(0);
+  EXPECT_TRUE(const_wide.has_dest());
+  EXPECT_TRUE(const_wide.dest_is_wide());
+  EXPECT_EQ(const_wide.nuses, 0);
+
+  const auto& add = code.at(3);
+  EXPECT_EQ(add.dest, 4);
+  EXPECT_EQ(add.nsrcs, 2);
+  EXPECT_TRUE(add.src_is_wide(0));
+  EXPECT_TRUE(add.src_is_wide(1));
+
+  // the range is expanded after the sources
+  const auto& range = code.at(4);
+  EXPECT_EQ(range.insn, invoke);
+  EXPECT_FALSE(range.has_dest());
+  EXPECT_EQ(range.nsrcs, 0);
+  ASSERT_EQ(range.nuses, 3);
+  for (uint16_t i = 0; i < 3; ++i) {
+    EXPECT_EQ(code.uses(range)[i], i);
+  }
+
+  // the branch target precedes the return, and so does the position
+  size_t targets = 0;
+  for (const auto& marker : code.markers()) {
+    if (marker.entry->type == MFLOW_TARGET) {
+      EXPECT_EQ(marker.index, 5);
+      ++targets;
+    }
+  }
+  EXPECT_EQ(targets, 1);
+  EXPECT_EQ(code.position_at(4), nullptr);
+  ASSERT_NE(code.position_at(5), nullptr);
+  EXPECT_EQ(code.position_at(5)->line, 42);
+}
+
+TEST_F(FlatCodeTest, tryAndCatchMarkers) {
+  auto thrower = DexMethod::make_method("LFoo;", "baz", "V", {});
+  thrower->make_concrete(ACC_PUBLIC | ACC_STATIC, false);
+  auto code = thrower->get_code();
+  code->set_registers_size(1);
+  auto catch_start =
+      new MethodItemEntry(DexType::make_type("Ljava/lang/Exception;"));
+  code->push_back(TRY_START, catch_start);
+  code->push_back(dasm(OPCODE_INVOKE_STATIC,
+                       DexMethod::make_method("LFoo;", "bar", "V", {}),
+                       {}));
+  code->push_back(TRY_END, catch_start);
+  code->push_back(dasm(OPCODE_RETURN_VOID));
+  code->push_back(*catch_start);
+  code->push_back(dasm(OPCODE_RETURN_VOID));
+  code->build_cfg();
+
+  FlatCode flat(code->cfg());
+  ASSERT_EQ(flat.size(), 3);
+  ASSERT_EQ(flat.markers().size(), 3);
+  auto& try_start = flat.markers()[0];
+  EXPECT_EQ(try_start.entry->type, MFLOW_TRY);
+  EXPECT_EQ(try_start.entry->tentry->type, TRY_START);
+  EXPECT_EQ(try_start.index, 0);
+  auto& try_end = flat.markers()[1];
+  EXPECT_EQ(try_end.entry->type, MFLOW_TRY);
+  EXPECT_EQ(try_end.entry->tentry->type, TRY_END);
+  EXPECT_EQ(try_end.index, 1);
+  auto& catch_marker = flat.markers()[2];
+  EXPECT_EQ(catch_marker.entry, catch_start);
+  EXPECT_EQ(catch_marker.index, 2);
+  EXPECT_EQ(flat.position_at(2), nullptr);
+}
+
+TEST_F(FlatCodeTest, livenessMatchesListIR) {
+  auto& cfg = method->get_code()->cfg();
+  auto blocks = postorder_sort(cfg.blocks());
+  auto expected = backwards_dataflow<Liveness>(
+      blocks, Liveness(6), Liveness::trans);
+  auto actual = Liveness::analyze(cfg, 6);
+  ASSERT_EQ(actual->size(), expected->size());
+  for (const auto& p : *expected) {
+    EXPECT_EQ(actual->at(p.first), p.second) << SHOW(p.first);
+  }
+  // both halves of v0 are read by the add-long and the range
+  EXPECT_FALSE(actual->at(invoke).is_live(0));
+  const auto& after_const = actual->at(FlatCode(cfg).at(0).insn);
+  EXPECT_TRUE(after_const.is_live(0));
+  EXPECT_TRUE(after_const.is_live(1));
+}
@@ -12,6 +12,8 @@
 #include "DexAsm.h"
 #include "DexUtil.h"
 #include "LocalDce.h"
+#include "Purity.h"
+#include "ScopeHelper.h"
 #include "Transform.h"
 
 struct LocalDceTryTest : testing::Test {
@@ -162,3 +164,76 @@ TEST_F(LocalDceTryTest, tryNeverThrows) {
   EXPECT_EQ(m_method->get_dex_code()->get_instructions().size(), 3);
   EXPECT_EQ(m_method->get_dex_code()->get_tries().size(), 1);
 }
+
+/*
+ * Check that a loop that nothing branches into, which the liveness analysis
+ * never visits, is removed like any other unreachable code.
+ */
+TEST_F(LocalDceTryTest, unreachableSelfLoop) {
+  using namespace dex_asm;
+
+  auto code = m_method->get_code();
+  code->push_back(dasm(OPCODE_RETURN_VOID));
+  auto goto_mie = new MethodItemEntry(dasm(OPCODE_GOTO));
+  auto target = new BranchTarget();
+  target->type = BRANCH_SIMPLE;
+  target->src = goto_mie;
+  code->push_back(target);
+  code->push_back(dasm(OPCODE_CONST_16, {0_v, 0x1_L}));
+  code->push_back(*goto_mie);
+
+  LocalDcePass().run(m_method);
+  m_method->sync();
+
+  EXPECT_EQ(m_method->get_dex_code()->get_instructions().size(), 1);
+}
+
+/*
+ * Check that an unused call to a method proven pure from its code is removed,
+ * and that calls to methods with side effects are kept.
+ */
+TEST(LocalDceTest, deadPureCall) {
+  using namespace dex_asm;
+  g_redex = new RedexContext();
+  auto scope = create_empty_scope();
+  auto cls = create_internal_class(
+      DexType::make_type("LFoo;"), get_object_type(), {});
+  scope.push_back(cls);
+  auto int_void = DexProto::make_proto(get_int_type(),
+                                       DexTypeList::make_type_list({}));
+  auto void_void = DexProto::make_proto(get_void_type(),
+                                        DexTypeList::make_type_list({}));
+
+  auto pure = create_static_method(cls, "pure", int_void, 1);
+  pure->get_code()->push_back(dasm(OPCODE_CONST_16, {0_v, 42_L}));
+  pure->get_code()->push_back(dasm(OPCODE_RETURN, {0_v}));
+
+  auto field = DexField::make_field(
+      cls->get_type(), DexString::make_string("f"), get_int_type());
+  field->make_concrete(ACC_PUBLIC | ACC_STATIC);
+  auto writer = create_static_method(cls, "writer", int_void, 1);
+  writer->get_code()->push_back(dasm(OPCODE_CONST_16, {0_v, 42_L}));
+  writer->get_code()->push_back(dasm(OPCODE_SPUT, field, {0_v}));
+  writer->get_code()->push_back(dasm(OPCODE_RETURN, {0_v}));
+
+  auto caller = create_static_method(cls, "caller", void_void, 1);
+  auto code = caller->get_code();
+  code->push_back(dasm(OPCODE_INVOKE_STATIC, pure, {}));
+  code->push_back(dasm(OPCODE_MOVE_RESULT, {0_v}));
+  code->push_back(dasm(OPCODE_INVOKE_STATIC, writer, {}));
+  code->push_back(dasm(OPCODE_MOVE_RESULT, {0_v}));
+  code->push_back(dasm(OPCODE_RETURN_VOID));
+
+  PureMethods pure_methods(scope);
+  LocalDcePass::run(caller, pure_methods);
+
+  std::vector<IRInstruction*> insns;
+  for (auto& mie : InstructionIterable(code)) {
+    insns.push_back(mie.insn);
+  }
+  ASSERT_EQ(insns.size(), 2);
+  EXPECT_EQ(insns[0]->opcode(), OPCODE_INVOKE_STATIC);
+  EXPECT_EQ(static_cast<IRMethodInstruction*>(insns[0])->get_method(), writer);
+  EXPECT_EQ(insns[1]->opcode(), OPCODE_RETURN_VOID);
+  delete g_redex;
+}
@@ -0,0 +1,106 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree. An additional grant
+ * of patent rights can be found in the PATENTS file in the same directory.
+ */
+
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "ControlFlow.h"
+#include "IRInstruction.h"
+#include "Liveness.h"
+#include "MemoryAccounting.h"
+#include "Transform.h"
+
+using namespace memory_accounting;
+
+TEST(MemoryAccountingTest, countsLiveObjects) {
+  auto before = snapshot();
+  std::unique_ptr<IRInstruction> insn(new IRInstruction(OPCODE_NOP));
+  std::unique_ptr<MethodItemEntry> mie(new MethodItemEntry());
+  auto during = snapshot();
+  EXPECT_EQ(during[IR].live_objects - before[IR].live_objects, 2);
+  EXPECT_EQ(during[IR].live_bytes - before[IR].live_bytes,
+            sizeof(IRInstruction) + sizeof(MethodItemEntry));
+  EXPECT_EQ(during[IR].allocations - before[IR].allocations, 2);
+  EXPECT_EQ(during[memory_accounting::CFG].live_objects,
+            before[memory_accounting::CFG].live_objects);
+
+  insn.reset();
+  mie.reset();
+  auto after = snapshot();
+  EXPECT_EQ(after[IR].live_objects, before[IR].live_objects);
+  EXPECT_EQ(after[IR].live_bytes, before[IR].live_bytes);
+  EXPECT_EQ(after[IR].allocations, during[IR].allocations);
+}
+
+TEST(MemoryAccountingTest, countsSubclassesByDynamicSize) {
+  auto before = snapshot();
+  // Deleted through a pointer to the base class.
+  std::unique_ptr<DexInstruction> insn(
+      new DexOpcodeString(OPCODE_CONST_STRING, nullptr));
+  auto during = snapshot();
+  EXPECT_EQ(during[DEX_CODE].live_bytes - before[DEX_CODE].live_bytes,
+            sizeof(DexOpcodeString));
+  insn.reset();
+  EXPECT_EQ(snapshot()[DEX_CODE].live_bytes, before[DEX_CODE].live_bytes);
+}
+
+TEST(MemoryAccountingTest, countsOwnedMemory) {
+  auto before = snapshot();
+  {
+    Liveness liveness(64);
+    auto small = snapshot();
+    EXPECT_EQ(small[LIVENESS].live_objects - before[LIVENESS].live_objects, 1);
+    auto small_bytes = small[LIVENESS].live_bytes;
+
+    liveness.enlarge(2, 1024);
+    EXPECT_GT(snapshot()[LIVENESS].live_bytes, small_bytes);
+
+    Liveness copy(liveness);
+    EXPECT_EQ(snapshot()[LIVENESS].live_objects - before[LIVENESS].live_objects,
+              2);
+  }
+  auto after = snapshot();
+  EXPECT_EQ(after[LIVENESS].live_objects, before[LIVENESS].live_objects);
+  EXPECT_EQ(after[LIVENESS].live_bytes, before[LIVENESS].live_bytes);
+}
+
+TEST(MemoryAccountingTest, countsContainerNodes) {
+  auto before = snapshot();
+  {
+    map<ANNOTATIONS, int, int> m;
+    for (int i = 0; i < 10; ++i) {
+      m[i] = i;
+    }
+    EXPECT_EQ(
+        snapshot()[ANNOTATIONS].live_objects - before[ANNOTATIONS].live_objects,
+        10);
+  }
+  EXPECT_EQ(snapshot()[ANNOTATIONS].live_bytes,
+            before[ANNOTATIONS].live_bytes);
+}
+
+TEST(MemoryAccountingTest, sumsAcrossThreads) {
+  auto before = snapshot();
+  std::vector<std::thread> threads;
+  std::vector<std::unique_ptr<IRInstruction>> insns(8);
+  for (size_t i = 0; i < insns.size(); ++i) {
+    threads.emplace_back(
+        [&insns, i] { insns[i].reset(new IRInstruction(OPCODE_NOP)); });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(snapshot()[IR].live_objects - before[IR].live_objects, 8);
+  // Freed on another thread than the one that allocated them.
+  insns.clear();
+  EXPECT_EQ(snapshot()[IR].live_objects, before[IR].live_objects);
+}
@@ -0,0 +1,123 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree. An additional grant
+ * of patent rights can be found in the PATENTS file in the same directory.
+ */
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+
+#include "DexAsm.h"
+#include "DexUtil.h"
+#include "MethodCosts.h"
+#include "RedexContext.h"
+#include "ScopeHelper.h"
+#include "Transform.h"
+#include "Walkers.h"
+
+namespace {
+
+void spin(std::chrono::milliseconds duration) {
+  auto end = std::chrono::steady_clock::now() + duration;
+  while (std::chrono::steady_clock::now() < end) {
+  }
+}
+
+struct MethodCostsTest : testing::Test {
+  MethodCostsTest() {
+    g_redex = new RedexContext();
+    scope = create_empty_scope();
+    auto cls = create_internal_class(
+        DexType::make_type("LFoo;"), get_object_type(), {});
+    scope.push_back(cls);
+    auto proto = DexProto::make_proto(get_void_type(),
+                                      DexTypeList::make_type_list({}));
+    slow = create_empty_method(cls, "slow", proto);
+    fast = create_empty_method(cls, "fast", proto);
+    method_costs::set_enabled(true);
+    method_costs::take_slowest(0);
+  }
+
+  ~MethodCostsTest() {
+    method_costs::set_enabled(false);
+    delete g_redex;
+  }
+
+  Scope scope;
+  DexMethod* slow;
+  DexMethod* fast;
+};
+
+}
+
+TEST_F(MethodCostsTest, attributesTimeToMethods) {
+  walk_methods(scope, [&](DexMethod* method) {
+    if (method == slow) {
+      spin(std::chrono::milliseconds(20));
+      // Nested walks are attributed to the outer method.
+      walk_code(scope,
+                [](DexMethod*) { return true; },
+                [](DexMethod*, IRCode&) {
+                  spin(std::chrono::milliseconds(5));
+                });
+    }
+  });
+  auto slowest = method_costs::take_slowest(1);
+  ASSERT_EQ(slowest.size(), 1);
+  EXPECT_EQ(slowest[0].method, show(slow));
+  EXPECT_GE(slowest[0].secs, 0.03);
+  EXPECT_EQ(slowest[0].visits, 1);
+  EXPECT_EQ(slowest[0].instructions, 1);
+  EXPECT_EQ(slowest[0].blocks, 1);
+
+  // Everything recorded was taken.
+  EXPECT_TRUE(method_costs::take_slowest(10).empty());
+}
+
+TEST_F(MethodCostsTest, attributesTimeOnWorkQueue) {
+  walk_methods_parallel(scope, [&](DexMethod* method) {
+    if (method == slow) {
+      spin(std::chrono::milliseconds(20));
+    }
+  });
+  auto slowest = method_costs::take_slowest(2);
+  ASSERT_EQ(slowest.size(), 2);
+  EXPECT_EQ(slowest[0].method, show(slow));
+  EXPECT_GE(slowest[0].secs, 0.02);
+  EXPECT_EQ(slowest[0].visits, 1);
+  EXPECT_EQ(slowest[1].method, show(fast));
+}
+
+TEST_F(MethodCostsTest, disabled) {
+  method_costs::set_enabled(false);
+  walk_methods(scope, [](DexMethod*) {});
+  method_costs::set_enabled(true);
+  EXPECT_TRUE(method_costs::take_slowest(10).empty());
+}
+
+TEST_F(MethodCostsTest, countBlocks) {
+  using namespace dex_asm;
+  auto method = DexMethod::make_method(
+      get_object_type(), DexString::make_string("branchy"),
+      DexProto::make_proto(get_void_type(), DexTypeList::make_type_list({})));
+  method->make_concrete(ACC_PUBLIC | ACC_STATIC, false);
+  auto code = method->get_code();
+  code->set_registers_size(1);
+
+  auto if_mie = new MethodItemEntry(dasm(OPCODE_IF_EQZ, {0_v}));
+  auto target = new BranchTarget();
+  target->type = BRANCH_SIMPLE;
+  target->src = if_mie;
+
+  code->push_back(dasm(OPCODE_CONST_4, {0_v, 0_L}));
+  code->push_back(*if_mie);
+  code->push_back(dasm(OPCODE_RETURN_VOID));
+  code->push_back(target);
+  code->push_back(dasm(OPCODE_RETURN_VOID));
+
+  EXPECT_EQ(method_costs::count_blocks(*code), 3);
+}
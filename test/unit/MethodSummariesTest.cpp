@@ -0,0 +1,151 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree. An additional grant
+ * of patent rights can be found in the PATENTS file in the same directory.
+ */
+
+#include <gtest/gtest.h>
+
+#include "CallGraph.h"
+#include "DexAsm.h"
+#include "DexUtil.h"
+#include "MethodSummaries.h"
+#include "ScopeHelper.h"
+#include "Transform.h"
+
+using namespace dex_asm;
+
+class MethodSummariesTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    g_redex = new RedexContext();
+    scope = create_empty_scope();
+    cls = create_internal_class(
+        DexType::make_type("LFoo;"), get_object_type(), {});
+    scope.push_back(cls);
+    auto args = DexTypeList::make_type_list({get_int_type()});
+    int_int = DexProto::make_proto(get_int_type(), args);
+    void_int = DexProto::make_proto(get_void_type(), args);
+  }
+
+  void TearDown() override { delete g_redex; }
+
+  std::unique_ptr<MethodSummaries> summarize(
+      const std::unordered_set<DexType*>& blacklist = {}) {
+    CallGraph graph(scope);
+    return std::unique_ptr<MethodSummaries>(
+        new MethodSummaries(scope, graph, blacklist));
+  }
+
+  Scope scope;
+  DexClass* cls;
+  // (int), the parameter is the last register
+  DexProto* int_int;
+  DexProto* void_int;
+};
+
+TEST_F(MethodSummariesTest, returnsAcrossLevels) {
+  auto leaf = create_static_method(cls, "leaf", int_int, 1);
+  leaf->get_code()->push_back(dasm(OPCODE_CONST_16, {0_v, 42_L}));
+  leaf->get_code()->push_back(dasm(OPCODE_RETURN, {0_v}));
+
+  // mid only knows what it returns through the summary of leaf
+  auto mid = create_static_method(cls, "mid", int_int, 2);
+  mid->get_code()->push_back(dasm(OPCODE_INVOKE_STATIC, leaf, {1_v}));
+  mid->get_code()->push_back(dasm(OPCODE_MOVE_RESULT, {0_v}));
+  mid->get_code()->push_back(dasm(OPCODE_RETURN, {0_v}));
+
+  auto top = create_static_method(cls, "top", int_int, 2);
+  top->get_code()->push_back(dasm(OPCODE_INVOKE_STATIC, mid, {1_v}));
+  top->get_code()->push_back(dasm(OPCODE_MOVE_RESULT, {0_v}));
+  top->get_code()->push_back(dasm(OPCODE_RETURN, {0_v}));
+
+  auto summaries = summarize();
+  for (auto m : {leaf, mid, top}) {
+    auto summary = summaries->get(m);
+    ASSERT_NE(summary, nullptr) << show(m);
+    EXPECT_TRUE(summary->ret.is_constant);
+    EXPECT_EQ(summary->ret.constant, 42);
+  }
+}
+
+TEST_F(MethodSummariesTest, paramsMeetCallSites) {
+  auto same = create_static_method(cls, "same", void_int, 1);
+  same->get_code()->push_back(dasm(OPCODE_RETURN_VOID));
+  auto differ = create_static_method(cls, "differ", void_int, 1);
+  differ->get_code()->push_back(dasm(OPCODE_RETURN_VOID));
+
+  auto caller = create_static_method(cls, "caller", void_int, 3);
+  auto code = caller->get_code();
+  code->push_back(dasm(OPCODE_CONST_4, {0_v, 1_L}));
+  code->push_back(dasm(OPCODE_CONST_4, {1_v, 2_L}));
+  code->push_back(dasm(OPCODE_INVOKE_STATIC, same, {0_v}));
+  code->push_back(dasm(OPCODE_INVOKE_STATIC, same, {0_v}));
+  code->push_back(dasm(OPCODE_INVOKE_STATIC, differ, {0_v}));
+  code->push_back(dasm(OPCODE_INVOKE_STATIC, differ, {1_v}));
+  code->push_back(dasm(OPCODE_RETURN_VOID));
+
+  auto summaries = summarize();
+  auto summary = summaries->get(same);
+  ASSERT_NE(summary, nullptr);
+  ASSERT_EQ(summary->params.size(), 1);
+  EXPECT_TRUE(summary->params[0].is_constant);
+  EXPECT_EQ(summary->params[0].constant, 1);
+  EXPECT_EQ(summaries->get(differ), nullptr);
+}
+
+TEST_F(MethodSummariesTest, newInstanceIsNotNull) {
+  auto factory = create_static_method(
+      cls, "make",
+      DexProto::make_proto(cls->get_type(), DexTypeList::make_type_list({})),
+      1);
+  factory->get_code()->push_back(
+      dasm(OPCODE_NEW_INSTANCE, cls->get_type(), {0_v}));
+  factory->get_code()->push_back(dasm(OPCODE_RETURN_OBJECT, {0_v}));
+
+  auto summaries = summarize();
+  auto summary = summaries->get(factory);
+  ASSERT_NE(summary, nullptr);
+  EXPECT_FALSE(summary->ret.is_constant);
+  EXPECT_TRUE(summary->ret.non_null);
+}
+
+TEST_F(MethodSummariesTest, mismatchedCallsHideParams) {
+  auto callee = create_static_method(cls, "callee", void_int, 1);
+  callee->get_code()->push_back(dasm(OPCODE_RETURN_VOID));
+
+  // The second call passes one register too many, so nothing is known about
+  // what the callee sees, whatever the calls around it pass.
+  auto caller = create_static_method(cls, "caller", void_int, 3);
+  auto code = caller->get_code();
+  code->push_back(dasm(OPCODE_CONST_4, {0_v, 1_L}));
+  code->push_back(dasm(OPCODE_INVOKE_STATIC, callee, {0_v}));
+  code->push_back(dasm(OPCODE_INVOKE_STATIC, callee, {0_v, 0_v}));
+  code->push_back(dasm(OPCODE_INVOKE_STATIC, callee, {0_v}));
+  code->push_back(dasm(OPCODE_RETURN_VOID));
+
+  auto summaries = summarize();
+  EXPECT_EQ(summaries->get(callee), nullptr);
+}
+
+TEST_F(MethodSummariesTest, blacklistedReturnsAreUnknown) {
+  auto bar = create_internal_class(
+      DexType::make_type("LBar;"), get_object_type(), {});
+  scope.push_back(bar);
+  auto leaf = create_static_method(bar, "leaf", int_int, 1);
+  leaf->get_code()->push_back(dasm(OPCODE_CONST_16, {0_v, 42_L}));
+  leaf->get_code()->push_back(dasm(OPCODE_RETURN, {0_v}));
+
+  auto mid = create_static_method(cls, "mid", int_int, 2);
+  mid->get_code()->push_back(dasm(OPCODE_INVOKE_STATIC, leaf, {1_v}));
+  mid->get_code()->push_back(dasm(OPCODE_MOVE_RESULT, {0_v}));
+  mid->get_code()->push_back(dasm(OPCODE_RETURN, {0_v}));
+
+  // nor is anything derived from it through the callers
+  auto summaries = summarize({bar->get_type()});
+  EXPECT_EQ(summaries->get(leaf), nullptr);
+  EXPECT_EQ(summaries->get(mid), nullptr);
+}
@@ -0,0 +1,46 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree. An additional grant
+ * of patent rights can be found in the PATENTS file in the same directory.
+ */
+
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <vector>
+
+#include "IRInstruction.h"
+#include "Profiler.h"
+#include "Transform.h"
+
+TEST(ProfilerTest, countsIRAllocations) {
+  PhaseProfiler profiler;
+  std::unique_ptr<IRInstruction> insn(new IRInstruction(OPCODE_NOP));
+  std::unique_ptr<IRInstruction> copy(insn->clone());
+  std::unique_ptr<MethodItemEntry> mie(new MethodItemEntry());
+  auto profile = profiler.stop();
+  EXPECT_EQ(profile.ir_allocations, 3);
+}
+
+TEST(ProfilerTest, measuresTimeAndMemory) {
+  PhaseProfiler profiler;
+  // Touch 64MB so that it becomes resident.
+  std::vector<char> buffer(64 << 20, 1);
+  volatile uint64_t sum = 0;
+  for (size_t i = 0; i < buffer.size(); i += 4096) {
+    sum += buffer[i];
+  }
+  auto profile = profiler.stop();
+  EXPECT_GT(profile.wall_secs, 0);
+  EXPECT_GE(profile.cpu_secs, 0);
+  EXPECT_EQ(profile.ir_allocations, 0);
+#ifdef __linux__
+  // Relative to the RSS the phase started with, whatever the rest of the
+  // process holds. Leave slack for pages the kernel did not keep resident.
+  EXPECT_GE(profile.rss_delta_kb, 32 << 10);
+  EXPECT_GE(profile.peak_rss_kb, profile.rss_delta_kb);
+#endif
+}
@@ -0,0 +1,171 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree. An additional grant
+ * of patent rights can be found in the PATENTS file in the same directory.
+ */
+
+#include <gtest/gtest.h>
+
+#include "DexAsm.h"
+#include "DexUtil.h"
+#include "Purity.h"
+#include "ScopeHelper.h"
+#include "Transform.h"
+
+using namespace dex_asm;
+
+class PurityTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    g_redex = new RedexContext();
+    scope = create_empty_scope();
+    cls = create_internal_class(
+        DexType::make_type("LFoo;"), get_object_type(), {});
+    scope.push_back(cls);
+    field = DexField::make_field(DexType::make_type("LFoo;"),
+                                 DexString::make_string("f"),
+                                 get_int_type());
+    field->make_concrete(ACC_PUBLIC | ACC_STATIC);
+    cls->add_field(field);
+  }
+
+  void TearDown() override { delete g_redex; }
+
+  // static int name()
+  DexMethod* make_method(const char* name) {
+    auto proto = DexProto::make_proto(get_int_type(),
+                                      DexTypeList::make_type_list({}));
+    return create_static_method(cls, name, proto, 1);
+  }
+
+  IRInstruction* invoke(DexMethod* callee) {
+    return dasm(OPCODE_INVOKE_STATIC, callee, {});
+  }
+
+  bool is_pure(const PureMethods& pure_methods, DexMethod* callee) {
+    auto insn = invoke(callee);
+    auto pure = pure_methods.is_pure_call(insn);
+    delete insn;
+    return pure;
+  }
+
+  Scope scope;
+  DexClass* cls;
+  DexField* field;
+};
+
+TEST_F(PurityTest, callsToPureMethods) {
+  auto leaf = make_method("leaf");
+  leaf->get_code()->push_back(dasm(OPCODE_CONST_4, {0_v, 1_L}));
+  leaf->get_code()->push_back(dasm(OPCODE_RETURN, {0_v}));
+
+  auto caller = make_method("caller");
+  caller->get_code()->push_back(invoke(leaf));
+  caller->get_code()->push_back(dasm(OPCODE_MOVE_RESULT, {0_v}));
+  caller->get_code()->push_back(dasm(OPCODE_RETURN, {0_v}));
+
+  // reading a field of LFoo;, which has no static initializer, is fine,
+  // writing it is not
+  auto reader = make_method("reader");
+  reader->get_code()->push_back(dasm(OPCODE_SGET, field, {0_v}));
+  reader->get_code()->push_back(dasm(OPCODE_RETURN, {0_v}));
+  auto writer = make_method("writer");
+  writer->get_code()->push_back(dasm(OPCODE_CONST_4, {0_v, 1_L}));
+  writer->get_code()->push_back(dasm(OPCODE_SPUT, field, {0_v}));
+  writer->get_code()->push_back(dasm(OPCODE_RETURN, {0_v}));
+
+  auto calls_writer = make_method("callsWriter");
+  calls_writer->get_code()->push_back(invoke(writer));
+  calls_writer->get_code()->push_back(dasm(OPCODE_MOVE_RESULT, {0_v}));
+  calls_writer->get_code()->push_back(dasm(OPCODE_RETURN, {0_v}));
+
+  PureMethods pure_methods(scope);
+  EXPECT_TRUE(is_pure(pure_methods, leaf));
+  EXPECT_TRUE(is_pure(pure_methods, caller));
+  EXPECT_TRUE(is_pure(pure_methods, reader));
+  EXPECT_FALSE(is_pure(pure_methods, writer));
+  EXPECT_FALSE(is_pure(pure_methods, calls_writer));
+  EXPECT_EQ(pure_methods.size(), 3);
+}
+
+TEST_F(PurityTest, mayInitializeClasses) {
+  auto bar_type = DexType::make_type("LBar;");
+  auto bar = create_internal_class(bar_type, get_object_type(), {});
+  scope.push_back(bar);
+  auto void_void =
+      DexProto::make_proto(get_void_type(), DexTypeList::make_type_list({}));
+  auto clinit = create_static_method(bar, "<clinit>", void_void, 0);
+  clinit->get_code()->push_back(dasm(OPCODE_RETURN_VOID));
+  auto bar_field = DexField::make_field(
+      bar_type, DexString::make_string("g"), get_int_type());
+  bar_field->make_concrete(ACC_PUBLIC | ACC_STATIC);
+  bar->add_field(bar_field);
+  // a field of a class that is not in the scope
+  auto unknown_field =
+      DexField::make_field(DexType::make_type("LUnknown;"),
+                           DexString::make_string("h"),
+                           get_int_type());
+
+  // LFoo; has no static initializer, LBar; has one
+  auto reads_foo = make_method("readsFoo");
+  reads_foo->get_code()->push_back(dasm(OPCODE_SGET, field, {0_v}));
+  reads_foo->get_code()->push_back(dasm(OPCODE_RETURN, {0_v}));
+  auto reads_bar = make_method("readsBar");
+  reads_bar->get_code()->push_back(dasm(OPCODE_SGET, bar_field, {0_v}));
+  reads_bar->get_code()->push_back(dasm(OPCODE_RETURN, {0_v}));
+  auto reads_unknown = make_method("readsUnknown");
+  reads_unknown->get_code()->push_back(
+      dasm(OPCODE_SGET, unknown_field, {0_v}));
+  reads_unknown->get_code()->push_back(dasm(OPCODE_RETURN, {0_v}));
+
+  auto make_new = [&](const char* name, DexType* type) {
+    auto method = make_method(name);
+    auto new_instance = new IRTypeInstruction(OPCODE_NEW_INSTANCE, type);
+    new_instance->set_dest(0);
+    method->get_code()->push_back(new_instance);
+    method->get_code()->push_back(dasm(OPCODE_CONST_4, {0_v, 0_L}));
+    method->get_code()->push_back(dasm(OPCODE_RETURN, {0_v}));
+    return method;
+  };
+  auto new_foo = make_new("newFoo", cls->get_type());
+  auto new_bar = make_new("newBar", bar_type);
+
+  PureMethods pure_methods(scope);
+  EXPECT_TRUE(is_pure(pure_methods, reads_foo));
+  EXPECT_FALSE(is_pure(pure_methods, reads_bar));
+  EXPECT_FALSE(is_pure(pure_methods, reads_unknown));
+  EXPECT_TRUE(is_pure(pure_methods, new_foo));
+  EXPECT_FALSE(is_pure(pure_methods, new_bar));
+  EXPECT_EQ(pure_methods.size(), 2);
+}
+
+TEST_F(PurityTest, mayNotTerminate) {
+  // calls itself, through another method
+  auto ping = make_method("ping");
+  auto pong = make_method("pong");
+  ping->get_code()->push_back(invoke(pong));
+  ping->get_code()->push_back(dasm(OPCODE_MOVE_RESULT, {0_v}));
+  ping->get_code()->push_back(dasm(OPCODE_RETURN, {0_v}));
+  pong->get_code()->push_back(invoke(ping));
+  pong->get_code()->push_back(dasm(OPCODE_MOVE_RESULT, {0_v}));
+  pong->get_code()->push_back(dasm(OPCODE_RETURN, {0_v}));
+
+  // spins forever
+  auto spin = make_method("spin");
+  auto code = spin->get_code();
+  auto target = new BranchTarget();
+  target->type = BRANCH_SIMPLE;
+  auto goto_mie = new MethodItemEntry(dasm(OPCODE_GOTO));
+  target->src = goto_mie;
+  code->push_back(target);
+  code->push_back(*goto_mie);
+
+  PureMethods pure_methods(scope);
+  EXPECT_FALSE(is_pure(pure_methods, ping));
+  EXPECT_FALSE(is_pure(pure_methods, pong));
+  EXPECT_FALSE(is_pure(pure_methods, spin));
+  EXPECT_EQ(pure_methods.size(), 0);
+}
@@ -0,0 +1,66 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree. An additional grant
+ * of patent rights can be found in the PATENTS file in the same directory.
+ */
+
+#include <gtest/gtest.h>
+
+#include <string>
+
+#include "ConfigFiles.h"
+#include "DexAsm.h"
+#include "DexUtil.h"
+#include "ProguardConfiguration.h"
+#include "ReachableClasses.h"
+#include "ScopeHelper.h"
+#include "Transform.h"
+
+using namespace dex_asm;
+
+TEST(ReachableClassesTest, classForNameInEveryMethod) {
+  g_redex = new RedexContext();
+  auto scope = create_empty_scope();
+  auto cls = create_internal_class(
+      DexType::make_type("LFoo;"), get_object_type(), {});
+  scope.push_back(cls);
+  auto for_name = DexMethod::make_method(
+      "Ljava/lang/Class;", "forName", "Ljava/lang/Class;",
+      {"Ljava/lang/String;"});
+  auto proto = DexProto::make_proto(get_void_type(),
+                                    DexTypeList::make_type_list({}));
+
+  // Enough methods to be spread over all the threads of the scan. Only the
+  // even ones pass the string to Class.forName.
+  const size_t kMethods = 256;
+  std::vector<DexClass*> targets;
+  for (size_t i = 0; i < kMethods; ++i) {
+    auto name = "Lcom/Bar" + std::to_string(i) + ";";
+    auto target = create_internal_class(
+        DexType::make_type(name.c_str()), get_object_type(), {});
+    scope.push_back(target);
+    targets.push_back(target);
+
+    auto method = create_static_method(
+        cls, ("m" + std::to_string(i)).c_str(), proto, 2);
+    auto code = method->get_code();
+    auto external = DexString::make_string("com.Bar" + std::to_string(i));
+    code->push_back(dasm(OPCODE_CONST_STRING, external, {0_v}));
+    code->push_back(dasm(OPCODE_INVOKE_STATIC, for_name, {i % 2 ? 1_v : 0_v}));
+    code->push_back(dasm(OPCODE_RETURN_VOID));
+  }
+
+  Json::Value config;
+  ConfigFiles cfg(config);
+  redex::ProguardConfiguration pg_config;
+  init_reachable_classes(scope, config, pg_config, cfg);
+
+  for (size_t i = 0; i < kMethods; ++i) {
+    EXPECT_EQ(targets[i]->rstate.is_referenced_by_string(), i % 2 == 0)
+        << SHOW(targets[i]);
+  }
+  delete g_redex;
+}
@@ -10,6 +10,7 @@
 #include "DexAsm.h"
 #include "DexUtil.h"
 #include "IRInstruction.h"
+#include "GraphColoring.h"
 #include "OpcodeList.h"
 #include "RegAlloc.h"
 #include "Show.h"
@@ -99,6 +100,35 @@ TEST_F(RegAllocTest, RegKindWide) {
   }
 }
 
+TEST_F(RegAllocTest, RegKindsAtJoin) {
+  using namespace dex_asm;
+  DexMethod* method = DexMethod::make_method(
+      "Lfoo;", "RegKindsAtJoin", "V", {"Ljava/lang/Object;"});
+  method->make_concrete(ACC_STATIC, false);
+  method->get_code()->set_registers_size(4);
+  method->get_code()->set_ins_size(1);
+  auto mt = method->get_code();
+  mt->push_back(dasm(OPCODE_CONST_4, {0_v, 0_L}));
+  auto if_ = new MethodItemEntry(dasm(OPCODE_IF_EQZ, {3_v}));
+  mt->push_back(*if_);
+  mt->push_back(dasm(OPCODE_CONST_WIDE_16, {0_v, 1_L}));
+  auto target = new BranchTarget();
+  target->type = BRANCH_SIMPLE;
+  target->src = if_;
+  mt->push_back(target);
+  auto move = dasm(OPCODE_MOVE_OBJECT, {1_v, 3_v});
+  mt->push_back(move);
+  mt->push_back(dasm(OPCODE_RETURN_VOID));
+
+  auto kinds = analyze_register_kinds(method);
+  EXPECT_EQ(kinds->kind_at(if_->insn, 0), RegisterKind::NORMAL);
+  EXPECT_EQ(kinds->src_kind(if_->insn, 0), RegisterKind::OBJECT);
+  EXPECT_EQ(kinds->src_kind(move, 0), RegisterKind::OBJECT);
+  // v0 holds an int on one path and a long on the other
+  EXPECT_EQ(kinds->kind_at(move, 0), RegisterKind::MIXED);
+  EXPECT_EQ(kinds->kind_at(move, 2), RegisterKind::UNKNOWN);
+}
+
 TEST_F(RegAllocTest, InsertMoveDest) {
   using namespace dex_asm;
   DexMethod* method =
@@ -231,3 +261,224 @@ TEST_F(RegAllocTest, ConvertToRangeForTwoSrc) {
   };
   EXPECT_TRUE(expected_insns.matches(InstructionIterable(mt)));
 }
+
+TEST_F(RegAllocTest, ColoringShrinksFrame) {
+  using namespace dex_asm;
+  DexMethod* method =
+      DexMethod::make_method("Lfoo;", "ColoringShrinksFrame", "I", {"I"});
+  method->make_concrete(ACC_STATIC, false);
+  method->get_code()->set_registers_size(20);
+  method->get_code()->set_ins_size(1);
+  auto mt = method->get_code();
+  mt->push_back(dasm(OPCODE_CONST_4, {10_v, 1_L}));
+  mt->push_back(dasm(OPCODE_ADD_INT, {15_v, 10_v, 19_v}));
+  mt->push_back(dasm(OPCODE_ADD_INT, {17_v, 15_v, 10_v}));
+  mt->push_back(dasm(OPCODE_RETURN, {17_v}));
+
+  GraphColoringAllocator allocator;
+  allocator.allocate(method);
+
+  // v10 and v15 are live at the same time, v17 can reuse either; the
+  // parameter stays at the top of the frame
+  InstructionList expected_insns {
+    dasm(OPCODE_CONST_4, {0_v, 1_L}),
+    dasm(OPCODE_ADD_INT, {1_v, 0_v, 2_v}),
+    dasm(OPCODE_ADD_INT, {0_v, 1_v, 0_v}),
+    dasm(OPCODE_RETURN, {0_v})
+  };
+  EXPECT_TRUE(expected_insns.matches(InstructionIterable(mt)));
+  EXPECT_EQ(mt->get_registers_size(), 3);
+  EXPECT_EQ(mt->get_ins_size(), 1);
+  EXPECT_EQ(allocator.get_stats().registers_saved, 17);
+}
+
+TEST_F(RegAllocTest, ColoringCoalescesMoves) {
+  using namespace dex_asm;
+  DexMethod* method =
+      DexMethod::make_method("Lfoo;", "ColoringCoalescesMoves", "J", {});
+  method->make_concrete(ACC_STATIC, false);
+  method->get_code()->set_registers_size(300);
+  method->get_code()->set_ins_size(0);
+  auto mt = method->get_code();
+  mt->push_back(dasm(OPCODE_CONST_WIDE_16, {3_v, 1_L}));
+  mt->push_back(dasm(OPCODE_MOVE_WIDE_16, {298_v, 3_v}));
+  mt->push_back(dasm(OPCODE_RETURN_WIDE, {298_v}));
+
+  GraphColoringAllocator allocator;
+  allocator.allocate(method);
+
+  InstructionList expected_insns {
+    dasm(OPCODE_CONST_WIDE_16, {0_v, 1_L}),
+    dasm(OPCODE_RETURN_WIDE, {0_v})
+  };
+  EXPECT_TRUE(expected_insns.matches(InstructionIterable(mt)));
+  EXPECT_EQ(mt->get_registers_size(), 2);
+  EXPECT_EQ(allocator.get_stats().moves_removed, 1);
+}
+
+TEST_F(RegAllocTest, ColoringKeepsInterferingMoves) {
+  using namespace dex_asm;
+  DexMethod* method =
+      DexMethod::make_method("Lfoo;", "ColoringKeepsInterferingMoves", "I", {});
+  method->make_concrete(ACC_STATIC, false);
+  method->get_code()->set_registers_size(40);
+  method->get_code()->set_ins_size(0);
+  auto mt = method->get_code();
+  mt->push_back(dasm(OPCODE_CONST_4, {20_v, 1_L}));
+  mt->push_back(dasm(OPCODE_MOVE_FROM16, {30_v, 20_v}));
+  // v20 is redefined while the copy in v30 is still live
+  mt->push_back(dasm(OPCODE_ADD_INT_LIT8, {20_v, 20_v, 1_L}));
+  mt->push_back(dasm(OPCODE_ADD_INT, {30_v, 30_v, 20_v}));
+  mt->push_back(dasm(OPCODE_RETURN, {30_v}));
+
+  GraphColoringAllocator allocator;
+  allocator.allocate(method);
+
+  // the move shrinks to its 4-bit form
+  InstructionList expected_insns {
+    dasm(OPCODE_CONST_4, {0_v, 1_L}),
+    dasm(OPCODE_MOVE, {1_v, 0_v}),
+    dasm(OPCODE_ADD_INT_LIT8, {0_v, 0_v, 1_L}),
+    dasm(OPCODE_ADD_INT, {1_v, 1_v, 0_v}),
+    dasm(OPCODE_RETURN, {1_v})
+  };
+  EXPECT_TRUE(expected_insns.matches(InstructionIterable(mt)));
+  EXPECT_EQ(mt->get_registers_size(), 2);
+  EXPECT_EQ(allocator.get_stats().moves_removed, 0);
+}
+
+TEST_F(RegAllocTest, ColoringKeepsMethodWhenNothingToGain) {
+  using namespace dex_asm;
+  DexMethod* method =
+      DexMethod::make_method("Lfoo;", "ColoringKeepsMethod", "I", {});
+  method->make_concrete(ACC_STATIC, false);
+  method->get_code()->set_registers_size(2);
+  method->get_code()->set_ins_size(0);
+  auto mt = method->get_code();
+  // a local of a register outside of the frame, which a new assignment
+  // would drop
+  mt->push_back(std::unique_ptr<DexDebugInstruction>(
+      new DexDebugOpcodeStartLocal(
+          5, DexString::make_string("x"), get_int_type())));
+  mt->push_back(dasm(OPCODE_CONST_4, {1_v, 1_L}));
+  mt->push_back(dasm(OPCODE_CONST_4, {0_v, 2_L}));
+  mt->push_back(dasm(OPCODE_ADD_INT, {0_v, 0_v, 1_v}));
+  mt->push_back(dasm(OPCODE_RETURN, {0_v}));
+
+  GraphColoringAllocator allocator;
+  allocator.allocate(method);
+
+  // two registers are live at the same time, there is nothing to save
+  InstructionList expected_insns {
+    dasm(OPCODE_CONST_4, {1_v, 1_L}),
+    dasm(OPCODE_CONST_4, {0_v, 2_L}),
+    dasm(OPCODE_ADD_INT, {0_v, 0_v, 1_v}),
+    dasm(OPCODE_RETURN, {0_v})
+  };
+  EXPECT_TRUE(expected_insns.matches(InstructionIterable(mt)));
+  EXPECT_EQ(mt->get_registers_size(), 2);
+  EXPECT_EQ(allocator.get_stats().methods_reallocated, 0);
+  ASSERT_EQ(mt->begin()->type, MFLOW_DEBUG);
+  EXPECT_EQ(mt->begin()->dbgop->uvalue(), 5);
+}
+
+TEST_F(RegAllocTest, ColoringSeesLivenessIntoCatchHandlers) {
+  using namespace dex_asm;
+  DexMethod* method =
+      DexMethod::make_method("Lfoo;", "ColoringCatch", "V", {});
+  method->make_concrete(ACC_STATIC, false);
+  method->get_code()->set_registers_size(10);
+  method->get_code()->set_ins_size(0);
+  auto use = DexMethod::make_method("Lfoo;", "use", "V", {"I"});
+  auto mt = method->get_code();
+  auto catch_start =
+      new MethodItemEntry(DexType::make_type("Ljava/lang/Exception;"));
+  mt->push_back(TRY_START, catch_start);
+  auto x = dasm(OPCODE_CONST_4, {5_v, 1_L});
+  mt->push_back(x);
+  auto y = dasm(OPCODE_CONST_4, {6_v, 2_L});
+  mt->push_back(y);
+  // may throw, and the handler reads v5
+  mt->push_back(dasm(OPCODE_INVOKE_STATIC, use, {6_v}));
+  // v5 is redefined before the end of the try block
+  mt->push_back(dasm(OPCODE_CONST_4, {5_v, 3_L}));
+  mt->push_back(dasm(OPCODE_INVOKE_STATIC, use, {5_v}));
+  mt->push_back(TRY_END, catch_start);
+  mt->push_back(dasm(OPCODE_RETURN_VOID));
+  mt->push_back(*catch_start);
+  mt->push_back(dasm(OPCODE_INVOKE_STATIC, use, {5_v}));
+  mt->push_back(dasm(OPCODE_RETURN_VOID));
+
+  GraphColoringAllocator allocator;
+  allocator.allocate(method);
+
+  // v6 is defined while the first value of v5 is live in the handler
+  EXPECT_EQ(mt->get_registers_size(), 2);
+  EXPECT_NE(x->dest(), y->dest());
+}
+
+TEST_F(RegAllocTest, ColoringKeepsRangeOperandsTogether) {
+  using namespace dex_asm;
+  DexMethod* method =
+      DexMethod::make_method("Lfoo;", "ColoringRange", "I", {});
+  method->make_concrete(ACC_STATIC, false);
+  method->get_code()->set_registers_size(20);
+  method->get_code()->set_ins_size(0);
+  auto mt = method->get_code();
+  auto live_across = dasm(OPCODE_CONST_4, {3_v, 1_L});
+  mt->push_back(live_across);
+  std::vector<IRInstruction*> args;
+  for (uint16_t reg = 10; reg < 13; ++reg) {
+    args.push_back(dasm(OPCODE_CONST_4, {Operand{VREG, reg}, 0_L}));
+    mt->push_back(args.back());
+  }
+  auto invoke = dasm(OPCODE_INVOKE_STATIC_RANGE,
+                     DexMethod::make_method("Lfoo;", "bar", "V",
+                                            {"I", "I", "I"}),
+                     {});
+  invoke->set_range_base(10)->set_range_size(3);
+  mt->push_back(invoke);
+  mt->push_back(dasm(OPCODE_RETURN, {3_v}));
+
+  GraphColoringAllocator allocator;
+  allocator.allocate(method);
+
+  // the operands stay adjacent and in order, apart from the value that is
+  // live across the call
+  EXPECT_EQ(mt->get_registers_size(), 4);
+  EXPECT_EQ(invoke->range_size(), 3);
+  auto base = invoke->range_base();
+  for (uint16_t i = 0; i < 3; ++i) {
+    EXPECT_EQ(args[i]->dest(), base + i);
+  }
+  auto other = live_across->dest();
+  EXPECT_TRUE(other < base || other >= base + 3);
+}
+
+TEST_F(RegAllocTest, ColoringHandlesDeadLoops) {
+  using namespace dex_asm;
+  DexMethod* method =
+      DexMethod::make_method("Lfoo;", "ColoringDeadLoop", "I", {});
+  method->make_concrete(ACC_STATIC, false);
+  method->get_code()->set_registers_size(20);
+  method->get_code()->set_ins_size(0);
+  auto mt = method->get_code();
+  mt->push_back(dasm(OPCODE_CONST_4, {10_v, 1_L}));
+  mt->push_back(dasm(OPCODE_RETURN, {10_v}));
+  // a loop that nothing branches into, and that no postorder reaches
+  auto goto_ = new MethodItemEntry(dasm(OPCODE_GOTO, {}));
+  auto target = new BranchTarget();
+  target->type = BRANCH_SIMPLE;
+  target->src = goto_;
+  mt->push_back(target);
+  auto add = dasm(OPCODE_ADD_INT_LIT8, {15_v, 15_v, 1_L});
+  mt->push_back(add);
+  mt->push_back(*goto_);
+
+  GraphColoringAllocator allocator;
+  allocator.allocate(method);
+
+  EXPECT_EQ(mt->count_opcodes(), 4);
+  EXPECT_EQ(mt->get_registers_size(), 1);
+  EXPECT_EQ(add->dest(), add->src(0));
+}
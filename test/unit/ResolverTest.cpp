@@ -7,7 +7,9 @@
  * of patent rights can be found in the PATENTS file in the same directory.
  */
 
+#include <atomic>
 #include <memory>
+#include <thread>
 #include <gtest/gtest.h>
 
 #include "DexClass.h"
@@ -211,3 +213,86 @@ TEST(ResolveField, empty) {
 
   delete g_redex;
 }
+
+TEST(ResolveField, sharedCache) {
+  g_redex = new RedexContext();
+  create_scope();
+
+  auto b = DexType::get_type("B");
+  auto string_t = DexType::get_type("Ljava/lang/String;");
+  DexField* f2_def = DexField::get_field(b,
+      DexString::get_string("f2"), string_t);
+  DexField* fref = make_field_ref(
+      DexType::get_type("C"), "f2", string_t);
+  EXPECT_TRUE(resolve_field_cached(fref, FieldSearch::Static) == f2_def);
+  EXPECT_TRUE(resolve_field_cached(fref, FieldSearch::Static) == f2_def);
+  EXPECT_TRUE(resolve_field_cached(fref, FieldSearch::Instance) == nullptr);
+
+  // removing the definition must not leave a stale resolution behind
+  type_class(b)->remove_field(f2_def);
+  EXPECT_TRUE(resolve_field_cached(fref, FieldSearch::Static) == nullptr);
+  type_class(b)->add_field(f2_def);
+  EXPECT_TRUE(resolve_field_cached(fref, FieldSearch::Static) == f2_def);
+
+  delete g_redex;
+}
+
+TEST(ResolveMethod, sharedCacheAcrossThreads) {
+  g_redex = new RedexContext();
+  create_scope();
+
+  auto b = DexType::get_type("B");
+  auto c = DexType::get_type("C");
+  auto void_void = DexProto::make_proto(DexType::make_type("V"),
+      DexTypeList::make_type_list({}));
+  auto m = DexString::make_string("m");
+  auto m_def = DexMethod::make_method(b, m, void_void);
+  m_def->make_concrete(ACC_PUBLIC, true);
+  type_class(b)->add_method(m_def);
+  auto m_ref = DexMethod::make_method(c, m, void_void);
+  auto missing_ref = DexMethod::make_method(
+      c, DexString::make_string("missing"), void_void);
+
+  auto& cache = shared_method_ref_cache();
+  DexMethod* cached = nullptr;
+  EXPECT_FALSE(cache.get(m_ref, MethodSearch::Virtual, cached));
+
+  // all the threads resolve the same refs, and race to fill the cache
+  std::atomic<size_t> wrong{0};
+  std::vector<std::thread> threads;
+  for (size_t t = 0; t < 8; ++t) {
+    threads.emplace_back([&] {
+      for (size_t i = 0; i < 1000; ++i) {
+        if (resolve_method_cached(m_ref, MethodSearch::Virtual) != m_def) {
+          ++wrong;
+        }
+        if (resolve_method_cached(m_ref, MethodSearch::Direct) != nullptr) {
+          ++wrong;
+        }
+        if (resolve_method_cached(missing_ref, MethodSearch::Virtual) !=
+            nullptr) {
+          ++wrong;
+        }
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(wrong, 0);
+
+  // the resolution is cached per search, and failed resolutions are not
+  EXPECT_TRUE(cache.get(m_ref, MethodSearch::Virtual, cached));
+  EXPECT_EQ(cached, m_def);
+  EXPECT_FALSE(cache.get(m_ref, MethodSearch::Direct, cached));
+  EXPECT_FALSE(cache.get(missing_ref, MethodSearch::Virtual, cached));
+
+  // removing the definition must not leave a stale resolution behind
+  type_class(b)->remove_method(m_def);
+  EXPECT_FALSE(cache.get(m_ref, MethodSearch::Virtual, cached));
+  EXPECT_EQ(resolve_method_cached(m_ref, MethodSearch::Virtual), nullptr);
+  type_class(b)->add_method(m_def);
+  EXPECT_EQ(resolve_method_cached(m_ref, MethodSearch::Virtual), m_def);
+
+  delete g_redex;
+}
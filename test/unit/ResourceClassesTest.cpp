@@ -0,0 +1,66 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree. An additional grant
+ * of patent rights can be found in the PATENTS file in the same directory.
+ */
+
+#include <cstdlib>
+#include <string>
+#include <gtest/gtest.h>
+
+#include "RedexResources.h"
+
+using StringSet = std::unordered_set<std::string>;
+
+namespace {
+
+/*
+ * An unpacked apk with a binary AndroidManifest.xml (UTF-16 string pool) and
+ * two binary layouts (UTF-8 string pools), checked in next to this file.
+ */
+std::string apk_dir() {
+  auto dir = std::getenv("resources_apk_dir");
+  if (dir != nullptr) {
+    return dir;
+  }
+  std::string file(__FILE__);
+  return file.substr(0, file.rfind('/') + 1) + "resources/apk";
+}
+
+}
+
+TEST(ResourceClassesTest, manifest) {
+  auto classes = get_manifest_classes(apk_dir() + "/AndroidManifest.xml");
+  // the meta-data name is not a component
+  EXPECT_EQ(classes,
+            StringSet({"Lcom/example/App;",
+                       "Lcom/example/MainActivity;",
+                       "Lcom/example/Alias;",
+                       "Lcom/example/Provider;",
+                       "Lcom/example/auth1;",
+                       "Lcom/example/auth2;"}));
+}
+
+TEST(ResourceClassesTest, layouts) {
+  // custom view tags, fragment names and view classes, from all the layout
+  // directories; attribute values of other elements are not class names
+  auto classes = get_layout_classes(apk_dir());
+  EXPECT_EQ(classes,
+            StringSet({"Lcom/example/CustomView;",
+                       "Lcom/example/MyFragment;",
+                       "Lcom/example/ViewByClass;",
+                       "Lcom/example/LandView;"}));
+}
+
+TEST(ResourceClassesTest, missingFiles) {
+  EXPECT_TRUE(get_manifest_classes(apk_dir() + "/NoManifest.xml").empty());
+  EXPECT_TRUE(get_layout_classes(apk_dir() + "/res").empty());
+
+  auto classes = get_resource_classes(apk_dir());
+  EXPECT_EQ(classes.manifest.size(), 6);
+  EXPECT_EQ(classes.layout.size(), 4);
+  EXPECT_TRUE(classes.native.empty());
+}
@@ -0,0 +1,163 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree. An additional grant
+ * of patent rights can be found in the PATENTS file in the same directory.
+ */
+
+#include <string>
+#include <vector>
+#include <gtest/gtest.h>
+
+#include "androidfw/ResourceTypes.h"
+
+#include "ResourceViews.h"
+
+namespace {
+
+void put16(std::string* out, uint16_t v) {
+  out->push_back(v & 0xff);
+  out->push_back(v >> 8);
+}
+
+void put32(std::string* out, uint32_t v) {
+  put16(out, v & 0xffff);
+  put16(out, v >> 16);
+}
+
+/*
+ * A ResStringPool chunk holding the given string data, as laid out by aapt.
+ */
+std::string pool_chunk(const std::vector<std::string>& entries, bool utf8) {
+  std::string data;
+  std::vector<uint32_t> offsets;
+  for (const auto& entry : entries) {
+    offsets.push_back(data.size());
+    data += entry;
+  }
+  while (data.size() % 4) {
+    data.push_back(0);
+  }
+  const uint32_t header_size = 28;
+  uint32_t strings_start = header_size + 4 * entries.size();
+  std::string chunk;
+  put16(&chunk, android::RES_STRING_POOL_TYPE);
+  put16(&chunk, header_size);
+  put32(&chunk, strings_start + data.size());
+  put32(&chunk, entries.size());
+  put32(&chunk, 0);
+  put32(&chunk, utf8 ? android::ResStringPool_header::UTF8_FLAG : 0);
+  put32(&chunk, strings_start);
+  put32(&chunk, 0);
+  for (auto offset : offsets) {
+    put32(&chunk, offset);
+  }
+  return chunk + data;
+}
+
+// lengths of 0x80 and more take two bytes
+void put_utf8_length(std::string* out, size_t len) {
+  if (len > 0x7f) {
+    out->push_back(0x80 | (len >> 8));
+  }
+  out->push_back(len & 0xff);
+}
+
+std::string utf8_entry(const std::string& str, size_t utf16_len) {
+  std::string entry;
+  put_utf8_length(&entry, utf16_len);
+  put_utf8_length(&entry, str.size());
+  return entry + str + std::string(1, '\0');
+}
+
+// lengths of 0x8000 and more take two units
+std::string utf16_entry(const std::u16string& str) {
+  std::string entry;
+  if (str.size() > 0x7fff) {
+    put16(&entry, 0x8000 | (str.size() >> 16));
+  }
+  put16(&entry, str.size() & 0xffff);
+  for (auto c : str) {
+    put16(&entry, c);
+  }
+  put16(&entry, 0);
+  return entry;
+}
+
+}
+
+TEST(ResourceViewsTest, utf8View) {
+  Utf8View none;
+  EXPECT_EQ(none.data(), nullptr);
+  EXPECT_FALSE(none == "");
+  EXPECT_FALSE(none.contains('.'));
+
+  const char* str = "com.Foo";
+  Utf8View view(str, 7);
+  EXPECT_TRUE(view == "com.Foo");
+  EXPECT_TRUE(view != "com.Fo");
+  EXPECT_TRUE(view.contains('.'));
+  EXPECT_FALSE(view.contains('/'));
+  EXPECT_EQ(view.str(), "com.Foo");
+
+  Utf8View empty(str, 0);
+  EXPECT_TRUE(empty == "");
+  EXPECT_TRUE(empty.empty());
+}
+
+TEST(ResourceViewsTest, utf8Pool) {
+  std::string long_str(300, 'x');
+  // "é" is one UTF-16 unit and two UTF-8 bytes
+  auto chunk = pool_chunk({utf8_entry("", 0),
+                           utf8_entry("view", 4),
+                           utf8_entry("caf\xc3\xa9", 4),
+                           utf8_entry(long_str, long_str.size())},
+                          true);
+  android::ResStringPool pool;
+  ASSERT_EQ(pool.setTo(chunk.data(), chunk.size()), android::NO_ERROR);
+  ASSERT_TRUE(pool.isUTF8());
+
+  StringPoolView strings(pool);
+  ASSERT_EQ(strings.size(), 4);
+  EXPECT_NE(strings.at(0).data(), nullptr);
+  EXPECT_TRUE(strings.at(0).empty());
+  EXPECT_TRUE(strings.at(1) == "view");
+  EXPECT_EQ(strings.at(2).size(), 5);
+  EXPECT_TRUE(strings.at(2) == "caf\xc3\xa9");
+  EXPECT_EQ(strings.at(3).str(), long_str);
+  // the strings are not copied
+  EXPECT_GE(strings.at(1).data(), chunk.data());
+  EXPECT_LT(strings.at(1).data(), chunk.data() + chunk.size());
+
+  EXPECT_EQ(strings.at(-1).data(), nullptr);
+  EXPECT_EQ(strings.at(4).data(), nullptr);
+}
+
+TEST(ResourceViewsTest, utf16Pool) {
+  std::u16string long_str(0x9000, u'y');
+  auto chunk = pool_chunk({utf16_entry(u""),
+                           utf16_entry(u"fragment"),
+                           utf16_entry(u"café"),
+                           utf16_entry(long_str)},
+                          false);
+  android::ResStringPool pool;
+  ASSERT_EQ(pool.setTo(chunk.data(), chunk.size()), android::NO_ERROR);
+  ASSERT_FALSE(pool.isUTF8());
+
+  StringPoolView strings(pool);
+  ASSERT_EQ(strings.size(), 4);
+  EXPECT_NE(strings.at(0).data(), nullptr);
+  EXPECT_TRUE(strings.at(0).empty());
+  EXPECT_TRUE(strings.at(1) == "fragment");
+  EXPECT_TRUE(strings.at(2) == "caf\xc3\xa9");
+  EXPECT_EQ(strings.at(3).str(), std::string(0x9000, 'y'));
+
+  // converted once, then served from the cache of the view
+  auto first = strings.at(1).data();
+  EXPECT_EQ(strings.at(1).data(), first);
+
+  EXPECT_EQ(strings.at(-1).data(), nullptr);
+  EXPECT_EQ(strings.at(4).data(), nullptr);
+}
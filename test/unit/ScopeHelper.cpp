@@ -245,3 +245,23 @@ DexMethod* create_empty_method(
   cls->add_method(method);
   return method;
 }
+
+DexMethod* create_static_method(
+    DexClass* cls,
+    const char* name,
+    DexProto* proto,
+    uint16_t nregs,
+    DexAccessFlags access /*= ACC_PUBLIC*/) {
+  auto method = DexMethod::make_method(
+      cls->get_type(), DexString::make_string(name), proto);
+  method->make_concrete(access | ACC_STATIC, false);
+  auto code = method->get_code();
+  code->set_registers_size(nregs);
+  uint16_t ins_size = 0;
+  for (auto arg : proto->get_args()->get_type_list()) {
+    ins_size += is_wide_type(arg) ? 2 : 1;
+  }
+  code->set_ins_size(ins_size);
+  cls->add_method(method);
+  return method;
+}
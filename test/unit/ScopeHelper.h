@@ -58,3 +58,15 @@ DexMethod* create_empty_method(
     const char* name,
     DexProto* proto,
     DexAccessFlags access = ACC_PUBLIC);
+
+/**
+ * Add a static method to the given class, with empty code of `nregs`
+ * registers for the test to fill in. The parameters are in the last
+ * registers.
+ */
+DexMethod* create_static_method(
+    DexClass* cls,
+    const char* name,
+    DexProto* proto,
+    uint16_t nregs,
+    DexAccessFlags access = ACC_PUBLIC);
@@ -9,8 +9,11 @@
 
 #include <gtest/gtest.h>
 
+#include "CallGraph.h"
 #include "DexAsm.h"
 #include "DexUtil.h"
+#include "InlineHelper.h"
+#include "ScopeHelper.h"
 #include "Transform.h"
 
 TEST(SimpleInlineTest, hasAliasedArgs) {
@@ -47,3 +50,80 @@ TEST(SimpleInlineTest, hasAliasedArgs) {
       inline_context, callee, invoke, /* no_exceed_16regs */ true));
   delete g_redex;
 }
+
+namespace {
+
+size_t count_invokes(DexMethod* method) {
+  size_t invokes = 0;
+  for (auto& mie : InstructionIterable(method->get_code())) {
+    if (is_invoke(mie.insn->opcode())) {
+      invokes++;
+    }
+  }
+  return invokes;
+}
+
+}
+
+TEST(SimpleInlineTest, inlinesBottomUpByLevel) {
+  g_redex = new RedexContext();
+  using namespace dex_asm;
+  auto scope = create_empty_scope();
+  auto cls = create_internal_class(
+      DexType::make_type("LFoo;"), get_object_type(), {});
+  scope.push_back(cls);
+  // top -> mid -> leaf, and rec1 <-> rec2
+  auto proto = DexProto::make_proto(get_void_type(),
+                                    DexTypeList::make_type_list({}));
+  auto leaf = create_static_method(cls, "leaf", proto, 0);
+  auto mid = create_static_method(cls, "mid", proto, 0);
+  auto top = create_static_method(cls, "top", proto, 0);
+  auto rec1 = create_static_method(cls, "rec1", proto, 0);
+  auto rec2 = create_static_method(cls, "rec2", proto, 0);
+  mid->get_code()->push_back(dasm(OPCODE_INVOKE_STATIC, leaf, {}));
+  top->get_code()->push_back(dasm(OPCODE_INVOKE_STATIC, mid, {}));
+  top->get_code()->push_back(dasm(OPCODE_INVOKE_STATIC, mid, {}));
+  top->get_code()->push_back(dasm(OPCODE_INVOKE_STATIC, rec1, {}));
+  rec1->get_code()->push_back(dasm(OPCODE_INVOKE_STATIC, rec2, {}));
+  rec2->get_code()->push_back(dasm(OPCODE_INVOKE_STATIC, rec1, {}));
+  for (auto m : {leaf, mid, top, rec1, rec2}) {
+    m->get_code()->push_back(dasm(OPCODE_RETURN_VOID));
+  }
+
+  CallGraph call_graph(scope);
+  CodeSummaries summaries(scope);
+  MultiMethodInliner::Config config;
+  config.callee_direct_invoke_inline = false;
+  config.virtual_same_class_inline = false;
+  config.super_same_class_inline = false;
+  config.use_liveness = false;
+  config.no_exceed_16regs = false;
+  MultiMethodInliner inliner(
+      scope,
+      DexClasses(),
+      {leaf, mid, rec1, rec2},
+      call_graph,
+      summaries,
+      [](DexMethod* method, MethodSearch search) {
+        return resolve_method(method, search);
+      },
+      config);
+  inliner.inline_methods();
+
+  // leaf into mid, then the resulting mid twice into top, then rec1 into top
+  // once rec1 is final. The calls between rec1 and rec2 are left alone.
+  EXPECT_EQ(inliner.get_info().calls_inlined, 4);
+  EXPECT_EQ(inliner.get_info().recursive, 2);
+  EXPECT_EQ(inliner.get_inlined(),
+            std::unordered_set<DexMethod*>({leaf, mid, rec1}));
+  EXPECT_EQ(count_invokes(mid), 0);
+  EXPECT_EQ(count_invokes(rec1), 1);
+  // what is left in top is the call to rec2 that came with rec1
+  EXPECT_EQ(count_invokes(top), 1);
+  EXPECT_EQ(call_graph.num_callsites_of(mid), 0);
+  EXPECT_EQ(call_graph.num_callsites_of(leaf), 0);
+  EXPECT_EQ(call_graph.num_callsites_of(rec2), 2);
+  EXPECT_EQ(summaries.get(top).insn_count, top->get_code()->count_opcodes());
+  EXPECT_EQ(summaries.get(mid).insn_count, mid->get_code()->count_opcodes());
+  delete g_redex;
+}
@@ -0,0 +1,97 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree. An additional grant
+ * of patent rights can be found in the PATENTS file in the same directory.
+ */
+
+#include <gtest/gtest.h>
+
+#include <fstream>
+#include <json/json.h>
+#include <set>
+#include <vector>
+
+#include "Timer.h"
+#include "TraceEvents.h"
+#include "WorkQueue.h"
+
+namespace {
+
+void noop(void*) {}
+
+}
+
+TEST(TraceEventsTest, writesChromeTraceJson) {
+  std::string path = ::testing::TempDir() + "trace_events_test.json";
+  trace_events::init(path);
+  ASSERT_TRUE(trace_events::enabled());
+
+  trace_events::set_thread_name("test \"main\"");
+  {
+    Timer t("outer");
+    std::vector<work_item> items(16, work_item{noop, nullptr});
+    WorkQueue wq;
+    wq.run_work_items(items.data(), (int)items.size());
+  }
+  trace_events::write();
+
+  Json::Value root;
+  std::ifstream in(path);
+  Json::Reader reader;
+  ASSERT_TRUE(reader.parse(in, root));
+  size_t work_items = 0;
+  std::set<int> work_item_tids;
+  int main_tid = -1;
+  bool saw_outer = false;
+  for (const auto& event : root["traceEvents"]) {
+    auto name = event["name"].asString();
+    if (event["ph"].asString() == "M") {
+      if (event["args"]["name"].asString() == "test \"main\"") {
+        main_tid = event["tid"].asInt();
+      }
+      continue;
+    }
+    EXPECT_EQ(event["ph"].asString(), "X");
+    EXPECT_GE(event["dur"].asDouble(), 0);
+    if (name == "work item") {
+      ++work_items;
+      work_item_tids.insert(event["tid"].asInt());
+    } else if (name == "outer") {
+      saw_outer = true;
+      EXPECT_EQ(event["cat"].asString(), "Timer");
+      EXPECT_EQ(event["tid"].asInt(), main_tid);
+    }
+  }
+  EXPECT_TRUE(saw_outer);
+  EXPECT_EQ(work_items, 16);
+  EXPECT_EQ(work_item_tids.count(main_tid), 0);
+  trace_events::init("");
+}
+
+TEST(TraceEventsTest, initDropsEarlierEvents) {
+  std::string path = ::testing::TempDir() + "trace_events_init_test.json";
+  trace_events::init(path);
+  { Timer t("before"); }
+  trace_events::init("");
+  EXPECT_FALSE(trace_events::enabled());
+  { Timer t("disabled"); }
+  trace_events::init(path);
+  { Timer t("after"); }
+  trace_events::write();
+  trace_events::init("");
+
+  Json::Value root;
+  std::ifstream in(path);
+  Json::Reader reader;
+  ASSERT_TRUE(reader.parse(in, root));
+  std::vector<std::string> names;
+  for (const auto& event : root["traceEvents"]) {
+    if (event["ph"].asString() == "X") {
+      names.push_back(event["name"].asString());
+    }
+  }
+  EXPECT_EQ(names, std::vector<std::string>{"after"});
+}
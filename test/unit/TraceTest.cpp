@@ -0,0 +1,149 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree. An additional grant
+ * of patent rights can be found in the PATENTS file in the same directory.
+ */
+
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Trace.h"
+
+namespace {
+
+template <typename... Args>
+std::string printf_string(const char* fmt, Args... args) {
+  char buf[8192];
+  snprintf(buf, sizeof(buf), fmt, args...);
+  return buf;
+}
+
+enum Color { RED, GREEN };
+
+/*
+ * Buffers the messages of two modules into a temporary file for the duration
+ * of a test.
+ */
+class BufferedTraceTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    m_file = tmpfile();
+    ASSERT_NE(m_file, nullptr);
+    for (auto module : {CFG, DCE}) {
+      m_levels.push_back(g_trace_levels[module]);
+      g_trace_levels[module] = 1;
+    }
+    trace_detail::set_buffering(64 * 1024, m_file);
+  }
+
+  void TearDown() override {
+    trace_detail::set_buffering(0, nullptr);
+    g_trace_levels[CFG] = m_levels[0];
+    g_trace_levels[DCE] = m_levels[1];
+    fclose(m_file);
+  }
+
+  std::vector<std::string> dumped_lines() {
+    dump_trace_buffers();
+    rewind(m_file);
+    std::vector<std::string> lines;
+    std::string line;
+    int c;
+    while ((c = fgetc(m_file)) != EOF) {
+      if (c == '\n') {
+        lines.push_back(line);
+        line.clear();
+      } else {
+        line.push_back(c);
+      }
+    }
+    return lines;
+  }
+
+  FILE* m_file;
+  std::vector<int> m_levels;
+};
+
+}
+
+#define EXPECT_FORMATS_LIKE_PRINTF(fmt, ...)        \
+  EXPECT_EQ(trace_detail::format(fmt, __VA_ARGS__), \
+            printf_string(fmt, __VA_ARGS__))
+
+TEST(TraceTest, formatsLikePrintf) {
+  EXPECT_EQ(trace_detail::format("no args %%\n"), "no args %\n");
+  EXPECT_FORMATS_LIKE_PRINTF("%d %i %u", -1, 42, 7u);
+  EXPECT_FORMATS_LIKE_PRINTF("%u %x %X %o", -1, 255, 255, 8);
+  EXPECT_FORMATS_LIKE_PRINTF("%ld %lu %lld %zu", -1L, (size_t)-1, -5LL,
+                             (size_t)12);
+  EXPECT_FORMATS_LIKE_PRINTF("%hu %hhd %c", 70000, 300, 'x');
+  EXPECT_FORMATS_LIKE_PRINTF("%5d|%-5d|%05d|%+d", 1, 2, 3, 4);
+  EXPECT_FORMATS_LIKE_PRINTF("%.1lf %e %g %.3f", 1.25, 1e10, 0.5, 2.0f);
+  EXPECT_FORMATS_LIKE_PRINTF("%s %10s %-4s|", "a", "right", "l");
+  EXPECT_FORMATS_LIKE_PRINTF("%*s%s", 8, "", "indented");
+  EXPECT_FORMATS_LIKE_PRINTF("%.*s", 3, "truncated");
+  EXPECT_FORMATS_LIKE_PRINTF("%d %d", RED, GREEN);
+  EXPECT_FORMATS_LIKE_PRINTF("%d %s", true, (const char*)nullptr);
+
+  int x;
+  EXPECT_FORMATS_LIKE_PRINTF("%p", &x);
+
+  std::string long_string(5000, 'y');
+  EXPECT_FORMATS_LIKE_PRINTF("%s!", long_string.c_str());
+}
+
+TEST(TraceTest, mismatchedArguments) {
+  EXPECT_EQ(trace_detail::format("%d %s", "str"), "<?> <?>");
+  EXPECT_EQ(trace_detail::format("%f", 1), "<?>");
+}
+
+TEST_F(BufferedTraceTest, dumpsAllThreadsOldestFirst) {
+  std::string arg("copied");
+  TRACE(CFG, 1, "one %d %s\n", 1, arg.c_str());
+  arg = "changed";
+  std::thread([] { TRACE(DCE, 1, "two %.1f\n", 2.0); }).join();
+  TRACE(DCE, 1, "three %p\n", nullptr);
+  TRACE(DCE, 2, "above the level\n");
+  TRACE(CFG, 1, "four %s\n", std::string(3000, 'x').c_str());
+
+  auto lines = dumped_lines();
+  ASSERT_EQ(lines.size(), 4);
+  EXPECT_EQ(lines[0], "one 1 copied");
+  EXPECT_EQ(lines[1], "two 2.0");
+  EXPECT_EQ(lines[2], printf_string("three %p", nullptr));
+  // long strings are truncated
+  EXPECT_EQ(lines[3], "four " + std::string(2048, 'x'));
+
+  // the buffers are dumped once only
+  TRACE(CFG, 1, "late\n");
+  EXPECT_EQ(dumped_lines().size(), 4);
+}
+
+TEST_F(BufferedTraceTest, evictsOldestRecords) {
+  // Several times the size of the buffer, wrapping around with records of
+  // varying sizes.
+  const int kRecords = 20000;
+  for (int i = 0; i < kRecords; ++i) {
+    TRACE(CFG, 1, "%d %s\n", i, std::string(i % 37, 'y').c_str());
+  }
+  TRACE(DCE, 1, "other module\n");
+
+  auto lines = dumped_lines();
+  ASSERT_GT(lines.size(), 100);
+  ASSERT_LT(lines.size(), kRecords);
+  EXPECT_EQ(lines.back(), "other module");
+  lines.pop_back();
+  // the newest records are kept, in order
+  int first = kRecords - lines.size();
+  for (size_t i = 0; i < lines.size(); ++i) {
+    int n = first + i;
+    EXPECT_EQ(lines[i], std::to_string(n) + " " + std::string(n % 37, 'y'));
+  }
+}
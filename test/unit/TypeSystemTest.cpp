@@ -0,0 +1,93 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree. An additional grant
+ * of patent rights can be found in the PATENTS file in the same directory.
+ */
+
+#include <gtest/gtest.h>
+
+#include "DexUtil.h"
+#include "RedexContext.h"
+#include "ScopeHelper.h"
+#include "TypeSystem.h"
+
+namespace {
+
+// Object
+//   External implements Ext
+//     A implements I1, I2
+//       B implements I3
+//   C extends Missing
+//   I1, I2 (I2 extends I1), Ext
+//   I3 extends I4
+//
+// I4 and Missing have no class.
+struct TypeSystemTest : testing::Test {
+  TypeSystemTest() {
+    g_redex = new RedexContext();
+    scope = create_empty_scope();
+    auto obj = get_object_type();
+    types.push_back(obj);
+    auto i1 = make("LI1;");
+    auto i2 = make("LI2;");
+    auto i3 = make("LI3;");
+    auto i4 = make("LI4;");
+    auto ext = make("LExt;");
+    auto external = make("LExternal;");
+    auto a = make("LA;");
+    auto b = make("LB;");
+    auto c = make("LC;");
+    auto missing = make("LMissing;");
+    auto intf = DexAccessFlags(ACC_PUBLIC | ACC_INTERFACE | ACC_ABSTRACT);
+    scope.push_back(create_internal_class(i1, obj, {}, intf));
+    scope.push_back(create_internal_class(i2, obj, {i1}, intf));
+    scope.push_back(create_internal_class(i3, obj, {i4}, intf));
+    create_external_class(ext, obj, {}, intf);
+    create_external_class(external, obj, {ext});
+    scope.push_back(create_internal_class(a, external, {i1, i2}));
+    scope.push_back(create_internal_class(b, a, {i3}));
+    scope.push_back(create_internal_class(c, missing, {}));
+  }
+
+  ~TypeSystemTest() { delete g_redex; }
+
+  DexType* make(const char* name) {
+    auto type = DexType::make_type(name);
+    types.push_back(type);
+    return type;
+  }
+
+  Scope scope;
+  std::vector<DexType*> types;
+};
+
+}
+
+TEST_F(TypeSystemTest, matchesCheckCast) {
+  TypeSystem ts(scope);
+  for (auto from : types) {
+    for (auto to : types) {
+      EXPECT_EQ(ts.is_assignable_to(from, to), check_cast(from, to))
+          << show(from) << " -> " << show(to);
+    }
+  }
+}
+
+TEST_F(TypeSystemTest, queries) {
+  TypeSystem ts(scope);
+  auto type = [](const char* name) { return DexType::get_type(name); };
+  EXPECT_TRUE(ts.is_subclass(get_object_type(), type("LB;")));
+  EXPECT_TRUE(ts.is_subclass(type("LExternal;"), type("LB;")));
+  EXPECT_FALSE(ts.is_subclass(type("LB;"), type("LA;")));
+  EXPECT_FALSE(ts.is_subclass(type("LI1;"), type("LA;")));
+  EXPECT_TRUE(ts.implements(type("LB;"), type("LI1;")));
+  EXPECT_TRUE(ts.implements(type("LB;"), type("LExt;")));
+  EXPECT_TRUE(ts.implements(type("LB;"), type("LI4;")));
+  EXPECT_FALSE(ts.implements(type("LA;"), type("LI3;")));
+  EXPECT_FALSE(ts.implements(type("LC;"), type("LI1;")));
+  EXPECT_TRUE(ts.is_assignable_to(type("LC;"), type("LMissing;")));
+  EXPECT_FALSE(ts.is_assignable_to(type("LC;"), get_object_type()));
+}
@@ -0,0 +1,170 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree. An additional grant
+ * of patent rights can be found in the PATENTS file in the same directory.
+ */
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+
+#include "DexAsm.h"
+#include "DexUtil.h"
+#include "Match.h"
+#include "ScopeHelper.h"
+#include "Transform.h"
+#include "Walkers.h"
+
+using namespace dex_asm;
+
+class WalkersTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    g_redex = new RedexContext();
+    scope = create_empty_scope();
+    cls = create_internal_class(
+        DexType::make_type("LFoo;"), get_object_type(), {});
+    scope.push_back(cls);
+  }
+
+  void TearDown() override { delete g_redex; }
+
+  DexMethod* make_method(const char* name) {
+    auto proto = DexProto::make_proto(get_void_type(),
+                                      DexTypeList::make_type_list({}));
+    return create_static_method(cls, name, proto, 2);
+  }
+
+  Scope scope;
+  DexClass* cls;
+};
+
+TEST_F(WalkersTest, overlappingMatches) {
+  auto method = make_method("consts");
+  auto code = method->get_code();
+  std::vector<IRInstruction*> consts;
+  for (int i = 0; i < 4; ++i) {
+    consts.push_back(dasm(OPCODE_CONST_4, {0_v, 1_L}));
+    code->push_back(consts.back());
+  }
+  code->push_back(dasm(OPCODE_RETURN_VOID));
+
+  auto match = std::make_tuple(m::is_opcode(OPCODE_CONST_4),
+                               m::is_opcode(OPCODE_CONST_4));
+  std::vector<std::pair<IRInstruction*, IRInstruction*>> matches;
+  walk_matching_opcodes(
+      scope, match, [&](const DexMethod*, size_t n, IRInstruction** insns) {
+        EXPECT_EQ(n, 2);
+        matches.emplace_back(insns[0], insns[1]);
+      });
+  ASSERT_EQ(matches.size(), 3);
+  for (size_t i = 0; i < matches.size(); ++i) {
+    EXPECT_EQ(matches[i].first, consts[i]);
+    EXPECT_EQ(matches[i].second, consts[i + 1]);
+  }
+
+  EXPECT_TRUE(m::has_opcodes(match).matches(method));
+  auto no_match =
+      std::make_tuple(m::return_void(), m::is_opcode(OPCODE_CONST_4));
+  EXPECT_FALSE(m::has_opcodes(no_match).matches(method));
+}
+
+TEST_F(WalkersTest, rewritesInCallback) {
+  auto method = make_method("rewrites");
+  auto code = method->get_code();
+  for (int i = 0; i < 4; ++i) {
+    code->push_back(dasm(OPCODE_CONST_4, {0_v, 1_L}));
+  }
+  code->push_back(dasm(OPCODE_RETURN_VOID));
+
+  // Replace the second const of every match, which deletes it. The next
+  // match starts with the replacement.
+  auto match = std::make_tuple(m::is_opcode(OPCODE_CONST_4),
+                               m::is_opcode(OPCODE_CONST_4));
+  std::vector<IRInstruction*> firsts;
+  std::vector<IRInstruction*> replacements;
+  walk_matching_opcodes(
+      scope, match, [&](const DexMethod*, size_t, IRInstruction** insns) {
+        firsts.push_back(insns[0]);
+        auto replacement = dasm(OPCODE_CONST_4, {1_v, 0_L});
+        code->replace_opcode(insns[1], replacement);
+        replacements.push_back(replacement);
+      });
+  ASSERT_EQ(replacements.size(), 3);
+  EXPECT_EQ(firsts[1], replacements[0]);
+  EXPECT_EQ(firsts[2], replacements[1]);
+
+  std::vector<IRInstruction*> insns;
+  for (auto& mie : InstructionIterable(code)) {
+    insns.push_back(mie.insn);
+  }
+  ASSERT_EQ(insns.size(), 5);
+  EXPECT_EQ(std::vector<IRInstruction*>(insns.begin() + 1, insns.end() - 1),
+            replacements);
+}
+
+TEST_F(WalkersTest, removesInCallback) {
+  auto method = make_method("removes");
+  auto code = method->get_code();
+  std::vector<IRInstruction*> consts;
+  for (int i = 0; i < 4; ++i) {
+    consts.push_back(dasm(OPCODE_CONST_4, {0_v, 1_L}));
+    code->push_back(consts.back());
+  }
+  code->push_back(dasm(OPCODE_RETURN_VOID));
+
+  // Remove the second const of every match. The next match pairs the first
+  // one with the const after the removed one.
+  auto match = std::make_tuple(m::is_opcode(OPCODE_CONST_4),
+                               m::is_opcode(OPCODE_CONST_4));
+  std::vector<std::pair<IRInstruction*, IRInstruction*>> matches;
+  walk_matching_opcodes(
+      scope, match, [&](const DexMethod*, size_t, IRInstruction** insns) {
+        matches.emplace_back(insns[0], insns[1]);
+        code->remove_opcode(insns[1]);
+      });
+  ASSERT_EQ(matches.size(), 3);
+  for (size_t i = 0; i < matches.size(); ++i) {
+    EXPECT_EQ(matches[i].first, consts[0]);
+    EXPECT_EQ(matches[i].second, consts[i + 1]);
+  }
+  EXPECT_EQ(code->count_opcodes(), 2);
+}
+
+TEST_F(WalkersTest, matchesStayInBlocks) {
+  auto method = make_method("blocks");
+  auto code = method->get_code();
+  code->push_back(dasm(OPCODE_CONST_4, {0_v, 1_L}));
+  auto if_mie = new MethodItemEntry(dasm(OPCODE_IF_EQZ, {0_v}));
+  code->push_back(*if_mie);
+  code->push_back(dasm(OPCODE_CONST_4, {0_v, 1_L}));
+  code->push_back(dasm(OPCODE_CONST_4, {1_v, 1_L}));
+  auto target = new BranchTarget();
+  target->type = BRANCH_SIMPLE;
+  target->src = if_mie;
+  code->push_back(target);
+  code->push_back(dasm(OPCODE_CONST_4, {1_v, 1_L}));
+  code->push_back(dasm(OPCODE_RETURN_VOID));
+
+  // the last two consts are in different blocks
+  auto match = std::make_tuple(m::is_opcode(OPCODE_CONST_4),
+                               m::is_opcode(OPCODE_CONST_4));
+  std::atomic<size_t> in_blocks{0};
+  walk_matching_opcodes_in_block_parallel(
+      scope,
+      match,
+      [&](const DexMethod*, IRCode*, Block*, size_t, IRInstruction**) {
+        in_blocks++;
+      });
+  EXPECT_EQ(in_blocks, 1);
+
+  size_t in_method = 0;
+  walk_matching_opcodes(
+      scope, match, [&](const DexMethod*, size_t, IRInstruction**) {
+        in_method++;
+      });
+  EXPECT_EQ(in_method, 2);
+}
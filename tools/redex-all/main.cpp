@@ -37,6 +37,7 @@
 #include "ReachableClasses.h"
 #include "RedexContext.h"
 #include "Timer.h"
+#include "TraceEvents.h"
 #include "Warning.h"
 
 static void usage() {
@@ -284,6 +285,16 @@ Json::Value get_stats(const dex_output_stats_t& stats) {
   return val;
 }
 
+Json::Value get_profile(const PhaseProfile& profile) {
+  Json::Value val;
+  val["wall_secs"] = profile.wall_secs;
+  val["cpu_secs"] = profile.cpu_secs;
+  val["rss_delta_kb"] = Json::Int64(profile.rss_delta_kb);
+  val["peak_rss_kb"] = Json::Int64(profile.peak_rss_kb);
+  val["ir_allocations"] = Json::UInt64(profile.ir_allocations);
+  return val;
+}
+
 Json::Value get_pass_stats(const PassManager& mgr) {
   Json::Value all(Json::ValueType::objectValue);
   for (auto pass_metrics : mgr.get_metrics()) {
@@ -294,11 +305,35 @@ Json::Value get_pass_stats(const PassManager& mgr) {
     for (auto pass_metric : pass_metrics.metrics) {
       pass[pass_metric.first] = pass_metric.second;
     }
+    pass["profile"]["eval"] = get_profile(pass_metrics.eval_profile);
+    pass["profile"]["run"] = get_profile(pass_metrics.run_profile);
+    for (size_t c = 0; c < memory_accounting::NUM_CATEGORIES; ++c) {
+      const auto& usage = pass_metrics.memory[c];
+      Json::Value memory;
+      memory["live_bytes"] = Json::Int64(usage.live_bytes);
+      memory["live_objects"] = Json::Int64(usage.live_objects);
+      memory["allocations"] = Json::UInt64(usage.allocations);
+      pass["memory"][memory_accounting::category_name(
+          static_cast<memory_accounting::Category>(c))] = memory;
+    }
     all[pass_metrics.name] = pass;
   }
   return all;
 }
 
+Json::Value get_analysis_stats(const PassManager& mgr) {
+  Json::Value all(Json::ValueType::objectValue);
+  for (const auto& it : mgr.get_analysis_manager().get_stats()) {
+    Json::Value analysis;
+    analysis["builds"] = Json::UInt64(it.second.builds);
+    analysis["hits"] = Json::UInt64(it.second.hits);
+    analysis["invalidations"] = Json::UInt64(it.second.invalidations);
+    analysis["build_secs"] = it.second.build_secs;
+    all[it.first] = analysis;
+  }
+  return all;
+}
+
 Json::Value get_detailed_stats(
     const std::vector<dex_output_stats_t>& dexes_stats) {
   Json::Value dexes;
@@ -317,12 +352,36 @@ void output_stats(const char* path,
   d["total_stats"] = get_stats(stats);
   d["dexes_stats"] = get_detailed_stats(dexes_stats);
   d["pass_stats"] = get_pass_stats(mgr);
+  d["analysis_stats"] = get_analysis_stats(mgr);
   Json::StyledStreamWriter writer;
   std::ofstream out(path);
   writer.write(out, d);
   out.close();
 }
 
+void output_method_costs(const char* path, const PassManager& mgr) {
+  if (!strcmp(path, "")) {
+    return;
+  }
+  Json::Value all(Json::ValueType::objectValue);
+  for (const auto& pass_metrics : mgr.get_metrics()) {
+    Json::Value methods(Json::ValueType::arrayValue);
+    for (const auto& cost : pass_metrics.slowest_methods) {
+      Json::Value method;
+      method["method"] = cost.method;
+      method["secs"] = cost.secs;
+      method["visits"] = Json::UInt64(cost.visits);
+      method["instructions"] = Json::UInt64(cost.instructions);
+      method["blocks"] = Json::UInt64(cost.blocks);
+      methods.append(method);
+    }
+    all[pass_metrics.name] = methods;
+  }
+  Json::StyledStreamWriter writer;
+  std::ofstream out(path);
+  writer.write(out, all);
+}
+
 void output_moved_methods_map(const char* path, ConfigFiles& cfg) {
   // print out moved methods map
   if (cfg.save_move_map() && strcmp(path, "")) {
@@ -363,6 +422,7 @@ int main(int argc, char* argv[]) {
   signal(SIGABRT, crash_backtrace_handler);
   signal(SIGBUS, crash_backtrace_handler);
 
+  trace_events::set_thread_name("main");
   Timer t("redex-all main()");
 
   g_redex = new RedexContext();
@@ -540,8 +600,11 @@ int main(int argc, char* argv[]) {
         cfg.metafile(args.config.get("stats_output", "").asString());
     auto method_move_map =
         cfg.metafile(args.config.get("method_move_map", "").asString());
+    auto method_costs_output =
+        cfg.metafile(args.config.get("method_costs_output", "").asString());
     pos_mapper->write_map();
     output_stats(stats_output.c_str(), totals, dexes_stats, manager);
+    output_method_costs(method_costs_output.c_str(), manager);
     output_moved_methods_map(method_move_map.c_str(), cfg);
     print_warning_summary();
   }
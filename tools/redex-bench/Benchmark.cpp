@@ -0,0 +1,227 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree. An additional grant
+ * of patent rights can be found in the PATENTS file in the same directory.
+ */
+
+#include "Benchmark.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <thread>
+#include <time.h>
+
+#include <boost/regex.hpp>
+#include <json/json.h>
+
+#include "Debug.h"
+
+namespace {
+
+/*
+ * Single-threaded runs count the CPU time of the whole process, so that work
+ * the benchmarked code fans out to the WorkQueue is included. Multi-threaded
+ * runs add up the time of their own threads instead.
+ */
+double now_cpu_secs(size_t threads) {
+  timespec ts;
+  clock_gettime(threads == 1 ? CLOCK_PROCESS_CPUTIME_ID
+                             : CLOCK_THREAD_CPUTIME_ID,
+                &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+std::vector<std::unique_ptr<bench::Benchmark>>& registry() {
+  static std::vector<std::unique_ptr<bench::Benchmark>> benchmarks;
+  return benchmarks;
+}
+
+struct Result {
+  std::string name;
+  size_t threads;
+  size_t iterations;
+  double wall_secs;
+  double cpu_secs;
+  size_t items;
+};
+
+std::string format_time(double secs) {
+  char buf[32];
+  if (secs >= 1) {
+    snprintf(buf, sizeof(buf), "%.3f s", secs);
+  } else if (secs >= 1e-3) {
+    snprintf(buf, sizeof(buf), "%.3f ms", secs * 1e3);
+  } else if (secs >= 1e-6) {
+    snprintf(buf, sizeof(buf), "%.3f us", secs * 1e6);
+  } else {
+    snprintf(buf, sizeof(buf), "%.1f ns", secs * 1e9);
+  }
+  return buf;
+}
+
+std::string format_rate(double rate) {
+  char buf[32];
+  if (rate >= 1e9) {
+    snprintf(buf, sizeof(buf), "%.2fG/s", rate / 1e9);
+  } else if (rate >= 1e6) {
+    snprintf(buf, sizeof(buf), "%.2fM/s", rate / 1e6);
+  } else if (rate >= 1e3) {
+    snprintf(buf, sizeof(buf), "%.2fk/s", rate / 1e3);
+  } else {
+    snprintf(buf, sizeof(buf), "%.2f/s", rate);
+  }
+  return buf;
+}
+
+double rate(size_t items, double secs) {
+  return secs > 0 ? items / secs : 0;
+}
+
+}
+
+namespace bench {
+
+void State::pause_timing() {
+  if (!m_running) {
+    return;
+  }
+  m_running = false;
+  m_wall_secs += std::chrono::duration<double>(
+                     std::chrono::steady_clock::now() - m_wall_start)
+                     .count();
+  m_cpu_secs += now_cpu_secs(m_threads) - m_cpu_start;
+}
+
+void State::resume_timing() {
+  if (m_running) {
+    return;
+  }
+  m_running = true;
+  m_cpu_start = now_cpu_secs(m_threads);
+  m_wall_start = std::chrono::steady_clock::now();
+}
+
+struct Runner {
+  static Result run(const Benchmark& benchmark,
+                    size_t threads,
+                    size_t iterations) {
+    if (benchmark.m_setup) {
+      benchmark.m_setup();
+    }
+    std::vector<std::unique_ptr<State>> states;
+    for (size_t i = 0; i < threads; ++i) {
+      states.emplace_back(new State(iterations, threads, i));
+    }
+    std::vector<std::thread> workers;
+    for (size_t i = 1; i < threads; ++i) {
+      workers.emplace_back([&, i] { benchmark.m_fn(*states[i]); });
+    }
+    benchmark.m_fn(*states[0]);
+    for (auto& worker : workers) {
+      worker.join();
+    }
+    if (benchmark.m_teardown) {
+      benchmark.m_teardown();
+    }
+
+    Result result{benchmark.m_name, threads, iterations, 0, 0, 0};
+    if (threads > 1) {
+      result.name += "/threads:" + std::to_string(threads);
+    }
+    for (const auto& state : states) {
+      result.wall_secs = std::max(result.wall_secs, state->wall_secs());
+      result.cpu_secs += state->cpu_secs();
+      result.items += state->items_processed();
+    }
+    return result;
+  }
+
+  /**
+   * Grow the iteration count until a run takes at least min_secs, the same
+   * way Google Benchmark does.
+   */
+  static Result measure(const Benchmark& benchmark,
+                        size_t threads,
+                        double min_secs) {
+    size_t iterations = 1;
+    while (true) {
+      auto result = run(benchmark, threads, iterations);
+      if (result.wall_secs >= min_secs || iterations >= 1000000000) {
+        return result;
+      }
+      double multiplier = result.wall_secs > 0
+                              ? min_secs * 1.4 / result.wall_secs
+                              : 10.0;
+      multiplier = std::min(10.0, std::max(2.0, multiplier));
+      iterations = static_cast<size_t>(iterations * multiplier);
+    }
+  }
+};
+
+Benchmark* register_benchmark(const std::string& name, Benchmark::Function fn) {
+  registry().emplace_back(new Benchmark(name, std::move(fn)));
+  return registry().back().get();
+}
+
+size_t run_benchmarks(const Options& options) {
+  boost::regex filter(options.filter.empty() ? ".*" : options.filter);
+  std::vector<Result> results;
+  printf("%-52s %12s %12s %12s %12s %14s\n",
+         "Benchmark",
+         "Time",
+         "CPU",
+         "Iterations",
+         "Items/s",
+         "Items/core");
+  printf("%s\n", std::string(119, '-').c_str());
+  for (const auto& benchmark : registry()) {
+    if (!boost::regex_search(benchmark->name(), filter)) {
+      continue;
+    }
+    auto thread_counts = benchmark->thread_counts();
+    if (thread_counts.empty()) {
+      thread_counts.push_back(1);
+    }
+    for (auto threads : thread_counts) {
+      auto r = Runner::measure(*benchmark, threads, options.min_secs);
+      // Time is wall time per iteration; CPU is per iteration and thread.
+      printf("%-52s %12s %12s %12zu %12s %14s\n",
+             r.name.c_str(),
+             format_time(r.wall_secs / r.iterations).c_str(),
+             format_time(r.cpu_secs / (r.iterations * r.threads)).c_str(),
+             r.iterations,
+             format_rate(rate(r.items, r.wall_secs)).c_str(),
+             format_rate(rate(r.items, r.cpu_secs)).c_str());
+      fflush(stdout);
+      results.push_back(std::move(r));
+    }
+  }
+
+  if (!options.json_output.empty()) {
+    Json::Value benchmarks(Json::arrayValue);
+    for (const auto& r : results) {
+      Json::Value b;
+      b["name"] = r.name;
+      b["threads"] = Json::UInt64(r.threads);
+      b["iterations"] = Json::UInt64(r.iterations);
+      b["real_time_secs"] = r.wall_secs / r.iterations;
+      b["cpu_time_secs"] = r.cpu_secs / (r.iterations * r.threads);
+      b["items_per_second"] = rate(r.items, r.wall_secs);
+      b["items_per_cpu_second"] = rate(r.items, r.cpu_secs);
+      benchmarks.append(b);
+    }
+    Json::Value root;
+    root["benchmarks"] = benchmarks;
+    std::ofstream out(options.json_output);
+    always_assert_log(out, "Can't open %s\n", options.json_output.c_str());
+    Json::StyledStreamWriter writer;
+    writer.write(out, root);
+  }
+  return results.size();
+}
+
+}
@@ -0,0 +1,152 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree. An additional grant
+ * of patent rights can be found in the PATENTS file in the same directory.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * A minimal, dependency-free benchmark harness modelled on Google Benchmark.
+ *
+ * A benchmark is a function that does its setup, then loops on
+ * State::keep_running() around the code being measured:
+ *
+ *   bench::register_benchmark("foo", [](bench::State& state) {
+ *     auto input = make_input();
+ *     while (state.keep_running()) {
+ *       foo(input);
+ *     }
+ *     state.set_items_processed(state.iterations() * input.size());
+ *   });
+ *
+ * The harness grows the iteration count until a run takes at least the
+ * minimum time, then reports wall and CPU time per iteration and the item
+ * throughput, both overall and per core (items per CPU-second).
+ */
+namespace bench {
+
+class State {
+ public:
+  State(size_t max_iterations, size_t threads, size_t thread_index)
+      : m_max_iterations(max_iterations),
+        m_threads(threads),
+        m_thread_index(thread_index) {}
+
+  /**
+   * Returns true while there are iterations left to run. The first call
+   * starts the timers and the last one stops them.
+   */
+  bool keep_running() {
+    if (!m_started) {
+      m_started = true;
+      resume_timing();
+    }
+    if (m_iterations < m_max_iterations) {
+      ++m_iterations;
+      return true;
+    }
+    pause_timing();
+    return false;
+  }
+
+  /**
+   * Exclude per-iteration setup or cleanup from the measurement.
+   */
+  void pause_timing();
+  void resume_timing();
+
+  void set_items_processed(size_t items) { m_items = items; }
+
+  size_t iterations() const { return m_iterations; }
+  size_t max_iterations() const { return m_max_iterations; }
+  size_t threads() const { return m_threads; }
+  size_t thread_index() const { return m_thread_index; }
+
+  double wall_secs() const { return m_wall_secs; }
+  double cpu_secs() const { return m_cpu_secs; }
+  size_t items_processed() const { return m_items; }
+
+ private:
+  size_t m_max_iterations;
+  size_t m_threads;
+  size_t m_thread_index;
+  size_t m_iterations{0};
+  size_t m_items{0};
+  bool m_started{false};
+  bool m_running{false};
+  std::chrono::steady_clock::time_point m_wall_start;
+  double m_cpu_start{0};
+  double m_wall_secs{0};
+  double m_cpu_secs{0};
+};
+
+class Benchmark {
+ public:
+  using Function = std::function<void(State&)>;
+
+  Benchmark(std::string name, Function fn)
+      : m_name(std::move(name)), m_fn(std::move(fn)) {}
+
+  /**
+   * Also run the benchmark on this many threads at once. Each thread runs
+   * the function with its own State.
+   */
+  Benchmark* threads(size_t n) {
+    m_threads.push_back(n);
+    return this;
+  }
+
+  /**
+   * Run once on the calling thread before and after each (possibly
+   * multi-threaded) run, for state shared by all threads.
+   */
+  Benchmark* setup(std::function<void()> fn) {
+    m_setup = std::move(fn);
+    return this;
+  }
+  Benchmark* teardown(std::function<void()> fn) {
+    m_teardown = std::move(fn);
+    return this;
+  }
+
+  const std::string& name() const { return m_name; }
+  const std::vector<size_t>& thread_counts() const { return m_threads; }
+
+ private:
+  friend struct Runner;
+
+  std::string m_name;
+  Function m_fn;
+  std::vector<size_t> m_threads;
+  std::function<void()> m_setup;
+  std::function<void()> m_teardown;
+};
+
+Benchmark* register_benchmark(const std::string& name, Benchmark::Function fn);
+
+struct Options {
+  // Only run benchmarks whose name matches this regex.
+  std::string filter;
+  // Minimum wall time of a measured run.
+  double min_secs{0.5};
+  // Also write the results as JSON to this file.
+  std::string json_output;
+};
+
+/**
+ * Run all registered benchmarks, printing a table to stdout. Returns the
+ * number of benchmarks run.
+ */
+size_t run_benchmarks(const Options& options);
+
+}
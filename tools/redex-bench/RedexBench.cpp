@@ -0,0 +1,490 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree. An additional grant
+ * of patent rights can be found in the PATENTS file in the same directory.
+ */
+
+/*
+ * redex-bench: reproducible benchmarks for the libredex hot paths, run on a
+ * synthetic app generated at startup and on any dex files given on the command
+ * line (e.g. the classes.dex of test/instr/redex-test.apk). Nothing is
+ * fetched over the network.
+ */
+
+#include <algorithm>
+#include <getopt.h>
+#include <random>
+#include <sstream>
+#include <thread>
+
+#include <boost/filesystem.hpp>
+#include <json/json.h>
+
+#include "Benchmark.h"
+#include "ConfigFiles.h"
+#include "ControlFlow.h"
+#include "Creators.h"
+#include "Dataflow.h"
+#include "DexClass.h"
+#include "DexLoader.h"
+#include "DexOutput.h"
+#include "DexUtil.h"
+#include "Liveness.h"
+#include "ProguardConfiguration.h"
+#include "ProguardMap.h"
+#include "ProguardMatcher.h"
+#include "ProguardParser.h"
+#include "RedexContext.h"
+#include "SyntheticApp.h"
+#include "TypeSystem.h"
+#include "VirtualScope.h"
+
+namespace {
+
+/*
+ * Generic rules, so that they do some matching on any input.
+ */
+const char* kProguardRules = R"(
+-keep public class * extends android.app.Activity
+-keep class com.facebook.** { public <methods>; }
+-keepclassmembers class * {
+  *** get*();
+  void set*(***);
+}
+-keepnames class **.*Impl*
+-keepclasseswithmembers class * {
+  public static void main(java.lang.String[]);
+}
+)";
+
+struct Input {
+  std::string name;
+  std::string path;
+  // ProGuard rules to match against the input, kProguardRules if empty
+  std::string proguard_rules;
+};
+
+/*
+ * A fresh RedexContext holding one dex, torn down on destruction.
+ */
+struct LoadedDex {
+  LoadedDex(const std::string& path, bool balloon) {
+    g_redex = new RedexContext();
+    classes = load_classes_from_dex(path.c_str(), balloon);
+    for (auto cls : classes) {
+      for (auto method : cls->get_dmethods()) {
+        methods.push_back(method);
+      }
+      for (auto method : cls->get_vmethods()) {
+        methods.push_back(method);
+      }
+    }
+  }
+
+  ~LoadedDex() {
+    delete g_redex;
+    g_redex = nullptr;
+  }
+
+  std::vector<IRCode*> codes() const {
+    std::vector<IRCode*> codes;
+    for (auto method : methods) {
+      if (method->get_code() != nullptr) {
+        codes.push_back(method->get_code());
+      }
+    }
+    return codes;
+  }
+
+  DexClasses classes;
+  std::vector<DexMethod*> methods;
+};
+
+void write_dex(const std::string& path, DexClasses& classes) {
+  Json::Value json(Json::objectValue);
+  ConfigFiles cfg(json);
+  std::unique_ptr<PositionMapper> pos_mapper(PositionMapper::make("", ""));
+  write_classes_to_dex(path,
+                       &classes,
+                       nullptr /* LocatorIndex* */,
+                       0,
+                       cfg,
+                       json,
+                       pos_mapper.get());
+}
+
+/*
+ * A toy forwards analysis: the registers that may have been written.
+ */
+struct DefinedRegs {
+  explicit DefinedRegs(size_t nregs) : regs(nregs) {}
+
+  void meet(const DefinedRegs& that) { regs |= that.regs; }
+  bool operator==(const DefinedRegs& that) const { return regs == that.regs; }
+  bool operator!=(const DefinedRegs& that) const { return !(*this == that); }
+
+  RegSet regs;
+};
+
+using CastQuery = std::pair<DexType*, DexType*>;
+
+/*
+ * For every class, a cast to each of its supertypes (succeeding) and to
+ * `per_class` classes of the scope picked at random (mostly failing).
+ */
+std::vector<CastQuery> make_cast_queries(const Scope& scope,
+                                         size_t per_class) {
+  std::vector<CastQuery> queries;
+  if (scope.empty()) {
+    return queries;
+  }
+  std::mt19937 rng(0);
+  std::uniform_int_distribution<size_t> pick(0, scope.size() - 1);
+  for (const auto& cls : scope) {
+    auto type = cls->get_type();
+    for (auto super = cls; super != nullptr;
+         super = type_class(super->get_super_class())) {
+      if (super->get_super_class() != nullptr) {
+        queries.emplace_back(type, super->get_super_class());
+      }
+      for (const auto& intf : super->get_interfaces()->get_type_list()) {
+        queries.emplace_back(type, intf);
+      }
+    }
+    for (size_t i = 0; i < per_class; ++i) {
+      queries.emplace_back(type, scope[pick(rng)]->get_type());
+    }
+  }
+  return queries;
+}
+
+void register_dex_benchmarks(const Input& input,
+                             const std::string& out_dir) {
+  auto path = input.path;
+  bench::register_benchmark(
+      "load_classes_from_dex/" + input.name, [path](bench::State& state) {
+        size_t methods = 0;
+        while (state.keep_running()) {
+          state.pause_timing();
+          g_redex = new RedexContext();
+          state.resume_timing();
+          auto classes = load_classes_from_dex(path.c_str(), false);
+          state.pause_timing();
+          for (auto cls : classes) {
+            methods += cls->get_dmethods().size() + cls->get_vmethods().size();
+          }
+          delete g_redex;
+          g_redex = nullptr;
+          state.resume_timing();
+        }
+        state.set_items_processed(methods);
+      });
+
+  bench::register_benchmark(
+      "balloon_sync/" + input.name, [path](bench::State& state) {
+        LoadedDex dex(path, false);
+        std::vector<DexMethod*> methods;
+        for (auto method : dex.methods) {
+          if (method->get_dex_code() != nullptr) {
+            methods.push_back(method);
+          }
+        }
+        while (state.keep_running()) {
+          for (auto method : methods) {
+            method->balloon();
+          }
+          for (auto method : methods) {
+            method->sync();
+          }
+        }
+        state.set_items_processed(state.iterations() * methods.size());
+      });
+
+  bench::register_benchmark(
+      "build_cfg/" + input.name, [path](bench::State& state) {
+        LoadedDex dex(path, true);
+        auto codes = dex.codes();
+        // Each build first clears the previous graph, as it does when passes
+        // rebuild the cfg of a method.
+        while (state.keep_running()) {
+          for (auto code : codes) {
+            code->build_cfg();
+          }
+        }
+        state.set_items_processed(state.iterations() * codes.size());
+      });
+
+  bench::register_benchmark(
+      "Liveness::analyze/" + input.name, [path](bench::State& state) {
+        LoadedDex dex(path, true);
+        auto codes = dex.codes();
+        for (auto code : codes) {
+          code->build_cfg();
+        }
+        while (state.keep_running()) {
+          for (auto code : codes) {
+            Liveness::analyze(code->cfg(), code->get_registers_size());
+          }
+        }
+        state.set_items_processed(state.iterations() * codes.size());
+      });
+
+  bench::register_benchmark(
+      "forwards_dataflow/" + input.name, [path](bench::State& state) {
+        LoadedDex dex(path, true);
+        auto codes = dex.codes();
+        for (auto code : codes) {
+          code->build_cfg();
+        }
+        std::function<void(const IRInstruction*, DefinedRegs*)> trans =
+            [](const IRInstruction* insn, DefinedRegs* defined) {
+              if (insn->dests_size()) {
+                defined->regs.set(insn->dest());
+              }
+            };
+        while (state.keep_running()) {
+          for (auto code : codes) {
+            DefinedRegs bottom(code->get_registers_size());
+            forwards_dataflow(code->cfg().blocks(), bottom, trans);
+          }
+        }
+        state.set_items_processed(state.iterations() * codes.size());
+      });
+
+  auto pg_rules = input.proguard_rules.empty() ? std::string(kProguardRules)
+                                               : input.proguard_rules;
+  bench::register_benchmark(
+      "process_proguard_rules/" + input.name,
+      [path, pg_rules](bench::State& state) {
+        LoadedDex dex(path, false);
+        redex::ProguardConfiguration pg_config;
+        std::istringstream rules(pg_rules);
+        redex::proguard_parser::parse(rules, &pg_config);
+        always_assert(pg_config.ok);
+        ProguardMap pg_map{std::string()};
+        Scope scope = dex.classes;
+        while (state.keep_running()) {
+          redex::process_proguard_rules(pg_map, &pg_config, scope);
+        }
+        state.set_items_processed(state.iterations() * scope.size());
+      });
+
+  bench::register_benchmark(
+      "build_signature_map/" + input.name, [path](bench::State& state) {
+        LoadedDex dex(path, false);
+        auto hierarchy = build_type_hierarchy(dex.classes);
+        while (state.keep_running()) {
+          build_signature_map(hierarchy);
+        }
+        state.set_items_processed(state.iterations() * dex.methods.size());
+      });
+
+  bench::register_benchmark(
+      "TypeSystem::TypeSystem/" + input.name, [path](bench::State& state) {
+        LoadedDex dex(path, false);
+        while (state.keep_running()) {
+          TypeSystem type_system(dex.classes);
+        }
+        state.set_items_processed(state.iterations() * dex.classes.size());
+      });
+
+  // The same subtype queries answered by walking the hierarchy and by the
+  // TypeSystem snapshot.
+  const size_t kRandomCastsPerClass = 16;
+  bench::register_benchmark(
+      "check_cast/" + input.name, [path](bench::State& state) {
+        LoadedDex dex(path, false);
+        auto queries = make_cast_queries(dex.classes, kRandomCastsPerClass);
+        size_t assignable = 0;
+        while (state.keep_running()) {
+          for (const auto& q : queries) {
+            assignable += check_cast(q.first, q.second);
+          }
+        }
+        always_assert(queries.empty() || assignable > 0);
+        state.set_items_processed(state.iterations() * queries.size());
+      });
+
+  bench::register_benchmark(
+      "TypeSystem::is_assignable_to/" + input.name,
+      [path](bench::State& state) {
+        LoadedDex dex(path, false);
+        auto queries = make_cast_queries(dex.classes, kRandomCastsPerClass);
+        TypeSystem type_system(dex.classes);
+        size_t assignable = 0;
+        while (state.keep_running()) {
+          for (const auto& q : queries) {
+            assignable += type_system.is_assignable_to(q.first, q.second);
+          }
+        }
+        always_assert(queries.empty() || assignable > 0);
+        state.set_items_processed(state.iterations() * queries.size());
+      });
+
+  auto out_path = out_dir + "/" + input.name + ".dex";
+  bench::register_benchmark(
+      "write_classes_to_dex/" + input.name,
+      [path, out_path](bench::State& state) {
+        LoadedDex dex(path, true);
+        auto methods = dex.methods;
+        methods.erase(std::remove_if(methods.begin(),
+                                     methods.end(),
+                                     [](DexMethod* method) {
+                                       return method->get_code() == nullptr;
+                                     }),
+                      methods.end());
+        while (state.keep_running()) {
+          write_dex(out_path, dex.classes);
+          // Writing syncs all the code, so balloon it back for the next one.
+          state.pause_timing();
+          for (auto method : methods) {
+            method->balloon();
+          }
+          state.resume_timing();
+        }
+        state.set_items_processed(state.iterations() * dex.methods.size());
+      });
+}
+
+/*
+ * Interning a mix of existing and new strings from several threads, which is
+ * what parallel loading and renaming passes do.
+ */
+void register_make_string_benchmark() {
+  const size_t kPoolSize = 4096;
+  const size_t kStringsPerIteration = 256;
+  auto pool = std::make_shared<std::vector<std::string>>();
+  for (size_t i = 0; i < kPoolSize; ++i) {
+    pool->push_back("Lcom/facebook/redex/bench/Pooled" + std::to_string(i) +
+                    ";");
+  }
+  auto benchmark = bench::register_benchmark(
+      "RedexContext::make_string", [pool](bench::State& state) {
+        char fresh[64];
+        size_t next = state.thread_index();
+        while (state.keep_running()) {
+          for (size_t i = 0; i < kStringsPerIteration; ++i, ++next) {
+            // One in eight strings is new, the rest are already interned.
+            if (i % 8 == 0) {
+              snprintf(fresh,
+                       sizeof(fresh),
+                       "fresh:%zu:%zu",
+                       state.thread_index(),
+                       next);
+              DexString::make_string(fresh);
+            } else {
+              DexString::make_string((*pool)[next % kPoolSize]);
+            }
+          }
+        }
+        state.set_items_processed(state.iterations() * kStringsPerIteration);
+      });
+  benchmark
+      ->setup([pool] {
+        g_redex = new RedexContext();
+        for (const auto& str : *pool) {
+          DexString::make_string(str);
+        }
+      })
+      ->teardown([] {
+        delete g_redex;
+        g_redex = nullptr;
+      });
+  // Contend from at least 8 threads, even on smaller machines.
+  size_t max_threads = std::max(8u, std::thread::hardware_concurrency());
+  for (size_t threads = 1; threads <= max_threads; threads *= 2) {
+    benchmark->threads(threads);
+  }
+}
+
+void usage() {
+  fprintf(stderr,
+          "Usage: redex-bench [options] [classes.dex ...]\n"
+          "  -f, --filter REGEX         only run matching benchmarks\n"
+          "  -t, --min-time SECS        minimum time per benchmark (0.5)\n"
+          "  -j, --json FILE            also write the results as JSON\n"
+          "  -n, --synthetic-classes N  size of the synthetic app (2000)\n");
+}
+
+}
+
+int main(int argc, char* argv[]) {
+  const struct option options[] = {
+      {"filter", required_argument, 0, 'f'},
+      {"min-time", required_argument, 0, 't'},
+      {"json", required_argument, 0, 'j'},
+      {"synthetic-classes", required_argument, 0, 'n'},
+      {"help", no_argument, 0, 'h'},
+      {nullptr, 0, nullptr, 0},
+  };
+  bench::Options bench_options;
+  size_t synthetic_classes = 2000;
+  int c;
+  while ((c = getopt_long(argc, argv, "f:t:j:n:h", &options[0], nullptr)) !=
+         -1) {
+    switch (c) {
+    case 'f':
+      bench_options.filter = optarg;
+      break;
+    case 't':
+      bench_options.min_secs = strtod(optarg, nullptr);
+      break;
+    case 'j':
+      bench_options.json_output = optarg;
+      break;
+    case 'n':
+      synthetic_classes = strtoul(optarg, nullptr, 10);
+      break;
+    case 'h':
+      usage();
+      return 0;
+    case '?':
+      usage();
+      return 1; // getopt_long has printed an error
+    default:
+      abort();
+    }
+  }
+
+  namespace fs = boost::filesystem;
+  auto out_dir =
+      fs::temp_directory_path() / fs::unique_path("redex-bench-%%%%-%%%%");
+  fs::create_directories(out_dir);
+
+  std::vector<Input> inputs;
+  if (synthetic_classes > 0) {
+    SyntheticAppConfig config;
+    config.num_classes = synthetic_classes;
+    auto synthetic_dir = out_dir / "synthetic";
+    fs::create_directories(synthetic_dir);
+    g_redex = new RedexContext();
+    auto dexes = write_synthetic_app(config, synthetic_dir.string());
+    delete g_redex;
+    g_redex = nullptr;
+    auto rules = make_proguard_config(config);
+    for (size_t i = 0; i < dexes.size(); ++i) {
+      auto name = "synthetic" + (i > 0 ? std::to_string(i + 1) : "");
+      inputs.push_back(Input{name, dexes[i], rules});
+    }
+  }
+  for (int i = optind; i < argc; ++i) {
+    inputs.push_back(Input{fs::path(argv[i]).stem().string(), argv[i], ""});
+  }
+
+  for (const auto& input : inputs) {
+    register_dex_benchmarks(input, out_dir.string());
+  }
+  register_make_string_benchmark();
+
+  auto ran = bench::run_benchmarks(bench_options);
+  fs::remove_all(out_dir);
+  if (ran == 0) {
+    fprintf(stderr, "No benchmark matches '%s'\n",
+            bench_options.filter.c_str());
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,138 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree. An additional grant
+ * of patent rights can be found in the PATENTS file in the same directory.
+ */
+
+/*
+ * redex-synth: generate a synthetic app of configurable size and shape, as
+ * classes*.dex plus a matching proguard.pro, for benchmarks and scaling tests.
+ */
+
+#include <getopt.h>
+
+#include <boost/filesystem.hpp>
+
+#include "RedexContext.h"
+#include "SyntheticApp.h"
+
+namespace {
+
+void usage() {
+  SyntheticAppConfig defaults;
+  fprintf(stderr,
+          "Usage: redex-synth [options] OUTDIR\n"
+          "  --classes N             number of classes (%zu)\n"
+          "  --depth N               maximum hierarchy depth (%zu)\n"
+          "  --fan-out N             subclasses per class (%zu)\n"
+          "  --interfaces N          number of interfaces (%zu)\n"
+          "  --interface-density P   fraction of classes implementing one "
+          "(%.2f)\n"
+          "  --methods N             methods per class (%zu)\n"
+          "  --method-size N         median method size in instructions "
+          "(%zu)\n"
+          "  --max-method-size N     maximum method size (%zu)\n"
+          "  --strings N             size of the string pool (%zu)\n"
+          "  --annotation-density P  fraction of annotated classes and "
+          "methods (%.2f)\n"
+          "  --seed N                random seed (%u)\n",
+          defaults.num_classes,
+          defaults.hierarchy_depth,
+          defaults.fan_out,
+          defaults.num_interfaces,
+          defaults.interface_density,
+          defaults.methods_per_class,
+          defaults.median_method_size,
+          defaults.max_method_size,
+          defaults.string_pool_size,
+          defaults.annotation_density,
+          defaults.seed);
+}
+
+}
+
+int main(int argc, char* argv[]) {
+  const struct option options[] = {
+      {"classes", required_argument, 0, 'c'},
+      {"depth", required_argument, 0, 'd'},
+      {"fan-out", required_argument, 0, 'f'},
+      {"interfaces", required_argument, 0, 'i'},
+      {"interface-density", required_argument, 0, 'I'},
+      {"methods", required_argument, 0, 'm'},
+      {"method-size", required_argument, 0, 'z'},
+      {"max-method-size", required_argument, 0, 'Z'},
+      {"strings", required_argument, 0, 's'},
+      {"annotation-density", required_argument, 0, 'a'},
+      {"seed", required_argument, 0, 'r'},
+      {"help", no_argument, 0, 'h'},
+      {nullptr, 0, nullptr, 0},
+  };
+  SyntheticAppConfig config;
+  int c;
+  while ((c = getopt_long(
+              argc, argv, "c:d:f:i:I:m:z:Z:s:a:r:h", &options[0], nullptr)) !=
+         -1) {
+    switch (c) {
+    case 'c':
+      config.num_classes = strtoul(optarg, nullptr, 10);
+      break;
+    case 'd':
+      config.hierarchy_depth = strtoul(optarg, nullptr, 10);
+      break;
+    case 'f':
+      config.fan_out = strtoul(optarg, nullptr, 10);
+      break;
+    case 'i':
+      config.num_interfaces = strtoul(optarg, nullptr, 10);
+      break;
+    case 'I':
+      config.interface_density = strtod(optarg, nullptr);
+      break;
+    case 'm':
+      config.methods_per_class = strtoul(optarg, nullptr, 10);
+      break;
+    case 'z':
+      config.median_method_size = strtoul(optarg, nullptr, 10);
+      break;
+    case 'Z':
+      config.max_method_size = strtoul(optarg, nullptr, 10);
+      break;
+    case 's':
+      config.string_pool_size = strtoul(optarg, nullptr, 10);
+      break;
+    case 'a':
+      config.annotation_density = strtod(optarg, nullptr);
+      break;
+    case 'r':
+      config.seed = strtoul(optarg, nullptr, 10);
+      break;
+    case 'h':
+      usage();
+      return 0;
+    case '?':
+      usage();
+      return 1; // getopt_long has printed an error
+    default:
+      abort();
+    }
+  }
+  if (optind != argc - 1) {
+    usage();
+    return 1;
+  }
+  std::string out_dir(argv[optind]);
+  boost::filesystem::create_directories(out_dir);
+
+  g_redex = new RedexContext();
+  auto dexes = write_synthetic_app(config, out_dir);
+  delete g_redex;
+
+  for (const auto& dex : dexes) {
+    printf("%s\n", dex.c_str());
+  }
+  printf("%s/proguard.pro\n", out_dir.c_str());
+  return 0;
+}
@@ -0,0 +1,459 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree. An additional grant
+ * of patent rights can be found in the PATENTS file in the same directory.
+ */
+
+#include "SyntheticApp.h"
+
+#include <cmath>
+#include <deque>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <unordered_map>
+#include <unordered_set>
+
+#include <json/json.h>
+
+#include "ConfigFiles.h"
+#include "Creators.h"
+#include "DexAnnotation.h"
+#include "DexOutput.h"
+#include "DexUtil.h"
+
+namespace {
+
+const char* kPackage = "Lcom/facebook/redex/synth/";
+const size_t kClassesPerPackage = 100;
+const size_t kRefLimit = 65536;
+
+/*
+ * The std distributions differ between standard libraries, but mt19937 does
+ * not, so numbers are derived from its raw output to be the same everywhere.
+ */
+class Random {
+ public:
+  explicit Random(uint32_t seed) : m_engine(seed) {}
+
+  size_t below(size_t n) { return n == 0 ? 0 : m_engine() % n; }
+
+  bool chance(double p) { return m_engine() < p * 4294967296.0; }
+
+  double uniform() { return (m_engine() + 0.5) / 4294967296.0; }
+
+  // Box-Muller
+  double normal() {
+    return std::sqrt(-2 * std::log(uniform())) *
+           std::cos(2 * M_PI * uniform());
+  }
+
+ private:
+  std::mt19937 m_engine;
+};
+
+struct Interface {
+  DexType* type;
+  std::vector<DexString*> method_names;
+};
+
+/*
+ * The registers a generated method body works with.
+ */
+struct Locals {
+  Location self;
+  Location arg;
+  Location tmp;
+  Location str;
+  DexField* field;
+  bool is_static;
+};
+
+class Generator {
+ public:
+  explicit Generator(const SyntheticAppConfig& config)
+      : m_config(config),
+        m_random(config.seed),
+        m_strings(config.string_pool_size, nullptr) {
+    m_proto = DexProto::make_proto(
+        get_int_type(), DexTypeList::make_type_list({get_int_type()}));
+    m_init_proto = DexProto::make_proto(get_void_type(),
+                                        DexTypeList::make_type_list({}));
+    m_keep_type =
+        DexType::make_type((std::string(kPackage) + "Keep;").c_str());
+    m_marker_type =
+        DexType::make_type((std::string(kPackage) + "Marker;").c_str());
+  }
+
+  DexClasses generate() {
+    for (size_t i = 0; i < m_config.num_interfaces; ++i) {
+      make_interface(i);
+    }
+    // Fill trees of the configured depth and fan-out breadth-first, starting
+    // a new root whenever the current tree is full.
+    struct Open {
+      DexClass* cls;
+      size_t depth;
+      size_t children;
+    };
+    std::deque<Open> open;
+    for (size_t i = 0; i < m_config.num_classes; ++i) {
+      DexClass* parent = nullptr;
+      size_t depth = 1;
+      if (!open.empty()) {
+        auto& front = open.front();
+        parent = front.cls;
+        depth = front.depth + 1;
+        if (++front.children == m_config.fan_out) {
+          open.pop_front();
+        }
+      }
+      auto cls = make_class(i, parent);
+      if (depth < m_config.hierarchy_depth && m_config.fan_out > 0) {
+        open.push_back(Open{cls, depth, 0});
+      }
+    }
+    return m_classes;
+  }
+
+ private:
+  void make_interface(size_t index) {
+    std::ostringstream name;
+    name << kPackage << "api/I" << index << ";";
+    Interface iface{DexType::make_type(name.str().c_str()), {}};
+    ClassCreator cc(iface.type);
+    cc.set_access(ACC_PUBLIC | ACC_INTERFACE | ACC_ABSTRACT);
+    cc.set_super(get_object_type());
+    auto num_methods = 1 + m_random.below(3);
+    for (size_t k = 0; k < num_methods; ++k) {
+      auto method_name = DexString::make_string(
+          "i" + std::to_string(index) + "_" + std::to_string(k));
+      auto method = DexMethod::make_method(iface.type, method_name, m_proto);
+      method->make_concrete(ACC_PUBLIC | ACC_ABSTRACT,
+                            std::unique_ptr<IRCode>(),
+                            true);
+      cc.add_method(method);
+      iface.method_names.push_back(method_name);
+    }
+    m_classes.push_back(cc.create());
+    m_interfaces.push_back(std::move(iface));
+  }
+
+  DexClass* make_class(size_t index, DexClass* parent) {
+    std::ostringstream name;
+    name << kPackage << "p" << index / kClassesPerPackage << "/C" << index
+         << ";";
+    auto type = DexType::make_type(name.str().c_str());
+    auto super_type = parent ? parent->get_type() : get_object_type();
+    ClassCreator cc(type);
+    cc.set_access(ACC_PUBLIC);
+    cc.set_super(super_type);
+    if (m_random.chance(m_config.annotation_density)) {
+      cc.get_class()->attach_annotation_set(
+          make_annotation(m_marker_type, DAV_RUNTIME));
+    }
+
+    auto field = DexField::make_field(
+        type, DexString::make_string("f"), get_int_type());
+    field->make_concrete(ACC_PRIVATE);
+    cc.add_field(field);
+    cc.add_method(make_constructor(type, super_type, field));
+
+    // Virtual methods named like one of the parent's override it and call
+    // the super implementation.
+    auto& virtuals = m_virtuals[type];
+    const std::unordered_set<const DexString*>* inherited = nullptr;
+    if (parent != nullptr) {
+      inherited = &m_virtuals.at(parent->get_type());
+      virtuals = *inherited;
+    }
+    auto make_virtual = [&](DexString* name) {
+      bool overrides = inherited && inherited->count(name);
+      cc.add_method(make_method(type,
+                                name,
+                                ACC_PUBLIC,
+                                field,
+                                overrides ? super_type : nullptr));
+      virtuals.insert(name);
+    };
+
+    if (!m_interfaces.empty() &&
+        m_random.chance(m_config.interface_density)) {
+      const auto& iface = m_interfaces[m_random.below(m_interfaces.size())];
+      cc.add_interface(iface.type);
+      for (auto method_name : iface.method_names) {
+        make_virtual(method_name);
+      }
+    }
+
+    std::unordered_set<size_t> used;
+    auto max_index = 2 * m_config.methods_per_class;
+    for (size_t k = 0; k < m_config.methods_per_class; ++k) {
+      if (m_random.below(3) == 0) {
+        auto method = make_method(
+            type,
+            DexString::make_string("s" + std::to_string(k)),
+            ACC_PUBLIC | ACC_STATIC,
+            nullptr,
+            nullptr);
+        cc.add_method(method);
+        m_statics.push_back(method);
+        continue;
+      }
+      auto j = m_random.below(max_index);
+      while (used.count(j)) {
+        j = (j + 1) % max_index;
+      }
+      used.insert(j);
+      make_virtual(DexString::make_string("v" + std::to_string(j)));
+    }
+
+    auto cls = cc.create();
+    m_classes.push_back(cls);
+    return cls;
+  }
+
+  DexMethod* make_constructor(DexType* type,
+                              DexType* super_type,
+                              DexField* field) {
+    MethodCreator mc(type,
+                     DexString::make_string("<init>"),
+                     m_init_proto,
+                     ACC_PUBLIC | ACC_CONSTRUCTOR);
+    auto self = mc.get_local(0);
+    auto zero = mc.make_local(get_int_type());
+    auto block = mc.get_main_block();
+    block->invoke(OPCODE_INVOKE_DIRECT,
+                  DexMethod::make_method(super_type,
+                                         DexString::make_string("<init>"),
+                                         m_init_proto),
+                  {self});
+    block->load_const(zero, 0);
+    block->iput(field, self, zero);
+    block->ret_void();
+    return mc.create();
+  }
+
+  /*
+   * An int (int) method; instance methods may call their super
+   * implementation.
+   */
+  DexMethod* make_method(DexType* type,
+                         DexString* name,
+                         DexAccessFlags access,
+                         DexField* field,
+                         DexType* super_type) {
+    if (m_random.chance(m_config.annotation_density)) {
+      DexMethod::make_method(type, name, m_proto)
+          ->attach_annotation_set(make_annotation(m_keep_type, DAV_BUILD));
+    }
+    MethodCreator mc(type, name, m_proto, access);
+    bool is_static = access & ACC_STATIC;
+    // self is only used by instance methods
+    Locals locals{mc.get_local(0),
+                  mc.get_local(is_static ? 0 : 1),
+                  mc.make_local(get_int_type()),
+                  mc.make_local(get_string_type()),
+                  field,
+                  is_static};
+    auto block = mc.get_main_block();
+    emit_code(block, locals, method_size(), 0);
+    if (super_type != nullptr) {
+      block->invoke(OPCODE_INVOKE_SUPER,
+                    DexMethod::make_method(super_type, name, m_proto),
+                    {locals.self, locals.arg});
+      block->move_result(locals.arg, get_int_type());
+    }
+    block->ret(locals.arg);
+    return mc.create();
+  }
+
+  /*
+   * Emit roughly `budget` instructions of arithmetic, string loads, field
+   * accesses, calls to earlier static methods and nested if/else blocks.
+   */
+  void emit_code(MethodBlock* block,
+                 Locals& locals,
+                 size_t budget,
+                 size_t nesting) {
+    size_t emitted = 0;
+    while (emitted < budget) {
+      switch (m_random.below(nesting < 3 ? 5 : 4)) {
+      case 0:
+        block->load_const(locals.tmp,
+                          static_cast<int32_t>(m_random.below(1000)));
+        block->binop_2addr(OPCODE_ADD_INT_2ADDR, locals.arg, locals.tmp);
+        emitted += 2;
+        break;
+      case 1:
+        if (!m_strings.empty()) {
+          block->load_const(locals.str, pooled_string());
+          emitted += 1;
+          break;
+        }
+      // fallthrough
+      case 2:
+        if (!m_statics.empty()) {
+          block->invoke(m_statics[m_random.below(m_statics.size())],
+                        {locals.arg});
+          block->move_result(locals.arg, get_int_type());
+          emitted += 2;
+          break;
+        }
+      // fallthrough
+      case 3:
+        if (!locals.is_static) {
+          block->iget(locals.field, locals.self, locals.tmp);
+          block->binop_2addr(OPCODE_XOR_INT_2ADDR, locals.tmp, locals.arg);
+          block->iput(locals.field, locals.self, locals.tmp);
+        } else {
+          block->load_const(locals.tmp, 31);
+          block->binop_2addr(OPCODE_MUL_INT_2ADDR, locals.arg, locals.tmp);
+        }
+        emitted += 3;
+        break;
+      case 4: {
+        MethodBlock* true_block;
+        auto false_block =
+            block->if_else_testz(OPCODE_IF_EQZ, locals.arg, &true_block);
+        auto inner = m_random.below(budget - emitted + 1);
+        emit_code(false_block, locals, inner / 2, nesting + 1);
+        emit_code(true_block, locals, inner - inner / 2, nesting + 1);
+        emitted += 2 + inner;
+        break;
+      }
+      }
+    }
+  }
+
+  size_t method_size() {
+    auto size = m_config.median_method_size * std::exp(0.8 * m_random.normal());
+    return std::max<size_t>(
+        1, std::min<size_t>(m_config.max_method_size, size));
+  }
+
+  DexString* pooled_string() {
+    auto index = m_random.below(m_strings.size());
+    if (m_strings[index] == nullptr) {
+      m_strings[index] =
+          DexString::make_string("synthetic string #" + std::to_string(index));
+    }
+    return m_strings[index];
+  }
+
+  DexAnnotationSet* make_annotation(DexType* type,
+                                    DexAnnotationVisibility viz) {
+    auto aset = new DexAnnotationSet();
+    aset->add_annotation(new DexAnnotation(type, viz));
+    return aset;
+  }
+
+  const SyntheticAppConfig& m_config;
+  Random m_random;
+  std::vector<DexString*> m_strings;
+  DexProto* m_proto;
+  DexProto* m_init_proto;
+  DexType* m_keep_type;
+  DexType* m_marker_type;
+  std::vector<Interface> m_interfaces;
+  std::vector<DexMethod*> m_statics;
+  // names of the virtual methods of each class, inherited ones included
+  std::unordered_map<const DexType*, std::unordered_set<const DexString*>>
+      m_virtuals;
+  DexClasses m_classes;
+};
+
+template <typename T>
+size_t count_new(const std::vector<T*>& refs,
+                 const std::unordered_set<T*>& seen) {
+  std::unordered_set<T*> fresh;
+  for (auto ref : refs) {
+    if (!seen.count(ref)) {
+      fresh.insert(ref);
+    }
+  }
+  return fresh.size();
+}
+
+}
+
+DexClasses make_synthetic_app(const SyntheticAppConfig& config) {
+  return Generator(config).generate();
+}
+
+std::vector<DexClasses> split_into_dexes(const DexClasses& classes) {
+  std::vector<DexClasses> dexes(1);
+  std::unordered_set<DexMethod*> methods;
+  std::unordered_set<DexField*> fields;
+  std::unordered_set<DexType*> types;
+  for (auto cls : classes) {
+    std::vector<DexMethod*> cls_methods;
+    std::vector<DexField*> cls_fields;
+    std::vector<DexType*> cls_types;
+    cls->gather_methods(cls_methods);
+    cls->gather_fields(cls_fields);
+    cls->gather_types(cls_types);
+    if (!dexes.back().empty() &&
+        (methods.size() + count_new(cls_methods, methods) > kRefLimit ||
+         fields.size() + count_new(cls_fields, fields) > kRefLimit ||
+         types.size() + count_new(cls_types, types) > kRefLimit)) {
+      dexes.emplace_back();
+      methods.clear();
+      fields.clear();
+      types.clear();
+    }
+    methods.insert(cls_methods.begin(), cls_methods.end());
+    fields.insert(cls_fields.begin(), cls_fields.end());
+    types.insert(cls_types.begin(), cls_types.end());
+    dexes.back().push_back(cls);
+  }
+  return dexes;
+}
+
+std::string make_proguard_config(const SyntheticAppConfig& config) {
+  std::ostringstream out;
+  out << "# Synthetic app: " << config.num_classes << " classes, seed "
+      << config.seed << "\n"
+      << "-keep class com.facebook.redex.synth.p0.** { *; }\n";
+  if (config.num_interfaces > 0) {
+    out << "-keep class * implements com.facebook.redex.synth.api.I0 {\n"
+        << "  public <methods>;\n"
+        << "}\n";
+  }
+  out << "-keep @com.facebook.redex.synth.Marker class *\n"
+      << "-keepclassmembers class * {\n"
+      << "  @com.facebook.redex.synth.Keep *;\n"
+      << "}\n"
+      << "-keepclassmembers class com.facebook.redex.synth.p1.** {\n"
+      << "  public static int s*(int);\n"
+      << "}\n";
+  return out.str();
+}
+
+std::vector<std::string> write_synthetic_app(const SyntheticAppConfig& config,
+                                             const std::string& out_dir) {
+  auto dexes = split_into_dexes(make_synthetic_app(config));
+  Json::Value json(Json::objectValue);
+  ConfigFiles cfg(json);
+  std::unique_ptr<PositionMapper> pos_mapper(PositionMapper::make("", ""));
+  std::vector<std::string> paths;
+  for (size_t i = 0; i < dexes.size(); ++i) {
+    auto path = out_dir + "/classes" + (i > 0 ? std::to_string(i + 1) : "") +
+                ".dex";
+    write_classes_to_dex(path,
+                         &dexes[i],
+                         nullptr /* LocatorIndex* */,
+                         i,
+                         cfg,
+                         json,
+                         pos_mapper.get());
+    paths.push_back(path);
+  }
+  std::ofstream pro(out_dir + "/proguard.pro");
+  always_assert_log(pro, "Can't write %s/proguard.pro\n", out_dir.c_str());
+  pro << make_proguard_config(config);
+  return paths;
+}
@@ -0,0 +1,68 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree. An additional grant
+ * of patent rights can be found in the PATENTS file in the same directory.
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "DexClass.h"
+
+/**
+ * Knobs for a synthetic app. The same config and seed always produce the
+ * same classes, so generated apps can be used for benchmarks and scaling
+ * tests without checking large binaries in.
+ */
+struct SyntheticAppConfig {
+  size_t num_classes{1000};
+  // Maximum length of a superclass chain below java.lang.Object.
+  size_t hierarchy_depth{4};
+  // Number of direct subclasses of each non-leaf class.
+  size_t fan_out{3};
+  // Number of interfaces, and the fraction of classes implementing one.
+  size_t num_interfaces{50};
+  double interface_density{0.2};
+  // Methods per class, excluding the constructor.
+  size_t methods_per_class{8};
+  // Method sizes in instructions follow a log-normal distribution around the
+  // median, capped at the maximum.
+  size_t median_method_size{24};
+  size_t max_method_size{1000};
+  // Number of distinct string literals shared by all methods.
+  size_t string_pool_size{10000};
+  // Fraction of classes and of methods carrying an annotation.
+  double annotation_density{0.1};
+  uint32_t seed{1};
+};
+
+/**
+ * Create the classes of a synthetic app in g_redex, with ballooned code.
+ * Interfaces come first, and every superclass precedes its subclasses.
+ */
+DexClasses make_synthetic_app(const SyntheticAppConfig& config);
+
+/**
+ * Split classes into dexes that fit the 64k method, field and type reference
+ * limits, keeping their order.
+ */
+std::vector<DexClasses> split_into_dexes(const DexClasses& classes);
+
+/**
+ * A ProGuard configuration whose rules match the generated app: the first
+ * package, implementors of the first interface, annotated classes and members
+ * and the static helpers are kept.
+ */
+std::string make_proguard_config(const SyntheticAppConfig& config);
+
+/**
+ * Generate the app in g_redex and write it to out_dir as classes.dex,
+ * classes2.dex, ... plus proguard.pro. Returns the paths of the dexes.
+ */
+std::vector<std::string> write_synthetic_app(const SyntheticAppConfig& config,
+                                             const std::string& out_dir);
@@ -144,8 +144,8 @@ DexStoresVector Tool::init(
   Json::Value config;
   redex::ProguardConfiguration pg_config;
   // TODO: Need to get this from a redex .config file
-  std::unordered_set<DexType*> no_optimizations_anno;
-  init_reachable_classes(scope, config, pg_config, no_optimizations_anno);
+  ConfigFiles cfg(config);
+  init_reachable_classes(scope, config, pg_config, cfg);
 
   return stores;
 }